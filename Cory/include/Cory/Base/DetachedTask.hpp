@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cppcoro/coroutine.hpp>
+
+#include <exception>
+
+namespace Cory {
+
+/**
+ * Return type for a coroutine that starts right away and cleans up after itself - nobody can
+ * wait for it. Used to run work on a thread pool in a fire-and-forget manner, the coroutine has
+ * to signal its completion itself. Exceptions must not escape the coroutine.
+ */
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() noexcept { return {}; }
+        cppcoro::suspend_never initial_suspend() noexcept { return {}; }
+        cppcoro::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+} // namespace Cory
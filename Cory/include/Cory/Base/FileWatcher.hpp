@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Cory/Base/Common.hpp>
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace Cory {
+
+/**
+ * Watches a set of files for modifications.
+ *
+ * On Linux, the directories containing the files are watched with inotify, so that files that
+ * are replaced by an editor (written to a temporary file and renamed) are picked up as well. On
+ * other platforms, the modification times of the files are compared on every poll().
+ *
+ * Files are identified by their canonical path.
+ */
+class FileWatcher : NoCopy {
+  public:
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(FileWatcher &&) = default;
+    FileWatcher &operator=(FileWatcher &&) = default;
+
+    /// start watching @a file - does nothing if the file is already watched
+    void watch(const std::filesystem::path &file);
+    [[nodiscard]] bool isWatched(const std::filesystem::path &file) const;
+    /// the number of watched files
+    [[nodiscard]] size_t size() const;
+
+    /// the watched files that were modified since the last call - never blocks
+    [[nodiscard]] std::vector<std::filesystem::path> poll();
+
+  private:
+    std::unique_ptr<struct FileWatcherPrivate> data_;
+};
+
+} // namespace Cory
@@ -5,6 +5,7 @@
 #include <cstdint>
 #include <iterator>
 #include <map>
+#include <mutex>
 #include <numeric>
 #include <string>
 #include <string_view>
@@ -73,9 +74,15 @@ class Profiler {
   public:
     using Record = ProfilerRecord<128>;
     static void PushCounter(std::string &name, int64_t deltaNs);
-    static std::map<std::string, Record> GetRecords() { return s_records; }
+    static std::map<std::string, Record> GetRecords()
+    {
+        const std::lock_guard lock{s_mutex};
+        return s_records;
+    }
 
   private:
+    // counters can be pushed from worker threads, e.g. during parallel command recording
+    static std::mutex s_mutex;
     static std::map<std::string, Record> s_records;
 };
 
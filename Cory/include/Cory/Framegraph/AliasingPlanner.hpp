@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Cory {
+
+/**
+ * @brief the lifetime of a transient resource within a frame
+ *
+ * Expressed as the (inclusive) range of indices into the resolved task execution order in which
+ * the resource is accessed.
+ */
+struct ResourceLifetime {
+    static constexpr uint32_t END_OF_FRAME{0xFFFFFFFF};
+
+    uint32_t firstUse{0};
+    uint32_t lastUse{END_OF_FRAME};
+
+    [[nodiscard]] bool overlaps(const ResourceLifetime &rhs) const
+    {
+        return firstUse <= rhs.lastUse && rhs.firstUse <= lastUse;
+    }
+    auto operator<=>(const ResourceLifetime &) const = default;
+};
+
+/// a single resource that should be placed in an aliased memory heap
+struct AliasingRequest {
+    ResourceLifetime lifetime;
+    uint64_t size{};
+    uint64_t alignment{1};
+};
+
+/// the result of planMemoryAliasing, all vectors are indexed like the request span
+struct AliasingPlan {
+    /// the offset of each resource in the shared heap
+    std::vector<uint64_t> offsets;
+    /// for each resource, the resources that occupied (parts of) the same memory before it. these
+    /// need to be synchronized with before the resource is first used.
+    std::vector<std::vector<uint32_t>> predecessors;
+    /// the total size that the shared heap needs to have
+    uint64_t heapSize{};
+};
+
+/**
+ * @brief place resources into a single heap so that resources with disjoint lifetimes share memory
+ *
+ * Greedy placement: resources are placed in order of decreasing size at the lowest (aligned)
+ * offset that does not collide with an already placed resource that is alive at the same time.
+ */
+[[nodiscard]] AliasingPlan planMemoryAliasing(std::span<const AliasingRequest> requests);
+
+} // namespace Cory
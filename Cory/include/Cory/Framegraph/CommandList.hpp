@@ -20,6 +20,8 @@ class CommandList : NoCopy {
     Magnum::Vk::CommandBuffer *operator->() { return cmdBuffer_; };
 
     CommandList &beginRenderPass(PipelineHandle pipelineHandle, const VkRenderingInfo *renderingInfo);
+    /// begin rendering without binding a pipeline
+    CommandList &beginRenderPass(const VkRenderingInfo *renderingInfo);
     CommandList &endPass();
 
   private:
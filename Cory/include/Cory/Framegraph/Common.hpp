@@ -13,6 +13,7 @@ struct RenderTaskExecutionAwaiter;
 class Framegraph;
 class RenderTaskBuilder;
 class TextureManager;
+class TransientTexturePool;
 class CommandList;
 class FramegraphVisualizer;
 
@@ -57,13 +58,56 @@ struct TextureInfo {
     glm::u32vec3 size;
     Magnum::Vk::PixelFormat format;
     int32_t sampleCount{1};
+    uint32_t mipLevels{1};
+    uint32_t arrayLayers{1};
 };
 
+/// the state of a texture - for textures with several mip levels or array layers, the state of
+/// mip level 0 / array layer 0, see TextureManager::lastAccess()
 struct TextureState {
     Sync::AccessType lastAccess{Sync::AccessType::None};
     TextureMemoryStatus status{TextureMemoryStatus::Virtual};
 };
 
+/// a range of mip levels and array layers of a texture - the whole texture by default
+struct SubresourceRange {
+    static constexpr uint32_t REMAINING{~0U};
+
+    uint32_t baseMipLevel{0};
+    uint32_t levelCount{REMAINING};
+    uint32_t baseArrayLayer{0};
+    uint32_t layerCount{REMAINING};
+
+    /// a single mip level of all array layers
+    static constexpr SubresourceRange mip(uint32_t level)
+    {
+        return SubresourceRange{.baseMipLevel = level, .levelCount = 1};
+    }
+    /// all mip levels of a single array layer
+    static constexpr SubresourceRange layer(uint32_t layer)
+    {
+        return SubresourceRange{.baseArrayLayer = layer, .layerCount = 1};
+    }
+    /// a single mip level of a single array layer
+    static constexpr SubresourceRange single(uint32_t level, uint32_t layer)
+    {
+        return SubresourceRange{
+            .baseMipLevel = level, .levelCount = 1, .baseArrayLayer = layer, .layerCount = 1};
+    }
+
+    /// resolve REMAINING against the mip levels and array layers of @a info
+    [[nodiscard]] constexpr SubresourceRange clamped(const TextureInfo &info) const
+    {
+        return SubresourceRange{
+            .baseMipLevel = baseMipLevel,
+            .levelCount = levelCount == REMAINING ? info.mipLevels - baseMipLevel : levelCount,
+            .baseArrayLayer = baseArrayLayer,
+            .layerCount = layerCount == REMAINING ? info.arrayLayers - baseArrayLayer : layerCount};
+    }
+
+    bool operator==(const SubresourceRange &) const = default;
+};
+
 using TextureHandle = PrivateTypedHandle<TextureInfo, const TextureManager>;
 class TransientTextureHandle {
   public:
@@ -99,6 +143,54 @@ class TransientTextureHandle {
 };
 using MutableTextureHandle = PrivateTypedHandle<TextureInfo, TextureManager>;
 
+struct BufferInfo {
+    std::string name;
+    uint64_t size{};
+    BufferUsage usage{};
+};
+
+struct BufferState {
+    Sync::AccessType lastAccess{Sync::AccessType::None};
+    TextureMemoryStatus status{TextureMemoryStatus::Virtual};
+};
+
+/// a transient buffer of the framegraph - not to be confused with BufferHandle of the
+/// ResourceManager, see TextureManager::buffer()
+using BufferResourceHandle = PrivateTypedHandle<BufferInfo, const TextureManager>;
+/// versioned handle to a transient buffer, analogous to TransientTextureHandle
+class TransientBufferHandle {
+  public:
+    TransientBufferHandle() = default;
+    /* implicit */ TransientBufferHandle(NullHandle_t null)
+        : buffer_{null}
+    {
+    }
+    TransientBufferHandle(BufferResourceHandle buffer)
+        : buffer_{buffer}
+        , version_{0} {};
+
+    TransientBufferHandle operator+(uint32_t inc)
+    {
+        return TransientBufferHandle{buffer_, version_ + inc};
+    }
+
+    // implicit conversion to the handle it wraps
+    operator BufferResourceHandle() const { return buffer_; }
+
+    BufferResourceHandle buffer() const { return buffer_; }
+    uint32_t version() const { return version_; }
+
+    auto operator<=>(const TransientBufferHandle &) const = default;
+    explicit operator bool() const { return buffer_.valid() && version_ != 0xFFFFFFFF; }
+
+  private:
+    TransientBufferHandle(BufferResourceHandle buffer, uint32_t version)
+        : buffer_{buffer}
+        , version_{version} {};
+    BufferResourceHandle buffer_{};
+    uint32_t version_{0xFFFFFFFF};
+};
+
 } // namespace Cory
 
 /// make SlotMapHandle hashable
@@ -107,4 +199,10 @@ template <> struct std::hash<Cory::TransientTextureHandle> {
     {
         return Cory::hashCompose(s.version(), s.texture());
     }
+};
+template <> struct std::hash<Cory::TransientBufferHandle> {
+    std::size_t operator()(const Cory::TransientBufferHandle &s) const noexcept
+    {
+        return Cory::hashCompose(s.version(), s.buffer());
+    }
 };
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <Cory/Base/Common.hpp>
 #include <Cory/Base/FmtUtils.hpp>
+#include <Cory/Framegraph/AliasingPlanner.hpp>
 #include <Cory/Framegraph/Common.hpp>
 #include <Cory/Framegraph/RenderTaskBuilder.hpp>
 
@@ -11,6 +12,7 @@
 
 #include <concepts>
 #include <set>
+#include <span>
 #include <string_view>
 #include <unordered_map>
 
@@ -23,10 +25,43 @@ struct ExecutionInfo {
         TransientTextureHandle resource;
         Sync::AccessType stateBefore;
         Sync::AccessType stateAfter;
+        /// whether no barrier of its own was needed, e.g. for a read after a read of the same kind
+        bool elided{false};
+        /// whether the barrier is split: released by an event after the producing level, and
+        /// acquired right before this task
+        bool split{false};
+        /// whether the barrier acquires the texture from the queue family of the async compute
+        /// queue
+        bool queueTransfer{false};
+    };
+    /// like TransitionInfo, for transient buffers - buffer barriers are never split
+    struct BufferTransitionInfo {
+        TaskDependencyKind kind;
+        RenderTaskHandle task;
+        TransientBufferHandle resource;
+        Sync::AccessType stateBefore;
+        Sync::AccessType stateAfter;
+        bool elided{false};
+        bool queueTransfer{false};
     };
     std::vector<RenderTaskHandle> tasks;
     std::vector<TextureHandle> resources;
+    /// the lifetime of each entry in @a resources, in terms of indices into @a tasks
+    std::vector<ResourceLifetime> lifetimes;
+    /// the transient buffers used by @a tasks, and their lifetimes
+    std::vector<BufferResourceHandle> buffers;
+    std::vector<ResourceLifetime> bufferLifetimes;
+    /// the dependency level of each entry in @a tasks - tasks in the same level don't depend on
+    /// each other and are recorded together (not filled by dryRun()). async compute tasks are
+    /// not part of any level and are always assigned level 0
+    std::vector<uint32_t> levels;
+    /// whether each entry in @a tasks runs on the async compute queue (not filled by dryRun())
+    std::vector<bool> asyncCompute;
     std::vector<TransitionInfo> transitions;
+    std::vector<BufferTransitionInfo> bufferTransitions;
+    /// whether the graph was structurally identical to a previous one and its compiled form was
+    /// reused instead of resolving it again
+    bool cacheHit{false};
 };
 
 /**
@@ -37,6 +72,14 @@ struct ExecutionInfo {
 class Framegraph : NoCopy {
   public:
     explicit Framegraph(Context &ctx);
+    /**
+     * @brief create a framegraph that allocates its transient textures from a shared pool
+     *
+     * Pass the same @a pool to the framegraphs of all frames in flight, so transient resources
+     * can be reused across frames instead of being recreated every frame. The owner of the pool
+     * has to call TransientTexturePool::collectGarbage() once per frame.
+     */
+    Framegraph(Context &ctx, std::shared_ptr<TransientTexturePool> pool);
     ~Framegraph();
 
     Framegraph(Framegraph &&) noexcept;
@@ -46,14 +89,34 @@ class Framegraph : NoCopy {
      * @brief record the commands from all render tasks into the given command buffer
      *
      * Note that this can be only called once. It will cause all relevant render tasks to execute.
+     *
+     * Tasks are recorded level by level, with one barrier at the start of each level (if any
+     * texture needs to be synchronized at all). Tasks in a
+     * level that allow it (see RenderTaskBuilder::allowParallelRecording()) are recorded into
+     * secondary command buffers on the context's worker pool, which are then executed from the
+     * primary command buffer in the resolved order.
+     *
+     * Async compute tasks (see RenderTaskBuilder::runOnAsyncCompute()) are recorded into a
+     * separate command buffer that is submitted to the compute queue right away. If the graphics
+     * work depends on them, @a frameCtx.asyncComputeDone is set to a semaphore that the
+     * submission of @a frameCtx.commandBuffer needs to wait on.
      */
     ExecutionInfo record(FrameContext& frameCtx);
 
+    /**
+     * @brief resolve the declared graph without allocating resources or recording any commands
+     *
+     * Always performs a full resolve, bypassing the compiled graph cache - mainly useful for
+     * debugging and benchmarking.
+     */
+    [[nodiscard]] ExecutionInfo dryRun();
+
     /**
      * @brief immediately retire all resources allocated by the framegraph
      *
      * should be called only when it can be ensured that all resources are no longer in use, e.g.
-     * for example when the next frame with the same swapchain image has been rendered.
+     * for example when the next frame with the same swapchain image has been rendered. Waits
+     * for the async compute work of the frame to finish.
      */
     void resetForNextFrame();
 
@@ -93,16 +156,80 @@ class Framegraph : NoCopy {
     /**
      * @brief resolve which render tasks need to be executed for requested resources
      *
-     * Returns the tasks that need to be executed in the given order, and all resources that
-     * are required to execute said resources.
+     * Returns the tasks that need to be executed in the given order, and all textures and
+     * buffers that are required to execute said tasks.
      * Updates the internal information about which render pass is required.
      */
     [[nodiscard]] ExecutionInfo
     resolve(const std::vector<TransientTextureHandle> &requestedResources);
 
+    /**
+     * @brief resolve the graph and allocate its resources
+     *
+     * The resolved graph is cached based on the structure of the declared graph (tasks, their
+     * dependencies, texture infos and the previous accesses of the inputs). If a structurally
+     * identical graph is declared in a later frame, the cached result is reused: resolve(),
+     * planTextureUsage(), computeLevels() and planRecording() are skipped, and only the images
+     * and buffers of the planned barriers are replaced by the ones of the current frame.
+     */
     [[nodiscard]] ExecutionInfo compile();
-    [[nodiscard]] std::vector<ExecutionInfo::TransitionInfo> executePass(CommandList &cmd,
-                                                                         RenderTaskHandle handle);
+    /**
+     * @brief decide which tasks in @a execInfo run on the async compute queue
+     *
+     * Only compute -> graphics dependencies are synchronized, so a task that asks for async
+     * compute runs on the graphics queue if it accesses a texture that the graphics queue has
+     * accessed before, that is not created by an async task, or that is an output of the graph.
+     */
+    void assignQueues(ExecutionInfo &execInfo) const;
+    /**
+     * @brief determine how the textures in @a execInfo are used
+     *
+     * Accumulates the image usage each texture needs from all of its accesses, and marks the
+     * texture versions that are read by a task or are an output of the graph as consumed, so
+     * render passes can drop the stores of all other attachments. Textures that are only accessed
+     * as attachments and never consumed don't need any memory. Needs to be called before
+     * allocation.
+     */
+    void planTextureUsage(const ExecutionInfo &execInfo);
+    /// determine the lifetimes of all textures and buffers in @a execInfo and deduplicate them
+    void computeLifetimes(ExecutionInfo &execInfo) const;
+    /**
+     * @brief assign each task in @a execInfo to a dependency level
+     *
+     * A task is placed in a later level than all tasks it has a hazard with: writes to the same
+     * texture, reads of a texture it writes, reads that need a different image layout, and
+     * accesses to textures that share memory with it. Needs to be called after allocation.
+     */
+    void computeLevels(ExecutionInfo &execInfo) const;
+    /**
+     * @brief group the tasks by level and plan the barriers of each level
+     *
+     * Simulates the accesses to all textures to drop barriers that are not needed (e.g. reads
+     * after reads with the same access), and merges the barriers of a level into a single
+     * barrier. When independent levels lie between the accesses that a barrier synchronizes,
+     * the barrier is split: an event is set after the level of the earlier accesses, and waited
+     * on before the later ones, so the GPU can overlap the work in between with the
+     * synchronization. Async compute tasks get a barrier of their own each, and textures they
+     * hand over to the graphics queue are transferred to its queue family if needed. Buffers are
+     * synchronized the same way, except that their barriers are never split. Each mip level and
+     * array layer of a texture is simulated separately, and only the subresources a task
+     * accesses are synchronized - neighbouring subresources with the same barrier are merged
+     * into one. Fills @a execInfo.transitions and @a execInfo.bufferTransitions.
+     */
+    void planRecording(ExecutionInfo &execInfo);
+    /// record the barriers and tasks of a dependency level, as planned by planRecording()
+    void recordLevel(CommandList &cmd, const ExecutionInfo &execInfo, uint32_t levelIdx);
+    /// record the @a parallelTasks of a @a level on worker threads into secondary command buffers
+    void recordParallel(CommandList &cmd,
+                        const ExecutionInfo &execInfo,
+                        std::span<const uint32_t> level,
+                        std::span<const std::pair<size_t, RenderTaskHandle>> parallelTasks);
+    /// record the async compute tasks into their own command buffer and submit it
+    void recordAsyncCompute(const ExecutionInfo &execInfo, FrameContext &frameCtx);
+    /// the barriers that a split barrier event is set and waited on with
+    [[nodiscard]] Sync::EventDependency eventDependency(uint32_t eventIdx);
+    /// resume the task coroutine to record its commands into @a cmd
+    void executeTask(CommandList &cmd, RenderTaskHandle handle);
 
     [[nodiscard]] cppcoro::generator<std::pair<RenderTaskHandle, const RenderTaskInfo &>>
     renderTasks() const;
@@ -46,13 +46,24 @@ struct RenderTaskInfo {
         TaskDependencyKind kind;
         TransientTextureHandle handle;
         Sync::AccessType access;
+        /// the mip levels and array layers that are accessed
+        SubresourceRange range{};
+    };
+    struct BufferDependency {
+        TaskDependencyKind kind;
+        TransientBufferHandle handle;
+        Sync::AccessType access;
     };
     std::string name;
     std::vector<Dependency> dependencies;
+    std::vector<BufferDependency> bufferDependencies;
+    bool parallelRecording{false}; ///< see RenderTaskBuilder::allowParallelRecording()
+    bool asyncCompute{false};      ///< see RenderTaskBuilder::runOnAsyncCompute()
 
     // framegraph internal stuff
     cppcoro::coroutine_handle<> coroHandle;
     int32_t executionPriority{-1}; ///< assigned when the render graph is resolved
+    CommandList *commandList{};    ///< the command list the task records into, set in record()
 };
 
 /**
@@ -74,16 +85,76 @@ class RenderTaskBuilder : NoCopy {
     TransientTextureHandle
     create(std::string name, glm::u32vec3 size, PixelFormat format, Sync::AccessType writeAccess);
 
-    /// declares a dependency to the named resource
-    TextureInfo read(TransientTextureHandle &h, Sync::AccessType readAccess);
+    /**
+     * @brief declare that a render pass creates a texture with several mip levels or array layers
+     *
+     * Only the subresources in @a range are written by the task, the contents of all others are
+     * undefined until another task writes them. The framegraph tracks the state of each mip level
+     * and array layer separately, so e.g. a downsampling chain only synchronizes the levels each
+     * task touches.
+     */
+    TransientTextureHandle
+    create(TextureInfo info, Sync::AccessType writeAccess, SubresourceRange range = {});
+
+    /// declares a dependency to the named resource, or to the given mip levels and array layers
+    TextureInfo
+    read(TransientTextureHandle &h, Sync::AccessType readAccess, SubresourceRange range = {});
 
-    /// declare that a render task writes to a certain texture
-    std::pair<TransientTextureHandle, TextureInfo> write(TransientTextureHandle handle,
-                                                         Sync::AccessType writeAccess);
+    /// declare that a render task writes to a certain texture (or some of its subresources)
+    std::pair<TransientTextureHandle, TextureInfo>
+    write(TransientTextureHandle handle, Sync::AccessType writeAccess, SubresourceRange range = {});
 
-    /// declare that a render task reads from and writes to a certain texture
+    /// declare that a render task reads from and writes to a certain texture (or some of its
+    /// subresources)
     std::pair<TransientTextureHandle, TextureInfo> readWrite(TransientTextureHandle handle,
-                                                             Sync::AccessType readWriteAccess);
+                                                             Sync::AccessType readWriteAccess,
+                                                             SubresourceRange range = {});
+
+    /**
+     * @brief declare that a render task creates a transient buffer
+     *
+     * Transient buffers live for a single frame, just like transient textures. They are placed
+     * in pooled memory and may alias other transient buffers whose lifetime does not overlap.
+     * The contents of a buffer are undefined when it is created.
+     */
+    TransientBufferHandle createBuffer(std::string name,
+                                       uint64_t size,
+                                       BufferUsage usage,
+                                       Sync::AccessType writeAccess);
+
+    /// declares a dependency to a transient buffer
+    BufferInfo read(TransientBufferHandle &h, Sync::AccessType readAccess);
+
+    /// declare that a render task writes to a transient buffer
+    std::pair<TransientBufferHandle, BufferInfo> write(TransientBufferHandle handle,
+                                                       Sync::AccessType writeAccess);
+
+    /// declare that a render task reads from and writes to a transient buffer
+    std::pair<TransientBufferHandle, BufferInfo> readWrite(TransientBufferHandle handle,
+                                                           Sync::AccessType readWriteAccess);
+
+    /**
+     * @brief allow the commands of this render task to be recorded on a worker thread
+     *
+     * Tasks that do not depend on each other are recorded in parallel, each into its own secondary
+     * command buffer. While recording, such a task must not modify shared state (e.g. write
+     * descriptor sets or create resources), and cannot rely on command buffer state that was set
+     * up outside of the task.
+     */
+    RenderTaskBuilder &allowParallelRecording();
+
+    /**
+     * @brief run this render task on the async compute queue
+     *
+     * The task is recorded into a separate command buffer that is submitted to
+     * Context::computeQueue(), so it can overlap with the graphics work of the frame. It may only
+     * use compute commands. Tasks that cannot run asynchronously are executed on the graphics
+     * queue instead: the framegraph only synchronizes async compute -> graphics dependencies, so
+     * an async task may only access textures that it creates itself or that are created by
+     * another async task and not yet accessed by the graphics queue (and are not an output of
+     * the graph).
+     */
+    RenderTaskBuilder &runOnAsyncCompute();
 
     /**
      * Declares a render pass with a default pipeline setup
@@ -107,6 +178,9 @@ class RenderTaskBuilder : NoCopy {
     const std::string &name() const { return info_.name; }
 
   private:
+    /// make sure that @a range lies within the texture described by @a info
+    void checkRange(const TextureInfo &info, SubresourceRange range) const;
+
     Context &ctx_;
     RenderTaskInfo info_;
     Framegraph &framegraph_;
@@ -1,12 +1,16 @@
 #pragma once
 
 #include <Cory/Base/SlotMap.hpp>
+#include <Cory/Framegraph/AliasingPlanner.hpp>
 #include <Cory/Framegraph/Common.hpp>
 
 #include <glm/vec3.hpp>
 
 #include <cstdint>
+#include <memory>
+#include <span>
 #include <string>
+#include <vector>
 
 namespace Cory {
 
@@ -23,12 +27,25 @@ namespace Cory {
  *  - Currently always creates an Image and corresponding ImageView, even
  *    though technically creating an ImageView and sampler could be avoided
  *    by having the knowledge from the framegraph how the texture will be used
- *  - Currently, allocates each Image separately - technically, could use an
- *    GPU arena for this
+ *  - All transient images of a frame are placed in one device-local heap (per memory type).
+ *    Textures whose lifetimes in the frame don't overlap share the same memory, see
+ *    @a planMemoryAliasing(). The framegraph synchronizes the first access to an aliased texture
+ *    with the last accesses of the textures that previously occupied its memory.
+ *  - Heaps, images and external image wrappers are not destroyed in @a clear() but returned to a
+ *    @a TransientTexturePool, so they can be reused in subsequent frames
+ *  - Transient buffers are handled just like textures, but are placed in heaps of their own so
+ *    they never share memory with images (which would have to respect bufferImageGranularity)
+ *  - The last access is tracked per mip level and array layer, textures with more than one
+ *    subresource get an additional image view per subresource
  */
 class TextureManager : NoCopy {
   public:
+    /// create a texture manager with its own, private @a TransientTexturePool, which is advanced
+    /// in clear()
     explicit TextureManager(Context &ctx);
+    /// create a texture manager that shares the given @a pool with other texture managers - the
+    /// owner of the pool has to call TransientTexturePool::collectGarbage() once per frame
+    TextureManager(Context &ctx, std::shared_ptr<TransientTexturePool> pool);
     ~TextureManager();
 
     TextureManager(TextureManager &&);
@@ -41,29 +58,123 @@ class TextureManager : NoCopy {
                                    Magnum::Vk::Image &resource,
                                    Magnum::Vk::ImageView &resourceView);
 
-    void allocate(const std::vector<TextureHandle> &handles);
+    BufferResourceHandle declareBuffer(BufferInfo info);
 
     /**
-     * @brief create a synchronization barrier object to sync subsequent reads
+     * @brief allocate memory for all virtual textures in @a handles
+     * @param lifetimes the lifetime of each texture in @a handles within the frame - used to
+     *        alias the memory of textures that are not alive at the same time
+     */
+    void allocate(const std::vector<TextureHandle> &handles,
+                  const std::vector<ResourceLifetime> &lifetimes);
+    /// allocate memory for all virtual buffers in @a handles, see above
+    void allocate(const std::vector<BufferResourceHandle> &handles,
+                  const std::vector<ResourceLifetime> &lifetimes);
+
+    /**
+     * @brief create a synchronization barrier object for accesses to a texture
      * @param handle the handle to synchronize
-     * @param access the access type
+     * @param range the mip levels and array layers to synchronize
+     * @param prevAccesses the accesses that have to be finished before @a nextAccesses
+     * @param nextAccesses the accesses to synchronize - need to have the same image layout
      * @param contentsMode whether the previous contents should be retained or discarded when
      *        accessing the texture - choose ImageContents::Discard if you overwrite the contents
+     * @param srcQueueFamily, dstQueueFamily the queue families to transfer the ownership of the
+     *        texture between, VK_QUEUE_FAMILY_IGNORED if it stays on the same queue
+     *
+     * Does not modify the state of the texture, see @a setLastAccess(). The @a Framegraph plans
+     * all barriers of a frame up front, taking into account aliased memory and redundant
+     * barriers.
+     */
+    [[nodiscard]] Sync::ImageBarrier
+    barrier(TextureHandle handle,
+            SubresourceRange range,
+            std::span<const Sync::AccessType> prevAccesses,
+            std::span<const Sync::AccessType> nextAccesses,
+            ImageContents contentsMode,
+            uint32_t srcQueueFamily = VK_QUEUE_FAMILY_IGNORED,
+            uint32_t dstQueueFamily = VK_QUEUE_FAMILY_IGNORED) const;
+
+    /// create a synchronization barrier object for accesses to a buffer, see above
+    [[nodiscard]] Sync::BufferBarrier
+    barrier(BufferResourceHandle handle,
+            std::span<const Sync::AccessType> prevAccesses,
+            std::span<const Sync::AccessType> nextAccesses,
+            uint32_t srcQueueFamily = VK_QUEUE_FAMILY_IGNORED,
+            uint32_t dstQueueFamily = VK_QUEUE_FAMILY_IGNORED) const;
+
+    /**
+     * @brief record that the contents of a texture version are read after they have been written
+     *
+     * Called by the @a Framegraph for the graph of the current frame. Render passes don't store
+     * attachments whose contents are not consumed, see TransientRenderPassBuilder::attach().
+     */
+    void markConsumed(TransientTextureHandle handle);
+    [[nodiscard]] bool consumed(TransientTextureHandle handle) const;
+    /// all versions of a texture that have been marked as consumed
+    [[nodiscard]] std::span<const uint32_t> consumedVersions(TextureHandle handle) const;
+
+    /**
+     * @brief declare that a texture does not need to be backed by memory
+     *
+     * For textures that are only used as attachments within render passes, and whose contents
+     * are never consumed. Needs to be called before @a allocate(), which creates the image as a
+     * transient attachment in lazily allocated memory (if the device has any).
+     */
+    void setMemoryless(TextureHandle handle);
+    [[nodiscard]] bool memoryless(TextureHandle handle) const;
+
+    /**
+     * @brief add to the image usage flags a texture needs to be created with
      *
-     * Will store the given @a access to sync subsequent accesses to the texture
+     * Called by the @a Framegraph with the usages derived from all accesses to the texture in the
+     * graph of the current frame. Needs to be called before @a allocate(), which creates the
+     * image with exactly the accumulated usage.
      */
-    Sync::ImageBarrier
-    synchronizeTexture(TextureHandle handle, Sync::AccessType access, ImageContents contentsMode);
+    void addUsage(TextureHandle handle, VkImageUsageFlags usage);
+    [[nodiscard]] VkImageUsageFlags usage(TextureHandle handle) const;
+
+    /// store the access with which (some subresources of) a texture have been synchronized most
+    /// recently
+    void setLastAccess(TextureHandle handle, Sync::AccessType access, SubresourceRange range = {});
+    /// store the access with which a buffer has been synchronized most recently
+    void setLastAccess(BufferResourceHandle handle, Sync::AccessType access);
 
     [[nodiscard]] const TextureInfo &info(TextureHandle handle) const;
     [[nodiscard]] ImageHandle image(TextureHandle handle) const;
     [[nodiscard]] ImageViewHandle imageView(TextureHandle handle) const;
+    /// a 2D view of a single mip level and array layer - the same as imageView() for textures
+    /// with a single subresource
+    [[nodiscard]] ImageViewHandle
+    imageView(TextureHandle handle, uint32_t mipLevel, uint32_t arrayLayer) const;
     [[nodiscard]] TextureState state(TextureHandle handle) const;
+    /// the access with which a single mip level and array layer has been synchronized most
+    /// recently
+    [[nodiscard]] Sync::AccessType
+    lastAccess(TextureHandle handle, uint32_t mipLevel, uint32_t arrayLayer) const;
+    /// the textures that occupied the memory of @a handle earlier in the frame
+    [[nodiscard]] const std::vector<TextureHandle> &aliasedPredecessors(TextureHandle handle) const;
+
+    [[nodiscard]] const BufferInfo &info(BufferResourceHandle handle) const;
+    [[nodiscard]] BufferHandle buffer(BufferResourceHandle handle) const;
+    [[nodiscard]] BufferState state(BufferResourceHandle handle) const;
+    /// the buffers that occupied the memory of @a handle earlier in the frame
+    [[nodiscard]] const std::vector<BufferResourceHandle> &
+    aliasedPredecessors(BufferResourceHandle handle) const;
+
+    /**
+     * @brief a dense index for the texture or buffer in [0, indexCapacity())
+     *
+     * Textures and buffers share the same index space, e.g. to build flat lookup tables for all
+     * resources of a frame. Indices of buffers change when more textures are declared.
+     */
+    [[nodiscard]] uint32_t index(TextureHandle handle) const;
+    [[nodiscard]] uint32_t index(BufferResourceHandle handle) const;
+    [[nodiscard]] uint32_t indexCapacity() const;
 
     void clear();
 
   private:
-    void allocate(TextureHandle handle);
     std::unique_ptr<struct TextureManagerPrivate> data_;
 };
 
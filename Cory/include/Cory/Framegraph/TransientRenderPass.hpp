@@ -1,7 +1,9 @@
 #pragma once
 
 #include <Cory/Framegraph/Common.hpp>
+#include <Cory/Renderer/PipelineCache.hpp>
 
+#include <optional>
 #include <string_view>
 #include <vector>
 
@@ -18,6 +20,11 @@ struct AttachmentKind {
     VkAttachmentLoadOp loadOp;
     VkAttachmentStoreOp storeOp;
     VkClearValue clearValue;
+    /// whether the ops are inferred from the framegraph, see TransientRenderPassBuilder::attach()
+    bool inferOps{false};
+    /// the mip level and array layer to render to - taken from the dependency of the render task
+    /// on the texture, see TransientRenderPassBuilder::finish()
+    SubresourceRange subresource{};
 };
 
 class TransientRenderPass : NoCopy {
@@ -34,8 +41,12 @@ class TransientRenderPass : NoCopy {
      *  1. Binds a pipeline with the required layout - 
      *  2. Calls CmdBeginRendering with the attachments
      *  3. Set up the dynamic state (Depth test, cull mode, ...) as set up in the builder
+     *
+     * If the pipeline is still compiling in the background and the PipelineCache is set up to
+     * skip such passes, no pipeline is bound and false is returned - the caller should not record
+     * any draws then, but still call end().
      */
-    void begin(CommandList &cmd);
+    bool begin(CommandList &cmd);
 
     void end(CommandList &cmd);
 
@@ -43,8 +54,11 @@ class TransientRenderPass : NoCopy {
     friend class TransientRenderPassBuilder;
     TransientRenderPass(Context &ctx, std::string_view name, TextureManager &textures);
 
+    /// look up (or start compiling) the pipeline - done when the pass is declared, so begin() does
+    /// not create any resources and can be called while recording on a worker thread
+    void createPipeline();
     int32_t determineSampleCount() const;
-    VkRenderingAttachmentInfo makeAttachmentInfo(TextureHandle handle,
+    VkRenderingAttachmentInfo makeAttachmentInfo(TransientTextureHandle handle,
                                                  AttachmentKind attachmentKind);
 
     Context* ctx_;
@@ -52,26 +66,52 @@ class TransientRenderPass : NoCopy {
     TextureManager *textures_;
 
     std::vector<ShaderHandle> shaders_;
-    std::vector<std::pair<TextureHandle, AttachmentKind>> colorAttachments_;
-    std::optional<std::pair<TextureHandle, AttachmentKind>> depthAttachment_;
-    std::optional<std::pair<TextureHandle, AttachmentKind>> stencilAttachment_;
+    std::vector<SpecializationConstant> specialization_;
+    std::vector<std::pair<TransientTextureHandle, AttachmentKind>> colorAttachments_;
+    std::optional<std::pair<TransientTextureHandle, AttachmentKind>> depthAttachment_;
+    std::optional<std::pair<TransientTextureHandle, AttachmentKind>> stencilAttachment_;
 
     DynamicStates dynamicStates_;
     bool hasMeshInput_{true}; // by default, uses the default mesh layout
 
-    PipelineHandle handle_;
+    PipelineFuture pipeline_;
     bool hasBegun_{false}; ///< only needed for diagnostics
     VkRect2D determineRenderArea();
 };
 
 class TransientRenderPassBuilder : NoCopy, NoMove {
   public:
+    /// @a task is the render task that declares the pass - needed to infer the attachment ops
     TransientRenderPassBuilder(Context &ctx,
-                               std::string_view name, TextureManager &textures);
+                               std::string_view name,
+                               TextureManager &textures,
+                               const RenderTaskInfo *task = nullptr);
 
     ~TransientRenderPassBuilder();
 
     TransientRenderPassBuilder &shaders(std::vector<ShaderHandle> shaders);
+    /// set the values of specialization constants of the shaders - each distinct set of values
+    /// creates its own pipeline, but all of them share the compiled shader modules
+    TransientRenderPassBuilder &specialize(std::vector<SpecializationConstant> constants);
+
+    /**
+     * @brief attach a color texture, inferring the load and store ops from the framegraph
+     *
+     * The previous contents are only loaded if the render task reads them (i.e. declared the
+     * texture with RenderTaskBuilder::readWrite()). Otherwise, the attachment is cleared to
+     * @a clearValue, or its contents are left undefined if there is no clear value. The contents
+     * are only stored if a later render task reads them or they are an output of the graph.
+     *
+     * The texture needs to be declared as a dependency of the render task before finish().
+     */
+    TransientRenderPassBuilder &attach(TransientTextureHandle handle,
+                                       std::optional<VkClearColorValue> clearValue = std::nullopt);
+    /// attach a depth texture, inferring the load and store ops - see attach()
+    TransientRenderPassBuilder &attachDepth(TransientTextureHandle handle,
+                                            std::optional<float> clearValue = std::nullopt);
+    /// attach a stencil texture, inferring the load and store ops - see attach()
+    TransientRenderPassBuilder &attachStencil(TransientTextureHandle handle,
+                                              std::optional<uint32_t> clearValue = std::nullopt);
 
     TransientRenderPassBuilder &attach(TransientTextureHandle handle,
                                        VkAttachmentLoadOp loadOp,
@@ -89,10 +129,22 @@ class TransientRenderPassBuilder : NoCopy, NoMove {
     /// create a render pass that does not expect any mesh to be attached
     TransientRenderPassBuilder & disableMeshInput();
 
+    /**
+     * @brief finish the declaration of the render pass
+     *
+     * If the render task declared a single mip level or array layer of an attachment (e.g. with
+     * RenderTaskBuilder::write()), the pass renders to a view of just that subresource.
+     */
     TransientRenderPass finish();
 
   private:
+    /// take the subresource of an attachment from the dependency of the render task on it
+    void inferSubresource(std::pair<TransientTextureHandle, AttachmentKind> &attachment) const;
+    /// determine the load op of an attachment that has been attached with inferred ops
+    void inferLoadOp(std::pair<TransientTextureHandle, AttachmentKind> &attachment) const;
+
     TransientRenderPass renderPass_;
+    const RenderTaskInfo *task_;
 };
 
 } // namespace Cory
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <Cory/Base/Common.hpp>
+#include <Cory/Framegraph/Common.hpp>
+
+#include <glm/vec3.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <utility>
+
+namespace Cory {
+
+/// describes a transient image - images with the same description are interchangeable
+struct TransientImageDesc {
+    glm::u32vec3 size;
+    PixelFormat format;
+    int32_t sampleCount{1};
+    VkImageUsageFlags usage{};
+    uint32_t mipLevels{1};
+    uint32_t arrayLayers{1};
+
+    bool operator==(const TransientImageDesc &) const = default;
+};
+
+/// describes a transient buffer - buffers with the same description are interchangeable
+struct TransientBufferDesc {
+    uint64_t size{};
+    VkBufferUsageFlags usage{};
+
+    bool operator==(const TransientBufferDesc &) const = default;
+};
+
+/// the memory requirements of a transient image or buffer
+struct TransientMemoryRequirements {
+    uint64_t size{};
+    uint64_t alignment{};
+    uint32_t memoryType{};
+};
+
+struct TransientHeap;
+using TransientHeapHandle = PrivateTypedHandle<TransientHeap, TransientTexturePool>;
+
+/**
+ * @brief keeps transient images and buffers and their memory alive across frames
+ *
+ * Shared by the framegraphs of all frames in flight (via their @a TextureManager). Instead of
+ * creating and destroying all transient images and buffers every frame, a @a TextureManager
+ * acquires memory heaps from the pool for the duration of a frame, and looks up the images and
+ * buffers it places into those heaps. In steady state, this means no Vulkan objects are created
+ * or destroyed at all.
+ *
+ * A heap is owned exclusively by one @a TextureManager between @a acquireHeap() and
+ * @a releaseHeap() - images and buffers bound to the heap can therefore never be used by two
+ * frames in flight at the same time.
+ *
+ * Also caches the wrappers for external images (e.g. the swapchain images), so they are not
+ * re-wrapped and re-named every frame.
+ *
+ * Heaps, images, buffers and wrappers that have not been used for @a maxUnusedFrames are
+ * destroyed.
+ */
+class TransientTexturePool : NoCopy {
+  public:
+    static constexpr uint32_t DEFAULT_MAX_UNUSED_FRAMES{8};
+
+    explicit TransientTexturePool(Context &ctx,
+                                  uint32_t maxUnusedFrames = DEFAULT_MAX_UNUSED_FRAMES);
+    ~TransientTexturePool();
+
+    TransientTexturePool(TransientTexturePool &&);
+    TransientTexturePool &operator=(TransientTexturePool &&);
+
+    /// query the memory requirements of an image with the given description (cached)
+    [[nodiscard]] TransientMemoryRequirements memoryRequirements(const TransientImageDesc &desc);
+    /// query the memory requirements of a buffer with the given description (cached)
+    [[nodiscard]] TransientMemoryRequirements memoryRequirements(const TransientBufferDesc &desc);
+
+    /// acquire a heap of at least @a size bytes of the given memory type for exclusive use
+    [[nodiscard]] TransientHeapHandle acquireHeap(uint32_t memoryType, uint64_t size);
+
+    /**
+     * @brief get an image that is bound to @a heap at the given @a offset
+     *
+     * Reuses an image that has been created in a previous frame if possible. An image is handed
+     * out at most once between acquiring and releasing the heap. The @a name is only used when a
+     * new image has to be created.
+     */
+    [[nodiscard]] std::pair<ImageHandle, ImageViewHandle>
+    acquireImage(TransientHeapHandle heap,
+                 const TransientImageDesc &desc,
+                 uint64_t offset,
+                 std::string_view name);
+
+    /**
+     * @brief views of the individual subresources of an image acquired from @a heap
+     *
+     * One 2D view per mip level and array layer, the view of mip level m of layer l is at index
+     * m * arrayLayers + l. Empty for images with a single subresource - use the view returned by
+     * acquireImage() for those.
+     */
+    [[nodiscard]] std::span<const ImageViewHandle> subresourceViews(TransientHeapHandle heap,
+                                                                    ImageHandle image) const;
+
+    /// get a buffer that is bound to @a heap at the given @a offset, see acquireImage()
+    [[nodiscard]] BufferHandle acquireBuffer(TransientHeapHandle heap,
+                                             const TransientBufferDesc &desc,
+                                             uint64_t offset,
+                                             std::string_view name);
+
+    /// return the heap and all images and buffers bound to it to the pool - the GPU must be done
+    /// using them
+    void releaseHeap(TransientHeapHandle heap);
+
+    /// get (cached) wrappers for an external image and view
+    [[nodiscard]] std::pair<ImageHandle, ImageViewHandle>
+    wrapExternal(std::string_view name, Magnum::Vk::Image &image, Magnum::Vk::ImageView &imageView);
+
+    /**
+     * @brief advance the frame counter of the pool, and destroy unused resources
+     *
+     * Has to be called exactly once per frame by the owner of a shared pool, after the frame's
+     * @a TextureManager has been cleared. A @a TextureManager with a private pool calls it
+     * itself.
+     */
+    void collectGarbage();
+
+    /// number of heaps currently held by the pool
+    [[nodiscard]] size_t heapCount() const;
+    /// number of images currently held by the pool
+    [[nodiscard]] size_t imageCount() const;
+    /// number of buffers currently held by the pool
+    [[nodiscard]] size_t bufferCount() const;
+    /// the total memory held by the pool in bytes
+    [[nodiscard]] uint64_t memoryUsage() const;
+
+  private:
+    std::unique_ptr<struct TransientTexturePoolPrivate> data_;
+};
+
+} // namespace Cory
+
+template <> struct std::hash<Cory::TransientImageDesc> {
+    std::size_t operator()(const Cory::TransientImageDesc &d) const noexcept
+    {
+        return Cory::hashCompose(0,
+                                 d.size.x,
+                                 d.size.y,
+                                 d.size.z,
+                                 d.format,
+                                 d.sampleCount,
+                                 d.usage,
+                                 d.mipLevels,
+                                 d.arrayLayers);
+    }
+};
+template <> struct std::hash<Cory::TransientBufferDesc> {
+    std::size_t operator()(const Cory::TransientBufferDesc &d) const noexcept
+    {
+        return Cory::hashCompose(0, d.size, d.usage);
+    }
+};
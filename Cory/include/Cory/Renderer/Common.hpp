@@ -22,7 +22,12 @@ struct ContextCreationInfo;
 class CpuBuffer;
 class RenderManager;
 class Shader;
+class ShaderSource;
 class ResourceManager;
+class PipelineCache;
+class MemoryAllocator;
+class MemoryDefragmenter;
+class ShaderReloader;
 class SingleShotCommandBuffer;
 // Swapchain.hpp
 struct SwapchainSupportDetails;
@@ -108,6 +113,10 @@ struct FrameContext {
     Semaphore *acquired{};
     Semaphore *rendered{};
     Magnum::Vk::CommandBuffer *commandBuffer{};
+    /// signaled by the async compute work of the frame, if the graphics work depends on it - set
+    /// by the Framegraph, the submission of commandBuffer needs to wait on it
+    Semaphore *asyncComputeDone{};
+    VkPipelineStageFlags asyncComputeWaitStages{}; ///< the stages that wait for asyncComputeDone
 };
 
 } // namespace Cory
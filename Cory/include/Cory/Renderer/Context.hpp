@@ -3,16 +3,22 @@
 #include <Cory/Base/Callback.hpp>
 #include <Cory/Base/Common.hpp>
 #include <Cory/Renderer/Common.hpp>
+#include <Cory/Renderer/GpuEvent.hpp>
 #include <Cory/Renderer/Semaphore.hpp>
 #include <Cory/Renderer/VulkanUtils.hpp>
 
 #include <Magnum/Vk/Fence.h>
 
 #include <magic_enum.hpp>
+#include <filesystem>
 #include <memory>
 #include <string>
 #include <string_view>
 
+namespace cppcoro {
+class static_thread_pool;
+}
+
 namespace Cory {
 
 struct DebugMessageInfo {
@@ -26,6 +32,8 @@ struct DebugMessageInfo {
 enum class ValidationLayers { Enabled, Disabled };
 struct ContextCreationInfo {
     ValidationLayers validation{ValidationLayers::Enabled};
+    /// file to persist the driver's pipeline cache data in across runs - not persisted if empty
+    std::filesystem::path pipelineCacheFile{};
 };
 
 /**
@@ -45,6 +53,7 @@ class Context : NoCopy {
     [[nodiscard]] Semaphore createSemaphore(std::string_view name = "");
     [[nodiscard]] Magnum::Vk::Fence createFence(std::string_view name = "",
                                                 FenceCreateMode mode = {});
+    [[nodiscard]] GpuEvent createEvent(std::string_view name = "");
 
     bool isHeadless() const;
 
@@ -56,12 +65,29 @@ class Context : NoCopy {
 
     Magnum::Vk::Queue &graphicsQueue();
     uint32_t graphicsQueueFamily() const;
+    /// a queue for async compute - same as graphicsQueue() if hasAsyncCompute() is false
     Magnum::Vk::Queue &computeQueue();
     uint32_t computeQueueFamily() const;
+    /// whether computeQueue() is a separate queue that can run in parallel to graphicsQueue()
+    [[nodiscard]] bool hasAsyncCompute() const;
+    /// whether VK_EXT_graphics_pipeline_library is enabled, see PipelineCache
+    [[nodiscard]] bool hasGraphicsPipelineLibrary() const;
 
+    /// allocates the device memory of the buffers and images created by the resources()
+    MemoryAllocator &allocator();
     ResourceManager &resources();
     const ResourceManager &resources() const;
 
+    /// the graphics pipelines used by render passes
+    PipelineCache &pipelines();
+    /// reloads shaders when their files change - disabled by default
+    ShaderReloader &shaderReloader();
+    /// moves relocatable buffers and images to defragment the memory - disabled by default
+    MemoryDefragmenter &defragmenter();
+
+    /// worker threads for CPU work that can be parallelized, e.g. command buffer recording
+    cppcoro::static_thread_pool &workerPool();
+
     /// register a callback that gets called on vulkan validation messages etc.
     void onVulkanDebugMessageReceived(std::function<void(const DebugMessageInfo &)> callback);
 
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <Cory/Renderer/VulkanUtils.hpp>
+
+using VkEvent = struct VkEvent_T *;
+
+namespace Cory {
+
+/// a VkEvent - named like this to avoid confusion with the application events
+using GpuEvent = BasicVkObjectWrapper<VkEvent>;
+
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <Cory/Base/Common.hpp>
+#include <Cory/Renderer/Common.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// opaque VMA handles, see vk_mem_alloc.h
+struct VmaAllocator_T;
+struct VmaAllocation_T;
+struct VmaPool_T;
+
+namespace Cory {
+
+/// where an allocation lives in device memory
+struct AllocationInfo {
+    VkDeviceMemory memory{VK_NULL_HANDLE};
+    VkDeviceSize offset{};
+    VkDeviceSize size{};
+    uint32_t memoryType{};
+    /// persistently mapped pointer to the start of the allocation - nullptr if the memory is not
+    /// host visible
+    std::byte *mappedData{};
+};
+
+/// memory statistics of a memory heap, see MemoryAllocator::heapStats()
+struct MemoryHeapStats {
+    VkDeviceSize size;            ///< the size of the heap
+    bool deviceLocal;             ///< whether the heap is on the GPU
+    uint32_t blockCount;          ///< the number of VkDeviceMemory objects allocated from the heap
+    uint32_t allocationCount;     ///< the number of resources placed in these blocks
+    VkDeviceSize blockBytes;      ///< the total size of the blocks
+    VkDeviceSize allocationBytes; ///< the part of the blocks that is used by allocations
+    /// estimated memory usage of the process in this heap, including memory that was not
+    /// allocated through the MemoryAllocator (e.g. the swapchain)
+    VkDeviceSize usage;
+    /// estimated amount of memory available to the process in this heap
+    VkDeviceSize budget;
+};
+
+/// limits the work of a single ResourceManager::defragment() call
+struct DefragmentationBudget {
+    /// CPU time for finding new places for resources and recording their copies
+    std::chrono::microseconds time{500};
+    /// the number of bytes that may be copied on the GPU
+    VkDeviceSize bytes{16 * 1024 * 1024};
+};
+
+/// what was done by one or more ResourceManager::defragment() calls
+struct DefragmentationStats {
+    uint32_t moves{};          ///< the number of buffers and images that were moved
+    VkDeviceSize bytesMoved{}; ///< the size of the moved resources
+};
+
+/// a block of device memory allocated from the MemoryAllocator, freed on destruction
+class MemoryAllocation : NoCopy {
+  public:
+    MemoryAllocation() = default;
+    ~MemoryAllocation();
+
+    MemoryAllocation(MemoryAllocation &&rhs) noexcept;
+    MemoryAllocation &operator=(MemoryAllocation &&rhs) noexcept;
+
+    [[nodiscard]] bool valid() const noexcept { return allocation_ != nullptr; }
+    [[nodiscard]] AllocationInfo info() const;
+
+    /// make host writes to a range of the allocation available to the device - only needed if
+    /// the memory is not host coherent. @a offset is relative to the start of the allocation
+    void flush(VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+    [[nodiscard]] VmaAllocation_T *handle() const noexcept { return allocation_; }
+
+  private:
+    friend class MemoryAllocator;
+    MemoryAllocation(VmaAllocator_T *allocator, VmaAllocation_T *allocation, VmaPool_T *pool);
+
+    VmaAllocator_T *allocator_{};
+    VmaAllocation_T *allocation_{};
+    /// the pool the allocation was made from - nullptr for dedicated allocations
+    VmaPool_T *pool_{};
+};
+
+/**
+ * Allocates the device memory for buffers and images with the Vulkan Memory Allocator.
+ * Owned by the Context.
+ *
+ * Resources are sub-allocated from large VkDeviceMemory blocks instead of getting a dedicated
+ * allocation each, which keeps the number of allocations far below maxMemoryAllocationCount and
+ * avoids a vkAllocateMemory for every resource. The blocks are grouped into pools by usage class
+ * (device local, upload or readback - derived from the required memory flags), memory type, and
+ * whether they contain buffers or optimally tiled images. Resources of at least
+ * DEDICATED_ALLOCATION_THRESHOLD bytes and lazily allocated memory get their own allocation.
+ *
+ * Host-visible allocations are persistently mapped, see AllocationInfo::mappedData.
+ *
+ * To defragment the memory, reallocate() finds a new place for a device local allocation in
+ * the other blocks of its pool. Moving the resource into it is up to the caller, see
+ * ResourceManager::defragment().
+ */
+class MemoryAllocator : NoCopy {
+  public:
+    /// resources of at least this size are not sub-allocated
+    static constexpr VkDeviceSize DEDICATED_ALLOCATION_THRESHOLD{32 * 1024 * 1024};
+
+    MemoryAllocator();
+    ~MemoryAllocator();
+
+    MemoryAllocator(MemoryAllocator &&) = default;
+    MemoryAllocator &operator=(MemoryAllocator &&) = default;
+
+    /// set up the context to be used and create the allocator - must be called exactly once,
+    /// after the device has been created and before any memory is allocated
+    void init(Context &ctx);
+
+    /// allocate memory with (at least) the @a requiredFlags for @a buffer and bind it
+    [[nodiscard]] MemoryAllocation allocate(Magnum::Vk::Buffer &buffer,
+                                            VkMemoryPropertyFlags requiredFlags);
+    /// allocate memory with (at least) the @a requiredFlags for @a image and bind it
+    [[nodiscard]] MemoryAllocation allocate(Magnum::Vk::Image &image,
+                                            VkImageTiling tiling,
+                                            VkMemoryPropertyFlags requiredFlags);
+
+    /**
+     * allocate memory to move the resource of @a allocation to, e.g. to empty a sparsely used
+     * block. the new allocation is placed in another existing block of the same pool, no new
+     * blocks are created.
+     *
+     * returns an empty allocation if there is no space, or if @a allocation is dedicated or host
+     * visible (moving it would invalidate the mapped pointer). the memory is not bound to any
+     * resource yet, see bind().
+     */
+    [[nodiscard]] MemoryAllocation reallocate(const MemoryAllocation &allocation,
+                                              const VkMemoryRequirements &requirements);
+    /// bind memory obtained from reallocate() to @a buffer
+    void bind(const MemoryAllocation &allocation, Magnum::Vk::Buffer &buffer);
+    /// bind memory obtained from reallocate() to @a image
+    void bind(const MemoryAllocation &allocation, Magnum::Vk::Image &image);
+
+    /// the statistics of every memory heap of the device - traverses all allocations, so it
+    /// should not be called every frame
+    [[nodiscard]] std::vector<MemoryHeapStats> heapStats() const;
+
+    /// the number of pools that have been created so far
+    [[nodiscard]] size_t poolCount() const;
+
+    [[nodiscard]] VmaAllocator_T *handle() const;
+
+  private:
+    std::unique_ptr<struct MemoryAllocatorPrivate> data_;
+};
+
+} // namespace Cory
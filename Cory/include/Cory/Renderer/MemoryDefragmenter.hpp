@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Cory/Base/Common.hpp>
+#include <Cory/Renderer/Common.hpp>
+#include <Cory/Renderer/MemoryAllocator.hpp>
+
+#include <memory>
+
+namespace Cory {
+
+/**
+ * Incrementally defragments the device memory of long-running applications. Owned by the
+ * Context, disabled by default.
+ *
+ * Every frame, nextFrame() moves a few relocatable buffers and images (see
+ * ResourceManager::allowRelocation()) out of sparsely used memory blocks, within the budget().
+ * The copies are submitted to the graphics queue between frames, so they are ordered after the
+ * previous frame and before the next one. Handles of moved resources stay valid. Once the copies
+ * have finished, the replaced resources are released through the deferred destruction of the
+ * ResourceManager (see ResourceManager::releaseRelocated()), so frames that were recorded with
+ * them can still be in flight. A new pass is only started after that.
+ */
+class MemoryDefragmenter : NoCopy {
+  public:
+    MemoryDefragmenter();
+    ~MemoryDefragmenter();
+
+    MemoryDefragmenter(MemoryDefragmenter &&) = default;
+    MemoryDefragmenter &operator=(MemoryDefragmenter &&) = default;
+
+    /// set up the context to be used - must be called exactly once
+    void init(Context &ctx);
+
+    [[nodiscard]] bool enabled() const;
+    void setEnabled(bool enabled);
+
+    /// the limits of a single pass
+    [[nodiscard]] DefragmentationBudget budget() const;
+    void setBudget(DefragmentationBudget budget);
+
+    /**
+     * release the resources of a finished pass and start a new pass if enabled. called once per
+     * frame by Swapchain::nextImage().
+     */
+    void nextFrame();
+
+    /// wait for the copies of the current pass and release the replaced resources
+    void wait();
+
+    /// what all passes so far have done
+    [[nodiscard]] DefragmentationStats stats() const;
+
+  private:
+    std::unique_ptr<struct MemoryDefragmenterPrivate> data_;
+};
+
+} // namespace Cory
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <Cory/Base/Common.hpp>
+#include <Cory/Renderer/Common.hpp>
+
+#include <bit>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace Cory {
+
+/**
+ * The value of a specialization constant, declared in a shader with layout(constant_id = id).
+ *
+ * Specialization constants are the preferred way to create variants of a shader: all variants
+ * share one compiled shader module, and the driver specializes it when the pipeline is created.
+ * Preprocessor defines (ShaderSource::setDefinition()) should only be used for structural
+ * changes that can not be expressed with constants, e.g. different resource bindings.
+ */
+struct SpecializationConstant {
+    SpecializationConstant(uint32_t constantId, uint32_t v)
+        : id{constantId}
+        , value{v}
+    {
+    }
+    SpecializationConstant(uint32_t constantId, int32_t v)
+        : id{constantId}
+        , value{std::bit_cast<uint32_t>(v)}
+    {
+    }
+    SpecializationConstant(uint32_t constantId, float v)
+        : id{constantId}
+        , value{std::bit_cast<uint32_t>(v)}
+    {
+    }
+    SpecializationConstant(uint32_t constantId, bool v)
+        : id{constantId}
+        , value{v ? VK_TRUE : VK_FALSE}
+    {
+    }
+    bool operator==(const SpecializationConstant &rhs) const = default;
+
+    uint32_t id;
+    /// the bits of the value - booleans are stored as VkBool32
+    uint32_t value;
+};
+
+/// describes everything about a (dynamic rendering) graphics pipeline that is not dynamic state
+struct PipelineDescriptor {
+    std::vector<ShaderHandle> shaders;
+    /// applied to all shader stages - constants that a stage does not declare are ignored
+    std::vector<SpecializationConstant> specialization{};
+    int32_t sampleCount;
+    std::vector<VkFormat> colorFormats;
+    VkFormat depthFormat;
+    VkFormat stencilFormat;
+    bool hasMeshInput;
+    std::size_t hash() const;
+    bool operator==(const PipelineDescriptor &rhs) const = default;
+};
+
+/// what to do when a render pass is recorded before its pipeline has finished compiling
+enum class PendingPipelinePolicy {
+    Block, ///< wait for the compilation, shows up as "PipelineCache/Wait" in the profiler
+    Skip,  ///< skip the draws of the render pass for this frame
+};
+
+/// a pipeline that is compiled in the background, see PipelineCache::request()
+class PipelineFuture {
+  public:
+    PipelineFuture() = default;
+
+    /// whether the compilation has finished (successfully or not) - can be called from any thread
+    [[nodiscard]] bool ready() const;
+    /// wait for the compilation to finish - throws if the pipeline could not be created
+    [[nodiscard]] PipelineHandle get() const;
+
+  private:
+    friend class PipelineCache;
+    friend struct PipelineCachePrivate;
+    PipelineHandle handle_;
+    std::shared_ptr<struct PipelineBuild> build_;
+};
+
+/**
+ * Creates and caches the graphics pipelines used by render passes. Owned by the Context.
+ *
+ * Pipelines are created through a VkPipelineCache. If a cache file is configured, the driver's
+ * cache data is loaded from it on startup and written back on destruction, so warm runs skip
+ * most of the shader compilation in the driver. The file is only used if it was written with the
+ * same device and driver version.
+ *
+ * Pipelines are compiled on a separate thread pool as soon as they are requested, usually when a
+ * render pass is declared. Render passes check whether their pipeline is ready when they are
+ * recorded and handle pending pipelines according to pendingPolicy().
+ *
+ * If the device supports VK_EXT_graphics_pipeline_library, pipelines are linked from four
+ * libraries (vertex input, pre-rasterization shaders, fragment shader and fragment output), which
+ * are cached independently. A new pipeline that only differs in e.g. its attachment formats then
+ * only needs to compile its fragment output library and link, instead of compiling all shaders
+ * again. Otherwise, pipelines are created monolithically.
+ *
+ * Pipelines are evicted in least-recently-used order once more than capacity() pipelines are
+ * cached, except for the ones used in the last frame. Evicted and replaced pipelines are released
+ * through the ResourceManager, which destroys them once the frames in flight are done with them.
+ */
+class PipelineCache : NoCopy {
+  public:
+    static constexpr size_t DEFAULT_CAPACITY{256};
+
+    PipelineCache();
+    ~PipelineCache();
+
+    PipelineCache(PipelineCache &&) = default;
+    PipelineCache &operator=(PipelineCache &&) = default;
+
+    /**
+     * set up the context to be used and create the VkPipelineCache - must be called exactly once,
+     * before any pipelines are created.
+     *
+     * If @a cacheFile is not empty, the initial cache data is loaded from it (if it exists and is
+     * valid for the current device), and the cache data is written back to it on destruction.
+     */
+    void init(Context &ctx, std::filesystem::path cacheFile);
+
+    /// look up the pipeline for @a descriptor, start compiling it in the background if it does
+    /// not exist yet
+    PipelineFuture request(std::string_view name, const PipelineDescriptor &descriptor);
+    /// look up the pipeline for @a descriptor, create it and wait for it if it does not exist yet
+    PipelineHandle query(std::string_view name, const PipelineDescriptor &descriptor);
+
+    /**
+     * rebuild all cached pipelines that use any of @a shaders in the background, e.g. after the
+     * shaders were reloaded. the rebuilt pipelines replace the old ones in nextFrame() once they
+     * are ready, the old pipelines are released when the GPU is done with them. if a pipeline
+     * can not be rebuilt, the old one is kept.
+     */
+    void reload(std::span<const ShaderHandle> shaders);
+
+    /// wait for all pipelines that are currently compiling
+    void wait();
+
+    /// advance the frame counter, swap in rebuilt pipelines and evict the least recently used
+    /// pipelines beyond capacity(). called once per frame by Swapchain::nextImage()
+    void nextFrame();
+
+    /// wait for pending compilations and release all cached pipelines - the GPU must not use any
+    /// of them anymore
+    void clear();
+
+    /// write the driver cache data to the cache file. returns false if there is no file configured
+    /// or the file could not be written
+    bool save();
+
+    /// whether the initial cache data was successfully loaded from the cache file
+    [[nodiscard]] bool loadedFromFile() const;
+
+    /// the number of pipelines currently in the cache
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] size_t capacity() const;
+    void setCapacity(size_t capacity);
+
+    /// whether pipelines are linked from pipeline libraries
+    [[nodiscard]] bool usesLibraries() const;
+    /// enable or disable the use of pipeline libraries for pipelines created from now on - can
+    /// only be enabled if Context::hasGraphicsPipelineLibrary() is true
+    void setUseLibraries(bool useLibraries);
+    /// the number of pipeline libraries currently in the cache
+    [[nodiscard]] size_t libraryCount() const;
+
+    [[nodiscard]] PendingPipelinePolicy pendingPolicy() const;
+    void setPendingPolicy(PendingPipelinePolicy policy);
+
+    [[nodiscard]] VkPipelineCache handle() const;
+
+  private:
+    std::unique_ptr<struct PipelineCachePrivate> data_;
+};
+
+} // namespace Cory
@@ -2,11 +2,15 @@
 
 #include <Cory/Base/SlotMap.hpp>
 #include <Cory/Renderer/Common.hpp>
+#include <Cory/Renderer/MemoryAllocator.hpp>
+
+#include <Magnum/Tags.h>
 
 #include <filesystem>
 #include <memory>
 #include <source_location>
 #include <string_view>
+#include <vector>
 
 namespace Cory {
 
@@ -20,6 +24,23 @@ enum class ResourceType { Buffer, Shader, Pipeline, Sampler };
  *
  * The available Handle types are declared in RenderCommon.hpp to reduce compile times.
  *
+ * The memory of buffers and images is sub-allocated through the MemoryAllocator of the Context.
+ * Buffers and images that allow it can be moved to defragment the memory, see defragment().
+ *
+ * Released Vulkan objects might still be used by frames in flight, so they are not destroyed
+ * right away: release() removes them from their SlotMap (invalidating the handle) and tags them
+ * with the current frame, see beginFrame(). They are destroyed by collect() once that frame has
+ * finished on the GPU. Shaders are not used by the GPU and are always destroyed immediately, as
+ * are all resources released before the first frame was started.
+ *
+ * Resources can be created, looked up and released from any thread, e.g. by asset loaders or
+ * pipeline compile workers. Every resource type has its own lock, which is only held while a slot
+ * is inserted, looked up or released - the Vulkan objects are created and destroyed outside of
+ * it. Lookups share the lock, so they only ever wait for a create or release of the same type
+ * that happens at the same time. References returned by operator[] stay valid until the resource
+ * is released, but the resource itself is not synchronized: a resource must not be released
+ * while another thread still uses it.
+ *
  * Currently, manages:
  *  - Buffers
  *  - Shaders
@@ -59,6 +80,13 @@ class ResourceManager : NoCopy {
                  ShaderType type,
                  std::filesystem::path filePath = "Unknown",
                  std::source_location loc = std::source_location::current());
+    /// compile the shaders concurrently on the worker pool of the context and create them. throws
+    /// if any of the shaders can not be compiled - none of the shaders is created in that case
+    [[nodiscard]] std::vector<ShaderHandle>
+    createShaders(std::vector<ShaderSource> sources,
+                  std::source_location loc = std::source_location::current());
+    /// the handles of all shaders
+    [[nodiscard]] std::vector<ShaderHandle> shaders() const;
     /// dereference a shader handle to access the shader. may throw!
     [[nodiscard]] Shader &operator[](ShaderHandle shaderHandle);
     void release(ShaderHandle shaderHandle);
@@ -67,20 +95,42 @@ class ResourceManager : NoCopy {
 
     // <editor-fold desc="Buffers">
     ///@{
+    /// create a buffer backed by memory with (at least) the memory @a flags - host-visible
+    /// buffers are persistently mapped, see memoryInfo()
     BufferHandle createBuffer(std::string_view name,
                               size_t bufferSizeInBytes,
                               BufferUsage usage,
                               MemoryFlags flags,
                               std::source_location loc = std::source_location::current());
+    /// create a buffer without any memory backing it - memory has to be bound with
+    /// Magnum::Vk::Buffer::bindMemory() before the buffer is used
+    BufferHandle createBuffer(std::string_view name,
+                              size_t bufferSizeInBytes,
+                              BufferUsage usage,
+                              Magnum::NoAllocateT,
+                              std::source_location loc = std::source_location::current());
     [[nodiscard]] Magnum::Vk::Buffer &operator[](BufferHandle handle);
+    /// where the memory of the buffer lives - empty if it was created with Magnum::NoAllocate
+    [[nodiscard]] AllocationInfo memoryInfo(BufferHandle handle);
+    /// make host writes to a range of a host-visible buffer available to the device - only
+    /// needed if the memory is not host coherent
+    void flush(BufferHandle handle, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
     void release(BufferHandle handle);
     ///@}
     // </editor-fold>
 
     // <editor-fold desc="Pipelines">
     ///@{
+    /// create a pipeline, optionally through a VkPipelineCache - usually, pipelines should be
+    /// obtained from the PipelineCache instead of creating them directly
     PipelineHandle createPipeline(std::string_view name,
                                   const Magnum::Vk::RasterizationPipelineCreateInfo &createInfo,
+                                  VkPipelineCache cache = VK_NULL_HANDLE,
+                                  std::source_location loc = std::source_location::current());
+    /// reserve a handle for a pipeline that is created later, e.g. on a worker thread - the
+    /// pipeline has to be assigned to operator[](PipelineHandle) before the handle is used
+    PipelineHandle createPipeline(std::string_view name,
+                                  Magnum::NoCreateT,
                                   std::source_location loc = std::source_location::current());
     Magnum::Vk::Pipeline &operator[](PipelineHandle handle);
     void release(PipelineHandle handle);
@@ -89,14 +139,24 @@ class ResourceManager : NoCopy {
 
     // <editor-fold desc="Images">
     ///@{
+    /// create an image backed by memory with (at least) the @a memoryFlags
     ImageHandle createImage(std::string_view name,
                             const Magnum::Vk::ImageCreateInfo &createInfo,
                             Magnum::Vk::MemoryFlags memoryFlags,
                             std::source_location loc = std::source_location::current());
+    /// create an image without any memory backing it - memory has to be bound with
+    /// Magnum::Vk::Image::bindMemory() before the image is used
+    ImageHandle createImage(std::string_view name,
+                            const Magnum::Vk::ImageCreateInfo &createInfo,
+                            Magnum::NoAllocateT,
+                            std::source_location loc = std::source_location::current());
     ImageHandle wrapImage(std::string_view name,
                           Magnum::Vk::Image &resource,
                           std::source_location loc = std::source_location::current());
     Magnum::Vk::Image &operator[](ImageHandle handle);
+    /// where the memory of the image lives - empty if it was created with Magnum::NoAllocate or
+    /// wrapped
+    [[nodiscard]] AllocationInfo memoryInfo(ImageHandle handle);
     void release(ImageHandle handle);
     ///@}
     // </editor-fold>
@@ -135,6 +195,59 @@ class ResourceManager : NoCopy {
     ///@}
     // </editor-fold>
 
+    // <editor-fold desc="Defragmentation">
+    ///@{
+    /**
+     * allow defragment() to move the buffer. its handle stays valid, but the VkBuffer behind it
+     * changes when it is moved, so it must not be kept across frames (e.g. in a descriptor set
+     * that is not written every frame). the buffer must have been created with
+     * BufferUsageBits::TransferSource and TransferDestination, in device local memory.
+     * relocatable resources must only be used on the thread that calls defragment().
+     */
+    void allowRelocation(BufferHandle handle);
+    /**
+     * allow defragment() to move the image, see allowRelocation(BufferHandle). the image must
+     * have been created with transfer source and destination usage and has to be in @a layout
+     * between frames. its contents are not copied if @a layout is VK_IMAGE_LAYOUT_UNDEFINED.
+     * image views are not recreated, so they must not be kept across frames either.
+     */
+    void allowRelocation(ImageHandle handle, VkImageLayout layout);
+
+    /**
+     * move relocatable buffers and images out of the least used memory blocks into fuller ones,
+     * so that the sparse blocks become empty and are freed - usually called once per frame by
+     * the MemoryDefragmenter.
+     *
+     * each moved resource is replaced by a new one in the same slot, and its contents are copied
+     * by commands recorded into @a cmd, which has to be executed before the resources are used
+     * again. the old resources are kept until releaseRelocated() is called.
+     */
+    DefragmentationStats defragment(Magnum::Vk::CommandBuffer &cmd,
+                                     const DefragmentationBudget &budget);
+    /// release the resources replaced by defragment() - the copies recorded by it must have
+    /// finished executing. like release(), they are destroyed once the current frame has finished,
+    /// so frames that were recorded with them can still be in flight
+    void releaseRelocated();
+    /// the number of resources replaced by defragment() that are waiting for releaseRelocated()
+    [[nodiscard]] size_t relocatedCount() const;
+    ///@}
+    // </editor-fold>
+
+    // <editor-fold desc="Deferred destruction">
+    ///@{
+    /// start a new frame - resources released from now on are destroyed once it has finished.
+    /// returns the number of the frame for collect(). called by the Swapchain for every frame
+    uint64_t beginFrame();
+    /// destroy the resources released in all frames up to (and including) @a completedFrame,
+    /// usually after waiting for the fence of that frame
+    void collect(uint64_t completedFrame);
+    /// destroy all released resources - the GPU must not use any of them anymore
+    void collectAll();
+    /// the number of released resources that are waiting to be destroyed
+    [[nodiscard]] size_t pendingReleaseCount() const;
+    ///@}
+    // </editor-fold>
+
   private:
     std::unique_ptr<struct ResourceManagerPrivate> data_;
 };
@@ -35,6 +35,9 @@ class ShaderSource {
     ShaderSource(ShaderSource &&rhs) = default;
     ShaderSource &operator=(ShaderSource &&rhs) = default;
 
+    /// define a preprocessor macro - every distinct set of definitions compiles its own shader
+    /// module, so prefer specialization constants (see SpecializationConstant) for variants that
+    /// do not change the structure of the shader
     void setDefinition(std::string defName, std::string defValue = "")
     {
         macroDefinitions_[defName] = defValue;
@@ -45,20 +48,49 @@ class ShaderSource {
     auto type() const { return type_; }
     const auto &defines() const { return macroDefinitions_; }
     const auto &filePath() const { return filename_; }
+    /// whether the source was loaded from filePath()
+    bool isFile() const { return isFile_; }
+
+    /// read the source from the file again - does nothing if the source was not loaded from a file
+    void reload();
 
   private:
     std::filesystem::path filename_{"Unknown"};
     std::string source_;
     ShaderType type_;
+    bool isFile_{false};
     std::map<std::string, std::string> macroDefinitions_;
 };
 
 class Shader {
   public:
-    static std::vector<uint32_t> CompileToSpv(const ShaderSource &source, bool optimize = true);
+    /**
+     * Compiles the source to SPIR-V. Returns an empty vector if the compilation failed.
+     *
+     * If a cache directory is set, the code is cached in that directory, keyed on a hash of the
+     * preprocessed source (i.e. including all included files), the defines, the shader type and
+     * the compiler options. Cached code is verified before it is used and recompiled if it is
+     * corrupted.
+     *
+     * If @a includedFiles is given, the paths of all files included by the source are added to it.
+     */
+    static std::vector<uint32_t>
+    CompileToSpv(const ShaderSource &source,
+                 bool optimize = true,
+                 std::vector<std::filesystem::path> *includedFiles = nullptr);
+
+    /// set the directory for the SPIR-V cache, creating it if necessary. an empty path disables
+    /// the cache (the default). can be shared between processes.
+    static void SetCacheDirectory(std::filesystem::path directory);
+    static std::filesystem::path CacheDirectory();
 
     Shader();
     Shader(Context &ctx, ShaderSource source);
+    /// create the shader from code that was already compiled with CompileToSpv()
+    Shader(Context &ctx,
+           ShaderSource source,
+           std::vector<uint32_t> spirvBinary,
+           std::vector<std::filesystem::path> includedFiles = {});
 
     // copyable!
     Shader(const Shader &rhs) = default;
@@ -69,6 +101,9 @@ class Shader {
 
     Magnum::Vk::Shader &module() { return *module_; }
     ShaderType type() const { return type_; }
+    const ShaderSource &source() const { return source_; }
+    /// the files the shader was compiled from: its source file (if any) and all included files
+    const std::vector<std::filesystem::path> &dependencies() const { return dependencies_; }
     bool valid() const;
 
     // vk::PipelineShaderStageCreateInfo stageCreateInfo();
@@ -82,7 +117,9 @@ class Shader {
     ShaderType type_{};
     size_t size_{};
     std::shared_ptr<Magnum::Vk::Shader> module_;
+    std::vector<std::filesystem::path> dependencies_;
 
+    void create(std::vector<uint32_t> spirvBinary);
     std::string preprocessShader();
 
     // Compiles a shader to SPIR-V assembly. Returns the assembly text
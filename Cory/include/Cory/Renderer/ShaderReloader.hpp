@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Cory/Base/Common.hpp>
+#include <Cory/Renderer/Common.hpp>
+
+#include <memory>
+
+namespace Cory {
+
+/**
+ * Reloads shaders when their source files or any of the files they include change on disk.
+ * Owned by the Context, disabled by default.
+ *
+ * Every shader records the files it was compiled from (see Shader::dependencies()), which are
+ * watched with a FileWatcher. When a file changes, only the shaders that depend on it are
+ * recompiled in the background. Recompiled shaders replace the old ones in update(), keeping
+ * their handles, and the PipelineCache rebuilds the pipelines that use them. If a shader can not
+ * be compiled, the error is logged and the old shader and pipelines are kept.
+ */
+class ShaderReloader : NoCopy {
+  public:
+    ShaderReloader();
+    ~ShaderReloader();
+
+    ShaderReloader(ShaderReloader &&) = default;
+    ShaderReloader &operator=(ShaderReloader &&) = default;
+
+    /// set up the context to be used - must be called exactly once
+    void init(Context &ctx);
+
+    [[nodiscard]] bool enabled() const;
+    void setEnabled(bool enabled);
+
+    /**
+     * check for changed files, start recompiling the affected shaders, and swap in the shaders
+     * that finished compiling. called once per frame by Swapchain::nextImage().
+     */
+    void update();
+
+    /// wait for all shaders that are currently compiling
+    void wait();
+
+    /// the number of shaders that are currently compiling
+    [[nodiscard]] size_t pendingCount() const;
+
+  private:
+    std::unique_ptr<struct ShaderReloaderPrivate> data_;
+};
+
+} // namespace Cory
@@ -50,7 +50,8 @@ class Swapchain : public BasicVkObjectWrapper<VkSwapchainKHR> {
     /**
      * acquire the next image. this method will obtain a Swapchain image index from the underlying
      * Swapchain. it will then wait for work on the image from a previous frame to be completed by
-     * waiting for the corresponding fence.
+     * waiting for the corresponding fence, and advance the per-frame state of the context (e.g.
+     * the ShaderReloader, the PipelineCache and the MemoryDefragmenter).
      *
      * upon acquiring the next image through this method and before calling the corresponding
      * present(), a client application MUST:
@@ -90,6 +91,8 @@ class Swapchain : public BasicVkObjectWrapper<VkSwapchainKHR> {
 
     // for each frame in flight, we also keep a set of additional resources
     std::vector<Magnum::Vk::Fence> inFlightFences_{};
+    /// the ResourceManager frame that was last submitted with each of the inFlightFences_
+    std::vector<uint64_t> fenceFrames_{};
     std::vector<Magnum::Vk::Fence *> imageFences_{};
     std::vector<Semaphore> imageAcquired_{};
     std::vector<Semaphore> imageRendered_{};
@@ -133,20 +133,17 @@ to use a feature.
 
 MEMORY ALLOCATION
 
-    The CmdPipelineBarrier and thWaitEvents commands allocate temporary
-    storage for the Vulkan barrier equivalents in order to pass them to the
-    respective Vulkan commands.
+    The CmdPipelineBarrier and CmdWaitEvents commands (and their
+    synchronization2 variants) need temporary storage for the Vulkan barrier
+    equivalents in order to pass them to the respective Vulkan commands.
 
-    These use the `SYNC_TEMP_ALLOC(size)` and `SYNC_TEMP_FREE(x)` macros,
-    which are by default set to alloca(size) and ((void)(x)), respectively.
-    If you don't want to use stack space or would rather use your own
-    allocation strategy, these can be overridden by defining these macros
-    in before #include-ing the header file with
-    _SIMPLER_VULKAN_SYNCHRONIZATION_IMPLEMENTATION defined.
+    The storage is taken from the optional `scratch` span that the caller
+    passes in - use BarrierScratchSize() to find out how much is needed.
+    Only if the scratch memory is too small (or not given), the remainder is
+    allocated from the default memory resource.
 
-    I'd rather avoid the need for these allocations in what are likely to be
-    high-traffic commands, but currently just want to ship something - may
-    revisit this at a future date based on feedback.
+    Access lists are stored inline in the barriers (see AccessList), so
+    creating a barrier does not allocate either.
 
 EXPRESSIVENESS COMPARED TO RAW VULKAN
 
@@ -198,12 +195,18 @@ ISSUES
     via a pull request yourself if you're so inclined.
 */
 
+#include <Cory/Base/Log.hpp>
+
 #include <Magnum/Vk/Vk.h>
 #include <Magnum/Vk/Vulkan.h>
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <cstdint>
-#include <vector>
+#include <initializer_list>
 #include <span>
+#include <vector>
 
 namespace Cory::Sync {
 
@@ -405,6 +408,61 @@ enum class ImageLayout {
     // GENERAL_AND_PRESENTATION
 };
 
+/**
+A fixed-capacity list of accesses that is stored inline, so barriers can be
+created and copied without allocating. MAX_ACCESSES is plenty for the
+accesses that can be combined in a single barrier (reads of the same layout).
+*/
+class AccessList {
+  public:
+    static constexpr uint32_t MAX_ACCESSES{16};
+
+    constexpr AccessList() = default;
+    constexpr AccessList(std::initializer_list<AccessType> accesses)
+        : AccessList(accesses.begin(), accesses.end())
+    {
+    }
+    template <typename It> constexpr AccessList(It first, It last)
+    {
+        for (; first != last; ++first) {
+            push_back(*first);
+        }
+    }
+
+    // overflowing the list is a bug in the caller, so this fails in every build type instead of
+    // writing past the end of the list in release builds
+    constexpr void push_back(AccessType access)
+    {
+        CO_CORE_ASSERT(size_ < MAX_ACCESSES,
+                       "Too many accesses in a single barrier, at most {} are supported",
+                       MAX_ACCESSES);
+        accesses_[size_++] = access;
+    }
+    constexpr void clear() { size_ = 0; }
+
+    [[nodiscard]] constexpr uint32_t size() const { return size_; }
+    [[nodiscard]] constexpr bool empty() const { return size_ == 0; }
+    [[nodiscard]] constexpr bool contains(AccessType access) const
+    {
+        return std::find(begin(), end(), access) != end();
+    }
+
+    [[nodiscard]] constexpr AccessType operator[](uint32_t idx) const { return accesses_[idx]; }
+    [[nodiscard]] constexpr AccessType front() const { return accesses_[0]; }
+    [[nodiscard]] constexpr AccessType back() const { return accesses_[size_ - 1]; }
+    [[nodiscard]] constexpr const AccessType *begin() const { return accesses_.data(); }
+    [[nodiscard]] constexpr const AccessType *end() const { return accesses_.data() + size_; }
+
+    /* implicit */ constexpr operator std::span<const AccessType>() const
+    {
+        return {accesses_.data(), size_};
+    }
+
+  private:
+    std::array<AccessType, MAX_ACCESSES> accesses_{};
+    uint32_t size_{};
+};
+
 /**
 Global barriers define a set of accesses on multiple resources at once.
 If a buffer or image doesn't require a queue ownership transfer, or an image
@@ -413,8 +471,8 @@ layouts) then a global barrier should be preferred.
 Simply define the previous and next access types of resources affected.
 */
 struct GlobalBarrier {
-    std::vector<AccessType> prevAccesses;
-    std::vector<AccessType> nextAccesses;
+    AccessList prevAccesses;
+    AccessList nextAccesses;
 };
 
 /**
@@ -433,8 +491,8 @@ queue in the destination queue family, with a semaphore guaranteeing
 execution order between them.
 */
 struct BufferBarrier {
-    std::vector<AccessType> prevAccesses;
-    std::vector<AccessType> nextAccesses;
+    AccessList prevAccesses;
+    AccessList nextAccesses;
     uint32_t srcQueueFamilyIndex;
     uint32_t dstQueueFamilyIndex;
     VkBuffer buffer;
@@ -469,8 +527,8 @@ going to be immediately overwritten. A good example of when to use this is
 when an application re-uses a presented image after vkAcquireNextImageKHR.
 */
 struct ImageBarrier {
-    std::vector<AccessType> prevAccesses;
-    std::vector<AccessType> nextAccesses;
+    AccessList prevAccesses;
+    AccessList nextAccesses;
     ImageLayout prevLayout;
     ImageLayout nextLayout;
     VkBool32 discardContents;
@@ -485,6 +543,12 @@ struct ImageBarrier {
  */
 VkImageLayout GetVkImageLayout(AccessType access);
 
+/**
+ * Access the image usage flags an image needs to support a specific access type. Returns 0 for
+ * accesses that don't apply to images. General access maps to all non-attachment usages.
+ */
+VkImageUsageFlags GetVkImageUsage(AccessType access);
+
 /**
 Mapping function that translates a set of accesses into the corresponding
 pipeline stages, VkAccessFlags, and image layout.
@@ -538,7 +602,8 @@ void CmdPipelineBarrier(Magnum::Vk::Device &device,
                         VkCommandBuffer commandBuffer,
                         const GlobalBarrier *pGlobalBarrier,
                         std::span<const BufferBarrier> bufferBarriers,
-                        std::span<const ImageBarrier> imageBarriers);
+                        std::span<const ImageBarrier> imageBarriers,
+                        std::span<std::byte> scratch = {});
 
 /**
 Wrapper around vkCmdSetEvent.
@@ -579,5 +644,104 @@ void CmdWaitEvents(Magnum::Vk::Device &device,
                    std::span<const VkEvent> events,
                    const GlobalBarrier *pGlobalBarrier,
                    std::span<const BufferBarrier> bufferBarriers,
-                   std::span<const ImageBarrier> imageBarriers);
+                   std::span<const ImageBarrier> imageBarriers,
+                   std::span<std::byte> scratch = {});
+
+//// Synchronization2 ////
+/*
+The functions below use VK_KHR_synchronization2 (core in Vulkan 1.3). Unlike
+the functions above, every barrier carries its own source and destination
+stage masks, so batching several barriers into a single command does not
+make each of them wait for the stages of all the others.
+*/
+
+/**
+A set of barriers that is used as the dependency of an event - vkCmdSetEvent2
+and vkCmdWaitEvents2 require the exact same dependency information for an
+event, so both are recorded from the same EventDependency.
+*/
+struct EventDependency {
+    VkEvent event;
+    const GlobalBarrier *pGlobalBarrier;
+    std::span<const BufferBarrier> bufferBarriers;
+    std::span<const ImageBarrier> imageBarriers;
+};
+
+/**
+Mapping function that translates a global barrier into a VkMemoryBarrier2
+with its own source and destination stages.
+*/
+void GetVulkanMemoryBarrier2(const GlobalBarrier &thBarrier, VkMemoryBarrier2 *pVkBarrier);
+
+/**
+Mapping function that translates a buffer barrier into a VkBufferMemoryBarrier2
+with its own source and destination stages.
+*/
+void GetVulkanBufferMemoryBarrier2(const BufferBarrier &thBarrier,
+                                   VkBufferMemoryBarrier2 *pVkBarrier);
+
+/**
+Mapping function that translates an image barrier into a VkImageMemoryBarrier2
+with its own source and destination stages.
+*/
+void GetVulkanImageMemoryBarrier2(const ImageBarrier &thBarrier,
+                                  VkImageMemoryBarrier2 *pVkBarrier);
+
+/**
+Simplified wrapper around vkCmdPipelineBarrier2.
+
+All barriers are translated with the mapping functions above and submitted
+with a single VkDependencyInfo.
+
+commandBuffer is passed unmodified to vkCmdPipelineBarrier2.
+*/
+void CmdPipelineBarrier2(Magnum::Vk::Device &device,
+                         VkCommandBuffer commandBuffer,
+                         const GlobalBarrier *pGlobalBarrier,
+                         std::span<const BufferBarrier> bufferBarriers,
+                         std::span<const ImageBarrier> imageBarriers,
+                         std::span<std::byte> scratch = {});
+
+/**
+Wrapper around vkCmdSetEvent2.
+
+Sets dependency.event when the first synchronization scope of the barriers
+in dependency is completed.
+
+commandBuffer is passed unmodified to vkCmdSetEvent2.
+*/
+void CmdSetEvent2(Magnum::Vk::Device &device,
+                  VkCommandBuffer commandBuffer,
+                  const EventDependency &dependency,
+                  std::span<std::byte> scratch = {});
+
+/**
+Wrapper around vkCmdWaitEvents2.
+
+Waits for all events in dependencies, each with the barriers it was set with.
+
+commandBuffer is passed unmodified to vkCmdWaitEvents2.
+*/
+void CmdWaitEvents2(Magnum::Vk::Device &device,
+                    VkCommandBuffer commandBuffer,
+                    std::span<const EventDependency> dependencies,
+                    std::span<std::byte> scratch = {});
+
+/**
+The size of the scratch memory that the commands above need to translate
+the given number of barriers without allocating. For CmdWaitEvents2,
+eventCount is the number of event dependencies.
+*/
+constexpr size_t BarrierScratchSize(size_t bufferBarrierCount,
+                                    size_t imageBarrierCount,
+                                    size_t eventCount = 1)
+{
+    // the synchronization2 structures are bigger than their legacy counterparts, so this is
+    // enough for both - plus padding for the alignment of each array
+    constexpr size_t arrayCount = 5;
+    return eventCount * (sizeof(VkEvent) + sizeof(VkDependencyInfo) + sizeof(VkMemoryBarrier2)) +
+           bufferBarrierCount * sizeof(VkBufferMemoryBarrier2) +
+           imageBarrierCount * sizeof(VkImageMemoryBarrier2) +
+           arrayCount * alignof(std::max_align_t);
+}
 } // namespace Cory::Sync
\ No newline at end of file
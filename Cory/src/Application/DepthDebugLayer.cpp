@@ -106,8 +106,6 @@ void DepthDebugLayer::onUpdate()
 RenderTaskDeclaration<LayerPassOutputs> DepthDebugLayer::renderTask(Cory::RenderTaskBuilder builder,
                                                                     LayerPassOutputs previousLayer)
 {
-    VkClearColorValue clearColor{0.0f, 0.0f, 0.0f, 1.0f};
-
     auto [writtenColorHandle, colorInfo] =
         builder.readWrite(previousLayer.color, Cory::Sync::AccessType::ColorAttachmentReadWrite);
     auto depthInfo =
@@ -117,10 +115,7 @@ RenderTaskDeclaration<LayerPassOutputs> DepthDebugLayer::renderTask(Cory::Render
     auto cubePass = builder.declareRenderPass("PASS_DepthDebug")
                         .shaders({state_->fullscreenTriShader, state_->depthDebugShader})
                         .disableMeshInput() // fullscreen triangle pass
-                        .attach(previousLayer.color,
-                                VkAttachmentLoadOp::VK_ATTACHMENT_LOAD_OP_LOAD,
-                                VK_ATTACHMENT_STORE_OP_STORE,
-                                clearColor)
+                        .attach(previousLayer.color)
                         .finish();
 
     /// ^^^^     DECLARATION      ^^^^
@@ -151,9 +146,9 @@ RenderTaskDeclaration<LayerPassOutputs> DepthDebugLayer::renderTask(Cory::Render
         .flushWrites()
         .bind(renderApi.cmd->handle(), frameCtx.index, ctx.defaultPipelineLayout());
 
-    cubePass.begin(*renderApi.cmd);
-
-    ctx.device()->CmdDraw(renderApi.cmd->handle(), 3, 1, 0, 0);
+    if (cubePass.begin(*renderApi.cmd)) {
+        ctx.device()->CmdDraw(renderApi.cmd->handle(), 3, 1, 0, 0);
+    }
     cubePass.end(*renderApi.cmd);
 }
 
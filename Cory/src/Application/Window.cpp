@@ -4,6 +4,7 @@
 #include <Cory/Base/Log.hpp>
 #include <Cory/Renderer/APIConversion.hpp>
 #include <Cory/Renderer/Context.hpp>
+#include <Cory/Renderer/ResourceManager.hpp>
 #include <Cory/Renderer/SingleShotCommandBuffer.hpp>
 #include <Cory/Renderer/Swapchain.hpp>
 
@@ -154,6 +155,8 @@ FrameContext Window::nextSwapchainImage()
         } while (dimensions_.x == 0 || dimensions_.y == 0);
 
         ctx_.device()->DeviceWaitIdle(ctx_.device());
+        // the fences of the old swapchain are gone, but the GPU is idle anyway
+        ctx_.resources().collectAll();
 
         // recreate the necessary resized resources and notify client code via
         // the onSwaphcainResized callback
@@ -182,6 +185,10 @@ void Window::submitAndPresent(FrameContext &frameCtx)
         std::vector<VkSemaphore> waitSemaphores{*frameCtx.acquired};
         std::vector<VkPipelineStageFlags> waitStages{VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
         std::vector<VkSemaphore> signalSemaphores{*frameCtx.rendered};
+        if (frameCtx.asyncComputeDone != nullptr) {
+            waitSemaphores.push_back(*frameCtx.asyncComputeDone);
+            waitStages.push_back(frameCtx.asyncComputeWaitStages);
+        }
 
         Magnum::Vk::SubmitInfo submitInfo{};
         submitInfo.setCommandBuffers({*frameCtx.commandBuffer});
@@ -0,0 +1,139 @@
+#include <Cory/Base/FileWatcher.hpp>
+
+#include <Cory/Base/Log.hpp>
+
+#include <algorithm>
+#include <array>
+#include <set>
+#include <unordered_map>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <sys/inotify.h>
+#include <unistd.h>
+#define CORY_FILEWATCHER_INOTIFY 1
+#endif
+
+namespace Cory {
+
+struct FileWatcherPrivate {
+    // key is the canonical path as a string, value is the last known modification time
+    std::unordered_map<std::string, std::filesystem::file_time_type> files;
+#ifdef CORY_FILEWATCHER_INOTIFY
+    int fd{-1};
+    // watch descriptor -> directory
+    std::unordered_map<int, std::filesystem::path> directories;
+    std::set<std::filesystem::path> watchedDirectories;
+#endif
+};
+
+namespace {
+std::filesystem::path canonicalPath(const std::filesystem::path &file)
+{
+    std::error_code ec;
+    auto path = std::filesystem::weakly_canonical(file, ec);
+    return ec ? std::filesystem::absolute(file) : path;
+}
+
+std::filesystem::file_time_type modificationTime(const std::filesystem::path &file)
+{
+    std::error_code ec;
+    const auto time = std::filesystem::last_write_time(file, ec);
+    return ec ? std::filesystem::file_time_type::min() : time;
+}
+} // namespace
+
+FileWatcher::FileWatcher()
+    : data_{std::make_unique<FileWatcherPrivate>()}
+{
+#ifdef CORY_FILEWATCHER_INOTIFY
+    data_->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (data_->fd < 0) {
+        CO_CORE_WARN("Could not initialize inotify ({}), falling back to polling file times",
+                     std::strerror(errno));
+    }
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef CORY_FILEWATCHER_INOTIFY
+    // if data_ is empty, object is moved-from
+    if (data_ && data_->fd >= 0) { close(data_->fd); }
+#endif
+}
+
+void FileWatcher::watch(const std::filesystem::path &file)
+{
+    const auto path = canonicalPath(file);
+    auto [it, inserted] = data_->files.emplace(path.string(), modificationTime(path));
+    if (!inserted) { return; }
+
+#ifdef CORY_FILEWATCHER_INOTIFY
+    const auto directory = path.parent_path();
+    if (data_->fd >= 0 && !data_->watchedDirectories.contains(directory)) {
+        const int wd = inotify_add_watch(
+            data_->fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (wd < 0) {
+            CO_CORE_WARN(
+                "Could not watch directory {}: {}", directory.string(), std::strerror(errno));
+        }
+        else {
+            data_->directories[wd] = directory;
+            data_->watchedDirectories.insert(directory);
+        }
+    }
+#endif
+}
+
+bool FileWatcher::isWatched(const std::filesystem::path &file) const
+{
+    return data_->files.contains(canonicalPath(file).string());
+}
+
+size_t FileWatcher::size() const { return data_->files.size(); }
+
+std::vector<std::filesystem::path> FileWatcher::poll()
+{
+    std::set<std::string> candidates;
+    bool usedInotify{false};
+#ifdef CORY_FILEWATCHER_INOTIFY
+    if (data_->fd >= 0) {
+        alignas(inotify_event) std::array<char, 4096> buffer;
+        ssize_t length;
+        while ((length = read(data_->fd, buffer.data(), buffer.size())) > 0) {
+            for (ssize_t offset = 0; offset < length;) {
+                const auto *event = reinterpret_cast<const inotify_event *>(&buffer[offset]);
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+                auto directory = data_->directories.find(event->wd);
+                if (event->len == 0 || directory == data_->directories.end()) { continue; }
+                auto path = (directory->second / event->name).string();
+                if (data_->files.contains(path)) { candidates.insert(std::move(path)); }
+            }
+        }
+        usedInotify = true;
+    }
+#endif
+    if (!usedInotify) {
+        for (const auto &[path, time] : data_->files) {
+            candidates.insert(path);
+        }
+    }
+
+    // an event does not necessarily mean that the file was changed, and an editor can produce
+    // several events for one save - only report files whose modification time changed
+    std::vector<std::filesystem::path> changed;
+    for (const auto &path : candidates) {
+        auto &lastTime = data_->files[path];
+        const auto time = modificationTime(path);
+        if (time != lastTime) {
+            lastTime = time;
+            changed.emplace_back(path);
+        }
+    }
+    return changed;
+}
+
+} // namespace Cory
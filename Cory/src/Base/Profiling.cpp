@@ -4,9 +4,14 @@
 
 namespace Cory {
 
+std::mutex Profiler::s_mutex;
 std::map<std::string, Profiler::Record> Profiler::s_records;
 
-void Profiler::PushCounter(std::string &name, int64_t deltaNs) { s_records[name].push(deltaNs); }
+void Profiler::PushCounter(std::string &name, int64_t deltaNs)
+{
+    const std::lock_guard lock{s_mutex};
+    s_records[name].push(deltaNs);
+}
 
 ScopeTimer::ScopeTimer(std::string name)
     : m_start{std::chrono::high_resolution_clock::now()}
@@ -0,0 +1,83 @@
+#include <Cory/Framegraph/AliasingPlanner.hpp>
+
+#include <algorithm>
+#include <numeric>
+
+namespace Cory {
+
+namespace {
+uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    if (alignment <= 1) { return value; }
+    return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+AliasingPlan planMemoryAliasing(std::span<const AliasingRequest> requests)
+{
+    const auto count = static_cast<uint32_t>(requests.size());
+    AliasingPlan plan{.offsets = std::vector<uint64_t>(count, 0),
+                      .predecessors = std::vector<std::vector<uint32_t>>(count),
+                      .heapSize = 0};
+
+    // place big resources first - they are the hardest to fit into gaps later on
+    std::vector<uint32_t> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t lhs, uint32_t rhs) {
+        return requests[lhs].size > requests[rhs].size;
+    });
+
+    struct Range {
+        uint64_t begin;
+        uint64_t end;
+    };
+    std::vector<uint32_t> placed;
+    std::vector<Range> occupied;
+    placed.reserve(count);
+    occupied.reserve(count);
+
+    for (const uint32_t idx : order) {
+        const AliasingRequest &request = requests[idx];
+
+        // collect the memory ranges of all placed resources that are alive at the same time
+        occupied.clear();
+        for (const uint32_t other : placed) {
+            if (!requests[other].lifetime.overlaps(request.lifetime)) { continue; }
+            occupied.push_back({plan.offsets[other], plan.offsets[other] + requests[other].size});
+        }
+        std::sort(occupied.begin(), occupied.end(), [](const Range &lhs, const Range &rhs) {
+            return lhs.begin < rhs.begin;
+        });
+
+        // first fit into the gaps between the occupied ranges
+        uint64_t offset = 0;
+        for (const Range &range : occupied) {
+            if (alignUp(offset, request.alignment) + request.size <= range.begin) { break; }
+            offset = std::max(offset, range.end);
+        }
+        offset = alignUp(offset, request.alignment);
+
+        plan.offsets[idx] = offset;
+        plan.heapSize = std::max(plan.heapSize, offset + request.size);
+        placed.push_back(idx);
+    }
+
+    // determine which resources reuse memory of resources that were used earlier in the frame
+    for (uint32_t idx = 0; idx < count; ++idx) {
+        const uint64_t begin = plan.offsets[idx];
+        const uint64_t end = begin + requests[idx].size;
+        for (uint32_t other = 0; other < count; ++other) {
+            const uint64_t otherBegin = plan.offsets[other];
+            const uint64_t otherEnd = otherBegin + requests[other].size;
+            const bool memoryOverlaps = begin < otherEnd && otherBegin < end;
+            if (other != idx && memoryOverlaps &&
+                requests[other].lifetime.lastUse < requests[idx].lifetime.firstUse) {
+                plan.predecessors[idx].push_back(other);
+            }
+        }
+    }
+
+    return plan;
+}
+
+} // namespace Cory
@@ -43,48 +43,71 @@ TransientTextureHandle RenderTaskBuilder::create(std::string name,
                                        PixelFormat format,
                                        Sync::AccessType writeAccess)
 {
-    const TextureInfo info{.name = std::move(name), .size = size, .format = format};
+    return create(TextureInfo{.name = std::move(name), .size = size, .format = format},
+                  writeAccess);
+}
+
+TransientTextureHandle
+RenderTaskBuilder::create(TextureInfo info, Sync::AccessType writeAccess, SubresourceRange range)
+{
+    CO_CORE_ASSERT(info.mipLevels > 0 && info.arrayLayers > 0,
+                   "Texture '{}' needs at least one mip level and array layer!",
+                   info.name);
+    checkRange(info, range);
 
-    auto handle = TransientTextureHandle{framegraph_.resources().declareTexture(info)};
+    auto handle = TransientTextureHandle{framegraph_.resources().declareTexture(std::move(info))};
 
     info_.dependencies.push_back(RenderTaskInfo::Dependency{
         .kind = TaskDependencyKindBits::CreateWrite,
         .handle = handle,
         .access = writeAccess,
+        .range = range,
     });
     return handle;
 }
 
-TextureInfo RenderTaskBuilder::read(TransientTextureHandle &handle, Sync::AccessType readAccess)
+TextureInfo RenderTaskBuilder::read(TransientTextureHandle &handle,
+                                    Sync::AccessType readAccess,
+                                    SubresourceRange range)
 {
+    const TextureInfo &info = framegraph_.resources().info(handle.texture());
+    checkRange(info, range);
     info_.dependencies.push_back(RenderTaskInfo::Dependency{
-        .kind = TaskDependencyKindBits::Read, .handle = handle, .access = readAccess});
-    return framegraph_.resources().info(handle.texture());
+        .kind = TaskDependencyKindBits::Read,
+        .handle = handle,
+        .access = readAccess,
+        .range = range,
+    });
+    return info;
 }
 
-std::pair<TransientTextureHandle, TextureInfo>
-RenderTaskBuilder::write(TransientTextureHandle handle,
-                                                              Sync::AccessType writeAccess)
+std::pair<TransientTextureHandle, TextureInfo> RenderTaskBuilder::write(
+    TransientTextureHandle handle, Sync::AccessType writeAccess, SubresourceRange range)
 {
+    checkRange(framegraph_.resources().info(handle.texture()), range);
+
     // increase the version of the texture handle to record the modification
     auto outputHandle = handle + 1;
     info_.dependencies.push_back({
         .kind = TaskDependencyKindBits::Write,
         .handle = outputHandle,
         .access = writeAccess,
+        .range = range,
     });
 
     return {outputHandle, framegraph_.resources().info(outputHandle.texture())};
 }
 
-std::pair<TransientTextureHandle, TextureInfo>
-RenderTaskBuilder::readWrite(TransientTextureHandle handle,
-                                                                  Sync::AccessType readWriteAccess)
+std::pair<TransientTextureHandle, TextureInfo> RenderTaskBuilder::readWrite(
+    TransientTextureHandle handle, Sync::AccessType readWriteAccess, SubresourceRange range)
 {
+    checkRange(framegraph_.resources().info(handle.texture()), range);
+
     info_.dependencies.push_back({
         .kind = TaskDependencyKindBits::Read,
         .handle = handle,
         .access = readWriteAccess,
+        .range = range,
     });
 
     // increase the version of the texture handle to record the modification
@@ -94,15 +117,102 @@ RenderTaskBuilder::readWrite(TransientTextureHandle handle,
         .kind = TaskDependencyKindBits::ReadWrite,
         .handle = outputHandle,
         .access = readWriteAccess,
+        .range = range,
     });
 
     return {outputHandle, framegraph_.resources().info(handle.texture())};
 }
 
+TransientBufferHandle RenderTaskBuilder::createBuffer(std::string name,
+                                                     uint64_t size,
+                                                     BufferUsage usage,
+                                                     Sync::AccessType writeAccess)
+{
+    const BufferInfo info{.name = std::move(name), .size = size, .usage = usage};
+
+    auto handle = TransientBufferHandle{framegraph_.resources().declareBuffer(info)};
+
+    info_.bufferDependencies.push_back(RenderTaskInfo::BufferDependency{
+        .kind = TaskDependencyKindBits::CreateWrite,
+        .handle = handle,
+        .access = writeAccess,
+    });
+    return handle;
+}
+
+BufferInfo RenderTaskBuilder::read(TransientBufferHandle &handle, Sync::AccessType readAccess)
+{
+    info_.bufferDependencies.push_back(RenderTaskInfo::BufferDependency{
+        .kind = TaskDependencyKindBits::Read, .handle = handle, .access = readAccess});
+    return framegraph_.resources().info(handle.buffer());
+}
+
+std::pair<TransientBufferHandle, BufferInfo>
+RenderTaskBuilder::write(TransientBufferHandle handle, Sync::AccessType writeAccess)
+{
+    // increase the version of the buffer handle to record the modification
+    auto outputHandle = handle + 1;
+    info_.bufferDependencies.push_back({
+        .kind = TaskDependencyKindBits::Write,
+        .handle = outputHandle,
+        .access = writeAccess,
+    });
+
+    return {outputHandle, framegraph_.resources().info(outputHandle.buffer())};
+}
+
+std::pair<TransientBufferHandle, BufferInfo>
+RenderTaskBuilder::readWrite(TransientBufferHandle handle, Sync::AccessType readWriteAccess)
+{
+    info_.bufferDependencies.push_back({
+        .kind = TaskDependencyKindBits::Read,
+        .handle = handle,
+        .access = readWriteAccess,
+    });
+
+    // increase the version of the buffer handle to record the modification
+    auto outputHandle = handle + 1;
+
+    info_.bufferDependencies.push_back({
+        .kind = TaskDependencyKindBits::ReadWrite,
+        .handle = outputHandle,
+        .access = readWriteAccess,
+    });
+
+    return {outputHandle, framegraph_.resources().info(handle.buffer())};
+}
+
+RenderTaskBuilder &RenderTaskBuilder::allowParallelRecording()
+{
+    info_.parallelRecording = true;
+    return *this;
+}
+
+RenderTaskBuilder &RenderTaskBuilder::runOnAsyncCompute()
+{
+    info_.asyncCompute = true;
+    return *this;
+}
+
 TransientRenderPassBuilder RenderTaskBuilder::declareRenderPass(std::string_view name)
 {
     return TransientRenderPassBuilder{
-        ctx_, name.empty() ? info_.name : name, framegraph_.resources()};
+        ctx_, name.empty() ? info_.name : name, framegraph_.resources(), &info_};
+}
+
+void RenderTaskBuilder::checkRange(const TextureInfo &info, SubresourceRange range) const
+{
+    const SubresourceRange clamped = range.clamped(info);
+    CO_CORE_ASSERT(range.baseMipLevel < info.mipLevels && range.baseArrayLayer < info.arrayLayers &&
+                       clamped.levelCount > 0 && clamped.layerCount > 0 &&
+                       clamped.baseMipLevel + clamped.levelCount <= info.mipLevels &&
+                       clamped.baseArrayLayer + clamped.layerCount <= info.arrayLayers,
+                   "Render task '{}': subresource range is outside of texture '{}' ({} mip "
+                   "levels, {} array layers)",
+                   info_.name,
+                   info.name,
+                   info.mipLevels,
+                   info.arrayLayers);
 }
 // </editor-fold>
 } // namespace Cory
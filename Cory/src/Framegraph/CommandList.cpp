@@ -104,6 +104,10 @@ CommandList &CommandList::beginRenderPass(PipelineHandle pipelineHandle,
 {
     cmdBuffer_->bindPipeline(ctx_->resources()[pipelineHandle]);
 
+    return beginRenderPass(renderingInfo);
+}
+CommandList &CommandList::beginRenderPass(const VkRenderingInfo *renderingInfo)
+{
     ctx_->device()->CmdBeginRendering(*cmdBuffer_, renderingInfo);
     return *this;
 }
@@ -5,31 +5,212 @@
 #include <Cory/Base/Profiling.hpp>
 #include <Cory/Framegraph/CommandList.hpp>
 #include <Cory/Framegraph/TextureManager.hpp>
+#include <Cory/Framegraph/TransientTexturePool.hpp>
 #include <Cory/Renderer/Context.hpp>
+#include <Cory/Renderer/ResourceManager.hpp>
+#include <Cory/Renderer/VulkanUtils.hpp>
 
+#include <Magnum/Vk/Buffer.h>
 #include <Magnum/Vk/CommandBuffer.h>
+#include <Magnum/Vk/CommandPool.h>
+#include <Magnum/Vk/CommandPoolCreateInfo.h>
+#include <Magnum/Vk/Device.h>
+#include <Magnum/Vk/Fence.h>
+#include <Magnum/Vk/Image.h>
+#include <Magnum/Vk/Queue.h>
 
-#include <range/v3/algorithm/contains.hpp>
-#include <range/v3/algorithm/sort.hpp>
-#include <range/v3/algorithm/transform.hpp>
-#include <range/v3/range/conversion.hpp>
-#include <range/v3/view/filter.hpp>
-#include <range/v3/view/transform.hpp>
+#include <cppcoro/static_thread_pool.hpp>
+#include <cppcoro/sync_wait.hpp>
+#include <cppcoro/task.hpp>
+#include <cppcoro/when_all.hpp>
 
-#include <deque>
+#include <gsl/narrow>
+#include <range/v3/algorithm/find_if.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <list>
+#include <memory_resource>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 
 namespace Vk = Magnum::Vk;
 
 namespace Cory {
 
+/**
+ * the structure of a declared graph: tasks, their dependencies and the textures and buffers
+ * involved.
+ *
+ * tasks, textures and buffers are identified by the order in which they are encountered rather
+ * than by their handles, so graphs declared identically in different frames have the same
+ * signature.
+ */
+struct GraphSignature {
+    std::size_t hash{};
+    std::vector<uint64_t> signature;
+    std::vector<SlotMapHandle> tasks;    ///< ordinal -> task
+    std::vector<TextureHandle> textures; ///< ordinal -> texture
+    std::unordered_map<TextureHandle, uint32_t> textureOrdinals;
+    std::vector<BufferResourceHandle> buffers; ///< ordinal -> buffer
+    std::unordered_map<BufferResourceHandle, uint32_t> bufferOrdinals;
+};
+
+/// how a compiled graph is recorded: the tasks and barriers of each dependency level
+struct RecordingPlan {
+    /// indices into ExecutionInfo::tasks, level by level - the tasks of level l are
+    /// tasks[levelTasks[l]] to tasks[levelTasks[l + 1] - 1]
+    std::vector<uint32_t> tasks;
+    std::vector<uint32_t> levelTasks;
+    /// the barriers issued at the start of each level (with the texture they refer to), laid out
+    /// the same way as the tasks
+    std::vector<Sync::ImageBarrier> barriers;
+    std::vector<TextureHandle> barrierTextures;
+    std::vector<uint32_t> levelBarriers;
+    /// the barriers of level l starting at levelSplitBarriers[l] are split barriers: they wait
+    /// for the events events[levelEvents[l]] to events[levelEvents[l + 1] - 1]
+    std::vector<uint32_t> levelSplitBarriers;
+    std::vector<uint32_t> levelEvents;
+    /// the buffer barriers issued at the start of each level, laid out the same way as the
+    /// (unsplit) image barriers
+    std::vector<Sync::BufferBarrier> bufferBarriers;
+    std::vector<BufferResourceHandle> bufferBarrierBuffers;
+    std::vector<uint32_t> levelBufferBarriers;
+
+    /// an event that is set after a level, and waited on by the split barriers of a later level -
+    /// both with the barriers barriers[firstBarrier] to barriers[lastBarrier - 1]
+    struct SplitEvent {
+        uint32_t setAfterLevel;
+        uint32_t firstBarrier{};
+        uint32_t lastBarrier{};
+    };
+    std::vector<SplitEvent> events;
+    /// the events to set after level l are setEvents[levelSetEvents[l]] to
+    /// setEvents[levelSetEvents[l + 1] - 1]
+    std::vector<uint32_t> setEvents;
+    std::vector<uint32_t> levelSetEvents;
+
+    /// indices into ExecutionInfo::tasks of the async compute tasks, in the order they are
+    /// recorded - the barriers issued before computeTasks[i] are computeBarriers[
+    /// computeTaskBarriers[i]] to computeBarriers[computeTaskBarriers[i + 1] - 1]
+    std::vector<uint32_t> computeTasks;
+    std::vector<Sync::ImageBarrier> computeBarriers;
+    std::vector<TextureHandle> computeBarrierTextures;
+    std::vector<uint32_t> computeTaskBarriers;
+    std::vector<Sync::BufferBarrier> computeBufferBarriers;
+    std::vector<BufferResourceHandle> computeBufferBarrierBuffers;
+    std::vector<uint32_t> computeTaskBufferBarriers;
+    /// queue family ownership releases at the end of the async compute work, matching the
+    /// acquiring barriers on the graphics queue
+    std::vector<Sync::ImageBarrier> releaseBarriers;
+    std::vector<Sync::BufferBarrier> bufferReleaseBarriers;
+    /// the stages in which the graphics work waits for the async compute work, 0 if it doesn't
+    /// depend on it at all
+    VkPipelineStageFlags computeWaitStages{};
+
+    [[nodiscard]] uint32_t levelCount() const
+    {
+        return levelTasks.empty() ? 0 : static_cast<uint32_t>(levelTasks.size() - 1);
+    }
+
+    /// the compute queue releases everything that the graphics queue acquires from it
+    void collectReleaseBarriers()
+    {
+        releaseBarriers.clear();
+        bufferReleaseBarriers.clear();
+        for (const Sync::ImageBarrier &barrier : barriers) {
+            if (barrier.srcQueueFamilyIndex != barrier.dstQueueFamilyIndex) {
+                releaseBarriers.push_back(barrier);
+            }
+        }
+        for (const Sync::BufferBarrier &barrier : bufferBarriers) {
+            if (barrier.srcQueueFamilyIndex != barrier.dstQueueFamilyIndex) {
+                bufferReleaseBarriers.push_back(barrier);
+            }
+        }
+    }
+};
+
+/// the result of compiling a graph, stored in terms of task, texture and buffer ordinals
+struct CompiledGraph {
+    std::size_t hash{};
+    std::vector<uint64_t> signature;
+    std::vector<uint32_t> taskOrder;          ///< task ordinals in execution order
+    std::vector<int32_t> executionPriorities; ///< per task ordinal
+    std::vector<uint32_t> resources;          ///< texture ordinals
+    std::vector<ResourceLifetime> lifetimes;
+    std::vector<uint32_t> buffers;            ///< buffer ordinals
+    std::vector<ResourceLifetime> bufferLifetimes;
+    std::vector<bool> asyncCompute;           ///< per entry in taskOrder
+    std::vector<uint32_t> levels;             ///< per entry in taskOrder
+
+    /// the results of planTextureUsage(), per texture ordinal
+    std::vector<VkImageUsageFlags> textureUsage;
+    std::vector<uint8_t> memoryless;
+    /// the consumed texture versions, as texture ordinal << 32 | version
+    std::vector<uint64_t> consumed;
+
+    /// the result of planRecording() - the textures and buffers of its barriers are replaced by
+    /// the ones of the current frame when it is reused
+    RecordingPlan plan;
+    std::vector<uint32_t> barrierTextures;             ///< texture ordinal per plan.barriers
+    std::vector<uint32_t> bufferBarrierBuffers;        ///< buffer ordinal per plan.bufferBarriers
+    std::vector<uint32_t> computeBarrierTextures;      ///< per plan.computeBarriers
+    std::vector<uint32_t> computeBufferBarrierBuffers; ///< per plan.computeBufferBarriers
+    std::vector<ExecutionInfo::TransitionInfo> transitions;
+    std::vector<uint32_t> transitionTasks;    ///< task ordinal per transition
+    std::vector<uint32_t> transitionTextures; ///< texture ordinal per transition
+    std::vector<ExecutionInfo::BufferTransitionInfo> bufferTransitions;
+    std::vector<uint32_t> bufferTransitionTasks;   ///< task ordinal per buffer transition
+    std::vector<uint32_t> bufferTransitionBuffers; ///< buffer ordinal per buffer transition
+};
+
+/// number of compiled graph variants that are kept around
+static constexpr size_t COMPILED_GRAPH_CACHE_SIZE{8};
+
+/// the command buffer for the async compute tasks of a frame, and its synchronization
+struct AsyncComputeSubmission {
+    Vk::CommandPool pool{Corrade::NoCreate};
+    Vk::CommandBuffer commandBuffer{Corrade::NoCreate};
+    Vk::Fence fence{Corrade::NoCreate};
+    Semaphore done;
+    bool submitted{false};
+};
+
+/// a command pool for recording secondary command buffers, used by one worker at a time
+struct SecondaryCommandPool {
+    Vk::CommandPool pool{Corrade::NoCreate};
+    std::vector<Vk::CommandBuffer> buffers;
+    size_t used{};
+
+    /// get the next unused command buffer - buffers are reused after the pool has been reset
+    Vk::CommandBuffer &next()
+    {
+        if (used == buffers.size()) {
+            buffers.push_back(pool.allocate(Vk::CommandBufferLevel::Secondary));
+        }
+        return buffers[used++];
+    }
+};
+
 struct FramegraphPrivate {
-    FramegraphPrivate(Context &ctx_param)
+    explicit FramegraphPrivate(Context &ctx_param)
         : ctx{&ctx_param}
         , resources{ctx_param}
     {
     }
+    FramegraphPrivate(Context &ctx_param, std::shared_ptr<TransientTexturePool> pool)
+        : ctx{&ctx_param}
+        , resources{ctx_param, std::move(pool)}
+    {
+    }
 
     Context *ctx;
     TextureManager resources;
@@ -37,10 +218,199 @@ struct FramegraphPrivate {
     std::vector<TransientTextureHandle> outputs;
 
     SlotMap<RenderTaskInfo> renderTasks;
-    CommandList *commandListInProgress{};
+    // total number of dependencies of all declared tasks
+    size_t dependencyCount{};
+    // backing memory for the temporary data structures in resolve(), reused across frames
+    std::vector<std::byte> resolveArena;
+    // most recently used first
+    std::list<CompiledGraph> compiledGraphs;
+    // one pool per worker that records tasks in parallel, reset in resetForNextFrame()
+    std::vector<SecondaryCommandPool> secondaryPools;
+    // planned in compile(), storage is reused across frames
+    RecordingPlan plan;
+    // events for split barriers, reset in resetForNextFrame()
+    std::vector<GpuEvent> events;
+    size_t usedEvents{};
+    // temporary memory to translate the barriers of a level, sized in planRecording()
+    std::vector<std::byte> barrierScratch;
+    std::vector<Sync::EventDependency> waitDependencies;
+    // scratch buffers to record the tasks of a level on worker threads, cleared for every level
+    std::vector<std::pair<size_t, RenderTaskHandle>> parallelTasks;
+    std::vector<VkCommandBuffer> secondaries;
+    std::vector<cppcoro::task<>> workers;
+    std::vector<VkCommandBuffer> pendingSecondaries;
+    // created on first use, waited for in resetForNextFrame()
+    AsyncComputeSubmission asyncCompute;
     FrameContext *currentFrameCtx{};
 };
 
+namespace {
+/// the arena memory needed for an array of @a count elements of type T
+template <typename T> constexpr size_t arenaBytes(size_t count)
+{
+    return count * sizeof(T) + alignof(T);
+}
+
+/// allocates from the heap like std::pmr::new_delete_resource(), and counts how much - used as
+/// the upstream of an arena to find out how much larger the arena needs to be
+class OverflowResource : public std::pmr::memory_resource {
+  public:
+    [[nodiscard]] size_t bytes() const { return bytes_; }
+
+  private:
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+        bytes_ += bytes + alignment;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    size_t bytes_{};
+};
+
+/// run @a work on a thread of the given @a pool
+cppcoro::task<> runOnWorker(cppcoro::static_thread_pool &pool, std::function<void()> work)
+{
+    co_await pool.schedule();
+    work();
+}
+
+/// reorder the elements of @a values from @a begin on, so element i comes from order[i - begin]
+template <typename T>
+void permuteTail(std::vector<T> &values, uint32_t begin, std::span<const uint32_t> order)
+{
+    std::vector<T> tail;
+    tail.reserve(order.size());
+    for (const uint32_t idx : order) {
+        tail.push_back(std::move(values[idx]));
+    }
+    std::move(tail.begin(), tail.end(), values.begin() + begin);
+}
+
+/// the texture or buffer that a versioned handle refers to
+TextureHandle resourceOf(const TransientTextureHandle &handle) { return handle.texture(); }
+BufferResourceHandle resourceOf(const TransientBufferHandle &handle) { return handle.buffer(); }
+
+/// call @a fn with each texture dependency and then each buffer dependency of @a task
+template <typename Fn> void forEachDependency(const RenderTaskInfo &task, Fn &&fn)
+{
+    for (const RenderTaskInfo::Dependency &dependency : task.dependencies) {
+        fn(dependency);
+    }
+    for (const RenderTaskInfo::BufferDependency &dependency : task.bufferDependencies) {
+        fn(dependency);
+    }
+}
+
+/// whether @a access only uses a texture as a color or depth/stencil attachment
+bool isAttachmentAccess(Sync::AccessType access)
+{
+    switch (access) {
+    case Sync::AccessType::ColorAttachmentRead:
+    case Sync::AccessType::DepthStencilAttachmentRead:
+    case Sync::AccessType::ColorAttachmentWrite:
+    case Sync::AccessType::DepthStencilAttachmentWrite:
+    case Sync::AccessType::DepthAttachmentWriteStencilReadOnly:
+    case Sync::AccessType::StencilAttachmentWriteDepthReadOnly:
+    case Sync::AccessType::ColorAttachmentReadWrite:
+        return true;
+    default:
+        return false;
+    }
+}
+
+template <typename Dependency>
+constexpr bool IsBufferDependency =
+    std::is_same_v<std::remove_cvref_t<Dependency>, RenderTaskInfo::BufferDependency>;
+
+/// the mip levels and array layers that @a barrier synchronizes
+SubresourceRange subresourcesOf(const Sync::ImageBarrier &barrier)
+{
+    return SubresourceRange{.baseMipLevel = barrier.subresourceRange.baseMipLevel,
+                            .levelCount = barrier.subresourceRange.levelCount,
+                            .baseArrayLayer = barrier.subresourceRange.baseArrayLayer,
+                            .layerCount = barrier.subresourceRange.layerCount};
+}
+
+/// extend the subresources of @a barrier by the ones of @a next, if the barriers are identical
+/// otherwise and the subresources of both together form a range again
+bool mergeSubresources(Sync::ImageBarrier &barrier, const Sync::ImageBarrier &next)
+{
+    const auto sameAccesses = [](const Sync::AccessList &lhs, const Sync::AccessList &rhs) {
+        return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    };
+    if (barrier.image != next.image || !sameAccesses(barrier.prevAccesses, next.prevAccesses) ||
+        !sameAccesses(barrier.nextAccesses, next.nextAccesses) ||
+        barrier.prevLayout != next.prevLayout || barrier.nextLayout != next.nextLayout ||
+        barrier.discardContents != next.discardContents ||
+        barrier.srcQueueFamilyIndex != next.srcQueueFamilyIndex ||
+        barrier.dstQueueFamilyIndex != next.dstQueueFamilyIndex) {
+        return false;
+    }
+
+    VkImageSubresourceRange &range = barrier.subresourceRange;
+    const VkImageSubresourceRange &nextRange = next.subresourceRange;
+    if (range.baseMipLevel == nextRange.baseMipLevel && range.levelCount == nextRange.levelCount &&
+        range.baseArrayLayer + range.layerCount == nextRange.baseArrayLayer) {
+        range.layerCount += nextRange.layerCount;
+        return true;
+    }
+    if (range.baseArrayLayer == nextRange.baseArrayLayer &&
+        range.layerCount == nextRange.layerCount &&
+        range.baseMipLevel + range.levelCount == nextRange.baseMipLevel) {
+        range.levelCount += nextRange.levelCount;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * merge the barriers from @a begin on that synchronize neighbouring subresources the same way
+ *
+ * Subresources are synchronized one by one, this brings e.g. a whole mip chain back to a single
+ * barrier. Barriers are only merged if their entries in all @a parallel arrays are the same, and
+ * the parallel arrays are compacted along with the barriers.
+ */
+template <typename... Parallel>
+void mergeSubresourceBarriers(std::vector<Sync::ImageBarrier> &barriers,
+                              size_t begin,
+                              std::vector<Parallel> &...parallel)
+{
+    const auto sameKeys = [&](size_t lhs, size_t rhs) {
+        return ((parallel[lhs] == parallel[rhs]) && ...);
+    };
+    const auto mergeInto = [&](size_t target, size_t source) {
+        return sameKeys(target, source) && mergeSubresources(barriers[target], barriers[source]);
+    };
+
+    // barriers[begin] to barriers[kept - 1] are the merged barriers so far
+    size_t kept = begin;
+    for (size_t i = begin; i < barriers.size(); ++i) {
+        if (kept > begin && mergeInto(kept - 1, i)) {
+            // the grown barrier may now complete a row of the one before it
+            while (kept - 1 > begin && mergeInto(kept - 2, kept - 1)) {
+                --kept;
+            }
+            continue;
+        }
+        if (kept != i) {
+            barriers[kept] = barriers[i];
+            ((parallel[kept] = parallel[i]), ...);
+        }
+        ++kept;
+    }
+    barriers.resize(kept);
+    (parallel.resize(kept), ...);
+}
+} // namespace
+
 RenderTaskBuilder Framegraph::Framegraph::declareTask(std::string_view name)
 {
     //
@@ -52,6 +422,11 @@ Framegraph::Framegraph(Context &ctx)
 {
 }
 
+Framegraph::Framegraph(Context &ctx, std::shared_ptr<TransientTexturePool> pool)
+    : data_{std::make_unique<FramegraphPrivate>(ctx, std::move(pool))}
+{
+}
+
 Framegraph::~Framegraph()
 {
     // if data_ is empty, object is moved-from
@@ -75,25 +450,47 @@ ExecutionInfo Framegraph::record(FrameContext &frameCtx)
 
     const Cory::ScopeTimer s2{"Framegraph/Execute/Record"};
     CommandList cmd{*data_->ctx, *frameCtx.commandBuffer};
-
-    data_->commandListInProgress = &cmd;
     data_->currentFrameCtx = &frameCtx;
 
-    auto resetCmdList = gsl::finally([this]() { data_->commandListInProgress = nullptr; });
+    // get the events for the split barriers of this frame
+    const size_t eventCount = data_->plan.events.size();
+    for (size_t i = data_->events.size(); i < eventCount; ++i) {
+        data_->events.push_back(data_->ctx->createEvent(fmt::format("Framegraph event {}", i)));
+    }
+    data_->usedEvents = eventCount;
+
+    // submit the async compute work right away, so it can run while the graphics work is recorded
+    recordAsyncCompute(executionInfo, frameCtx);
 
-    for (const auto &handle : executionInfo.tasks) {
-        auto transitions = executePass(cmd, handle);
-        executionInfo.transitions.insert(
-            executionInfo.transitions.end(), transitions.begin(), transitions.end());
+    for (uint32_t level = 0; level < data_->plan.levelCount(); ++level) {
+        recordLevel(cmd, executionInfo, level);
     }
     return executionInfo;
 }
 
+ExecutionInfo Framegraph::dryRun() { return resolve(data_->outputs); }
+
 void Framegraph::resetForNextFrame()
 {
+    AsyncComputeSubmission &compute = data_->asyncCompute;
+    if (compute.submitted) {
+        compute.fence.wait();
+        compute.fence.reset();
+        compute.pool.reset();
+        compute.submitted = false;
+    }
     data_->resources.clear();
     data_->externalInputs.clear();
     data_->outputs.clear();
+    data_->dependencyCount = 0;
+    for (SecondaryCommandPool &pool : data_->secondaryPools) {
+        pool.pool.reset();
+        pool.used = 0;
+    }
+    for (size_t i = 0; i < data_->usedEvents; ++i) {
+        data_->ctx->device()->ResetEvent(data_->ctx->device(), data_->events[i]);
+    }
+    data_->usedEvents = 0;
 
     for (RenderTaskInfo &info : data_->renderTasks) { // NOLINT (false positive)
         info.coroHandle.destroy();
@@ -101,39 +498,252 @@ void Framegraph::resetForNextFrame()
     data_->renderTasks.clear();
 }
 
-std::vector<ExecutionInfo::TransitionInfo> Framegraph::executePass(CommandList &cmd,
-                                                                   RenderTaskHandle handle)
+void Framegraph::recordLevel(CommandList &cmd, const ExecutionInfo &execInfo, uint32_t levelIdx)
 {
-    std::vector<ExecutionInfo::TransitionInfo> transitions;
-    const RenderTaskInfo &rpInfo = data_->renderTasks[handle];
-    const Cory::ScopeTimer s1{fmt::format("Framegraph/Execute/Record/{}", rpInfo.name)};
+    const RecordingPlan &plan = data_->plan;
+    const auto level = std::span{plan.tasks}.subspan(
+        plan.levelTasks[levelIdx], plan.levelTasks[levelIdx + 1] - plan.levelTasks[levelIdx]);
+    const auto barriers =
+        std::span{plan.barriers}.subspan(plan.levelBarriers[levelIdx],
+                                         plan.levelSplitBarriers[levelIdx] -
+                                             plan.levelBarriers[levelIdx]);
+    const auto splitBarriers =
+        std::span{plan.barriers}.subspan(plan.levelSplitBarriers[levelIdx],
+                                         plan.levelBarriers[levelIdx + 1] -
+                                             plan.levelSplitBarriers[levelIdx]);
+    const auto bufferBarriers =
+        std::span{plan.bufferBarriers}.subspan(plan.levelBufferBarriers[levelIdx],
+                                               plan.levelBufferBarriers[levelIdx + 1] -
+                                                   plan.levelBufferBarriers[levelIdx]);
+    auto &device = data_->ctx->device();
 
-    CO_CORE_TRACE("Setting up Render pass {}", rpInfo.name);
+    // synchronize the textures and buffers of all tasks in the level with a single barrier, and
+    // wait for the events of the split barriers
+    if (!barriers.empty() || !bufferBarriers.empty()) {
+        Sync::CmdPipelineBarrier2(
+            device, cmd.handle(), nullptr, bufferBarriers, barriers, data_->barrierScratch);
+    }
+    if (!splitBarriers.empty()) {
+        auto &dependencies = data_->waitDependencies;
+        dependencies.clear();
+        for (uint32_t i = plan.levelEvents[levelIdx]; i < plan.levelEvents[levelIdx + 1]; ++i) {
+            dependencies.push_back(eventDependency(i));
+        }
+        Sync::CmdWaitEvents2(device, cmd.handle(), dependencies, data_->barrierScratch);
+    }
+    for (uint32_t barrierIdx = plan.levelBarriers[levelIdx];
+         barrierIdx < plan.levelBarriers[levelIdx + 1];
+         ++barrierIdx) {
+        data_->resources.setLastAccess(plan.barrierTextures[barrierIdx],
+                                       plan.barriers[barrierIdx].nextAccesses.back(),
+                                       subresourcesOf(plan.barriers[barrierIdx]));
+    }
+    for (uint32_t barrierIdx = plan.levelBufferBarriers[levelIdx];
+         barrierIdx < plan.levelBufferBarriers[levelIdx + 1];
+         ++barrierIdx) {
+        data_->resources.setLastAccess(plan.bufferBarrierBuffers[barrierIdx],
+                                       plan.bufferBarriers[barrierIdx].nextAccesses.back());
+    }
 
-    auto emitBarrier = [&](const RenderTaskInfo::Dependency &resourceInfo) {
-        transitions.push_back(ExecutionInfo::TransitionInfo{
-            .kind = resourceInfo.kind,
-            .task = handle,
-            .resource = resourceInfo.handle,
-            .stateBefore = data_->resources.state(resourceInfo.handle).lastAccess,
-            .stateAfter = resourceInfo.access});
+    // (position in level, task) of all tasks that can be recorded on a worker thread
+    auto &parallelTasks = data_->parallelTasks;
+    parallelTasks.clear();
+    for (size_t pos = 0; pos < level.size(); ++pos) {
+        const RenderTaskHandle handle = execInfo.tasks[level[pos]];
+        if (data_->renderTasks[handle].parallelRecording) {
+            parallelTasks.emplace_back(pos, handle);
+        }
+    }
 
-        // only discard if it is not a read/write dependency
-        const auto contentsMode = resourceInfo.kind.is_set(TaskDependencyKindBits::Read)
-                                      ? ImageContents::Retain
-                                      : ImageContents::Discard;
+    // not worth the overhead of secondary command buffers if there is nothing to parallelize
+    auto &workerPool = data_->ctx->workerPool();
+    if (parallelTasks.size() < 2 || workerPool.thread_count() < 2) {
+        for (const uint32_t taskIdx : level) {
+            executeTask(cmd, execInfo.tasks[taskIdx]);
+        }
+    }
+    else {
+        recordParallel(cmd, execInfo, level, parallelTasks);
+    }
 
-        return data_->resources.synchronizeTexture(
-            resourceInfo.handle, resourceInfo.access, contentsMode);
-    };
+    // release the textures that are only consumed a few levels later
+    for (uint32_t i = plan.levelSetEvents[levelIdx]; i < plan.levelSetEvents[levelIdx + 1]; ++i) {
+        Sync::CmdSetEvent2(
+            device, cmd.handle(), eventDependency(plan.setEvents[i]), data_->barrierScratch);
+    }
+}
+
+void Framegraph::recordAsyncCompute(const ExecutionInfo &execInfo, FrameContext &frameCtx)
+{
+    const RecordingPlan &plan = data_->plan;
+    frameCtx.asyncComputeDone = nullptr;
+    frameCtx.asyncComputeWaitStages = 0;
+    if (plan.computeTasks.empty()) { return; }
 
-    // fill the barriers from the inputs and outputs
-    const std::vector<Sync::ImageBarrier> imageBarriers =
-        rpInfo.dependencies | ranges::views::transform(emitBarrier) | ranges::to<std::vector>;
+    const Cory::ScopeTimer s{"Framegraph/Execute/Record/AsyncCompute"};
+    Context &ctx = *data_->ctx;
+    AsyncComputeSubmission &compute = data_->asyncCompute;
+    if (!compute.pool.handle()) {
+        compute.pool =
+            Vk::CommandPool{ctx.device(), Vk::CommandPoolCreateInfo{ctx.computeQueueFamily()}};
+        compute.commandBuffer = compute.pool.allocate();
+        nameVulkanObject(ctx.device(), compute.commandBuffer, "CMD_Framegraph_AsyncCompute");
+        compute.fence = ctx.createFence("Framegraph async compute");
+        compute.done = ctx.createSemaphore("Framegraph async compute done");
+    }
+
+    compute.commandBuffer.begin(
+        Vk::CommandBufferBeginInfo{Vk::CommandBufferBeginInfo::Flag::OneTimeSubmit});
+    CommandList cmd{ctx, compute.commandBuffer};
+    for (uint32_t i = 0; i < plan.computeTasks.size(); ++i) {
+        const uint32_t firstBarrier = plan.computeTaskBarriers[i];
+        const uint32_t lastBarrier = plan.computeTaskBarriers[i + 1];
+        const uint32_t firstBufferBarrier = plan.computeTaskBufferBarriers[i];
+        const uint32_t lastBufferBarrier = plan.computeTaskBufferBarriers[i + 1];
+        const auto barriers =
+            std::span{plan.computeBarriers}.subspan(firstBarrier, lastBarrier - firstBarrier);
+        const auto bufferBarriers = std::span{plan.computeBufferBarriers}.subspan(
+            firstBufferBarrier, lastBufferBarrier - firstBufferBarrier);
+        if (!barriers.empty() || !bufferBarriers.empty()) {
+            Sync::CmdPipelineBarrier2(ctx.device(),
+                                      cmd.handle(),
+                                      nullptr,
+                                      bufferBarriers,
+                                      barriers,
+                                      data_->barrierScratch);
+        }
+        for (uint32_t barrierIdx = firstBarrier; barrierIdx < lastBarrier; ++barrierIdx) {
+            data_->resources.setLastAccess(plan.computeBarrierTextures[barrierIdx],
+                                           plan.computeBarriers[barrierIdx].nextAccesses.back(),
+                                           subresourcesOf(plan.computeBarriers[barrierIdx]));
+        }
+        for (uint32_t barrierIdx = firstBufferBarrier; barrierIdx < lastBufferBarrier;
+             ++barrierIdx) {
+            data_->resources.setLastAccess(
+                plan.computeBufferBarrierBuffers[barrierIdx],
+                plan.computeBufferBarriers[barrierIdx].nextAccesses.back());
+        }
+        executeTask(cmd, execInfo.tasks[plan.computeTasks[i]]);
+    }
+    // hand the textures and buffers that the graphics queue uses over to its queue family
+    if (!plan.releaseBarriers.empty() || !plan.bufferReleaseBarriers.empty()) {
+        Sync::CmdPipelineBarrier2(ctx.device(),
+                                  cmd.handle(),
+                                  nullptr,
+                                  plan.bufferReleaseBarriers,
+                                  plan.releaseBarriers,
+                                  data_->barrierScratch);
+    }
+    compute.commandBuffer.end();
+
+    // only signal the semaphore if the graphics work is going to wait for it
+    const bool graphicsWaits = plan.computeWaitStages != 0;
+    VkSemaphore doneSemaphore = compute.done;
+    Vk::SubmitInfo submitInfo{};
+    submitInfo.setCommandBuffers({compute.commandBuffer});
+    if (graphicsWaits) {
+        submitInfo->pSignalSemaphores = &doneSemaphore;
+        submitInfo->signalSemaphoreCount = 1;
+    }
+    ctx.computeQueue().submit({submitInfo}, compute.fence);
+    compute.submitted = true;
+
+    if (graphicsWaits) {
+        frameCtx.asyncComputeDone = &compute.done;
+        frameCtx.asyncComputeWaitStages = plan.computeWaitStages;
+    }
+}
 
-    Sync::CmdPipelineBarrier(data_->ctx->device(), cmd.handle(), nullptr, {}, imageBarriers);
+Sync::EventDependency Framegraph::eventDependency(uint32_t eventIdx)
+{
+    const RecordingPlan::SplitEvent &event = data_->plan.events[eventIdx];
+    return Sync::EventDependency{
+        .event = data_->events[eventIdx],
+        .pGlobalBarrier = nullptr,
+        .bufferBarriers = {},
+        .imageBarriers = std::span{data_->plan.barriers}.subspan(
+            event.firstBarrier, event.lastBarrier - event.firstBarrier)};
+}
+
+void Framegraph::recordParallel(CommandList &cmd,
+                                const ExecutionInfo &execInfo,
+                                std::span<const uint32_t> level,
+                                std::span<const std::pair<size_t, RenderTaskHandle>> parallelTasks)
+{
+    auto &workerPool = data_->ctx->workerPool();
+
+    const Cory::ScopeTimer s{"Framegraph/Execute/Record/Parallel"};
+    const size_t workerCount = std::min<size_t>(parallelTasks.size(), workerPool.thread_count());
+    for (size_t i = data_->secondaryPools.size(); i < workerCount; ++i) {
+        data_->secondaryPools.push_back(SecondaryCommandPool{
+            .pool = Vk::CommandPool{data_->ctx->device(),
+                                    Vk::CommandPoolCreateInfo{data_->ctx->graphicsQueueFamily()}},
+            .buffers = {},
+            .used = 0});
+    }
+
+    // each worker records every workerCount'th task into secondary buffers from its own pool
+    auto &secondaries = data_->secondaries;
+    secondaries.assign(level.size(), VK_NULL_HANDLE);
+    auto &workers = data_->workers;
+    workers.clear();
+    for (size_t worker = 0; worker < workerCount; ++worker) {
+        workers.push_back(runOnWorker(workerPool, [&, worker]() {
+            SecondaryCommandPool &pool = data_->secondaryPools[worker];
+            for (size_t i = worker; i < parallelTasks.size(); i += workerCount) {
+                const auto [pos, handle] = parallelTasks[i];
+                Vk::CommandBuffer &buffer = pool.next();
+
+                // tasks use dynamic rendering, so there is no render pass state to inherit
+                const VkCommandBufferInheritanceInfo inheritanceInfo{
+                    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+                Vk::CommandBufferBeginInfo beginInfo{
+                    Vk::CommandBufferBeginInfo::Flag::OneTimeSubmit};
+                beginInfo->pInheritanceInfo = &inheritanceInfo;
+                buffer.begin(beginInfo);
+                CommandList secondaryCmd{*data_->ctx, buffer};
+                executeTask(secondaryCmd, handle);
+                buffer.end();
+
+                secondaries[pos] = buffer;
+            }
+        }));
+    }
+    // wait on the tasks by reference, so the scratch vector keeps its storage
+    cppcoro::sync_wait(cppcoro::when_all(
+        std::vector<std::reference_wrapper<cppcoro::task<>>>(workers.begin(), workers.end())));
+    workers.clear();
+
+    // stitch everything together in the resolved order - tasks that were not recorded on a
+    // worker are recorded directly into the primary buffer
+    auto &pending = data_->pendingSecondaries;
+    pending.clear();
+    auto flushPending = [&]() {
+        if (pending.empty()) { return; }
+        data_->ctx->device()->CmdExecuteCommands(
+            cmd.handle(), gsl::narrow<uint32_t>(pending.size()), pending.data());
+        pending.clear();
+    };
+    for (size_t pos = 0; pos < level.size(); ++pos) {
+        if (secondaries[pos] != VK_NULL_HANDLE) {
+            pending.push_back(secondaries[pos]);
+            continue;
+        }
+        flushPending();
+        executeTask(cmd, execInfo.tasks[level[pos]]);
+    }
+    flushPending();
+}
+
+void Framegraph::executeTask(CommandList &cmd, RenderTaskHandle handle)
+{
+    RenderTaskInfo &rpInfo = data_->renderTasks[handle];
+    const Cory::ScopeTimer s1{fmt::format("Framegraph/Execute/Record/{}", rpInfo.name)};
 
     CO_CORE_TRACE("Executing rendering commands for {}", rpInfo.name);
+    rpInfo.commandList = &cmd;
+    auto resetCmdList = gsl::finally([&rpInfo]() { rpInfo.commandList = nullptr; });
+
     const auto &coroHandle = rpInfo.coroHandle;
     if (!coroHandle.done()) { coroHandle.resume(); }
 
@@ -141,8 +751,6 @@ std::vector<ExecutionInfo::TransitionInfo> Framegraph::executePass(CommandList &
                    "Render task coroutine seems to have more unnecessary coroutine synchronization "
                    "points! A render task should only have a single co_yield and should wait on "
                    "the builder's finishTaskDeclaration() exactly once!");
-
-    return transitions;
 }
 
 TransientTextureHandle Framegraph::declareInput(TextureInfo info,
@@ -165,14 +773,1001 @@ std::pair<TextureInfo, TextureState> Framegraph::declareOutput(TransientTextureH
     return {data_->resources.info(handle), data_->resources.state(handle)};
 }
 
+namespace {
+GraphSignature computeSignature(FramegraphPrivate &data)
+{
+    GraphSignature sig;
+    sig.tasks.reserve(data.renderTasks.size());
+
+    const auto textureOrdinal = [&](TextureHandle handle) -> uint32_t {
+        auto [it, inserted] =
+            sig.textureOrdinals.try_emplace(handle, static_cast<uint32_t>(sig.textures.size()));
+        if (inserted) {
+            sig.textures.push_back(handle);
+            const TextureInfo &info = data.resources.info(handle);
+            sig.signature.push_back(uint64_t{info.size.x} << 32 | info.size.y);
+            sig.signature.push_back(uint64_t{info.size.z} << 32 | uint32_t(info.format));
+            sig.signature.push_back(static_cast<uint64_t>(info.sampleCount));
+            sig.signature.push_back(uint64_t{info.mipLevels} << 32 | info.arrayLayers);
+        }
+        return it->second;
+    };
+    const auto bufferOrdinal = [&](BufferResourceHandle handle) -> uint32_t {
+        auto [it, inserted] =
+            sig.bufferOrdinals.try_emplace(handle, static_cast<uint32_t>(sig.buffers.size()));
+        if (inserted) {
+            sig.buffers.push_back(handle);
+            const BufferInfo &info = data.resources.info(handle);
+            sig.signature.push_back(info.size);
+            sig.signature.push_back(info.usage.underlying_bits());
+        }
+        return it->second;
+    };
+
+    for (const auto &[taskHandle, taskInfo] : data.renderTasks.items()) {
+        sig.tasks.push_back(taskHandle);
+        sig.signature.push_back(taskInfo.dependencies.size());
+        sig.signature.push_back(taskInfo.bufferDependencies.size());
+        sig.signature.push_back(taskInfo.asyncCompute ? 1 : 0);
+        forEachDependency(taskInfo, [&](const auto &dependency) {
+            uint64_t ordinal{};
+            if constexpr (IsBufferDependency<decltype(dependency)>) {
+                ordinal = bufferOrdinal(dependency.handle.buffer());
+            }
+            else {
+                ordinal = textureOrdinal(dependency.handle.texture());
+                const SubresourceRange &range = dependency.range;
+                sig.signature.push_back(uint64_t{range.baseMipLevel} << 32 | range.levelCount);
+                sig.signature.push_back(uint64_t{range.baseArrayLayer} << 32 | range.layerCount);
+            }
+            sig.signature.push_back(ordinal << 32 | dependency.handle.version());
+            const auto kind = static_cast<uint64_t>(dependency.kind.underlying_bits());
+            sig.signature.push_back(kind << 32 | static_cast<uint32_t>(dependency.access));
+        });
+    }
+    sig.signature.push_back(data.outputs.size());
+    for (const TransientTextureHandle &output : data.outputs) {
+        const uint64_t ordinal = textureOrdinal(output.texture());
+        sig.signature.push_back(ordinal << 32 | output.version());
+    }
+    sig.signature.push_back(data.externalInputs.size());
+    for (const TransientTextureHandle &input : data.externalInputs) {
+        const uint64_t ordinal = textureOrdinal(input.texture());
+        sig.signature.push_back(ordinal << 32 | input.version());
+        // the barriers planned for the graph depend on how each subresource of the inputs was
+        // accessed before
+        const TextureInfo &info = data.resources.info(input.texture());
+        for (uint32_t mip = 0; mip < info.mipLevels; ++mip) {
+            for (uint32_t layer = 0; layer < info.arrayLayers; ++layer) {
+                sig.signature.push_back(
+                    static_cast<uint64_t>(data.resources.lastAccess(input.texture(), mip, layer)));
+            }
+        }
+    }
+
+    sig.hash = hashCombine(0, sig.signature);
+    return sig;
+}
+
+/// store the planned texture usage and recording of the current frame in @a compiled
+void storePlan(FramegraphPrivate &data,
+               const GraphSignature &sig,
+               const std::unordered_map<SlotMapHandle, uint32_t> &taskOrdinals,
+               const ExecutionInfo &execInfo,
+               CompiledGraph &compiled)
+{
+    const TextureManager &resources = data.resources;
+    for (uint32_t ordinal = 0; ordinal < sig.textures.size(); ++ordinal) {
+        const TextureHandle texture = sig.textures[ordinal];
+        compiled.textureUsage.push_back(resources.usage(texture));
+        compiled.memoryless.push_back(resources.memoryless(texture) ? 1 : 0);
+        for (const uint32_t version : resources.consumedVersions(texture)) {
+            compiled.consumed.push_back(uint64_t{ordinal} << 32 | version);
+        }
+    }
+    compiled.levels = execInfo.levels;
+
+    const auto ordinalsOf = [](const auto &handles, const auto &ordinals) {
+        std::vector<uint32_t> result;
+        result.reserve(handles.size());
+        for (const auto &handle : handles) {
+            result.push_back(ordinals.at(handle));
+        }
+        return result;
+    };
+    compiled.plan = data.plan;
+    compiled.barrierTextures = ordinalsOf(data.plan.barrierTextures, sig.textureOrdinals);
+    compiled.bufferBarrierBuffers = ordinalsOf(data.plan.bufferBarrierBuffers, sig.bufferOrdinals);
+    compiled.computeBarrierTextures =
+        ordinalsOf(data.plan.computeBarrierTextures, sig.textureOrdinals);
+    compiled.computeBufferBarrierBuffers =
+        ordinalsOf(data.plan.computeBufferBarrierBuffers, sig.bufferOrdinals);
+
+    compiled.transitions = execInfo.transitions;
+    for (const ExecutionInfo::TransitionInfo &transition : execInfo.transitions) {
+        compiled.transitionTasks.push_back(taskOrdinals.at(transition.task));
+        compiled.transitionTextures.push_back(
+            sig.textureOrdinals.at(transition.resource.texture()));
+    }
+    compiled.bufferTransitions = execInfo.bufferTransitions;
+    for (const ExecutionInfo::BufferTransitionInfo &transition : execInfo.bufferTransitions) {
+        compiled.bufferTransitionTasks.push_back(taskOrdinals.at(transition.task));
+        compiled.bufferTransitionBuffers.push_back(
+            sig.bufferOrdinals.at(transition.resource.buffer()));
+    }
+}
+
+/// reuse the planned texture usage of @a compiled for the textures of the current frame - has to
+/// be called before allocation
+void restoreTextureUsage(FramegraphPrivate &data,
+                         const GraphSignature &sig,
+                         const CompiledGraph &compiled)
+{
+    TextureManager &resources = data.resources;
+    for (uint32_t ordinal = 0; ordinal < sig.textures.size(); ++ordinal) {
+        const TextureHandle texture = sig.textures[ordinal];
+        if (compiled.textureUsage[ordinal] != 0) {
+            resources.addUsage(texture, compiled.textureUsage[ordinal]);
+        }
+        if (compiled.memoryless[ordinal]) { resources.setMemoryless(texture); }
+    }
+    for (const uint64_t consumed : compiled.consumed) {
+        resources.markConsumed(TransientTextureHandle{sig.textures[consumed >> 32]} +
+                               static_cast<uint32_t>(consumed));
+    }
+}
+
+/// reuse the planned recording of @a compiled with the textures and buffers of the current frame
+/// - has to be called after allocation
+void restorePlan(FramegraphPrivate &data,
+                 const GraphSignature &sig,
+                 const CompiledGraph &compiled,
+                 ExecutionInfo &execInfo)
+{
+    const TextureManager &resources = data.resources;
+    ResourceManager &vkResources = data.ctx->resources();
+    RecordingPlan &plan = data.plan;
+    plan = compiled.plan;
+
+    const auto patchImages = [&](std::vector<Sync::ImageBarrier> &barriers,
+                                 std::vector<TextureHandle> &textures,
+                                 const std::vector<uint32_t> &ordinals) {
+        for (size_t i = 0; i < barriers.size(); ++i) {
+            textures[i] = sig.textures[ordinals[i]];
+            barriers[i].image = vkResources[resources.image(textures[i])];
+        }
+    };
+    const auto patchBuffers = [&](std::vector<Sync::BufferBarrier> &barriers,
+                                  std::vector<BufferResourceHandle> &buffers,
+                                  const std::vector<uint32_t> &ordinals) {
+        for (size_t i = 0; i < barriers.size(); ++i) {
+            buffers[i] = sig.buffers[ordinals[i]];
+            barriers[i].buffer = vkResources[resources.buffer(buffers[i])];
+        }
+    };
+    patchImages(plan.barriers, plan.barrierTextures, compiled.barrierTextures);
+    patchImages(plan.computeBarriers, plan.computeBarrierTextures, compiled.computeBarrierTextures);
+    patchBuffers(plan.bufferBarriers, plan.bufferBarrierBuffers, compiled.bufferBarrierBuffers);
+    patchBuffers(plan.computeBufferBarriers,
+                 plan.computeBufferBarrierBuffers,
+                 compiled.computeBufferBarrierBuffers);
+    plan.collectReleaseBarriers();
+
+    execInfo.levels = compiled.levels;
+    execInfo.transitions = compiled.transitions;
+    for (size_t i = 0; i < execInfo.transitions.size(); ++i) {
+        ExecutionInfo::TransitionInfo &transition = execInfo.transitions[i];
+        transition.task = RenderTaskHandle{sig.tasks[compiled.transitionTasks[i]]};
+        transition.resource = TransientTextureHandle{sig.textures[compiled.transitionTextures[i]]} +
+                              transition.resource.version();
+    }
+    execInfo.bufferTransitions = compiled.bufferTransitions;
+    for (size_t i = 0; i < execInfo.bufferTransitions.size(); ++i) {
+        ExecutionInfo::BufferTransitionInfo &transition = execInfo.bufferTransitions[i];
+        transition.task = RenderTaskHandle{sig.tasks[compiled.bufferTransitionTasks[i]]};
+        transition.resource =
+            TransientBufferHandle{sig.buffers[compiled.bufferTransitionBuffers[i]]} +
+            transition.resource.version();
+    }
+}
+} // namespace
+
 ExecutionInfo Framegraph::compile()
 {
     const Cory::ScopeTimer s{"Framegraph/Execute/Compile"};
 
-    auto execInfo = resolve(data_->outputs);
-    data_->resources.allocate(execInfo.resources);
+    const GraphSignature sig = computeSignature(*data_);
+
+    auto &cache = data_->compiledGraphs;
+    const auto cached = ranges::find_if(cache, [&](const CompiledGraph &compiled) {
+        return compiled.hash == sig.hash && compiled.signature == sig.signature;
+    });
+
+    ExecutionInfo execInfo;
+    if (cached != cache.end()) {
+        // same structure as a previous frame - just map the ordinals back to this frame's handles
+        cache.splice(cache.begin(), cache, cached);
+        const CompiledGraph &compiled = cache.front();
+
+        execInfo.tasks.reserve(compiled.taskOrder.size());
+        for (const uint32_t ordinal : compiled.taskOrder) {
+            execInfo.tasks.push_back(RenderTaskHandle{sig.tasks[ordinal]});
+        }
+        for (size_t ordinal = 0; ordinal < sig.tasks.size(); ++ordinal) {
+            data_->renderTasks[sig.tasks[ordinal]].executionPriority =
+                compiled.executionPriorities[ordinal];
+        }
+        execInfo.resources.reserve(compiled.resources.size());
+        for (const uint32_t ordinal : compiled.resources) {
+            execInfo.resources.push_back(sig.textures[ordinal]);
+        }
+        execInfo.lifetimes = compiled.lifetimes;
+        execInfo.buffers.reserve(compiled.buffers.size());
+        for (const uint32_t ordinal : compiled.buffers) {
+            execInfo.buffers.push_back(sig.buffers[ordinal]);
+        }
+        execInfo.bufferLifetimes = compiled.bufferLifetimes;
+        execInfo.asyncCompute = compiled.asyncCompute;
+        execInfo.cacheHit = true;
+
+        // the barriers are planned in terms of the same accesses, only the images and buffers
+        // behind the textures differ
+        restoreTextureUsage(*data_, sig, compiled);
+        data_->resources.allocate(execInfo.resources, execInfo.lifetimes);
+        data_->resources.allocate(execInfo.buffers, execInfo.bufferLifetimes);
+        restorePlan(*data_, sig, compiled, execInfo);
+        return execInfo;
+    }
+
+    {
+        const Cory::ScopeTimer s2{"Framegraph/Execute/Compile/Resolve"};
+        execInfo = resolve(data_->outputs);
+        assignQueues(execInfo);
+        computeLifetimes(execInfo);
+    }
+
+    planTextureUsage(execInfo);
+    data_->resources.allocate(execInfo.resources, execInfo.lifetimes);
+    data_->resources.allocate(execInfo.buffers, execInfo.bufferLifetimes);
+    computeLevels(execInfo);
+    planRecording(execInfo);
+
+    // don't cache failed resolves, so the errors are reported every frame
+    if (!execInfo.tasks.empty() || data_->outputs.empty()) {
+        std::unordered_map<SlotMapHandle, uint32_t> taskOrdinals;
+        for (uint32_t ordinal = 0; ordinal < sig.tasks.size(); ++ordinal) {
+            taskOrdinals[sig.tasks[ordinal]] = ordinal;
+        }
+
+        CompiledGraph compiled{.hash = sig.hash, .signature = sig.signature};
+        for (const RenderTaskHandle &task : execInfo.tasks) {
+            compiled.taskOrder.push_back(taskOrdinals.at(task));
+        }
+        for (const SlotMapHandle &task : sig.tasks) {
+            compiled.executionPriorities.push_back(data_->renderTasks[task].executionPriority);
+        }
+        for (const TextureHandle &texture : execInfo.resources) {
+            compiled.resources.push_back(sig.textureOrdinals.at(texture));
+        }
+        compiled.lifetimes = execInfo.lifetimes;
+        for (const BufferResourceHandle &buffer : execInfo.buffers) {
+            compiled.buffers.push_back(sig.bufferOrdinals.at(buffer));
+        }
+        compiled.bufferLifetimes = execInfo.bufferLifetimes;
+        compiled.asyncCompute = execInfo.asyncCompute;
+        storePlan(*data_, sig, taskOrdinals, execInfo, compiled);
+
+        cache.push_front(std::move(compiled));
+        if (cache.size() > COMPILED_GRAPH_CACHE_SIZE) { cache.pop_back(); }
+    }
+
+    return execInfo;
+}
+
+void Framegraph::assignQueues(ExecutionInfo &execInfo) const
+{
+    const TextureManager &resources = data_->resources;
+    execInfo.asyncCompute.assign(execInfo.tasks.size(), false);
+    if (!data_->ctx->hasAsyncCompute()) { return; }
+
+    // whether a texture or buffer is (so far) only accessed by async compute tasks. outputs are
+    // accessed by the graphics queue after the framegraph, so they always belong to the graphics
+    // queue
+    std::vector<uint8_t> onComputeQueue(resources.indexCapacity(), 0);
+    std::vector<uint8_t> isOutput(resources.indexCapacity(), 0);
+    for (const TransientTextureHandle &output : data_->outputs) {
+        isOutput[resources.index(output.texture())] = 1;
+    }
+
+    for (uint32_t taskIdx = 0; taskIdx < execInfo.tasks.size(); ++taskIdx) {
+        const RenderTaskInfo &task = data_->renderTasks[execInfo.tasks[taskIdx]];
+        bool async = task.asyncCompute;
+        forEachDependency(task, [&](const auto &dependency) {
+            const uint32_t index = resources.index(resourceOf(dependency.handle));
+            const bool created = dependency.kind.is_set(TaskDependencyKindBits::Create);
+            if (async && (isOutput[index] || (!created && !onComputeQueue[index]))) {
+                // the compute queue would have to wait for the graphics queue
+                CO_CORE_DEBUG("Render task '{}' accesses '{}' on the graphics queue, running it "
+                              "on the graphics queue instead of async compute",
+                              task.name,
+                              resources.info(resourceOf(dependency.handle)).name);
+                async = false;
+            }
+        });
+        forEachDependency(task, [&](const auto &dependency) {
+            onComputeQueue[resources.index(resourceOf(dependency.handle))] = async ? 1 : 0;
+        });
+        execInfo.asyncCompute[taskIdx] = async;
+    }
+}
+
+void Framegraph::planTextureUsage(const ExecutionInfo &execInfo)
+{
+    TextureManager &resources = data_->resources;
+
+    std::vector<uint8_t> attachmentOnly(resources.indexCapacity(), 1);
+    const auto consume = [&](TransientTextureHandle handle) {
+        resources.markConsumed(handle);
+        attachmentOnly[resources.index(handle.texture())] = 0;
+    };
+    for (const TransientTextureHandle &output : data_->outputs) {
+        consume(output);
+        // we don't know how outputs are used after the graph, allow the common cases
+        resources.addUsage(output.texture(),
+                           VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+    }
+    for (const RenderTaskHandle &taskHandle : execInfo.tasks) {
+        for (const RenderTaskInfo::Dependency &dependency :
+             data_->renderTasks[taskHandle].dependencies) {
+            // the read of a read/write dependency is declared separately, see
+            // RenderTaskBuilder::readWrite()
+            if (dependency.kind.is_set(TaskDependencyKindBits::Read) &&
+                !dependency.kind.is_set(TaskDependencyKindBits::Write)) {
+                consume(dependency.handle);
+            }
+            if (!isAttachmentAccess(dependency.access)) {
+                attachmentOnly[resources.index(dependency.handle.texture())] = 0;
+            }
+            resources.addUsage(dependency.handle.texture(),
+                               Sync::GetVkImageUsage(dependency.access));
+        }
+    }
+
+    for (const TextureHandle &texture : execInfo.resources) {
+        if (attachmentOnly[resources.index(texture)] &&
+            resources.state(texture).status == TextureMemoryStatus::Virtual) {
+            CO_CORE_TRACE("'{}' is only used as an attachment, making it memoryless",
+                          resources.info(texture).name);
+            resources.setMemoryless(texture);
+        }
+    }
+}
+
+void Framegraph::computeLifetimes(ExecutionInfo &execInfo) const
+{
+    const TextureManager &resources = data_->resources;
+
+    // determine the range of tasks in which each texture and buffer is used, so that resources
+    // which are never alive at the same time can share memory
+    std::vector<ResourceLifetime> lifetimes(resources.indexCapacity());
+    std::vector<uint8_t> used(resources.indexCapacity(), 0);
+    std::vector<uint8_t> usedAsync(resources.indexCapacity(), 0);
+    for (uint32_t taskIdx = 0; taskIdx < execInfo.tasks.size(); ++taskIdx) {
+        const RenderTaskInfo &task = data_->renderTasks[execInfo.tasks[taskIdx]];
+        forEachDependency(task, [&](const auto &dependency) {
+            const uint32_t index = resources.index(resourceOf(dependency.handle));
+            if (!used[index]) {
+                used[index] = 1;
+                lifetimes[index] = ResourceLifetime{taskIdx, taskIdx};
+            }
+            lifetimes[index].lastUse = std::max(lifetimes[index].lastUse, taskIdx);
+            if (execInfo.asyncCompute[taskIdx]) { usedAsync[index] = 1; }
+        });
+    }
+    for (uint32_t index = 0; index < lifetimes.size(); ++index) {
+        // async compute runs in parallel to the graphics work, so the task order says nothing
+        // about when these resources are alive
+        if (usedAsync[index]) {
+            lifetimes[index] = ResourceLifetime{0, ResourceLifetime::END_OF_FRAME};
+        }
+    }
+    // outputs are accessed after the framegraph has executed, so they can't be aliased
+    for (const TransientTextureHandle &output : data_->outputs) {
+        lifetimes[resources.index(output.texture())].lastUse = ResourceLifetime::END_OF_FRAME;
+    }
+
+    // resolve() may report resources multiple times (once per version) - deduplicate here
+    std::vector<uint8_t> seen(resources.indexCapacity(), 0);
+    const auto deduplicate = [&](auto &handles, std::vector<ResourceLifetime> &handleLifetimes) {
+        std::remove_cvref_t<decltype(handles)> unique;
+        unique.reserve(handles.size());
+        handleLifetimes.clear();
+        for (const auto &handle : handles) {
+            const uint32_t index = resources.index(handle);
+            if (seen[index]) { continue; }
+            seen[index] = 1;
+            unique.push_back(handle);
+            handleLifetimes.push_back(lifetimes[index]);
+        }
+        handles = std::move(unique);
+    };
+    deduplicate(execInfo.resources, execInfo.lifetimes);
+    deduplicate(execInfo.buffers, execInfo.bufferLifetimes);
+}
+
+void Framegraph::computeLevels(ExecutionInfo &execInfo) const
+{
+    const TextureManager &resources = data_->resources;
+
+    // the latest levels in which a texture or buffer has been accessed so far
+    struct TextureLevels {
+        int32_t lastWrite{-1};
+        int32_t lastRead{-1};
+        Sync::AccessType readAccess{Sync::AccessType::None};
+    };
+    std::vector<TextureLevels> textureLevels(resources.indexCapacity());
+    auto levelsOf = [&](auto resource) -> TextureLevels & {
+        return textureLevels[resources.index(resource)];
+    };
+
+    execInfo.levels.clear();
+    execInfo.levels.reserve(execInfo.tasks.size());
+    for (uint32_t taskIdx = 0; taskIdx < execInfo.tasks.size(); ++taskIdx) {
+        // async compute tasks are synchronized with the graphics queue as a whole
+        if (execInfo.asyncCompute[taskIdx]) {
+            execInfo.levels.push_back(0);
+            continue;
+        }
+        const RenderTaskInfo &task = data_->renderTasks[execInfo.tasks[taskIdx]];
+
+        uint32_t level{0};
+        auto after = [&level](int32_t otherLevel) {
+            level = std::max(level, static_cast<uint32_t>(otherLevel + 1));
+        };
+        forEachDependency(task, [&](const auto &dependency) {
+            const auto resource = resourceOf(dependency.handle);
+            const TextureLevels &texture = levelsOf(resource);
+            after(texture.lastWrite);
+            // concurrent reads are fine, as long as they don't need a different image layout -
+            // buffers don't have a layout at all
+            if (dependency.kind.is_set(TaskDependencyKindBits::Write) ||
+                (!IsBufferDependency<decltype(dependency)> &&
+                 texture.readAccess != dependency.access)) {
+                after(texture.lastRead);
+            }
+            // the memory of the resource may still be used by the ones that were aliased to it
+            for (const auto &predecessor : resources.aliasedPredecessors(resource)) {
+                after(levelsOf(predecessor).lastWrite);
+                after(levelsOf(predecessor).lastRead);
+            }
+        });
+
+        forEachDependency(task, [&](const auto &dependency) {
+            TextureLevels &texture = levelsOf(resourceOf(dependency.handle));
+            if (!dependency.kind.is_set(TaskDependencyKindBits::Write)) {
+                texture.lastRead = std::max(texture.lastRead, static_cast<int32_t>(level));
+                texture.readAccess = dependency.access;
+            }
+            else {
+                texture.lastWrite = static_cast<int32_t>(level);
+                texture.readAccess = Sync::AccessType::None;
+            }
+        });
+        execInfo.levels.push_back(level);
+    }
+}
+
+void Framegraph::planRecording(ExecutionInfo &execInfo)
+{
+    const Cory::ScopeTimer s{"Framegraph/Execute/Compile/PlanBarriers"};
+    RecordingPlan &plan = data_->plan;
+    const TextureManager &resources = data_->resources;
+
+    // group the graphics tasks by level, keeping the resolved order within each level
+    plan.tasks.clear();
+    for (uint32_t taskIdx = 0; taskIdx < execInfo.tasks.size(); ++taskIdx) {
+        if (!execInfo.asyncCompute[taskIdx]) { plan.tasks.push_back(taskIdx); }
+    }
+    std::stable_sort(plan.tasks.begin(), plan.tasks.end(), [&](uint32_t lhs, uint32_t rhs) {
+        return execInfo.levels[lhs] < execInfo.levels[rhs];
+    });
+    plan.levelTasks.clear();
+    for (uint32_t i = 0; i < plan.tasks.size(); ++i) {
+        if (i == 0 || execInfo.levels[plan.tasks[i]] != execInfo.levels[plan.tasks[i - 1]]) {
+            plan.levelTasks.push_back(i);
+        }
+    }
+    plan.levelTasks.push_back(static_cast<uint32_t>(plan.tasks.size()));
+
+    // simulate the accesses to all textures and buffers to find out which barriers are actually
+    // required
+    static constexpr uint32_t NO_LEVEL{std::numeric_limits<uint32_t>::max()};
+    // accesses from before the frame are treated as if they happened in level -1
+    static constexpr int32_t EXTERNAL_LEVEL{-1};
+    struct TextureSync {
+        Sync::AccessType lastAccess{Sync::AccessType::None};
+        Sync::AccessType lastWrite{Sync::AccessType::None};
+        /// reads that have been synchronized with lastWrite already (all with the same layout)
+        Sync::AccessList readsSinceWrite;
+        /// the levels of lastWrite and of the latest of the readsSinceWrite
+        int32_t lastWriteLevel{EXTERNAL_LEVEL};
+        int32_t readsLevel{EXTERNAL_LEVEL};
+        bool accessed{false};
+        /// accessed by async compute tasks, and not yet by the graphics queue
+        bool onComputeQueue{false};
+        /// a buffer rather than a texture - buffers don't have an image layout
+        bool isBuffer{false};
+        /// the barrier for this texture in the current level, if any
+        uint32_t barrierLevel{NO_LEVEL};
+        uint32_t barrier{};
+
+        /// the accesses that need to be finished before the memory can be written, returns the
+        /// level of the latest of them
+        int32_t pendingAccesses(Sync::AccessList &accesses) const
+        {
+            const auto add = [&](Sync::AccessType access) {
+                if (!accesses.contains(access)) { accesses.push_back(access); }
+            };
+            if (readsSinceWrite.empty()) {
+                add(lastWrite);
+                return lastWriteLevel;
+            }
+            std::for_each(readsSinceWrite.begin(), readsSinceWrite.end(), add);
+            return readsLevel;
+        }
+    };
+    const auto isRead = [](Sync::AccessType access) {
+        return access != Sync::AccessType::None && access < Sync::AccessType::END_OF_READ_ACCESS;
+    };
+    const auto isWriteAccess = [](Sync::AccessType access) {
+        return access > Sync::AccessType::END_OF_READ_ACCESS;
+    };
+    const auto sameLayout =
+        [](const TextureSync &sync, Sync::AccessType lhs, Sync::AccessType rhs) {
+            return sync.isBuffer || Sync::GetVkImageLayout(lhs) == Sync::GetVkImageLayout(rhs);
+        };
+    // update the simulated state of a texture after an access in the given level
+    const auto simulateAccess =
+        [&](TextureSync &sync, Sync::AccessType access, bool isWrite, int32_t level) {
+            sync.accessed = true;
+            sync.lastAccess = access;
+            if (isWrite) {
+                sync.lastWrite = access;
+                sync.lastWriteLevel = level;
+                sync.readsSinceWrite.clear();
+            }
+            else if (!sync.readsSinceWrite.empty() &&
+                     !sameLayout(sync, sync.readsSinceWrite.front(), access)) {
+                sync.readsSinceWrite = {access};
+                sync.readsLevel = level;
+            }
+            else {
+                if (!sync.readsSinceWrite.contains(access)) {
+                    sync.readsSinceWrite.push_back(access);
+                }
+                sync.readsLevel = std::max(sync.readsLevel, level);
+            }
+        };
+    const auto stagesOf = [](std::span<const Sync::AccessType> accesses) {
+        VkPipelineStageFlags stages{};
+        VkAccessFlags accessMask{};
+        VkImageLayout layout{};
+        bool hasWrite{};
+        Sync::GetAccessInfo(accesses, &stages, &accessMask, &layout, &hasWrite);
+        return stages;
+    };
+
+    // every mip level and array layer of a texture is simulated on its own - the state of the
+    // texture or buffer with index i starts at syncs[syncBase[i]]
+    std::vector<uint32_t> syncBase(resources.indexCapacity() + 1, 0);
+    for (const TextureHandle &texture : execInfo.resources) {
+        const TextureInfo &info = resources.info(texture);
+        syncBase[resources.index(texture) + 1] = info.mipLevels * info.arrayLayers;
+    }
+    for (const BufferResourceHandle &buffer : execInfo.buffers) {
+        syncBase[resources.index(buffer) + 1] = 1;
+    }
+    std::inclusive_scan(syncBase.begin(), syncBase.end(), syncBase.begin());
+    std::vector<TextureSync> syncs(syncBase.back());
+    const auto syncsOf = [&](const auto &resource) {
+        const uint32_t index = resources.index(resource);
+        return std::span{syncs}.subspan(syncBase[index], syncBase[index + 1] - syncBase[index]);
+    };
+    // call fn(range, sync) with each mip level and array layer that @a dependency accesses
+    const auto forEachSubresource = [&](const auto &dependency, auto &&fn) {
+        if constexpr (IsBufferDependency<decltype(dependency)>) {
+            fn(SubresourceRange{}, syncsOf(dependency.handle.buffer()).front());
+        }
+        else {
+            const TextureInfo &info = resources.info(dependency.handle.texture());
+            const SubresourceRange range = dependency.range.clamped(info);
+            const auto textureSyncs = syncsOf(dependency.handle.texture());
+            for (uint32_t level = range.baseMipLevel;
+                 level < range.baseMipLevel + range.levelCount;
+                 ++level) {
+                for (uint32_t layer = range.baseArrayLayer;
+                     layer < range.baseArrayLayer + range.layerCount;
+                     ++layer) {
+                    fn(SubresourceRange::single(level, layer),
+                       textureSyncs[level * info.arrayLayers + layer]);
+                }
+            }
+        }
+    };
+
+    for (const TextureHandle &texture : execInfo.resources) {
+        const TextureInfo &info = resources.info(texture);
+        const auto textureSyncs = syncsOf(texture);
+        for (uint32_t subresource = 0; subresource < textureSyncs.size(); ++subresource) {
+            TextureSync &sync = textureSyncs[subresource];
+            // external textures might have been accessed before
+            sync.lastAccess = resources.lastAccess(
+                texture, subresource / info.arrayLayers, subresource % info.arrayLayers);
+            if (isRead(sync.lastAccess)) { sync.readsSinceWrite.push_back(sync.lastAccess); }
+            else { sync.lastWrite = sync.lastAccess; }
+        }
+    }
+    for (const BufferResourceHandle &buffer : execInfo.buffers) {
+        syncsOf(buffer).front().isBuffer = true;
+    }
+
+    plan.barriers.clear();
+    plan.barrierTextures.clear();
+    plan.levelBarriers.clear();
+    plan.levelSplitBarriers.clear();
+    plan.levelEvents.clear();
+    plan.events.clear();
+    plan.bufferBarriers.clear();
+    plan.bufferBarrierBuffers.clear();
+    plan.levelBufferBarriers.clear();
+    // the event each barrier waits for, NO_EVENT for barriers that are not split
+    static constexpr uint32_t NO_EVENT{std::numeric_limits<uint32_t>::max()};
+    std::vector<uint32_t> barrierEvents;
+    // get the event set after srcLevel that the current level waits for
+    const auto splitEvent = [&](uint32_t srcLevel) {
+        auto it = std::find_if(plan.events.begin() + plan.levelEvents.back(),
+                               plan.events.end(),
+                               [&](const auto &event) { return event.setAfterLevel == srcLevel; });
+        if (it == plan.events.end()) {
+            plan.events.push_back(RecordingPlan::SplitEvent{.setAfterLevel = srcLevel});
+            it = std::prev(plan.events.end());
+        }
+        return static_cast<uint32_t>(std::distance(plan.events.begin(), it));
+    };
+    Sync::AccessList prevAccesses;
+    // record the transition of a texture or buffer dependency in execInfo
+    const auto addTransition = [&](RenderTaskHandle taskHandle,
+                                   const auto &dependency,
+                                   Sync::AccessType stateBefore,
+                                   bool elided,
+                                   bool split,
+                                   bool queueTransfer) {
+        if constexpr (IsBufferDependency<decltype(dependency)>) {
+            execInfo.bufferTransitions.push_back(
+                ExecutionInfo::BufferTransitionInfo{.kind = dependency.kind,
+                                                    .task = taskHandle,
+                                                    .resource = dependency.handle,
+                                                    .stateBefore = stateBefore,
+                                                    .stateAfter = dependency.access,
+                                                    .elided = elided,
+                                                    .queueTransfer = queueTransfer});
+        }
+        else {
+            execInfo.transitions.push_back(
+                ExecutionInfo::TransitionInfo{.kind = dependency.kind,
+                                              .task = taskHandle,
+                                              .resource = dependency.handle,
+                                              .stateBefore = stateBefore,
+                                              .stateAfter = dependency.access,
+                                              .elided = elided,
+                                              .split = split,
+                                              .queueTransfer = queueTransfer});
+        }
+    };
+
+    // async compute tasks are recorded one after another into their own command buffer, each
+    // with a barrier of its own. the graphics queue waits for all of them with a semaphore, so
+    // their accesses count as external (level -1) for the graphics queue
+    plan.computeTasks.clear();
+    plan.computeBarriers.clear();
+    plan.computeBarrierTextures.clear();
+    plan.computeTaskBarriers.clear();
+    plan.computeBufferBarriers.clear();
+    plan.computeBufferBarrierBuffers.clear();
+    plan.computeTaskBufferBarriers.clear();
+    plan.releaseBarriers.clear();
+    plan.bufferReleaseBarriers.clear();
+    plan.computeWaitStages = 0;
+    const uint32_t computeFamily = data_->ctx->computeQueueFamily();
+    const uint32_t graphicsFamily = data_->ctx->graphicsQueueFamily();
+    // with a dedicated compute queue family, resources need a queue family ownership transfer
+    const bool transferOwnership = computeFamily != graphicsFamily;
+    for (uint32_t taskIdx = 0; taskIdx < execInfo.tasks.size(); ++taskIdx) {
+        if (!execInfo.asyncCompute[taskIdx]) { continue; }
+        plan.computeTasks.push_back(taskIdx);
+        plan.computeTaskBarriers.push_back(static_cast<uint32_t>(plan.computeBarriers.size()));
+        plan.computeTaskBufferBarriers.push_back(
+            static_cast<uint32_t>(plan.computeBufferBarriers.size()));
+
+        const RenderTaskHandle taskHandle = execInfo.tasks[taskIdx];
+        forEachDependency(data_->renderTasks[taskHandle], [&](const auto &dependency) {
+            const auto resource = resourceOf(dependency.handle);
+            const bool isWrite = dependency.kind.is_set(TaskDependencyKindBits::Write);
+            std::optional<Sync::AccessType> stateBefore;
+            bool elided{true};
+
+            const auto syncSubresource = [&]([[maybe_unused]] SubresourceRange range,
+                                             TextureSync &sync) {
+                if (!stateBefore) { stateBefore = sync.lastAccess; }
+
+                // read-after-read with the same access is already synchronized
+                if (isWrite || !sync.readsSinceWrite.contains(dependency.access)) {
+                    elided = false;
+                    prevAccesses.clear();
+                    if (!isWrite && !sync.readsSinceWrite.empty() &&
+                        sameLayout(sync, sync.readsSinceWrite.front(), dependency.access)) {
+                        prevAccesses.push_back(sync.lastWrite);
+                    }
+                    else {
+                        sync.pendingAccesses(prevAccesses);
+                    }
+                    const auto nextAccesses = std::span{&dependency.access, 1};
+                    if constexpr (IsBufferDependency<decltype(dependency)>) {
+                        plan.computeBufferBarriers.push_back(
+                            resources.barrier(resource, prevAccesses, nextAccesses));
+                        plan.computeBufferBarrierBuffers.push_back(resource);
+                    }
+                    else {
+                        const auto contentsMode =
+                            dependency.kind.is_set(TaskDependencyKindBits::Read)
+                                ? ImageContents::Retain
+                                : ImageContents::Discard;
+                        plan.computeBarriers.push_back(resources.barrier(
+                            resource, range, prevAccesses, nextAccesses, contentsMode));
+                        plan.computeBarrierTextures.push_back(resource);
+                    }
+                }
+
+                simulateAccess(sync, dependency.access, isWrite, EXTERNAL_LEVEL);
+                sync.onComputeQueue = true;
+            };
+            forEachSubresource(dependency, syncSubresource);
+            addTransition(taskHandle, dependency, *stateBefore, elided, false, false);
+        });
+        mergeSubresourceBarriers(
+            plan.computeBarriers, plan.computeTaskBarriers.back(), plan.computeBarrierTextures);
+    }
+    plan.computeTaskBarriers.push_back(static_cast<uint32_t>(plan.computeBarriers.size()));
+    plan.computeTaskBufferBarriers.push_back(
+        static_cast<uint32_t>(plan.computeBufferBarriers.size()));
+
+    for (uint32_t level = 0; level < plan.levelCount(); ++level) {
+        plan.levelBarriers.push_back(static_cast<uint32_t>(plan.barriers.size()));
+        plan.levelBufferBarriers.push_back(static_cast<uint32_t>(plan.bufferBarriers.size()));
+        plan.levelEvents.push_back(static_cast<uint32_t>(plan.events.size()));
+
+        for (uint32_t i = plan.levelTasks[level]; i < plan.levelTasks[level + 1]; ++i) {
+            const RenderTaskHandle taskHandle = execInfo.tasks[plan.tasks[i]];
+            forEachDependency(data_->renderTasks[taskHandle], [&](const auto &dependency) {
+                constexpr bool isBuffer = IsBufferDependency<decltype(dependency)>;
+                const auto resource = resourceOf(dependency.handle);
+                const bool isWrite = dependency.kind.is_set(TaskDependencyKindBits::Write);
+                // a dependency is only elided if none of its subresources needs a barrier
+                std::optional<Sync::AccessType> stateBefore;
+                bool dependencyElided{true};
+                bool dependencySplit{false};
+                bool dependencyQueueTransfer{false};
+
+                const auto syncSubresource = [&]([[maybe_unused]] SubresourceRange range,
+                                             TextureSync &sync) {
+                    if (!stateBefore) { stateBefore = sync.lastAccess; }
+                    bool elided{true};
+                    // the accesses of the barrier of this level, if sync.barrierLevel == level
+                    const auto levelAccesses = [&]() -> Sync::AccessList & {
+                        if constexpr (isBuffer) {
+                            return plan.bufferBarriers[sync.barrier].nextAccesses;
+                        }
+                        else {
+                            return plan.barriers[sync.barrier].nextAccesses;
+                        }
+                    };
 
-    return std::move(execInfo);
+                    if (sync.barrierLevel == level &&
+                        levelAccesses().contains(dependency.access)) {
+                        // already synchronized for exactly this access in this level
+                    }
+                    else if (sync.barrierLevel == level && !isWrite &&
+                             isRead(levelAccesses().front()) &&
+                             sameLayout(sync, levelAccesses().front(), dependency.access)) {
+                        // another read in the same layout - merge into the barrier of this level
+                        levelAccesses().push_back(dependency.access);
+                    }
+                    else if (!isWrite && sync.readsSinceWrite.contains(dependency.access) &&
+                             !(sync.onComputeQueue && transferOwnership)) {
+                        // read-after-read with the same access is already synchronized
+                    }
+                    else {
+                        elided = false;
+                        prevAccesses.clear();
+                        int32_t srcLevel{EXTERNAL_LEVEL};
+                        const bool aliased =
+                            !sync.accessed && !resources.aliasedPredecessors(resource).empty();
+                        if (aliased) {
+                            // on the first access to an aliased resource, only wait for the ones
+                            // that previously occupied the same memory - their contents are
+                            // discarded anyway
+                            for (const auto &predecessor :
+                                 resources.aliasedPredecessors(resource)) {
+                                for (const TextureSync &predecessorSync : syncsOf(predecessor)) {
+                                    if (!predecessorSync.accessed) { continue; }
+                                    srcLevel = std::max(
+                                        srcLevel, predecessorSync.pendingAccesses(prevAccesses));
+                                }
+                            }
+                            // a write has to be the only previous access of a barrier, but the
+                            // predecessors can end in different writes, or in reads and writes.
+                            // those are covered by a single general access - the old layout is
+                            // discarded, so the layouts they were left in don't matter
+                            if (prevAccesses.size() > 1 &&
+                                std::ranges::any_of(prevAccesses, isWriteAccess)) {
+                                prevAccesses.clear();
+                                prevAccesses.push_back(Sync::AccessType::General);
+                            }
+                        }
+                        else if (!isWrite && !sync.readsSinceWrite.empty() &&
+                                 sameLayout(
+                                     sync, sync.readsSinceWrite.front(), dependency.access)) {
+                            // a different read in the same layout only has to wait for the last
+                            // write
+                            prevAccesses.push_back(sync.lastWrite);
+                            srcLevel = sync.lastWriteLevel;
+                        }
+                        else {
+                            // writes and layout transitions have to wait for all previous reads
+                            srcLevel = sync.pendingAccesses(prevAccesses);
+                        }
+                        if (prevAccesses.empty()) {
+                            prevAccesses.push_back(Sync::AccessType::None);
+                        }
+
+                        // the first graphics access to a resource of the async compute queue
+                        // acquires it from the compute queue family, which releases it at the end
+                        // of its work. the semaphore wait needs to cover the source stages
+                        const bool queueTransfer = sync.onComputeQueue && transferOwnership;
+                        if (sync.onComputeQueue) {
+                            plan.computeWaitStages |= stagesOf(prevAccesses);
+                        }
+                        dependencyQueueTransfer |= queueTransfer;
+
+                        sync.barrierLevel = level;
+                        const uint32_t srcFamily =
+                            queueTransfer ? computeFamily : VK_QUEUE_FAMILY_IGNORED;
+                        const uint32_t dstFamily =
+                            queueTransfer ? graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+                        const auto nextAccesses = std::span{&dependency.access, 1};
+                        if constexpr (isBuffer) {
+                            // buffer barriers are cheap compared to image barriers (no layout
+                            // transitions), so they are never split
+                            sync.barrier = static_cast<uint32_t>(plan.bufferBarriers.size());
+                            plan.bufferBarriers.push_back(resources.barrier(
+                                resource, prevAccesses, nextAccesses, srcFamily, dstFamily));
+                            plan.bufferBarrierBuffers.push_back(resource);
+                        }
+                        else {
+                            // only discard if it is not a read/write dependency
+                            const auto contentsMode =
+                                dependency.kind.is_set(TaskDependencyKindBits::Read) && !aliased
+                                    ? ImageContents::Retain
+                                    : ImageContents::Discard;
+                            sync.barrier = static_cast<uint32_t>(plan.barriers.size());
+                            plan.barriers.push_back(resources.barrier(resource,
+                                                                      range,
+                                                                      prevAccesses,
+                                                                      nextAccesses,
+                                                                      contentsMode,
+                                                                      srcFamily,
+                                                                      dstFamily));
+                            plan.barrierTextures.push_back(resource);
+
+                            // split the barrier if there are levels in between that don't touch
+                            // the texture - they can run while the texture is being synchronized
+                            const bool split = srcLevel != EXTERNAL_LEVEL &&
+                                               srcLevel + 1 < static_cast<int32_t>(level);
+                            dependencySplit |= split;
+                            barrierEvents.push_back(
+                                split ? splitEvent(static_cast<uint32_t>(srcLevel)) : NO_EVENT);
+                        }
+                    }
+                    dependencyElided &= elided;
+
+                    // without a barrier, the semaphore wait has to happen before the access
+                    // itself
+                    if (sync.onComputeQueue && elided) {
+                        plan.computeWaitStages |= stagesOf(std::span{&dependency.access, 1});
+                    }
+                    sync.onComputeQueue = false;
+                    simulateAccess(sync, dependency.access, isWrite, static_cast<int32_t>(level));
+                };
+                forEachSubresource(dependency, syncSubresource);
+
+                addTransition(taskHandle,
+                              dependency,
+                              *stateBefore,
+                              dependencyElided,
+                              dependencySplit,
+                              dependencyQueueTransfer);
+            });
+        }
+
+        // move the split barriers of the level to the end of its range, grouped by their event -
+        // they are recorded with a single vkCmdWaitEvents2 after the regular barriers
+        const uint32_t levelBegin = plan.levelBarriers[level];
+        std::vector<uint32_t> order(plan.barriers.size() - levelBegin);
+        std::iota(order.begin(), order.end(), levelBegin);
+        // NO_EVENT wraps around to sort first
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t lhs, uint32_t rhs) {
+            return barrierEvents[lhs] + 1 < barrierEvents[rhs] + 1;
+        });
+        permuteTail(plan.barriers, levelBegin, order);
+        permuteTail(plan.barrierTextures, levelBegin, order);
+        permuteTail(barrierEvents, levelBegin, order);
+        // the subresources of a texture that are synchronized the same way share a barrier
+        mergeSubresourceBarriers(plan.barriers, levelBegin, plan.barrierTextures, barrierEvents);
+
+        const auto firstSplit = std::find_if(
+            barrierEvents.begin() + levelBegin, barrierEvents.end(), [](uint32_t event) {
+                return event != NO_EVENT;
+            });
+        plan.levelSplitBarriers.push_back(
+            static_cast<uint32_t>(std::distance(barrierEvents.begin(), firstSplit)));
+        for (uint32_t barrierIdx = plan.levelSplitBarriers.back();
+             barrierIdx < barrierEvents.size();
+             ++barrierIdx) {
+            RecordingPlan::SplitEvent &event = plan.events[barrierEvents[barrierIdx]];
+            if (event.lastBarrier == 0) { event.firstBarrier = barrierIdx; }
+            event.lastBarrier = barrierIdx + 1;
+        }
+    }
+    plan.levelBarriers.push_back(static_cast<uint32_t>(plan.barriers.size()));
+    plan.levelBufferBarriers.push_back(static_cast<uint32_t>(plan.bufferBarriers.size()));
+    plan.levelEvents.push_back(static_cast<uint32_t>(plan.events.size()));
+
+    plan.collectReleaseBarriers();
+
+    // make sure the barriers of every level can be translated without allocating
+    size_t scratchSize{};
+    for (uint32_t level = 0; level < plan.levelCount(); ++level) {
+        scratchSize = std::max(
+            scratchSize,
+            Sync::BarrierScratchSize(
+                plan.levelBufferBarriers[level + 1] - plan.levelBufferBarriers[level],
+                plan.levelBarriers[level + 1] - plan.levelBarriers[level],
+                plan.levelEvents[level + 1] - plan.levelEvents[level]));
+    }
+    for (uint32_t i = 0; i < plan.computeTasks.size(); ++i) {
+        scratchSize = std::max(
+            scratchSize,
+            Sync::BarrierScratchSize(
+                plan.computeTaskBufferBarriers[i + 1] - plan.computeTaskBufferBarriers[i],
+                plan.computeTaskBarriers[i + 1] - plan.computeTaskBarriers[i]));
+    }
+    scratchSize = std::max(scratchSize,
+                           Sync::BarrierScratchSize(plan.bufferReleaseBarriers.size(),
+                                                    plan.releaseBarriers.size()));
+    if (data_->barrierScratch.size() < scratchSize) { data_->barrierScratch.resize(scratchSize); }
+
+    // the events to set after each level
+    plan.levelSetEvents.assign(plan.levelCount() + 1, 0);
+    for (const RecordingPlan::SplitEvent &event : plan.events) {
+        ++plan.levelSetEvents[event.setAfterLevel + 1];
+    }
+    std::partial_sum(
+        plan.levelSetEvents.begin(), plan.levelSetEvents.end(), plan.levelSetEvents.begin());
+    plan.setEvents.resize(plan.events.size());
+    std::vector<uint32_t> fill(plan.levelSetEvents.begin(), plan.levelSetEvents.end() - 1);
+    for (uint32_t eventIdx = 0; eventIdx < plan.events.size(); ++eventIdx) {
+        plan.setEvents[fill[plan.events[eventIdx].setAfterLevel]++] = eventIdx;
+    }
 }
 
 std::string Framegraph::dump(const ExecutionInfo &executionInfo)
@@ -183,6 +1778,7 @@ std::string Framegraph::dump(const ExecutionInfo &executionInfo)
 
 RenderTaskHandle Framegraph::finishTaskDeclaration(RenderTaskInfo &&info)
 {
+    data_->dependencyCount += info.dependencies.size() + info.bufferDependencies.size();
     return data_->renderTasks.emplace(info);
 }
 
@@ -204,116 +1800,238 @@ const std::vector<TransientTextureHandle> &Framegraph::outputs() const { return
 
 ExecutionInfo Framegraph::resolve(const std::vector<TransientTextureHandle> &requestedResources)
 {
-    // counter to assign render tasks an increasing execution priority - tasks
-    // with higher priority should be executed earlier
-    int32_t executionPrio{-1};
+    static constexpr uint32_t NO_TASK{0xFFFFFFFF};
+    const TextureManager &resources = data_->resources;
+    const auto taskCapacity = static_cast<uint32_t>(data_->renderTasks.capacity());
+    // textures and buffers share one index space
+    const uint32_t resourceCapacity = resources.indexCapacity();
+    const size_t maxNodes =
+        data_->dependencyCount + requestedResources.size() + data_->externalInputs.size();
+
+    enum class VisitState : uint8_t { New, InProgress, Done };
+    struct StackEntry {
+        uint32_t task;
+        uint32_t nextInput;
+    };
+
+    // all temporary data is allocated from an arena that is reused across frames. every
+    // resource version ("node") and task is identified by a dense index, so all lookups below
+    // are plain array accesses. the arena is sized for all arrays below - if that estimate is
+    // ever too small (nodes are counted per version, which is only bounded by the number of
+    // handles), the overflow is allocated from the heap and the arena grows for the next frame
+    const size_t arenaSize = arenaBytes<uint32_t>(resourceCapacity + 1) +    // nodeBase
+                             arenaBytes<const RenderTaskInfo *>(taskCapacity) + // taskInfos
+                             arenaBytes<SlotMapHandle>(taskCapacity) +         // taskHandles
+                             arenaBytes<uint8_t>(maxNodes) +                   // isExternal
+                             arenaBytes<uint32_t>(maxNodes) +                  // writer
+                             arenaBytes<uint32_t>(taskCapacity + 1) +          // inputBegin
+                             arenaBytes<uint32_t>(data_->dependencyCount) +    // inputs
+                             arenaBytes<VisitState>(taskCapacity) +            // visitState
+                             arenaBytes<StackEntry>(taskCapacity) +            // stack
+                             arenaBytes<uint32_t>(taskCapacity) +              // order
+                             arenaBytes<uint8_t>(resourceCapacity);            // resourceRequired
+    if (data_->resolveArena.size() < arenaSize) { data_->resolveArena.resize(arenaSize); }
+    OverflowResource overflow;
+    // runs after the arena has returned its overflow to the heap
+    const auto growArena = gsl::finally([&]() {
+        if (overflow.bytes() > 0) {
+            data_->resolveArena.resize(data_->resolveArena.size() + overflow.bytes());
+        }
+    });
+    std::pmr::monotonic_buffer_resource arena{
+        data_->resolveArena.data(), data_->resolveArena.size(), &overflow};
 
-    // first, reorder the information into a more convenient graph representation
-    // essentially, in- and out-edges
-    std::unordered_map<TransientTextureHandle, RenderTaskHandle> resourceToTask;
-    std::unordered_multimap<RenderTaskHandle, TransientTextureHandle> taskInputs;
-    std::unordered_map<TransientTextureHandle, TextureInfo> textures;
+    // resource nodes: each version of each resource gets an index nodeBase[resource] + version
+    std::pmr::vector<uint32_t> nodeBase(resourceCapacity + 1, 0, &arena);
+    const auto countVersion = [&](const auto &handle) {
+        uint32_t &count = nodeBase[resources.index(resourceOf(handle)) + 1];
+        count = std::max(count, handle.version() + 1);
+    };
+    // index tasks by their slot index
+    std::pmr::vector<const RenderTaskInfo *> taskInfos(taskCapacity, nullptr, &arena);
+    std::pmr::vector<SlotMapHandle> taskHandles(taskCapacity, SlotMapHandle{}, &arena);
     for (const auto &[taskHandle, taskInfo] : data_->renderTasks.items()) {
-        for (const RenderTaskInfo::Dependency &dependency : taskInfo.dependencies) {
-            const auto kind = dependency.kind;
-            // only counts as input if it is a 'pure' read dependency, not read/write
-            if (kind.is_set(TaskDependencyKindBits::Read) &&
-                !kind.is_set(TaskDependencyKindBits::Write)) {
-                taskInputs.insert({taskHandle, dependency.handle});
-            }
-            if (kind.is_set(TaskDependencyKindBits::Write)) {
-                resourceToTask[dependency.handle] = taskHandle;
+        taskInfos[taskHandle.index()] = &taskInfo;
+        taskHandles[taskHandle.index()] = taskHandle;
+        forEachDependency(taskInfo,
+                          [&](const auto &dependency) { countVersion(dependency.handle); });
+    }
+    for (const TransientTextureHandle &handle : requestedResources) {
+        countVersion(handle);
+    }
+    for (const TransientTextureHandle &handle : data_->externalInputs) {
+        countVersion(handle);
+    }
+    std::inclusive_scan(nodeBase.begin(), nodeBase.end(), nodeBase.begin());
+    const auto nodeOf = [&](const auto &handle) -> uint32_t {
+        return nodeBase[resources.index(resourceOf(handle))] + handle.version();
+    };
+
+    std::pmr::vector<uint8_t> isExternal(nodeBase.back(), 0, &arena);
+    for (const TransientTextureHandle &handle : data_->externalInputs) {
+        isExternal[nodeOf(handle)] = 1;
+    }
+
+    // the task that writes each resource node, and the 'pure' read dependencies of each task
+    // in compressed sparse row layout: inputs of task t are in [inputBegin[t], inputBegin[t+1])
+    std::pmr::vector<uint32_t> writer(nodeBase.back(), NO_TASK, &arena);
+    std::pmr::vector<uint32_t> inputBegin(taskCapacity + 1, 0, &arena);
+    const auto isPureRead = [](TaskDependencyKind kind) {
+        return kind.is_set(TaskDependencyKindBits::Read) &&
+               !kind.is_set(TaskDependencyKindBits::Write);
+    };
+    for (uint32_t task = 0; task < taskCapacity; ++task) {
+        if (taskInfos[task] == nullptr) { continue; }
+        forEachDependency(*taskInfos[task], [&](const auto &dependency) {
+            if (isPureRead(dependency.kind)) { ++inputBegin[task + 1]; }
+            if (dependency.kind.is_set(TaskDependencyKindBits::Write)) {
+                writer[nodeOf(dependency.handle)] = task;
             }
-            textures[dependency.handle] = data_->resources.info(dependency.handle);
-        }
+        });
+    }
+    std::inclusive_scan(inputBegin.begin(), inputBegin.end(), inputBegin.begin());
+    // the resource nodes that each task reads
+    std::pmr::vector<uint32_t> inputs(inputBegin.back(), &arena);
+    for (uint32_t task = 0; task < taskCapacity; ++task) {
+        if (taskInfos[task] == nullptr) { continue; }
+        uint32_t next = inputBegin[task];
+        forEachDependency(*taskInfos[task], [&](const auto &dependency) {
+            if (isPureRead(dependency.kind)) { inputs[next++] = nodeOf(dependency.handle); }
+        });
     }
 
-    std::vector<TextureHandle> requiredResources; // collects all actually required resources
+    // describes a resource node for error messages - only needed when resolving fails, so just
+    // search for a handle that refers to it
+    const auto describeNode = [&](uint32_t node) {
+        std::string description;
+        const auto check = [&](const auto &handle) {
+            if (description.empty() && nodeOf(handle) == node) {
+                description = fmt::format("'{} v{}' ({})",
+                                          resources.info(resourceOf(handle)).name,
+                                          handle.version(),
+                                          resourceOf(handle));
+            }
+        };
+        for (const TransientTextureHandle &handle : requestedResources) {
+            check(handle);
+        }
+        for (uint32_t task = 0; task < taskCapacity; ++task) {
+            if (taskInfos[task] == nullptr) { continue; }
+            forEachDependency(*taskInfos[task],
+                              [&](const auto &dependency) { check(dependency.handle); });
+        }
+        return description;
+    };
 
-    // flood-fill the graph starting at the resources requested from the outside
-    std::deque<TransientTextureHandle> nextResourcesToResolve{requestedResources.cbegin(),
-                                                              requestedResources.cend()};
-    while (!nextResourcesToResolve.empty()) {
-        auto nextResource = nextResourcesToResolve.front();
-        nextResourcesToResolve.pop_front();
-        requiredResources.push_back(nextResource);
+    // depth-first search starting at the requested resources. tasks are emitted in post-order,
+    // so every task comes after the tasks that produce its inputs. each task and each edge is
+    // visited exactly once.
+    std::pmr::vector<VisitState> visitState(taskCapacity, VisitState::New, &arena);
+    std::pmr::vector<StackEntry> stack(&arena);
+    std::pmr::vector<uint32_t> order(&arena);
+    stack.reserve(taskCapacity);
+    order.reserve(taskCapacity);
 
-        // determine the task that writes/creates the resource
-        auto writingTaskIt = resourceToTask.find(nextResource);
-        if (writingTaskIt == resourceToTask.end()) {
+    // returns false if the resource node can't be resolved
+    const auto visitResource = [&](uint32_t node) {
+        const uint32_t writingTask = writer[node];
+        if (writingTask == NO_TASK) {
             // if resource is external, we don't have to resolve it
-            if (ranges::contains(data_->externalInputs, nextResource)) { continue; }
-
-            CO_CORE_ERROR(
-                "Could not resolve frame dependency graph: resource '{} v{}' ({}) is not created "
-                "by any render task",
-                textures[nextResource].name,
-                nextResource.version(),
-                nextResource.texture());
-            return {};
-        }
-
-        const RenderTaskHandle writingTask = writingTaskIt->second;
-        CO_CORE_TRACE("Resolving resource '{} v{}': created/written by render task '{}'",
-                      textures[nextResource].name,
-                      nextResource.version(),
-                      data_->renderTasks[writingTask].name);
-        data_->renderTasks[writingTask].executionPriority = ++executionPrio;
-
-        // mark the resources created by the task as required
-        for (const RenderTaskInfo::Dependency &created :
-             data_->renderTasks[writingTask].dependencies |
-                 ranges::views::filter([](const auto &outputDesc) {
-                     return outputDesc.kind.is_set(TaskDependencyKindBits::Create);
-                 })) {
-            requiredResources.push_back(created.handle);
-        }
-
-        // enqueue the inputs of the task for resolution
-        auto rng = taskInputs.equal_range(writingTask);
-        ranges::transform(
-            rng.first, rng.second, std::back_inserter(nextResourcesToResolve), [&](const auto &it) {
-                CO_CORE_TRACE("Requesting input resource for {}: '{} v{}'",
-                              data_->renderTasks[writingTask].name,
-                              textures[it.second].name,
-                              it.second.version());
-                return it.second;
-            });
+            if (isExternal[node]) { return true; }
+
+            CO_CORE_ERROR("Could not resolve frame dependency graph: resource {} is not created "
+                          "by any render task",
+                          describeNode(node));
+            return false;
+        }
+        if (visitState[writingTask] == VisitState::InProgress) {
+            CO_CORE_ERROR("Could not resolve frame dependency graph: render task '{}' depends on "
+                          "its own outputs",
+                          taskInfos[writingTask]->name);
+            return false;
+        }
+        if (visitState[writingTask] == VisitState::New) {
+            visitState[writingTask] = VisitState::InProgress;
+            stack.push_back({writingTask, inputBegin[writingTask]});
+        }
+        return true;
+    };
+
+    for (const TransientTextureHandle &requested : requestedResources) {
+        if (!visitResource(nodeOf(requested))) { return {}; }
+        while (!stack.empty()) {
+            StackEntry &top = stack.back();
+            if (top.nextInput < inputBegin[top.task + 1]) {
+                // note: visitResource may push to the stack and invalidate top
+                const uint32_t input = inputs[top.nextInput++];
+                if (!visitResource(input)) { return {}; }
+                continue;
+            }
+            visitState[top.task] = VisitState::Done;
+            order.push_back(top.task);
+            stack.pop_back();
+        }
     }
 
-    auto items = data_->renderTasks.items();
-    auto tasksToExecute =
-        items | ranges::views::transform([](const auto &it) {
-            return std::make_pair(RenderTaskHandle{it.first}, it.second.executionPriority);
-        }) |
-        ranges::views::filter([](const auto &it) { return it.second >= 0; }) |
-        ranges::to<std::vector>;
+    // collect all textures and buffers that are touched by the tasks to execute
+    std::pmr::vector<uint8_t> resourceRequired(resourceCapacity, 0, &arena);
+    std::vector<TextureHandle> requiredResources;
+    std::vector<BufferResourceHandle> requiredBuffers;
+    const auto require = [&](auto resource, auto &required) {
+        uint8_t &isRequired = resourceRequired[resources.index(resource)];
+        if (!isRequired) {
+            isRequired = 1;
+            required.push_back(resource);
+        }
+    };
+    for (const TransientTextureHandle &requested : requestedResources) {
+        require(requested.texture(), requiredResources);
+    }
 
-    // sort in descending order so the tasks with the highest priority come first
-    ranges::sort(tasksToExecute, {}, [](const auto &it) { return -it.second; });
+    std::vector<RenderTaskHandle> tasks;
+    tasks.reserve(order.size());
+    for (size_t position = 0; position < order.size(); ++position) {
+        const uint32_t task = order[position];
+        // tasks with higher priority are executed earlier
+        data_->renderTasks[taskHandles[task]].executionPriority =
+            static_cast<int32_t>(order.size() - position - 1);
+        tasks.push_back(RenderTaskHandle{taskHandles[task]});
+        for (const RenderTaskInfo::Dependency &dependency : taskInfos[task]->dependencies) {
+            require(dependency.handle.texture(), requiredResources);
+        }
+        for (const RenderTaskInfo::BufferDependency &dependency :
+             taskInfos[task]->bufferDependencies) {
+            require(dependency.handle.buffer(), requiredBuffers);
+        }
+    }
 
     CO_CORE_TRACE("Render task order after resolve:");
-    for (const auto &[handle, prio] : tasksToExecute) {
-        CO_CORE_TRACE("  [{}] {}", prio, data_->renderTasks[handle].name);
+    for (const uint32_t task : order) {
+        CO_CORE_TRACE("  {}", taskInfos[task]->name);
     }
 
-    auto tasks = tasksToExecute |
-                 ranges::views::transform([](const auto &it) { return it.first; }) |
-                 ranges::to<std::vector<RenderTaskHandle>>;
-
-    return {
-        .tasks = std::move(tasks), .resources = std::move(requiredResources), .transitions = {}};
+    return {.tasks = std::move(tasks),
+            .resources = std::move(requiredResources),
+            .lifetimes = {},
+            .buffers = std::move(requiredBuffers),
+            .bufferLifetimes = {},
+            .levels = {},
+            .asyncCompute = {},
+            .transitions = {},
+            .bufferTransitions = {},
+            .cacheHit = false};
 }
 
 RenderInput Framegraph::renderInput(RenderTaskHandle taskHandle)
 {
-    CO_CORE_ASSERT(data_->commandListInProgress, "No command list recording in progress!");
+    const RenderTaskInfo &info = data_->renderTasks[taskHandle];
+    CO_CORE_ASSERT(info.commandList, "No command list recording in progress!");
     return {
         .ctx = data_->ctx,
         .frameCtx = data_->currentFrameCtx,
         .resources = &data_->resources,
         .descriptors = &data_->ctx->descriptorSets(),
-        .cmd = data_->commandListInProgress,
+        .cmd = info.commandList,
     };
 }
 
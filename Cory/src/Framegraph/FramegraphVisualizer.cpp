@@ -149,10 +149,16 @@ std::string FramegraphVisualizer::generateDotGraph(const ExecutionInfo &executio
     }
 
     for (const Index::DependencyInfo &dep : index.inputDependencies) {
+        const bool elided = dep.transitionInfo && dep.transitionInfo->elided;
+        const bool split = dep.transitionInfo && dep.transitionInfo->split;
+        const bool queueTransfer = dep.transitionInfo && dep.transitionInfo->queueTransfer;
         append("  \"{}\" -> \"{}\" [label=\"{}\"]\n",
                make_label(index.textures[dep.resource]),
                make_label(index.tasks[dep.task]),
-               "");
+               elided          ? "<no barrier>"
+               : split         ? "<split barrier>"
+               : queueTransfer ? "<queue transfer>"
+                               : "");
     }
     for (const Index::DependencyInfo &dep : index.createDependencies) {
 
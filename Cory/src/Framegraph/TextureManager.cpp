@@ -2,14 +2,16 @@
 
 #include <Cory/Base/FmtUtils.hpp>
 #include <Cory/Base/Log.hpp>
+#include <Cory/Framegraph/TransientTexturePool.hpp>
 #include <Cory/Renderer/Context.hpp>
 #include <Cory/Renderer/ResourceManager.hpp>
 
 #include <Magnum/Vk/CommandBuffer.h>
 #include <Magnum/Vk/Device.h>
-#include <Magnum/Vk/ImageCreateInfo.h>
-#include <Magnum/Vk/ImageViewCreateInfo.h>
-#include <gsl/narrow>
+#include <Magnum/Vk/Image.h>
+
+#include <algorithm>
+#include <map>
 
 namespace Vk = Magnum::Vk;
 
@@ -20,17 +22,49 @@ struct TextureResource {
     TextureState state;
     ImageHandle image;
     ImageViewHandle view;
+    // one view per mip level and array layer, empty for textures with a single subresource
+    std::vector<ImageViewHandle> subresourceViews{};
+    // the last access of each mip level and array layer, state.lastAccess mirrors the first one
+    std::vector<Sync::AccessType> subresourceAccesses{};
+    // textures that occupied the same memory earlier in the frame
+    std::vector<TextureHandle> aliasedPredecessors{};
+    // the versions of the texture whose contents are read later in the frame
+    std::vector<uint32_t> consumedVersions{};
+    bool memoryless{false};
+    // the union of the image usages of all accesses to the texture in the frame
+    VkImageUsageFlags usage{};
+};
+
+struct BufferResource {
+    BufferInfo info;
+    BufferState state;
+    BufferHandle buffer;
+    // buffers that occupied the same memory earlier in the frame
+    std::vector<BufferResourceHandle> aliasedPredecessors{};
 };
 
 struct TextureManagerPrivate {
     Context *ctx_{};
+    std::shared_ptr<TransientTexturePool> pool_;
+    // a private pool is advanced in clear(), a shared one by its owner
+    bool ownsPool_{false};
     SlotMap<TextureResource> textureResources_;
+    SlotMap<BufferResource> bufferResources_;
+    // the memory heaps that all transient textures of the frame are allocated from
+    std::vector<TransientHeapHandle> heaps_;
 };
 
 TextureManager::TextureManager(Context &ctx)
+    : TextureManager(ctx, std::make_shared<TransientTexturePool>(ctx))
+{
+    data_->ownsPool_ = true;
+}
+
+TextureManager::TextureManager(Context &ctx, std::shared_ptr<TransientTexturePool> pool)
     : data_{std::make_unique<TextureManagerPrivate>()}
 {
     data_->ctx_ = &ctx;
+    data_->pool_ = std::move(pool);
 }
 
 TextureManager::~TextureManager() = default;
@@ -39,17 +73,23 @@ TextureManager &TextureManager::operator=(TextureManager &&) = default;
 
 TextureHandle TextureManager::declareTexture(TextureInfo info)
 {
-    CO_CORE_DEBUG("Declaring '{}' of {} ({}, {} samples)",
+    CO_CORE_DEBUG("Declaring '{}' of {} ({}, {} samples, {} mip levels, {} array layers)",
                   info.name,
                   info.size,
                   info.format,
-                  info.sampleCount);
+                  info.sampleCount,
+                  info.mipLevels,
+                  info.arrayLayers);
 
+    const uint32_t subresourceCount = info.mipLevels * info.arrayLayers;
     auto handle = data_->textureResources_.emplace(TextureResource{
-        info,
-        TextureState{.lastAccess = Sync::AccessType::None, .status = TextureMemoryStatus::Virtual},
-        NullHandle,
-        NullHandle});
+        .info = std::move(info),
+        .state = TextureState{.lastAccess = Sync::AccessType::None,
+                              .status = TextureMemoryStatus::Virtual},
+        .image = NullHandle,
+        .view = NullHandle,
+        .subresourceAccesses =
+            std::vector<Sync::AccessType>(subresourceCount, Sync::AccessType::None)});
     return handle;
 }
 
@@ -58,98 +98,330 @@ TextureHandle TextureManager::registerExternal(TextureInfo info,
                                                Magnum::Vk::Image &resource,
                                                Magnum::Vk::ImageView &resourceView)
 {
-    auto &resources = data_->ctx_->resources();
+    auto [image, view] = data_->pool_->wrapExternal(info.name, resource, resourceView);
+    const uint32_t subresourceCount = info.mipLevels * info.arrayLayers;
     auto handle = data_->textureResources_.emplace(
         TextureResource{.info = info,
                         .state = TextureState{.lastAccess = lastWriteAccess,
                                               .status = TextureMemoryStatus::External},
-                        .image = resources.wrapImage(info.name, resource),
-                        .view = resources.wrapImageView(info.name, resourceView)});
+                        .image = image,
+                        .view = view,
+                        .subresourceAccesses =
+                            std::vector<Sync::AccessType>(subresourceCount, lastWriteAccess)});
 
     return handle;
 }
 
-void TextureManager::allocate(TextureHandle handle)
+BufferResourceHandle TextureManager::declareBuffer(BufferInfo info)
 {
-    TextureResource &res = data_->textureResources_[handle];
-    auto &resources = data_->ctx_->resources();
-    CO_CORE_DEBUG("Allocating '{}' of {} ({})", res.info.name, res.info.size, res.info.format);
-
-    // TODO allocate from a big buffer instead of individual allocations
-    {
-        const auto size = Magnum::Vector2i{gsl::narrow<int32_t>(res.info.size.x),
-                                           gsl::narrow<int32_t>(res.info.size.y)};
-        static const int32_t levels = 1;
-        static const Magnum::Vk::ImageLayout initialLayout{Magnum::Vk::ImageLayout::Undefined};
-
-        Vk::ImageUsages usage{};
-        usage |= isDepthFormat(res.info.format) ? Vk::ImageUsage::DepthStencilAttachment
-                                                : Vk::ImageUsage::ColorAttachment;
-        usage |= Vk::ImageUsage::Sampled;
-        usage |= Vk::ImageUsage::InputAttachment;
-
-        const Vk::ImageCreateInfo2D createInfo{
-            usage, res.info.format, size, levels, res.info.sampleCount, initialLayout};
-
-        // todo eventually want to externalize these memory flags
-        res.image = resources.createImage(
-            fmt::format("{} (IMG)", res.info.name), createInfo, Vk::MemoryFlag::DeviceLocal);
+    CO_CORE_DEBUG("Declaring buffer '{}' of {} bytes", info.name, info.size);
+
+    auto handle = data_->bufferResources_.emplace(BufferResource{
+        .info = std::move(info),
+        .state = BufferState{.lastAccess = Sync::AccessType::None,
+                             .status = TextureMemoryStatus::Virtual},
+        .buffer = NullHandle});
+    return handle;
+}
+
+namespace {
+TransientImageDesc transientImageDesc(const TextureResource &res)
+{
+    Vk::ImageUsages usage{Vk::ImageUsage(res.usage)};
+    // a texture without any access can't be created with empty usage, make it an attachment
+    if (res.usage == 0) {
+        usage = isDepthFormat(res.info.format) ? Vk::ImageUsage::DepthStencilAttachment
+                                               : Vk::ImageUsage::ColorAttachment;
     }
+    // memoryless textures are only accessed as attachments, see Framegraph::planTextureUsage()
+    if (res.memoryless) { usage |= Vk::ImageUsage::TransientAttachment; }
+
+    return TransientImageDesc{.size = res.info.size,
+                              .format = res.info.format,
+                              .sampleCount = res.info.sampleCount,
+                              .usage = VkImageUsageFlags(usage),
+                              .mipLevels = res.info.mipLevels,
+                              .arrayLayers = res.info.arrayLayers};
+}
 
-    {
-        const Vk::ImageViewCreateInfo2D createInfo{resources[res.image]};
-        res.view = resources.createImageView(fmt::format("{} (VIEW)", res.info.name), createInfo);
+/// place the resources of all @a requests in a single heap of the given memory type
+std::pair<TransientHeapHandle, AliasingPlan>
+placeInHeap(TransientTexturePool &pool,
+            uint32_t memoryType,
+            const std::vector<AliasingRequest> &requests,
+            std::string_view kind)
+{
+    uint64_t unaliasedSize{};
+    for (const AliasingRequest &request : requests) {
+        unaliasedSize += request.size;
     }
-    res.state.status = TextureMemoryStatus::Allocated;
+
+    AliasingPlan plan = planMemoryAliasing(requests);
+    CO_CORE_DEBUG("Placing {} transient {} in a heap of {} bytes ({} bytes without "
+                  "aliasing) from memory type {}",
+                  requests.size(),
+                  kind,
+                  plan.heapSize,
+                  unaliasedSize,
+                  memoryType);
+
+    const TransientHeapHandle heap = pool.acquireHeap(memoryType, plan.heapSize);
+    return {heap, std::move(plan)};
 }
+} // namespace
 
-void TextureManager::allocate(const std::vector<TextureHandle> &handles)
+void TextureManager::allocate(const std::vector<TextureHandle> &handles,
+                              const std::vector<ResourceLifetime> &lifetimes)
 {
-    for (const auto &handle : handles) {
-        auto &res = data_->textureResources_[handle];
+    CO_CORE_ASSERT(handles.size() == lifetimes.size(),
+                   "Need exactly one lifetime per texture to allocate!");
+    TransientTexturePool &pool = *data_->pool_;
+
+    struct PendingTexture {
+        TextureHandle handle;
+        TransientImageDesc desc;
+        AliasingRequest request;
+    };
+    // memory type index -> textures to be placed in a heap of that type
+    std::map<uint32_t, std::vector<PendingTexture>> pendingByMemoryType;
+
+    for (size_t i = 0; i < handles.size(); ++i) {
+        const TextureResource &res = data_->textureResources_[handles[i]];
         // don't allocate external resources or resources that are already allocated
         if (res.state.status != TextureMemoryStatus::Virtual) { continue; }
 
-        allocate(handle);
+        const TransientImageDesc desc = transientImageDesc(res);
+        const TransientMemoryRequirements requirements = pool.memoryRequirements(desc);
+        pendingByMemoryType[requirements.memoryType].push_back(
+            PendingTexture{.handle = handles[i],
+                           .desc = desc,
+                           .request = {.lifetime = lifetimes[i],
+                                       .size = requirements.size,
+                                       .alignment = requirements.alignment}});
+    }
+
+    for (const auto &[memoryType, pending] : pendingByMemoryType) {
+        std::vector<AliasingRequest> requests;
+        requests.reserve(pending.size());
+        for (const PendingTexture &texture : pending) {
+            requests.push_back(texture.request);
+        }
+
+        const auto [heap, plan] = placeInHeap(pool, memoryType, requests, "textures");
+        data_->heaps_.push_back(heap);
+
+        for (size_t i = 0; i < pending.size(); ++i) {
+            TextureResource &res = data_->textureResources_[pending[i].handle];
+            CO_CORE_TRACE("Allocating '{}' of {} ({}) at offset {}",
+                          res.info.name,
+                          res.info.size,
+                          res.info.format,
+                          plan.offsets[i]);
+            std::tie(res.image, res.view) =
+                pool.acquireImage(heap, pending[i].desc, plan.offsets[i], res.info.name);
+            const auto subresourceViews = pool.subresourceViews(heap, res.image);
+            res.subresourceViews.assign(subresourceViews.begin(), subresourceViews.end());
+
+            res.aliasedPredecessors.clear();
+            for (const uint32_t predecessor : plan.predecessors[i]) {
+                res.aliasedPredecessors.push_back(pending[predecessor].handle);
+            }
+            res.state.status = TextureMemoryStatus::Allocated;
+        }
+    }
+}
+
+void TextureManager::allocate(const std::vector<BufferResourceHandle> &handles,
+                              const std::vector<ResourceLifetime> &lifetimes)
+{
+    CO_CORE_ASSERT(handles.size() == lifetimes.size(),
+                   "Need exactly one lifetime per buffer to allocate!");
+    TransientTexturePool &pool = *data_->pool_;
+
+    struct PendingBuffer {
+        BufferResourceHandle handle;
+        TransientBufferDesc desc;
+        AliasingRequest request;
+    };
+    // memory type index -> buffers to be placed in a heap of that type
+    std::map<uint32_t, std::vector<PendingBuffer>> pendingByMemoryType;
+
+    for (size_t i = 0; i < handles.size(); ++i) {
+        const BufferResource &res = data_->bufferResources_[handles[i]];
+        if (res.state.status != TextureMemoryStatus::Virtual) { continue; }
+
+        const TransientBufferDesc desc{.size = res.info.size,
+                                       .usage = res.info.usage.underlying_bits()};
+        const TransientMemoryRequirements requirements = pool.memoryRequirements(desc);
+        pendingByMemoryType[requirements.memoryType].push_back(
+            PendingBuffer{.handle = handles[i],
+                          .desc = desc,
+                          .request = {.lifetime = lifetimes[i],
+                                      .size = requirements.size,
+                                      .alignment = requirements.alignment}});
+    }
+
+    for (const auto &[memoryType, pending] : pendingByMemoryType) {
+        std::vector<AliasingRequest> requests;
+        requests.reserve(pending.size());
+        for (const PendingBuffer &buffer : pending) {
+            requests.push_back(buffer.request);
+        }
+
+        const auto [heap, plan] = placeInHeap(pool, memoryType, requests, "buffers");
+        data_->heaps_.push_back(heap);
+
+        for (size_t i = 0; i < pending.size(); ++i) {
+            BufferResource &res = data_->bufferResources_[pending[i].handle];
+            CO_CORE_TRACE("Allocating buffer '{}' of {} bytes at offset {}",
+                          res.info.name,
+                          res.info.size,
+                          plan.offsets[i]);
+            res.buffer = pool.acquireBuffer(heap, pending[i].desc, plan.offsets[i], res.info.name);
+
+            res.aliasedPredecessors.clear();
+            for (const uint32_t predecessor : plan.predecessors[i]) {
+                res.aliasedPredecessors.push_back(pending[predecessor].handle);
+            }
+            res.state.status = TextureMemoryStatus::Allocated;
+        }
     }
 }
 
-Sync::ImageBarrier TextureManager::synchronizeTexture(TextureHandle handle,
-                                                      Sync::AccessType access,
-                                                      ImageContents contentsMode)
+Sync::ImageBarrier TextureManager::barrier(TextureHandle handle,
+                                           SubresourceRange range,
+                                           std::span<const Sync::AccessType> prevAccesses,
+                                           std::span<const Sync::AccessType> nextAccesses,
+                                           ImageContents contentsMode,
+                                           uint32_t srcQueueFamily,
+                                           uint32_t dstQueueFamily) const
 {
     const auto &info = data_->textureResources_[handle].info;
     auto aspectMask = VkImageAspectFlags(imageAspectsFor(info.format));
-    auto &state = data_->textureResources_[handle].state;
+    const SubresourceRange subresources = range.clamped(info);
 
     const VkBool32 discard = (contentsMode == ImageContents::Discard) ? VK_TRUE : VK_FALSE;
-    Sync::ImageBarrier barrier{.prevAccesses{state.lastAccess},
-                               .nextAccesses{access},
+    Sync::ImageBarrier barrier{.prevAccesses{prevAccesses.begin(), prevAccesses.end()},
+                               .nextAccesses{nextAccesses.begin(), nextAccesses.end()},
                                .prevLayout = Sync::ImageLayout::Optimal,
                                .nextLayout = Sync::ImageLayout::Optimal,
                                .discardContents = discard,
-                               // todo: probably problematic once we actually use more queues
-                               .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                               .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                               .srcQueueFamilyIndex = srcQueueFamily,
+                               .dstQueueFamilyIndex = dstQueueFamily,
                                .image = data_->ctx_->resources()[image(handle)],
                                .subresourceRange = {
                                    .aspectMask = aspectMask,
-                                   .baseMipLevel = 0,
-                                   .levelCount = 1,
-                                   .baseArrayLayer = 0,
-                                   .layerCount = 1,
+                                   .baseMipLevel = subresources.baseMipLevel,
+                                   .levelCount = subresources.levelCount,
+                                   .baseArrayLayer = subresources.baseArrayLayer,
+                                   .layerCount = subresources.layerCount,
                                }};
 
-    CO_CORE_TRACE("BARRIER '{}' written as {} ({}), read as {}",
+    CO_CORE_TRACE("BARRIER '{}' (mips {}+{}, layers {}+{}) accessed as {} ({}), next accessed "
+                  "as {}",
                   info.name,
-                  state.lastAccess,
+                  subresources.baseMipLevel,
+                  subresources.levelCount,
+                  subresources.baseArrayLayer,
+                  subresources.layerCount,
+                  fmt::join(prevAccesses, ", "),
                   contentsMode,
-                  access);
+                  fmt::join(nextAccesses, ", "));
+    return barrier;
+}
 
-    state.lastAccess = access;
+Sync::BufferBarrier TextureManager::barrier(BufferResourceHandle handle,
+                                            std::span<const Sync::AccessType> prevAccesses,
+                                            std::span<const Sync::AccessType> nextAccesses,
+                                            uint32_t srcQueueFamily,
+                                            uint32_t dstQueueFamily) const
+{
+    const BufferResource &res = data_->bufferResources_[handle];
+    Sync::BufferBarrier barrier{.prevAccesses{prevAccesses.begin(), prevAccesses.end()},
+                                .nextAccesses{nextAccesses.begin(), nextAccesses.end()},
+                                .srcQueueFamilyIndex = srcQueueFamily,
+                                .dstQueueFamilyIndex = dstQueueFamily,
+                                .buffer = data_->ctx_->resources()[res.buffer],
+                                .offset = 0,
+                                .size = VK_WHOLE_SIZE};
+
+    CO_CORE_TRACE("BARRIER '{}' accessed as {}, next accessed as {}",
+                  res.info.name,
+                  fmt::join(prevAccesses, ", "),
+                  fmt::join(nextAccesses, ", "));
     return barrier;
 }
 
+void TextureManager::markConsumed(TransientTextureHandle handle)
+{
+    auto &versions = data_->textureResources_[handle.texture()].consumedVersions;
+    if (std::find(versions.begin(), versions.end(), handle.version()) == versions.end()) {
+        versions.push_back(handle.version());
+    }
+}
+
+bool TextureManager::consumed(TransientTextureHandle handle) const
+{
+    const auto &versions = data_->textureResources_[handle.texture()].consumedVersions;
+    return std::find(versions.begin(), versions.end(), handle.version()) != versions.end();
+}
+
+std::span<const uint32_t> TextureManager::consumedVersions(TextureHandle handle) const
+{
+    return data_->textureResources_[handle].consumedVersions;
+}
+
+void TextureManager::setMemoryless(TextureHandle handle)
+{
+    TextureResource &res = data_->textureResources_[handle];
+    CO_CORE_ASSERT(res.state.status == TextureMemoryStatus::Virtual,
+                   "Texture '{}' is already backed by memory!",
+                   res.info.name);
+    res.memoryless = true;
+}
+
+bool TextureManager::memoryless(TextureHandle handle) const
+{
+    return data_->textureResources_[handle].memoryless;
+}
+
+void TextureManager::addUsage(TextureHandle handle, VkImageUsageFlags usage)
+{
+    TextureResource &res = data_->textureResources_[handle];
+    CO_CORE_ASSERT(res.state.status != TextureMemoryStatus::Allocated,
+                   "Texture '{}' is already allocated!",
+                   res.info.name);
+    res.usage |= usage;
+}
+
+VkImageUsageFlags TextureManager::usage(TextureHandle handle) const
+{
+    return data_->textureResources_[handle].usage;
+}
+
+void TextureManager::setLastAccess(TextureHandle handle,
+                                   Sync::AccessType access,
+                                   SubresourceRange range)
+{
+    TextureResource &res = data_->textureResources_[handle];
+    const SubresourceRange subresources = range.clamped(res.info);
+    for (uint32_t level = subresources.baseMipLevel;
+         level < subresources.baseMipLevel + subresources.levelCount;
+         ++level) {
+        for (uint32_t layer = subresources.baseArrayLayer;
+             layer < subresources.baseArrayLayer + subresources.layerCount;
+             ++layer) {
+            res.subresourceAccesses[level * res.info.arrayLayers + layer] = access;
+        }
+    }
+    res.state.lastAccess = res.subresourceAccesses.front();
+}
+
+void TextureManager::setLastAccess(BufferResourceHandle handle, Sync::AccessType access)
+{
+    data_->bufferResources_[handle].state.lastAccess = access;
+}
+
 const TextureInfo &TextureManager::info(TextureHandle handle) const
 {
     return data_->textureResources_[handle].info;
@@ -165,18 +437,83 @@ ImageViewHandle TextureManager::imageView(TextureHandle handle) const
     return data_->textureResources_[handle].view;
 }
 
+ImageViewHandle
+TextureManager::imageView(TextureHandle handle, uint32_t mipLevel, uint32_t arrayLayer) const
+{
+    const TextureResource &res = data_->textureResources_[handle];
+    if (res.info.mipLevels * res.info.arrayLayers == 1) { return res.view; }
+    CO_CORE_ASSERT(!res.subresourceViews.empty(),
+                   "Texture '{}' has no views of its subresources!",
+                   res.info.name);
+    return res.subresourceViews[mipLevel * res.info.arrayLayers + arrayLayer];
+}
+
 TextureState TextureManager::state(TextureHandle handle) const
 {
     return data_->textureResources_[handle].state;
 }
 
+Sync::AccessType
+TextureManager::lastAccess(TextureHandle handle, uint32_t mipLevel, uint32_t arrayLayer) const
+{
+    const TextureResource &res = data_->textureResources_[handle];
+    return res.subresourceAccesses[mipLevel * res.info.arrayLayers + arrayLayer];
+}
+
+const std::vector<TextureHandle> &TextureManager::aliasedPredecessors(TextureHandle handle) const
+{
+    return data_->textureResources_[handle].aliasedPredecessors;
+}
+
+const BufferInfo &TextureManager::info(BufferResourceHandle handle) const
+{
+    return data_->bufferResources_[handle].info;
+}
+
+BufferHandle TextureManager::buffer(BufferResourceHandle handle) const
+{
+    return data_->bufferResources_[handle].buffer;
+}
+
+BufferState TextureManager::state(BufferResourceHandle handle) const
+{
+    return data_->bufferResources_[handle].state;
+}
+
+const std::vector<BufferResourceHandle> &
+TextureManager::aliasedPredecessors(BufferResourceHandle handle) const
+{
+    return data_->bufferResources_[handle].aliasedPredecessors;
+}
+
+uint32_t TextureManager::index(TextureHandle handle) const
+{
+    return static_cast<SlotMapHandle>(handle).index();
+}
+
+uint32_t TextureManager::index(BufferResourceHandle handle) const
+{
+    // buffers come after all textures
+    return static_cast<uint32_t>(data_->textureResources_.capacity()) +
+           static_cast<SlotMapHandle>(handle).index();
+}
+
+uint32_t TextureManager::indexCapacity() const
+{
+    return static_cast<uint32_t>(data_->textureResources_.capacity() +
+                                 data_->bufferResources_.capacity());
+}
+
 void TextureManager::clear()
 {
-    for (auto &res : data_->textureResources_) {
-        data_->ctx_->resources().release(res.image);
-        data_->ctx_->resources().release(res.view);
+    // images and views are owned by the pool, which keeps them around for the next frames
+    for (const TransientHeapHandle heap : data_->heaps_) {
+        data_->pool_->releaseHeap(heap);
     }
+    data_->heaps_.clear();
     data_->textureResources_.clear();
+    data_->bufferResources_.clear();
+    if (data_->ownsPool_) { data_->pool_->collectGarbage(); }
 }
 
 } // namespace Cory
\ No newline at end of file
@@ -3,24 +3,18 @@
 #include "Cory/Framegraph/TextureManager.hpp"
 #include <Cory/Framegraph/CommandList.hpp>
 #include <Cory/Framegraph/Common.hpp>
+#include <Cory/Framegraph/RenderTaskBuilder.hpp>
 #include <Cory/Renderer/Context.hpp>
 #include <Cory/Renderer/ResourceManager.hpp>
-#include <Cory/Renderer/Shader.hpp>
 
+#include <range/v3/algorithm/find_if.hpp>
 #include <range/v3/range/conversion.hpp>
 #include <range/v3/view/transform.hpp>
 
 #include <Corrade/Containers/ArrayView.h>
 #include <Magnum/Vk/ImageView.h>
-#include <Magnum/Vk/PipelineLayout.h>
-#include <Magnum/Vk/RasterizationPipelineCreateInfo.h>
-#include <Magnum/Vk/Shader.h>
-#include <Magnum/Vk/ShaderCreateInfo.h>
-#include <Magnum/Vk/ShaderSet.h>
 
-#include <gsl/narrow>
-
-#include <unordered_map>
+#include <algorithm>
 
 #include "Cory/Base/Math.hpp"
 
@@ -28,103 +22,6 @@ namespace Vk = Magnum::Vk;
 
 namespace Cory {
 
-struct PipelineDescriptor {
-    std::vector<ShaderHandle> shaders;
-    int32_t sampleCount;
-    std::vector<VkFormat> colorFormats;
-    VkFormat depthFormat;
-    VkFormat stencilFormat;
-    bool hasMeshInput;
-    std::size_t hash() const
-    {
-        return hashCompose(0, shaders, sampleCount, colorFormats, depthFormat, stencilFormat);
-    }
-    bool operator==(const PipelineDescriptor &rhs) const = default;
-};
-
-class PipelineCache {
-  public:
-    PipelineHandle query(Context &ctx, std::string_view name, PipelineDescriptor &info)
-    {
-        if (auto it = cache_.find(info); it != cache_.end()) { return it->second; }
-        auto handle = create(ctx, name, info);
-        cache_.insert({info, handle});
-        return handle;
-    }
-
-  private:
-    PipelineHandle create(Context &ctx, std::string_view name, PipelineDescriptor &info)
-    {
-        CO_CORE_INFO("Creating new pipeline for '{}' ({:X})", name, info.hash());
-        // set up shaders
-        auto &resources = ctx.resources();
-        Vk::ShaderSet shaderSet{};
-        for (auto shaderHandle : info.shaders) {
-            auto &shader = resources[shaderHandle];
-            shaderSet.addShader(
-                static_cast<Vk::ShaderStage>(shader.type()), shader.module(), "main");
-        }
-
-        Vk::RasterizationPipelineCreateInfo pipelineCreateInfo{
-            shaderSet,
-            ctx.defaultMeshLayout(!info.hasMeshInput),
-            ctx.defaultPipelineLayout(),
-            VK_NULL_HANDLE,
-            0,
-            1};
-
-        // configure dynamic states
-        pipelineCreateInfo.setDynamicStates(Vk::DynamicRasterizationState::Viewport |
-                                            Vk::DynamicRasterizationState::Scissor |
-                                            Vk::DynamicRasterizationState::CullMode |
-                                            Vk::DynamicRasterizationState::DepthTestEnable |
-                                            Vk::DynamicRasterizationState::DepthWriteEnable |
-                                            Vk::DynamicRasterizationState::DepthCompareOperation);
-
-        const VkPipelineViewportStateCreateInfo viewportState{
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-            .viewportCount = 1,
-            .scissorCount = 1,
-        };
-        pipelineCreateInfo->pViewportState = &viewportState;
-
-        // multisampling setup
-        const VkPipelineMultisampleStateCreateInfo multisampling{
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-            .rasterizationSamples = (VkSampleCountFlagBits)info.sampleCount,
-            .sampleShadingEnable = VK_TRUE,
-        };
-
-        // note: depth setup is ignored and actually overridden the dynamic states, only stencil and
-        // depth bounds are relevant here
-        const VkPipelineDepthStencilStateCreateInfo depthStencilState{
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
-            .depthTestEnable = VK_TRUE,
-            .depthWriteEnable = VK_TRUE,
-            .depthCompareOp = VkCompareOp::VK_COMPARE_OP_LESS,
-            .minDepthBounds = 0.0f,
-            .maxDepthBounds = 1.0f,
-        };
-
-        pipelineCreateInfo->pMultisampleState = &multisampling;
-        pipelineCreateInfo->pDepthStencilState = &depthStencilState;
-
-        // set up KHR_dynamic_rendering information
-        const VkPipelineRenderingCreateInfo pipelineRenderingCreateInfo{
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
-            .colorAttachmentCount = gsl::narrow<uint32_t>(info.colorFormats.size()),
-            .pColorAttachmentFormats = info.colorFormats.data(),
-            .depthAttachmentFormat = info.depthFormat,
-            .stencilAttachmentFormat = info.stencilFormat,
-        };
-        pipelineCreateInfo->pNext = &pipelineRenderingCreateInfo;
-
-        return ctx.resources().createPipeline(name, pipelineCreateInfo);
-    }
-    using DescriptorHasher = decltype([](const PipelineDescriptor &d) { return d.hash(); });
-    std::unordered_map<PipelineDescriptor, PipelineHandle, DescriptorHasher> cache_;
-};
-
 TransientRenderPass::TransientRenderPass(Context &ctx,
                                          std::string_view name,
                                          TextureManager &textures)
@@ -141,24 +38,16 @@ TransientRenderPass::~TransientRenderPass()
     }
 }
 
-void TransientRenderPass::begin(CommandList &cmd)
+void TransientRenderPass::createPipeline()
 {
-    hasBegun_ = true;
-    auto getColorFormat = [&](const std::pair<TextureHandle, AttachmentKind> &h) {
+    auto getColorFormat = [&](const std::pair<TransientTextureHandle, AttachmentKind> &h) {
         return toVk(textures_->info(h.first).format);
     };
 
-    // if a render area has not been set up explicitly, we determine it by checking the attachments
-    if (dynamicStates_.renderArea.offset.x == 0 && dynamicStates_.renderArea.offset.y == 0 &&
-        dynamicStates_.renderArea.extent.width == 0 &&
-        dynamicStates_.renderArea.extent.height == 0) {
-
-        dynamicStates_.renderArea = determineRenderArea();
-    }
-
     // determine color formats for all attachments
     PipelineDescriptor descriptor{
         .shaders = shaders_,
+        .specialization = specialization_,
         .sampleCount = determineSampleCount(),
         .colorFormats =
             colorAttachments_ | ranges::views::transform(getColorFormat) | ranges::to<std::vector>,
@@ -166,15 +55,28 @@ void TransientRenderPass::begin(CommandList &cmd)
         .stencilFormat = stencilAttachment_.transform(getColorFormat).value_or(VK_FORMAT_UNDEFINED),
         .hasMeshInput = hasMeshInput_};
 
-    // todo need to move this out of here, statics SUCK
-    static PipelineCache cache;
+    pipeline_ = ctx_->pipelines().request(name_, descriptor);
+}
+
+bool TransientRenderPass::begin(CommandList &cmd)
+{
+    hasBegun_ = true;
+
+    // if a render area has not been set up explicitly, we determine it by checking the attachments
+    if (dynamicStates_.renderArea.offset.x == 0 && dynamicStates_.renderArea.offset.y == 0 &&
+        dynamicStates_.renderArea.extent.width == 0 &&
+        dynamicStates_.renderArea.extent.height == 0) {
 
-    auto pipelineHandle = cache.query(*ctx_, name_, descriptor);
+        dynamicStates_.renderArea = determineRenderArea();
+    }
 
-    auto toAttachment = [&](const std::pair<TextureHandle, AttachmentKind> &p) {
+    auto toAttachment = [&](const std::pair<TransientTextureHandle, AttachmentKind> &p) {
         return makeAttachmentInfo(p.first, p.second);
     };
 
+    const bool skipDraws = !pipeline_.ready() &&
+                           ctx_->pipelines().pendingPolicy() == PendingPipelinePolicy::Skip;
+
     {
         // create the VkRenderingAttachmentInfo structs
         auto colorAttachmentDescs =
@@ -195,10 +97,18 @@ void TransientRenderPass::begin(CommandList &cmd)
             .pDepthAttachment = depthAttachmentDesc ? &depthAttachmentDesc.value() : nullptr,
             .pStencilAttachment = stencilAttachmentDesc ? &stencilAttachmentDesc.value() : nullptr};
 
-        cmd.beginRenderPass(pipelineHandle, &beginRenderingInfo);
+        if (skipDraws) {
+            // still begin rendering, so the attachments are cleared and end() can be called
+            CO_CORE_TRACE("Pipeline for '{}' is not ready yet, skipping its draws", name_);
+            cmd.beginRenderPass(&beginRenderingInfo);
+        }
+        else {
+            cmd.beginRenderPass(pipeline_.get(), &beginRenderingInfo);
+        }
     }
 
     cmd.setupDynamicStates(dynamicStates_);
+    return !skipDraws;
 }
 
 void TransientRenderPass::end(CommandList &cmd)
@@ -207,13 +117,24 @@ void TransientRenderPass::end(CommandList &cmd)
     hasBegun_ = false;
 }
 
-VkRenderingAttachmentInfo TransientRenderPass::makeAttachmentInfo(TextureHandle handle,
+VkRenderingAttachmentInfo TransientRenderPass::makeAttachmentInfo(TransientTextureHandle handle,
                                                                   AttachmentKind attachmentKind)
 {
+    // nothing reads the contents after the pass, no need to write them back to memory
+    if (attachmentKind.inferOps && !textures_->consumed(handle)) {
+        attachmentKind.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    }
+    // a single mip level or array layer is rendered to through a view of its own
+    const SubresourceRange range = attachmentKind.subresource.clamped(textures_->info(handle));
+    const ImageViewHandle view =
+        range.levelCount == 1 && range.layerCount == 1
+            ? textures_->imageView(handle, range.baseMipLevel, range.baseArrayLayer)
+            : textures_->imageView(handle);
     return VkRenderingAttachmentInfo{
         .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
-        .imageView = ctx_->resources()[textures_->imageView(handle)],
-        .imageLayout = Sync::GetVkImageLayout(textures_->state(handle).lastAccess),
+        .imageView = ctx_->resources()[view],
+        .imageLayout = Sync::GetVkImageLayout(
+            textures_->lastAccess(handle, range.baseMipLevel, range.baseArrayLayer)),
         .loadOp = attachmentKind.loadOp,
         .storeOp = attachmentKind.storeOp,
         .clearValue = attachmentKind.clearValue};
@@ -235,7 +156,8 @@ VkRect2D TransientRenderPass::determineRenderArea()
     VkRect2D rect{};
     auto extent = [this](auto pair) {
         const auto s = textures_->info(pair.first).size;
-        return VkExtent2D{s.x, s.y};
+        const uint32_t mipLevel = pair.second.subresource.baseMipLevel;
+        return VkExtent2D{std::max(s.x >> mipLevel, 1U), std::max(s.y >> mipLevel, 1U)};
     };
     if (colorAttachments_.empty()) {
         rect.extent =
@@ -254,8 +176,10 @@ VkRect2D TransientRenderPass::determineRenderArea()
 
 TransientRenderPassBuilder::TransientRenderPassBuilder(Context &ctx,
                                                        std::string_view name,
-                                                       TextureManager &textures)
+                                                       TextureManager &textures,
+                                                       const RenderTaskInfo *task)
     : renderPass_{ctx, name, textures}
+    , task_{task}
 {
 }
 
@@ -267,6 +191,13 @@ TransientRenderPassBuilder &TransientRenderPassBuilder::shaders(std::vector<Shad
     return *this;
 }
 
+TransientRenderPassBuilder &
+TransientRenderPassBuilder::specialize(std::vector<SpecializationConstant> constants)
+{
+    renderPass_.specialization_ = std::move(constants);
+    return *this;
+}
+
 TransientRenderPassBuilder &TransientRenderPassBuilder::attach(TransientTextureHandle handle,
                                                                VkAttachmentLoadOp loadOp,
                                                                VkAttachmentStoreOp storeOp,
@@ -300,12 +231,129 @@ TransientRenderPassBuilder &TransientRenderPassBuilder::attachStencil(TransientT
     return *this;
 }
 
+TransientRenderPassBuilder &
+TransientRenderPassBuilder::attach(TransientTextureHandle handle,
+                                   std::optional<VkClearColorValue> clearValue)
+{
+    renderPass_.colorAttachments_.emplace_back(
+        handle,
+        AttachmentKind{.loadOp = clearValue ? VK_ATTACHMENT_LOAD_OP_CLEAR
+                                            : VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                       .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+                       .clearValue = {.color = clearValue.value_or(VkClearColorValue{})},
+                       .inferOps = true});
+    return *this;
+}
+
+TransientRenderPassBuilder &TransientRenderPassBuilder::attachDepth(TransientTextureHandle handle,
+                                                                    std::optional<float> clearValue)
+{
+    renderPass_.depthAttachment_ = std::make_pair(
+        handle,
+        AttachmentKind{.loadOp = clearValue ? VK_ATTACHMENT_LOAD_OP_CLEAR
+                                            : VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                       .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+                       .clearValue = {.depthStencil = {.depth = clearValue.value_or(1.0f),
+                                                       .stencil = 0}},
+                       .inferOps = true});
+    return *this;
+}
+
+TransientRenderPassBuilder &
+TransientRenderPassBuilder::attachStencil(TransientTextureHandle handle,
+                                          std::optional<uint32_t> clearValue)
+{
+    renderPass_.stencilAttachment_ = std::make_pair(
+        handle,
+        AttachmentKind{.loadOp = clearValue ? VK_ATTACHMENT_LOAD_OP_CLEAR
+                                            : VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                       .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+                       .clearValue = {.depthStencil = {.depth = 1.0f,
+                                                       .stencil = clearValue.value_or(0)}},
+                       .inferOps = true});
+    return *this;
+}
+
 TransientRenderPassBuilder &TransientRenderPassBuilder::disableMeshInput()
 {
     renderPass_.hasMeshInput_ = false;
     return *this;
 }
 
-TransientRenderPass TransientRenderPassBuilder::finish() { return std::move(renderPass_); }
+TransientRenderPass TransientRenderPassBuilder::finish()
+{
+    for (auto &attachment : renderPass_.colorAttachments_) {
+        inferSubresource(attachment);
+        inferLoadOp(attachment);
+    }
+    if (renderPass_.depthAttachment_) {
+        inferSubresource(*renderPass_.depthAttachment_);
+        inferLoadOp(*renderPass_.depthAttachment_);
+    }
+    if (renderPass_.stencilAttachment_) {
+        inferSubresource(*renderPass_.stencilAttachment_);
+        inferLoadOp(*renderPass_.stencilAttachment_);
+    }
+
+    renderPass_.createPipeline();
+    return std::move(renderPass_);
+}
+
+void TransientRenderPassBuilder::inferSubresource(
+    std::pair<TransientTextureHandle, AttachmentKind> &attachment) const
+{
+    if (task_ == nullptr) { return; }
+    auto &[handle, kind] = attachment;
+    const auto dependency = ranges::find_if(task_->dependencies, [&](const auto &dependency) {
+        return dependency.handle.texture() == handle.texture();
+    });
+    if (dependency != task_->dependencies.end()) { kind.subresource = dependency->range; }
+}
+
+void TransientRenderPassBuilder::inferLoadOp(
+    std::pair<TransientTextureHandle, AttachmentKind> &attachment) const
+{
+    auto &[handle, kind] = attachment;
+    if (!kind.inferOps) { return; }
+
+    // keep the contents if we can't tell how the texture is used
+    const auto keepContents = [&kind]() {
+        if (kind.loadOp == VK_ATTACHMENT_LOAD_OP_DONT_CARE) {
+            kind.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        }
+        kind.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        kind.inferOps = false;
+    };
+    if (task_ == nullptr) {
+        keepContents();
+        return;
+    }
+
+    const auto sameTexture = [&](const RenderTaskInfo::Dependency &dependency) {
+        return dependency.handle.texture() == handle.texture();
+    };
+    const auto write = ranges::find_if(task_->dependencies, [&](const auto &dependency) {
+        return sameTexture(dependency) && dependency.kind.is_set(TaskDependencyKindBits::Write);
+    });
+    if (write == task_->dependencies.end()) {
+        const auto read = ranges::find_if(task_->dependencies, sameTexture);
+        if (read == task_->dependencies.end()) {
+            CO_CORE_WARN("Render pass '{}': attachment '{}' is not a dependency of render task "
+                         "'{}', can't infer its load and store ops",
+                         renderPass_.name_,
+                         renderPass_.textures_->info(handle).name,
+                         task_->name);
+        }
+        // read-only attachment
+        keepContents();
+        return;
+    }
+
+    // the version written by the task is the one that later tasks might consume
+    handle = write->handle;
+    if (write->kind.is_set(TaskDependencyKindBits::Read)) {
+        kind.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    }
+}
 
 } // namespace Cory
\ No newline at end of file
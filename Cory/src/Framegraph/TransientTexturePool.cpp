@@ -0,0 +1,445 @@
+#include <Cory/Framegraph/TransientTexturePool.hpp>
+
+#include <Cory/Base/FmtUtils.hpp>
+#include <Cory/Base/Log.hpp>
+#include <Cory/Base/SlotMap.hpp>
+#include <Cory/Renderer/Context.hpp>
+#include <Cory/Renderer/ResourceManager.hpp>
+
+#include <Corrade/Containers/Optional.h>
+#include <Magnum/Vk/Buffer.h>
+#include <Magnum/Vk/BufferCreateInfo.h>
+#include <Magnum/Vk/Device.h>
+#include <Magnum/Vk/DeviceProperties.h>
+#include <Magnum/Vk/Image.h>
+#include <Magnum/Vk/ImageCreateInfo.h>
+#include <Magnum/Vk/ImageView.h>
+#include <Magnum/Vk/ImageViewCreateInfo.h>
+#include <Magnum/Vk/Memory.h>
+#include <Magnum/Vk/MemoryAllocateInfo.h>
+#include <gsl/narrow>
+
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace Vk = Magnum::Vk;
+
+namespace Cory {
+
+namespace {
+Vk::ImageCreateInfo imageCreateInfo(const TransientImageDesc &desc)
+{
+    const auto size =
+        Magnum::Vector2i{gsl::narrow<int32_t>(desc.size.x), gsl::narrow<int32_t>(desc.size.y)};
+    const auto levels = gsl::narrow<int32_t>(desc.mipLevels);
+    static const Magnum::Vk::ImageLayout initialLayout{Magnum::Vk::ImageLayout::Undefined};
+
+    if (desc.arrayLayers > 1) {
+        return Vk::ImageCreateInfo2DArray{Vk::ImageUsages{Vk::ImageUsage(desc.usage)},
+                                          desc.format,
+                                          {size, gsl::narrow<int32_t>(desc.arrayLayers)},
+                                          levels,
+                                          desc.sampleCount,
+                                          initialLayout};
+    }
+    return Vk::ImageCreateInfo2D{Vk::ImageUsages{Vk::ImageUsage(desc.usage)},
+                                 desc.format,
+                                 size,
+                                 levels,
+                                 desc.sampleCount,
+                                 initialLayout};
+}
+} // namespace
+
+struct PooledExternalKey {
+    VkImage image;
+    VkImageView view;
+    PixelFormat format;
+    bool operator==(const PooledExternalKey &) const = default;
+};
+struct PooledExternalKeyHash {
+    std::size_t operator()(const PooledExternalKey &k) const noexcept
+    {
+        return hashCompose(0, k.image, k.view, k.format);
+    }
+};
+struct PooledExternalWrapper {
+    ImageHandle image;
+    ImageViewHandle view;
+    uint64_t lastUsedFrame{};
+};
+
+struct PooledImage {
+    TransientImageDesc desc;
+    uint64_t offset{};
+    ImageHandle image;
+    ImageViewHandle view;
+    /// see TransientTexturePool::subresourceViews()
+    std::vector<ImageViewHandle> subresourceViews;
+    bool inUse{false};
+    uint64_t lastUsedFrame{};
+};
+
+struct PooledBuffer {
+    TransientBufferDesc desc;
+    uint64_t offset{};
+    BufferHandle buffer;
+    bool inUse{false};
+    uint64_t lastUsedFrame{};
+};
+
+struct TransientHeap {
+    uint32_t memoryType{};
+    uint64_t size{};
+    Vk::Memory memory;
+    bool inUse{false};
+    uint64_t lastUsedFrame{};
+    std::vector<PooledImage> images;
+    std::vector<PooledBuffer> buffers;
+};
+
+struct TransientTexturePoolPrivate {
+    Context *ctx{};
+    uint32_t maxUnusedFrames{};
+    uint64_t frame{};
+    SlotMap<TransientHeap> heaps;
+    std::unordered_map<TransientImageDesc, TransientMemoryRequirements> requirements;
+    std::unordered_map<TransientBufferDesc, TransientMemoryRequirements> bufferRequirements;
+    std::unordered_map<PooledExternalKey, PooledExternalWrapper, PooledExternalKeyHash> externals;
+
+    void destroyImage(PooledImage &pooled)
+    {
+        for (const ImageViewHandle view : pooled.subresourceViews) {
+            ctx->resources().release(view);
+        }
+        ctx->resources().release(pooled.view);
+        ctx->resources().release(pooled.image);
+    }
+    void destroyBuffer(PooledBuffer &pooled) { ctx->resources().release(pooled.buffer); }
+    void destroyHeapContents(TransientHeap &heap)
+    {
+        for (PooledImage &pooled : heap.images) {
+            destroyImage(pooled);
+        }
+        for (PooledBuffer &pooled : heap.buffers) {
+            destroyBuffer(pooled);
+        }
+    }
+};
+
+TransientTexturePool::TransientTexturePool(Context &ctx, uint32_t maxUnusedFrames)
+    : data_{std::make_unique<TransientTexturePoolPrivate>()}
+{
+    data_->ctx = &ctx;
+    data_->maxUnusedFrames = maxUnusedFrames;
+}
+
+TransientTexturePool::~TransientTexturePool()
+{
+    // if data_ is empty, object is moved-from
+    if (!data_) { return; }
+
+    for (TransientHeap &heap : data_->heaps) {
+        CO_CORE_ASSERT(!heap.inUse, "Transient heap is still in use while destroying the pool!");
+        data_->destroyHeapContents(heap);
+    }
+    data_->heaps.clear();
+    for (auto &[key, wrapper] : data_->externals) {
+        data_->ctx->resources().release(wrapper.view);
+        data_->ctx->resources().release(wrapper.image);
+    }
+}
+
+TransientTexturePool::TransientTexturePool(TransientTexturePool &&) = default;
+TransientTexturePool &TransientTexturePool::operator=(TransientTexturePool &&) = default;
+
+TransientMemoryRequirements TransientTexturePool::memoryRequirements(const TransientImageDesc &desc)
+{
+    auto it = data_->requirements.find(desc);
+    if (it != data_->requirements.end()) { return it->second; }
+
+    // create a temporary image without memory, just to query its requirements
+    Vk::Image probe{data_->ctx->device(), imageCreateInfo(desc), Magnum::NoAllocate};
+    const Vk::MemoryRequirements requirements = probe.memoryRequirements();
+    // transient attachments go into lazily allocated memory if possible, which tiled GPUs might
+    // never back with physical memory at all
+    auto &physicalDevice = data_->ctx->physicalDevice();
+    Corrade::Containers::Optional<Magnum::UnsignedInt> lazyMemoryType;
+    if (desc.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) {
+        lazyMemoryType = physicalDevice.tryPickMemory(Vk::MemoryFlag::LazilyAllocated,
+                                                      requirements.memories());
+    }
+    // todo eventually want to externalize these memory flags
+    const uint32_t memoryType =
+        lazyMemoryType ? *lazyMemoryType
+                       : physicalDevice.pickMemory(Vk::MemoryFlag::DeviceLocal,
+                                                   requirements.memories());
+
+    const TransientMemoryRequirements result{.size = requirements.size(),
+                                             .alignment = requirements.alignment(),
+                                             .memoryType = memoryType};
+    data_->requirements.emplace(desc, result);
+    return result;
+}
+
+TransientMemoryRequirements
+TransientTexturePool::memoryRequirements(const TransientBufferDesc &desc)
+{
+    auto it = data_->bufferRequirements.find(desc);
+    if (it != data_->bufferRequirements.end()) { return it->second; }
+
+    // create a temporary buffer without memory, just to query its requirements
+    Vk::Buffer probe{data_->ctx->device(),
+                     Vk::BufferCreateInfo{Vk::BufferUsages{Vk::BufferUsage(desc.usage)}, desc.size},
+                     Magnum::NoAllocate};
+    const Vk::MemoryRequirements requirements = probe.memoryRequirements();
+    const uint32_t memoryType = data_->ctx->physicalDevice().pickMemory(
+        Vk::MemoryFlag::DeviceLocal, requirements.memories());
+
+    const TransientMemoryRequirements result{.size = requirements.size(),
+                                             .alignment = requirements.alignment(),
+                                             .memoryType = memoryType};
+    data_->bufferRequirements.emplace(desc, result);
+    return result;
+}
+
+TransientHeapHandle TransientTexturePool::acquireHeap(uint32_t memoryType, uint64_t size)
+{
+    // find the smallest free heap that is big enough
+    SlotMapHandle bestHeap{};
+    uint64_t bestSize{std::numeric_limits<uint64_t>::max()};
+    for (const auto &[handle, heap] : data_->heaps.items()) {
+        if (!heap.inUse && heap.memoryType == memoryType && heap.size >= size &&
+            heap.size < bestSize) {
+            bestHeap = handle;
+            bestSize = heap.size;
+        }
+    }
+
+    if (!bestHeap.valid()) {
+        CO_CORE_DEBUG("Allocating transient heap of {} bytes from memory type {}", size, memoryType);
+        bestHeap = data_->heaps.emplace(TransientHeap{
+            .memoryType = memoryType,
+            .size = size,
+            .memory = Vk::Memory{data_->ctx->device(), Vk::MemoryAllocateInfo{size, memoryType}},
+            .inUse = false,
+            .lastUsedFrame = data_->frame,
+            .images = {},
+            .buffers = {}});
+        nameVulkanObject(data_->ctx->device(),
+                         data_->heaps[bestHeap].memory,
+                         fmt::format("Transient texture heap ({} bytes)", size));
+    }
+
+    TransientHeap &heap = data_->heaps[bestHeap];
+    heap.inUse = true;
+    heap.lastUsedFrame = data_->frame;
+    return bestHeap;
+}
+
+std::pair<ImageHandle, ImageViewHandle>
+TransientTexturePool::acquireImage(TransientHeapHandle heapHandle,
+                                   const TransientImageDesc &desc,
+                                   uint64_t offset,
+                                   std::string_view name)
+{
+    TransientHeap &heap = data_->heaps[heapHandle];
+    CO_CORE_ASSERT(heap.inUse, "Heap needs to be acquired before acquiring images from it!");
+
+    for (PooledImage &pooled : heap.images) {
+        if (!pooled.inUse && pooled.offset == offset && pooled.desc == desc) {
+            pooled.inUse = true;
+            pooled.lastUsedFrame = data_->frame;
+            return {pooled.image, pooled.view};
+        }
+    }
+
+    CO_CORE_DEBUG("Creating transient image '{}' of {} ({}) at offset {}",
+                  name,
+                  desc.size,
+                  desc.format,
+                  offset);
+    auto &resources = data_->ctx->resources();
+    const ImageHandle image = resources.createImage(
+        fmt::format("{} (IMG)", name), imageCreateInfo(desc), Magnum::NoAllocate);
+    resources[image].bindMemory(heap.memory, offset);
+
+    const ImageViewHandle view =
+        desc.arrayLayers > 1
+            ? resources.createImageView(fmt::format("{} (VIEW)", name),
+                                        Vk::ImageViewCreateInfo2DArray{resources[image]})
+            : resources.createImageView(fmt::format("{} (VIEW)", name),
+                                        Vk::ImageViewCreateInfo2D{resources[image]});
+
+    // render tasks can render to (or read from) individual mip levels and array layers
+    std::vector<ImageViewHandle> subresourceViews;
+    if (desc.mipLevels * desc.arrayLayers > 1) {
+        subresourceViews.reserve(desc.mipLevels * desc.arrayLayers);
+        for (uint32_t level = 0; level < desc.mipLevels; ++level) {
+            for (uint32_t layer = 0; layer < desc.arrayLayers; ++layer) {
+                subresourceViews.push_back(resources.createImageView(
+                    fmt::format("{} (VIEW mip {} layer {})", name, level, layer),
+                    Vk::ImageViewCreateInfo2D{resources[image], layer, level, 1}));
+            }
+        }
+    }
+
+    heap.images.push_back(PooledImage{.desc = desc,
+                                      .offset = offset,
+                                      .image = image,
+                                      .view = view,
+                                      .subresourceViews = std::move(subresourceViews),
+                                      .inUse = true,
+                                      .lastUsedFrame = data_->frame});
+    return {image, view};
+}
+
+std::span<const ImageViewHandle>
+TransientTexturePool::subresourceViews(TransientHeapHandle heapHandle, ImageHandle image) const
+{
+    const TransientHeap &heap = data_->heaps[heapHandle];
+    const auto it = std::find_if(heap.images.begin(), heap.images.end(), [&](const auto &pooled) {
+        return pooled.image == image;
+    });
+    CO_CORE_ASSERT(it != heap.images.end(), "Image was not acquired from this heap!");
+    return it->subresourceViews;
+}
+
+BufferHandle TransientTexturePool::acquireBuffer(TransientHeapHandle heapHandle,
+                                                const TransientBufferDesc &desc,
+                                                uint64_t offset,
+                                                std::string_view name)
+{
+    TransientHeap &heap = data_->heaps[heapHandle];
+    CO_CORE_ASSERT(heap.inUse, "Heap needs to be acquired before acquiring buffers from it!");
+
+    for (PooledBuffer &pooled : heap.buffers) {
+        if (!pooled.inUse && pooled.offset == offset && pooled.desc == desc) {
+            pooled.inUse = true;
+            pooled.lastUsedFrame = data_->frame;
+            return pooled.buffer;
+        }
+    }
+
+    CO_CORE_DEBUG(
+        "Creating transient buffer '{}' of {} bytes at offset {}", name, desc.size, offset);
+    auto &resources = data_->ctx->resources();
+    const BufferHandle buffer = resources.createBuffer(fmt::format("{} (BUF)", name),
+                                                       desc.size,
+                                                       BufferUsage{desc.usage},
+                                                       Magnum::NoAllocate);
+    resources[buffer].bindMemory(heap.memory, offset);
+
+    heap.buffers.push_back(PooledBuffer{.desc = desc,
+                                        .offset = offset,
+                                        .buffer = buffer,
+                                        .inUse = true,
+                                        .lastUsedFrame = data_->frame});
+    return buffer;
+}
+
+void TransientTexturePool::releaseHeap(TransientHeapHandle heapHandle)
+{
+    TransientHeap &heap = data_->heaps[heapHandle];
+    heap.inUse = false;
+    for (PooledImage &pooled : heap.images) {
+        pooled.inUse = false;
+    }
+    for (PooledBuffer &pooled : heap.buffers) {
+        pooled.inUse = false;
+    }
+}
+
+std::pair<ImageHandle, ImageViewHandle> TransientTexturePool::wrapExternal(
+    std::string_view name, Magnum::Vk::Image &image, Magnum::Vk::ImageView &imageView)
+{
+    const PooledExternalKey key{
+        .image = image.handle(), .view = imageView.handle(), .format = image.format()};
+    auto it = data_->externals.find(key);
+    if (it == data_->externals.end()) {
+        auto &resources = data_->ctx->resources();
+        it = data_->externals
+                 .emplace(key,
+                          PooledExternalWrapper{.image = resources.wrapImage(name, image),
+                                          .view = resources.wrapImageView(name, imageView),
+                                          .lastUsedFrame = data_->frame})
+                 .first;
+    }
+    it->second.lastUsedFrame = data_->frame;
+    return {it->second.image, it->second.view};
+}
+
+void TransientTexturePool::collectGarbage()
+{
+    ++data_->frame;
+    const auto isStale = [&](uint64_t lastUsedFrame) {
+        return lastUsedFrame + data_->maxUnusedFrames < data_->frame;
+    };
+
+    std::vector<SlotMapHandle> staleHeaps;
+    for (auto [handle, heap] : data_->heaps.items()) {
+        // heaps that are in use might still be accessed by the GPU, so don't touch them
+        if (heap.inUse) { continue; }
+        if (isStale(heap.lastUsedFrame)) {
+            staleHeaps.push_back(handle);
+            continue;
+        }
+        std::erase_if(heap.images, [&](PooledImage &pooled) {
+            if (!isStale(pooled.lastUsedFrame)) { return false; }
+            data_->destroyImage(pooled);
+            return true;
+        });
+        std::erase_if(heap.buffers, [&](PooledBuffer &pooled) {
+            if (!isStale(pooled.lastUsedFrame)) { return false; }
+            data_->destroyBuffer(pooled);
+            return true;
+        });
+    }
+    for (const SlotMapHandle handle : staleHeaps) {
+        TransientHeap &heap = data_->heaps[handle];
+        CO_CORE_DEBUG("Releasing unused transient heap of {} bytes", heap.size);
+        data_->destroyHeapContents(heap);
+        data_->heaps.release(handle);
+    }
+
+    std::erase_if(data_->externals, [&](auto &entry) {
+        auto &[key, wrapper] = entry;
+        if (!isStale(wrapper.lastUsedFrame)) { return false; }
+        data_->ctx->resources().release(wrapper.view);
+        data_->ctx->resources().release(wrapper.image);
+        return true;
+    });
+}
+
+size_t TransientTexturePool::heapCount() const { return data_->heaps.size(); }
+
+size_t TransientTexturePool::imageCount() const
+{
+    size_t count{};
+    for (const TransientHeap &heap : data_->heaps) {
+        count += heap.images.size();
+    }
+    return count;
+}
+
+size_t TransientTexturePool::bufferCount() const
+{
+    size_t count{};
+    for (const TransientHeap &heap : data_->heaps) {
+        count += heap.buffers.size();
+    }
+    return count;
+}
+
+uint64_t TransientTexturePool::memoryUsage() const
+{
+    uint64_t total{};
+    for (const TransientHeap &heap : data_->heaps) {
+        total += heap.size;
+    }
+    return total;
+}
+
+} // namespace Cory
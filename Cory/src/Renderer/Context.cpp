@@ -3,6 +3,10 @@
 #include <Cory/Base/FmtUtils.hpp>
 #include <Cory/Base/Log.hpp>
 #include <Cory/Renderer/DescriptorSets.hpp>
+#include <Cory/Renderer/MemoryAllocator.hpp>
+#include <Cory/Renderer/MemoryDefragmenter.hpp>
+#include <Cory/Renderer/PipelineCache.hpp>
+#include <Cory/Renderer/ShaderReloader.hpp>
 #include <Cory/Renderer/ResourceManager.hpp>
 #include <Cory/Renderer/VulkanUtils.hpp>
 
@@ -28,6 +32,10 @@
 #include <Magnum/Vk/Version.h>
 #include <Magnum/Vk/VertexFormat.h>
 
+#include <cppcoro/static_thread_pool.hpp>
+
+#include <optional>
+
 namespace Vk = Magnum::Vk;
 
 namespace Cory {
@@ -44,10 +52,20 @@ struct ContextPrivate {
     uint32_t graphicsQueueFamily{};
     Vk::Queue computeQueue{Corrade::NoCreate};
     uint32_t computeQueueFamily{};
+    bool hasAsyncCompute{false};
+    bool hasGraphicsPipelineLibrary{false};
 
     Vk::CommandPool commandPool{Corrade::NoCreate};
 
+    // declared before the resources so it outlives the buffers and images allocated from it
+    MemoryAllocator allocator;
     ResourceManager resources;
+    // declared after the resources so the pipelines are released before the resource manager
+    PipelineCache pipelines;
+    ShaderReloader shaderReloader;
+    MemoryDefragmenter defragmenter;
+
+    cppcoro::static_thread_pool workerPool;
 
     Callback<const DebugMessageInfo &> onVulkanDebugMessageReceived;
 
@@ -65,6 +83,8 @@ struct ContextPrivate {
 };
 
 namespace detail {
+bool supportsGraphicsPipelineLibrary(ContextPrivate &data,
+                                     const Vk::ExtensionProperties &extensions);
 PNextChain<> setupRequiredDeviceFeatures(Vk::DeviceCreateInfo &info, ContextPrivate &data);
 Magnum::Vk::PipelineLayout
 createDefaultPipelineLayout(Context &ctx, Vk::DescriptorSetLayout &descriptorSetLayout);
@@ -107,12 +127,46 @@ Context::Context(ContextCreationInfo creationInfo)
                                VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME,
                                "VK_KHR_fragment_shading_rate",
                                "VK_KHR_dynamic_rendering"});
+    // graphics pipeline libraries are optional, they speed up the creation of pipelines
+    // that share some of their state with previously created ones
+    data_->hasGraphicsPipelineLibrary = detail::supportsGraphicsPipelineLibrary(*data_, extensions);
+    if (data_->hasGraphicsPipelineLibrary) {
+        info.addEnabledExtensions({VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME,
+                                   VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME});
+        CO_APP_INFO("Using graphics pipeline libraries");
+    }
 
     // configure a Graphics and a Compute queue - assumes that there is a family that
     // supports both graphics and compute, which is probably not universal
     data_->graphicsQueueFamily = data_->physicalDevice.pickQueueFamily(
         Vk::QueueFlags::Type::Graphics | Vk::QueueFlags::Type::Compute);
-    info.addQueues(data_->graphicsQueueFamily, {1.0f}, {data_->graphicsQueue});
+    // for async compute, prefer a dedicated compute family (which usually maps to separate
+    // hardware queues), and fall back to a second queue of the graphics family
+    std::optional<uint32_t> asyncComputeFamily;
+    for (uint32_t family = 0; family < data_->physicalDevice.queueFamilyCount(); ++family) {
+        const Vk::QueueFlags flags = data_->physicalDevice.queueFamilyFlags(family);
+        if ((flags & Vk::QueueFlags::Type::Compute) && !(flags & Vk::QueueFlags::Type::Graphics)) {
+            asyncComputeFamily = family;
+            break;
+        }
+    }
+    if (asyncComputeFamily) {
+        data_->computeQueueFamily = *asyncComputeFamily;
+        info.addQueues(data_->graphicsQueueFamily, {1.0f}, {data_->graphicsQueue});
+        info.addQueues(data_->computeQueueFamily, {0.5f}, {data_->computeQueue});
+        data_->hasAsyncCompute = true;
+    }
+    else if (data_->physicalDevice.queueFamilySize(data_->graphicsQueueFamily) > 1) {
+        data_->computeQueueFamily = data_->graphicsQueueFamily;
+        info.addQueues(data_->graphicsQueueFamily,
+                       {1.0f, 0.5f},
+                       {data_->graphicsQueue, data_->computeQueue});
+        data_->hasAsyncCompute = true;
+    }
+    else {
+        data_->computeQueueFamily = data_->graphicsQueueFamily;
+        info.addQueues(data_->graphicsQueueFamily, {1.0f}, {data_->graphicsQueue});
+    }
 
     // set up the required features
     auto pnext_chain = detail::setupRequiredDeviceFeatures(info, *data_);
@@ -127,15 +181,24 @@ Context::Context(ContextCreationInfo creationInfo)
     // set a debug name for the logical device and queues
     nameVulkanObject(data_->device, data_->device, fmt::format("DEV_{}", data_->name));
     nameVulkanObject(data_->device, data_->graphicsQueue, fmt::format("QUE_Gfx_{}", data_->name));
-    // nameVulkanObject(data_->device, data_->computeQueue, fmt::format("QUE_Comp_{}",
-    // data_->name));
+    if (data_->hasAsyncCompute) {
+        nameVulkanObject(
+            data_->device, data_->computeQueue, fmt::format("QUE_Comp_{}", data_->name));
+        CO_APP_INFO("Using queue family {} for async compute", data_->computeQueueFamily);
+    }
+    else {
+        // no separate queue available - compute work goes to the graphics queue
+        data_->computeQueue = Vk::Queue::wrap(data_->device, data_->graphicsQueue.handle());
+        CO_APP_INFO("No separate compute queue available, async compute is disabled");
+    }
 
     setupDebugMessenger();
 
     data_->commandPool =
         Vk::CommandPool{data_->device, Vk::CommandPoolCreateInfo{data_->graphicsQueueFamily}};
 
-    // delayed-init of the resource manager
+    // delayed-init of the allocator and the resource manager
+    data_->allocator.init(*this);
     resources().setContext(*this);
 
     // TODO descriptorsetmanager should move to more frontend-facing object like swapchain, window,
@@ -170,6 +233,10 @@ Context::Context(ContextCreationInfo creationInfo)
     data_->defaultPipelineLayout = detail::createDefaultPipelineLayout(
         *this, resources()[data_->descriptorSetManager.layout()]);
     data_->defaultSampler = resources().createSampler("SMPL_Default", Vk::SamplerCreateInfo{});
+
+    data_->pipelines.init(*this, std::move(creationInfo.pipelineCacheFile));
+    data_->shaderReloader.init(*this);
+    data_->defragmenter.init(*this);
 }
 
 Context::Context(Context &&rhs) { std::swap(rhs.data_, data_); }
@@ -182,6 +249,9 @@ Context &Context::operator=(Context &&rhs)
 Context::~Context()
 {
     if (data_) {
+        // pipelines that are still compiling use the layouts, which are destroyed before the
+        // pipeline cache
+        data_->pipelines.wait();
         data_->resources.release(data_->defaultSampler);
         CO_CORE_TRACE("Destroying Cory::Context {}", data_->name);
     }
@@ -231,6 +301,21 @@ Semaphore Context::createSemaphore(std::string_view name)
                      }};
 }
 
+GpuEvent Context::createEvent(std::string_view name)
+{
+    VkEventCreateInfo create_info{.sType = VK_STRUCTURE_TYPE_EVENT_CREATE_INFO, .flags = 0};
+
+    VkEvent event;
+    THROW_ON_ERROR(device()->CreateEvent(data_->device, &create_info, nullptr, &event),
+                   "failed to create an event object");
+
+    if (!name.empty()) { nameRawVulkanObject(data_->device, event, name); }
+
+    return GpuEvent{event, [&device = data_->device](VkEvent e) {
+                        device->DestroyEvent(device, e, nullptr);
+                    }};
+}
+
 Vk::Fence Context::createFence(std::string_view name, Cory::FenceCreateMode mode)
 {
     Vk::Fence fence{Corrade::NoCreate};
@@ -253,8 +338,15 @@ Magnum::Vk::Queue &Context::graphicsQueue() { return data_->graphicsQueue; }
 uint32_t Context::graphicsQueueFamily() const { return data_->graphicsQueueFamily; }
 Magnum::Vk::Queue &Context::computeQueue() { return data_->computeQueue; }
 uint32_t Context::computeQueueFamily() const { return data_->computeQueueFamily; }
+bool Context::hasAsyncCompute() const { return data_->hasAsyncCompute; }
+bool Context::hasGraphicsPipelineLibrary() const { return data_->hasGraphicsPipelineLibrary; }
+cppcoro::static_thread_pool &Context::workerPool() { return data_->workerPool; }
+MemoryAllocator &Context::allocator() { return data_->allocator; }
 ResourceManager &Context::resources() { return data_->resources; }
 const ResourceManager &Context::resources() const { return data_->resources; }
+PipelineCache &Context::pipelines() { return data_->pipelines; }
+ShaderReloader &Context::shaderReloader() { return data_->shaderReloader; }
+MemoryDefragmenter &Context::defragmenter() { return data_->defragmenter; }
 
 void Context::onVulkanDebugMessageReceived(std::function<void(const DebugMessageInfo &)> callback)
 {
@@ -300,6 +392,29 @@ void ContextPrivate::receiveDebugUtilsMessage(
 
 namespace detail {
 
+bool supportsGraphicsPipelineLibrary(ContextPrivate &data,
+                                     const Vk::ExtensionProperties &extensions)
+{
+    if (!extensions.isSupported(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) ||
+        !extensions.isSupported(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME)) {
+        return false;
+    }
+    // the instance is created for Vulkan 1.0, so the core entry point may not be available
+    auto getFeatures2 = data.instance->GetPhysicalDeviceFeatures2;
+    if (getFeatures2 == nullptr) {
+        getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>(
+            vkGetInstanceProcAddr(data.instance, "vkGetPhysicalDeviceFeatures2KHR"));
+    }
+    if (getFeatures2 == nullptr) { return false; }
+
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT libraryFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT};
+    VkPhysicalDeviceFeatures2 features{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                                       .pNext = &libraryFeatures};
+    getFeatures2(data.physicalDevice, &features);
+    return libraryFeatures.graphicsPipelineLibrary == VK_TRUE;
+}
+
 PNextChain<> setupRequiredDeviceFeatures(Vk::DeviceCreateInfo &info, ContextPrivate &data)
 {
     PNextChain chain;
@@ -336,6 +451,12 @@ PNextChain<> setupRequiredDeviceFeatures(Vk::DeviceCreateInfo &info, ContextPriv
         .descriptorBindingPartiallyBound = VK_TRUE,
         .runtimeDescriptorArray = VK_TRUE});
 
+    if (data.hasGraphicsPipelineLibrary) {
+        chain.prepend(VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT,
+            .graphicsPipelineLibrary = VK_TRUE});
+    }
+
     return chain;
 }
 
@@ -0,0 +1,335 @@
+#include <Cory/Renderer/MemoryAllocator.hpp>
+
+#include <Cory/Base/Log.hpp>
+#include <Cory/Renderer/Context.hpp>
+#include <Cory/Renderer/VulkanUtils.hpp>
+
+#include <Magnum/Vk/Buffer.h>
+#include <Magnum/Vk/Device.h>
+#include <Magnum/Vk/DeviceProperties.h>
+#include <Magnum/Vk/Image.h>
+#include <Magnum/Vk/Instance.h>
+#include <Magnum/Vk/Memory.h>
+
+#include <vk_mem_alloc.h>
+
+#include <magic_enum.hpp>
+
+#include <array>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+
+namespace Cory {
+
+namespace Vk = Magnum::Vk;
+
+namespace {
+/// the usage classes that allocations are pooled by
+enum class MemoryUsage { Device, Upload, Readback };
+/// buffers and linear images are kept apart from optimal images, so the pools can ignore the
+/// bufferImageGranularity
+enum class ResourceKind { Linear, Optimal };
+
+constexpr VkMemoryPropertyFlags HOST_FLAGS = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                             VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
+                                             VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+
+MemoryUsage usageClass(VkMemoryPropertyFlags requiredFlags)
+{
+    if (requiredFlags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) { return MemoryUsage::Readback; }
+    if (requiredFlags & HOST_FLAGS) { return MemoryUsage::Upload; }
+    return MemoryUsage::Device;
+}
+
+VmaMemoryUsage toVma(MemoryUsage usage)
+{
+    switch (usage) {
+    case MemoryUsage::Device:
+        return VMA_MEMORY_USAGE_GPU_ONLY;
+    case MemoryUsage::Upload:
+        return VMA_MEMORY_USAGE_CPU_TO_GPU;
+    case MemoryUsage::Readback:
+        return VMA_MEMORY_USAGE_GPU_TO_CPU;
+    }
+    return VMA_MEMORY_USAGE_UNKNOWN;
+}
+} // namespace
+
+struct MemoryAllocatorPrivate {
+    Context *ctx{};
+    VmaAllocator allocator{};
+
+    using PoolKey = std::tuple<MemoryUsage, ResourceKind, uint32_t>;
+    mutable std::mutex poolMutex;
+    std::map<PoolKey, VmaPool> pools;
+
+    /// the pool for allocations of @a kind with @a usage in @a memoryType, created on first use
+    VmaPool pool(MemoryUsage usage, ResourceKind kind, uint32_t memoryType);
+    MemoryAllocation allocate(const VkMemoryRequirements &requirements,
+                              ResourceKind kind,
+                              VkMemoryPropertyFlags requiredFlags);
+};
+
+MemoryAllocation::MemoryAllocation(VmaAllocator_T *allocator,
+                                   VmaAllocation_T *allocation,
+                                   VmaPool_T *pool)
+    : allocator_{allocator}
+    , allocation_{allocation}
+    , pool_{pool}
+{
+}
+
+MemoryAllocation::~MemoryAllocation()
+{
+    if (allocation_ != nullptr) { vmaFreeMemory(allocator_, allocation_); }
+}
+
+MemoryAllocation::MemoryAllocation(MemoryAllocation &&rhs) noexcept
+    : allocator_{std::exchange(rhs.allocator_, nullptr)}
+    , allocation_{std::exchange(rhs.allocation_, nullptr)}
+    , pool_{std::exchange(rhs.pool_, nullptr)}
+{
+}
+
+MemoryAllocation &MemoryAllocation::operator=(MemoryAllocation &&rhs) noexcept
+{
+    std::swap(allocator_, rhs.allocator_);
+    std::swap(allocation_, rhs.allocation_);
+    std::swap(pool_, rhs.pool_);
+    return *this;
+}
+
+AllocationInfo MemoryAllocation::info() const
+{
+    if (allocation_ == nullptr) { return {}; }
+    VmaAllocationInfo info;
+    vmaGetAllocationInfo(allocator_, allocation_, &info);
+    return AllocationInfo{.memory = info.deviceMemory,
+                          .offset = info.offset,
+                          .size = info.size,
+                          .memoryType = info.memoryType,
+                          .mappedData = static_cast<std::byte *>(info.pMappedData)};
+}
+
+void MemoryAllocation::flush(VkDeviceSize offset, VkDeviceSize size)
+{
+    CO_CORE_ASSERT(allocation_ != nullptr, "Flushing an empty allocation");
+    // VMA skips the flush for coherent memory and aligns the range to nonCoherentAtomSize
+    THROW_ON_ERROR(vmaFlushAllocation(allocator_, allocation_, offset, size),
+                   "Could not flush the allocation");
+}
+
+MemoryAllocator::MemoryAllocator()
+    : data_{std::make_unique<MemoryAllocatorPrivate>()}
+{
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+    if (!data_ || data_->allocator == nullptr) { return; }
+    for (auto &[key, pool] : data_->pools) {
+        vmaDestroyPool(data_->allocator, pool);
+    }
+    vmaDestroyAllocator(data_->allocator);
+}
+
+void MemoryAllocator::init(Context &ctx)
+{
+    CO_CORE_ASSERT(data_->ctx == nullptr, "MemoryAllocator already initialized!");
+    data_->ctx = &ctx;
+
+    // use the function pointers Magnum loaded for the device instead of the loader trampolines
+    Vk::Instance &instance = ctx.instance();
+    Vk::Device &device = ctx.device();
+    const VmaVulkanFunctions functions{
+        .vkGetPhysicalDeviceProperties = instance->GetPhysicalDeviceProperties,
+        .vkGetPhysicalDeviceMemoryProperties = instance->GetPhysicalDeviceMemoryProperties,
+        .vkAllocateMemory = device->AllocateMemory,
+        .vkFreeMemory = device->FreeMemory,
+        .vkMapMemory = device->MapMemory,
+        .vkUnmapMemory = device->UnmapMemory,
+        .vkFlushMappedMemoryRanges = device->FlushMappedMemoryRanges,
+        .vkInvalidateMappedMemoryRanges = device->InvalidateMappedMemoryRanges,
+        .vkBindBufferMemory = device->BindBufferMemory,
+        .vkBindImageMemory = device->BindImageMemory,
+        .vkGetBufferMemoryRequirements = device->GetBufferMemoryRequirements,
+        .vkGetImageMemoryRequirements = device->GetImageMemoryRequirements,
+        .vkCreateBuffer = device->CreateBuffer,
+        .vkDestroyBuffer = device->DestroyBuffer,
+        .vkCreateImage = device->CreateImage,
+        .vkDestroyImage = device->DestroyImage,
+        .vkCmdCopyBuffer = device->CmdCopyBuffer,
+    };
+    // the instance is created for Vulkan 1.0
+    const VmaAllocatorCreateInfo createInfo{
+        .physicalDevice = ctx.physicalDevice().handle(),
+        .device = device.handle(),
+        .pVulkanFunctions = &functions,
+        .instance = instance.handle(),
+        .vulkanApiVersion = VK_API_VERSION_1_0,
+    };
+    THROW_ON_ERROR(vmaCreateAllocator(&createInfo, &data_->allocator),
+                   "Could not create the memory allocator");
+}
+
+MemoryAllocation MemoryAllocator::allocate(Vk::Buffer &buffer, VkMemoryPropertyFlags requiredFlags)
+{
+    CO_CORE_ASSERT(data_->allocator != nullptr, "MemoryAllocator was not initialized!");
+    const Vk::MemoryRequirements requirements = buffer.memoryRequirements();
+    MemoryAllocation allocation =
+        data_->allocate(requirements->memoryRequirements, ResourceKind::Linear, requiredFlags);
+    THROW_ON_ERROR(vmaBindBufferMemory(data_->allocator, allocation.handle(), buffer),
+                   "Could not bind the buffer memory");
+    return allocation;
+}
+
+MemoryAllocation MemoryAllocator::allocate(Vk::Image &image,
+                                           VkImageTiling tiling,
+                                           VkMemoryPropertyFlags requiredFlags)
+{
+    CO_CORE_ASSERT(data_->allocator != nullptr, "MemoryAllocator was not initialized!");
+    const Vk::MemoryRequirements requirements = image.memoryRequirements();
+    const ResourceKind kind =
+        tiling == VK_IMAGE_TILING_OPTIMAL ? ResourceKind::Optimal : ResourceKind::Linear;
+    MemoryAllocation allocation =
+        data_->allocate(requirements->memoryRequirements, kind, requiredFlags);
+    THROW_ON_ERROR(vmaBindImageMemory(data_->allocator, allocation.handle(), image),
+                   "Could not bind the image memory");
+    return allocation;
+}
+
+MemoryAllocation MemoryAllocator::reallocate(const MemoryAllocation &allocation,
+                                             const VkMemoryRequirements &requirements)
+{
+    CO_CORE_ASSERT(data_->allocator != nullptr, "MemoryAllocator was not initialized!");
+    if (allocation.pool_ == nullptr) { return {}; }
+    const AllocationInfo info = allocation.info();
+    VkMemoryPropertyFlags memoryFlags;
+    vmaGetMemoryTypeProperties(data_->allocator, info.memoryType, &memoryFlags);
+    if (memoryFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) { return {}; }
+
+    // best fit tries the fullest blocks first
+    const VmaAllocationCreateInfo createInfo{
+        .flags = VMA_ALLOCATION_CREATE_NEVER_ALLOCATE_BIT |
+                 VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT,
+        .pool = allocation.pool_,
+    };
+    VmaAllocation moved;
+    if (vmaAllocateMemory(data_->allocator, &requirements, &createInfo, &moved, nullptr) !=
+        VK_SUCCESS) {
+        return {};
+    }
+    MemoryAllocation result{data_->allocator, moved, allocation.pool_};
+    // moving within the same block does not free anything
+    if (result.info().memory == info.memory) { return {}; }
+    return result;
+}
+
+void MemoryAllocator::bind(const MemoryAllocation &allocation, Vk::Buffer &buffer)
+{
+    CO_CORE_ASSERT(allocation.valid(), "Binding an empty allocation");
+    THROW_ON_ERROR(vmaBindBufferMemory(data_->allocator, allocation.handle(), buffer),
+                   "Could not bind the buffer memory");
+}
+
+void MemoryAllocator::bind(const MemoryAllocation &allocation, Vk::Image &image)
+{
+    CO_CORE_ASSERT(allocation.valid(), "Binding an empty allocation");
+    THROW_ON_ERROR(vmaBindImageMemory(data_->allocator, allocation.handle(), image),
+                   "Could not bind the image memory");
+}
+
+MemoryAllocation MemoryAllocatorPrivate::allocate(const VkMemoryRequirements &requirements,
+                                                  ResourceKind kind,
+                                                  VkMemoryPropertyFlags requiredFlags)
+{
+    const MemoryUsage usage = usageClass(requiredFlags);
+    VmaAllocationCreateInfo createInfo{
+        .usage = toVma(usage),
+        .requiredFlags = requiredFlags,
+    };
+    if (requiredFlags & HOST_FLAGS) { createInfo.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT; }
+
+    // large resources would waste most of a pool block, lazily allocated memory can not be
+    // sub-allocated at all
+    if (requirements.size >= MemoryAllocator::DEDICATED_ALLOCATION_THRESHOLD ||
+        (requiredFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+        createInfo.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    }
+    else {
+        uint32_t memoryType;
+        THROW_ON_ERROR(vmaFindMemoryTypeIndex(
+                           allocator, requirements.memoryTypeBits, &createInfo, &memoryType),
+                       "No memory type matches the requirements of the resource");
+        createInfo.pool = pool(usage, kind, memoryType);
+    }
+
+    VmaAllocation allocation;
+    THROW_ON_ERROR(vmaAllocateMemory(allocator, &requirements, &createInfo, &allocation, nullptr),
+                   "Could not allocate device memory");
+    return MemoryAllocation{allocator, allocation, createInfo.pool};
+}
+
+VmaPool MemoryAllocatorPrivate::pool(MemoryUsage usage, ResourceKind kind, uint32_t memoryType)
+{
+    const std::lock_guard lock{poolMutex};
+    const PoolKey key{usage, kind, memoryType};
+    if (auto it = pools.find(key); it != pools.end()) { return it->second; }
+
+    // block sizes are chosen by VMA based on the size of the heap
+    const VmaPoolCreateInfo createInfo{
+        .memoryTypeIndex = memoryType,
+        .flags = VMA_POOL_CREATE_IGNORE_BUFFER_IMAGE_GRANULARITY_BIT,
+    };
+    VmaPool pool;
+    THROW_ON_ERROR(vmaCreatePool(allocator, &createInfo, &pool), "Could not create memory pool");
+    const std::string name = fmt::format(
+        "{}/{}/Type {}", magic_enum::enum_name(usage), magic_enum::enum_name(kind), memoryType);
+    vmaSetPoolName(allocator, pool, name.c_str());
+    CO_CORE_DEBUG("Created memory pool {}", name);
+
+    pools.emplace(key, pool);
+    return pool;
+}
+
+std::vector<MemoryHeapStats> MemoryAllocator::heapStats() const
+{
+    CO_CORE_ASSERT(data_->allocator != nullptr, "MemoryAllocator was not initialized!");
+    const VkPhysicalDeviceMemoryProperties *properties;
+    vmaGetMemoryProperties(data_->allocator, &properties);
+    VmaStats stats;
+    vmaCalculateStats(data_->allocator, &stats);
+    std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets;
+    vmaGetBudget(data_->allocator, budgets.data());
+
+    std::vector<MemoryHeapStats> heaps;
+    heaps.reserve(properties->memoryHeapCount);
+    for (uint32_t i = 0; i < properties->memoryHeapCount; ++i) {
+        const VkMemoryHeap &heap = properties->memoryHeaps[i];
+        const VmaStatInfo &info = stats.memoryHeap[i];
+        heaps.push_back(MemoryHeapStats{
+            .size = heap.size,
+            .deviceLocal = (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0,
+            .blockCount = info.blockCount,
+            .allocationCount = info.allocationCount,
+            .blockBytes = budgets[i].blockBytes,
+            .allocationBytes = budgets[i].allocationBytes,
+            .usage = budgets[i].usage,
+            .budget = budgets[i].budget,
+        });
+    }
+    return heaps;
+}
+
+size_t MemoryAllocator::poolCount() const
+{
+    const std::lock_guard lock{data_->poolMutex};
+    return data_->pools.size();
+}
+
+VmaAllocator_T *MemoryAllocator::handle() const { return data_->allocator; }
+
+} // namespace Cory
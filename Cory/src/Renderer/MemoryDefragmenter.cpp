@@ -0,0 +1,105 @@
+#include <Cory/Renderer/MemoryDefragmenter.hpp>
+
+#include <Cory/Base/Log.hpp>
+#include <Cory/Base/Profiling.hpp>
+#include <Cory/Renderer/Context.hpp>
+#include <Cory/Renderer/ResourceManager.hpp>
+
+#include <Magnum/Vk/CommandBuffer.h>
+#include <Magnum/Vk/CommandPool.h>
+#include <Magnum/Vk/CommandPoolCreateInfo.h>
+#include <Magnum/Vk/Fence.h>
+#include <Magnum/Vk/Queue.h>
+
+namespace Cory {
+
+namespace Vk = Magnum::Vk;
+
+struct MemoryDefragmenterPrivate {
+    Context *ctx{};
+    bool enabled{false};
+    DefragmentationBudget budget{};
+    DefragmentationStats stats{};
+
+    Vk::CommandPool commandPool{Corrade::NoCreate};
+    Vk::CommandBuffer commandBuffer{Corrade::NoCreate};
+    Vk::Fence fence{Corrade::NoCreate};
+    /// whether the copies of the current pass were submitted and have not been waited for
+    bool submitted{false};
+
+    /// release the resources replaced by the current pass
+    void release();
+};
+
+MemoryDefragmenter::MemoryDefragmenter()
+    : data_{std::make_unique<MemoryDefragmenterPrivate>()}
+{
+}
+
+MemoryDefragmenter::~MemoryDefragmenter()
+{
+    if (data_ && data_->submitted) { wait(); }
+}
+
+void MemoryDefragmenter::init(Context &ctx)
+{
+    CO_CORE_ASSERT(data_->ctx == nullptr, "MemoryDefragmenter already initialized!");
+    data_->ctx = &ctx;
+    data_->commandPool = Vk::CommandPool{
+        ctx.device(),
+        Vk::CommandPoolCreateInfo{ctx.graphicsQueueFamily(),
+                                  Vk::CommandPoolCreateInfo::Flag::Transient}};
+    data_->fence = ctx.createFence("Defragmentation");
+}
+
+bool MemoryDefragmenter::enabled() const { return data_->enabled; }
+void MemoryDefragmenter::setEnabled(bool enabled) { data_->enabled = enabled; }
+
+DefragmentationBudget MemoryDefragmenter::budget() const { return data_->budget; }
+void MemoryDefragmenter::setBudget(DefragmentationBudget budget) { data_->budget = budget; }
+
+void MemoryDefragmenter::nextFrame()
+{
+    CO_CORE_ASSERT(data_->ctx != nullptr, "MemoryDefragmenter was not initialized!");
+    if (data_->submitted) {
+        if (!data_->fence.status()) { return; }
+        data_->release();
+    }
+    if (!data_->enabled) { return; }
+
+    const Cory::ScopeTimer s{"MemoryDefragmenter/Pass"};
+    data_->commandBuffer = data_->commandPool.allocate();
+    data_->commandBuffer.begin();
+    const DefragmentationStats pass =
+        data_->ctx->resources().defragment(data_->commandBuffer, data_->budget);
+    data_->commandBuffer.end();
+    if (pass.moves == 0) {
+        data_->commandPool.reset();
+        return;
+    }
+
+    data_->ctx->graphicsQueue().submit(
+        {Vk::SubmitInfo{}.setCommandBuffers({data_->commandBuffer})}, data_->fence);
+    data_->submitted = true;
+    data_->stats.moves += pass.moves;
+    data_->stats.bytesMoved += pass.bytesMoved;
+}
+
+void MemoryDefragmenter::wait()
+{
+    if (!data_->submitted) { return; }
+    data_->fence.wait();
+    data_->release();
+}
+
+DefragmentationStats MemoryDefragmenter::stats() const { return data_->stats; }
+
+void MemoryDefragmenterPrivate::release()
+{
+    ctx->resources().releaseRelocated();
+    fence.reset();
+    commandPool.reset();
+    submitted = false;
+}
+
+} // namespace Cory
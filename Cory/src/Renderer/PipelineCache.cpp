@@ -0,0 +1,882 @@
+#include <Cory/Renderer/PipelineCache.hpp>
+
+#include <Cory/Base/DetachedTask.hpp>
+#include <Cory/Base/Log.hpp>
+#include <Cory/Base/Math.hpp>
+#include <Cory/Base/Profiling.hpp>
+#include <Cory/Base/Utils.hpp>
+#include <Cory/Renderer/Context.hpp>
+#include <Cory/Renderer/ResourceManager.hpp>
+#include <Cory/Renderer/Shader.hpp>
+#include <Cory/Renderer/VulkanUtils.hpp>
+
+#include <Magnum/Vk/Device.h>
+#include <Magnum/Vk/DeviceProperties.h>
+#include <Magnum/Vk/Pipeline.h>
+#include <Magnum/Vk/PipelineLayout.h>
+#include <Magnum/Vk/RasterizationPipelineCreateInfo.h>
+#include <Magnum/Vk/Shader.h>
+#include <Magnum/Vk/ShaderSet.h>
+
+#include <cppcoro/static_thread_pool.hpp>
+#include <gsl/narrow>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+namespace Vk = Magnum::Vk;
+
+namespace Cory {
+
+std::size_t PipelineDescriptor::hash() const
+{
+    std::size_t hash = hashCompose(
+        0, shaders, sampleCount, colorFormats, depthFormat, stencilFormat, hasMeshInput);
+    for (const auto &constant : specialization) {
+        hash = hashCompose(hash, constant.id, constant.value);
+    }
+    return hash;
+}
+
+namespace {
+/// precedes the driver's cache data in the cache file. the driver data starts with a
+/// VkPipelineCacheHeaderVersionOne, but that does not include the driver version
+struct CacheFileHeader {
+    static constexpr uint32_t MAGIC{0x43505943}; // "CYPC"
+    static constexpr uint32_t VERSION{1};
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    uint64_t dataSize;
+    uint64_t dataHash;
+};
+
+uint64_t hashData(const char *data, size_t size)
+{
+    return std::hash<std::string_view>{}(std::string_view{data, size});
+}
+
+CacheFileHeader makeHeader(const VkPhysicalDeviceProperties &props)
+{
+    CacheFileHeader header{.magic = CacheFileHeader::MAGIC,
+                           .version = CacheFileHeader::VERSION,
+                           .vendorID = props.vendorID,
+                           .deviceID = props.deviceID,
+                           .driverVersion = props.driverVersion};
+    std::memcpy(header.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE);
+    return header;
+}
+
+/// checks the cache file contents against the device - returns the driver data if it is valid
+std::string_view validateCacheFile(const std::vector<char> &contents,
+                                   const VkPhysicalDeviceProperties &props)
+{
+    CacheFileHeader header;
+    if (contents.size() < sizeof(header)) { return {}; }
+    std::memcpy(&header, contents.data(), sizeof(header));
+
+    const CacheFileHeader expected = makeHeader(props);
+    if (header.magic != expected.magic || header.version != expected.version) {
+        CO_CORE_WARN("Pipeline cache file has an unknown format");
+        return {};
+    }
+    if (header.vendorID != expected.vendorID || header.deviceID != expected.deviceID ||
+        header.driverVersion != expected.driverVersion ||
+        std::memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        CO_CORE_INFO("Pipeline cache file was written by a different device or driver version");
+        return {};
+    }
+
+    const std::string_view data{contents.data() + sizeof(header),
+                                contents.size() - sizeof(header)};
+    if (header.dataSize != data.size() || header.dataHash != hashData(data.data(), data.size())) {
+        CO_CORE_WARN("Pipeline cache file is corrupted");
+        return {};
+    }
+
+    // the driver validates this as well, but some drivers are known to not be very robust
+    VkPipelineCacheHeaderVersionOne driverHeader;
+    if (data.size() < sizeof(driverHeader)) { return {}; }
+    std::memcpy(&driverHeader, data.data(), sizeof(driverHeader));
+    if (driverHeader.headerSize < sizeof(driverHeader) ||
+        driverHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+        driverHeader.vendorID != props.vendorID || driverHeader.deviceID != props.deviceID ||
+        std::memcmp(driverHeader.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        CO_CORE_WARN("Pipeline cache file contains invalid driver data");
+        return {};
+    }
+
+    return data;
+}
+
+/// the parts a pipeline is split into when graphics pipeline libraries are used
+enum class LibraryPart { VertexInput, PreRasterization, FragmentShader, FragmentOutput };
+constexpr size_t LIBRARY_PART_COUNT{4};
+
+constexpr VkGraphicsPipelineLibraryFlagsEXT libraryFlags(LibraryPart part)
+{
+    switch (part) {
+    case LibraryPart::VertexInput:
+        return VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT;
+    case LibraryPart::PreRasterization:
+        return VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT;
+    case LibraryPart::FragmentShader:
+        return VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT;
+    case LibraryPart::FragmentOutput:
+        return VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+    }
+    return 0;
+}
+
+constexpr std::string_view libraryPartName(LibraryPart part)
+{
+    switch (part) {
+    case LibraryPart::VertexInput:
+        return "VertexInput";
+    case LibraryPart::PreRasterization:
+        return "PreRasterization";
+    case LibraryPart::FragmentShader:
+        return "FragmentShader";
+    case LibraryPart::FragmentOutput:
+        return "FragmentOutput";
+    }
+    return "Unknown";
+}
+
+/// identifies a pipeline library - the descriptor only contains the fields relevant to the part
+struct LibraryKey {
+    LibraryPart part;
+    PipelineDescriptor descriptor;
+    // a reloaded shader keeps its handle, so the modules tell the versions of a shader apart
+    std::vector<VkShaderModule> modules;
+    bool operator==(const LibraryKey &rhs) const = default;
+};
+struct LibraryKeyHasher {
+    std::size_t operator()(const LibraryKey &key) const
+    {
+        return hashCompose(key.descriptor.hash(), key.part, key.modules);
+    }
+};
+
+/// a pipeline library, compiled by the first pipeline build that needs it
+struct PipelineLibrary {
+    Vk::Pipeline pipeline{Magnum::NoCreate};
+    std::atomic<bool> done{false};
+    std::exception_ptr error;
+};
+
+/// the pipeline libraries shared between all pipelines of a cache - accessed from worker threads
+struct PipelineLibraries {
+    std::mutex mutex;
+    std::unordered_map<LibraryKey, std::shared_ptr<PipelineLibrary>, LibraryKeyHasher> libraries;
+    // incremented when the libraries of reloaded shaders are dropped - builds that started
+    // before must not add libraries of the old shaders again
+    uint64_t generation{};
+};
+
+} // namespace
+
+/// everything needed to create a pipeline on a worker thread
+struct PipelineBuild {
+    PipelineBuild(Context &ctx,
+                  std::string_view pipelineName,
+                  const PipelineDescriptor &info,
+                  VkPipelineCache pipelineCache,
+                  Vk::Pipeline &storage,
+                  std::shared_ptr<PipelineLibraries> pipelineLibraries);
+
+    /// create the pipeline into target - called on a worker thread
+    void run() noexcept;
+
+    /// create the pipeline from its libraries, creating the libraries that do not exist yet
+    VkPipeline link();
+    /// create the library for @a part, or wait for it if another build is already creating it.
+    /// the library might be dropped from the cache at any time, so the caller has to keep it
+    std::shared_ptr<PipelineLibrary> acquireLibrary(LibraryPart part);
+    void createLibrary(LibraryPart part, PipelineLibrary &library) const;
+
+    std::string name;
+    Vk::Device *device;
+    VkPipelineCache cache;
+    // the storage of the pipeline in the ResourceManager - SlotMap elements do not move in memory
+    Vk::Pipeline *target;
+
+    // copies keep the shader modules alive even if a shader is replaced while compiling
+    std::vector<Shader> shaders;
+    Vk::ShaderSet shaderSet;
+    std::vector<VkFormat> colorFormats;
+    Vk::RasterizationPipelineCreateInfo createInfo;
+    VkPipelineViewportStateCreateInfo viewportState;
+    VkPipelineMultisampleStateCreateInfo multisampling;
+    VkPipelineDepthStencilStateCreateInfo depthStencilState;
+    VkPipelineRenderingCreateInfo renderingCreateInfo;
+
+    // only set if graphics pipeline libraries are used
+    std::shared_ptr<PipelineLibraries> libraries;
+    std::array<LibraryKey, LIBRARY_PART_COUNT> libraryKeys;
+    uint64_t libraryGeneration{};
+    VkPipelineLayout layout;
+
+    std::atomic<bool> done{false};
+    std::exception_ptr error;
+};
+
+namespace {
+std::vector<Shader> copyShaders(ResourceManager &resources,
+                                const std::vector<ShaderHandle> &handles)
+{
+    std::vector<Shader> shaders;
+    shaders.reserve(handles.size());
+    for (auto shaderHandle : handles) {
+        shaders.push_back(resources[shaderHandle]);
+    }
+    return shaders;
+}
+
+Vk::ShaderSet makeShaderSet(std::vector<Shader> &shaders,
+                            const std::vector<SpecializationConstant> &specialization)
+{
+    // the shader set copies the specialization data
+    std::vector<Vk::ShaderSpecialization> specializations;
+    specializations.reserve(specialization.size());
+    for (const auto &constant : specialization) {
+        specializations.emplace_back(constant.id, constant.value);
+    }
+
+    Vk::ShaderSet shaderSet{};
+    for (auto &shader : shaders) {
+        shaderSet.addShader(static_cast<Vk::ShaderStage>(shader.type()),
+                            shader.module(),
+                            "main",
+                            {specializations.data(), specializations.size()});
+    }
+    return shaderSet;
+}
+
+DetachedTask compileOnWorker(cppcoro::static_thread_pool &pool,
+                             std::shared_ptr<PipelineBuild> build)
+{
+    co_await pool.schedule();
+    build->run();
+}
+} // namespace
+
+struct PipelineCachePrivate {
+    using DescriptorHasher = decltype([](const PipelineDescriptor &d) { return d.hash(); });
+    struct Entry {
+        std::string name;
+        PipelineDescriptor descriptor;
+        PipelineFuture pipeline;
+        uint64_t lastUsed;
+        // rebuilt pipeline after a shader was reloaded, replaces pipeline once it is ready
+        PipelineFuture replacement{};
+    };
+    Context *ctx{};
+    // kept separately so the destructor does not depend on the state of the context
+    Vk::Device *device{};
+    ResourceManager *resources{};
+    VkPhysicalDeviceProperties deviceProperties{};
+    std::filesystem::path cacheFile;
+    BasicVkObjectWrapper<VkPipelineCache> cache;
+    bool loadedFromFile{false};
+    // set when pipelines were created since the cache data was loaded
+    bool dirty{false};
+
+    // most recently used first
+    std::list<Entry> entries;
+    std::unordered_map<PipelineDescriptor, std::list<Entry>::iterator, DescriptorHasher> lookup;
+    size_t capacity{PipelineCache::DEFAULT_CAPACITY};
+    uint64_t frame{};
+    PendingPipelinePolicy pendingPolicy{PendingPipelinePolicy::Block};
+
+    // pipelines are compiled on a pool of their own so they never hold up command recording
+    std::unique_ptr<cppcoro::static_thread_pool> compilePool;
+    // null if pipelines are created monolithically
+    std::shared_ptr<PipelineLibraries> libraries;
+    // replaced pipelines that are still compiling, released once they are done
+    std::vector<PipelineFuture> retired;
+
+    PipelineFuture startBuild(std::string_view name, const PipelineDescriptor &descriptor);
+    void retire(PipelineFuture pipeline);
+    void evict(std::list<Entry>::iterator it);
+};
+
+PipelineCache::PipelineCache()
+    : data_{std::make_unique<PipelineCachePrivate>()}
+{
+}
+
+PipelineCache::~PipelineCache()
+{
+    // if data_ is empty, object is moved-from
+    if (data_ && data_->ctx) {
+        wait();
+        try {
+            if (data_->dirty) { save(); }
+        }
+        catch (const std::exception &e) {
+            CO_CORE_ERROR("Could not save the pipeline cache: {}", e.what());
+        }
+        clear();
+    }
+}
+
+void PipelineCache::init(Context &ctx, std::filesystem::path cacheFile)
+{
+    CO_CORE_ASSERT(data_->ctx == nullptr, "PipelineCache already initialized!");
+    data_->ctx = &ctx;
+    data_->device = &ctx.device();
+    data_->resources = &ctx.resources();
+    data_->deviceProperties = ctx.physicalDevice().properties().properties;
+    data_->cacheFile = std::move(cacheFile);
+    data_->compilePool = std::make_unique<cppcoro::static_thread_pool>(
+        std::max(1U, std::thread::hardware_concurrency() / 2));
+    if (ctx.hasGraphicsPipelineLibrary()) {
+        data_->libraries = std::make_shared<PipelineLibraries>();
+    }
+
+    std::vector<char> contents;
+    std::string_view initialData;
+    if (!data_->cacheFile.empty() && std::filesystem::exists(data_->cacheFile)) {
+        contents = readFile(data_->cacheFile);
+        initialData = validateCacheFile(contents, data_->deviceProperties);
+    }
+
+    const VkPipelineCacheCreateInfo createInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = initialData.size(),
+        .pInitialData = initialData.data(),
+    };
+    VkPipelineCache cache;
+    THROW_ON_ERROR(ctx.device()->CreatePipelineCache(ctx.device(), &createInfo, nullptr, &cache),
+                   "failed to create a pipeline cache");
+    nameRawVulkanObject(ctx.device(), cache, fmt::format("PLC_{}", ctx.name()));
+    data_->cache.wrap(cache, [&device = ctx.device()](VkPipelineCache c) {
+        device->DestroyPipelineCache(device, c, nullptr);
+    });
+
+    data_->loadedFromFile = !initialData.empty();
+    if (data_->loadedFromFile) {
+        CO_CORE_INFO("Loaded pipeline cache data ({}) from {}",
+                     formatBytes(initialData.size()),
+                     data_->cacheFile.string());
+    }
+}
+
+bool PipelineFuture::ready() const
+{
+    return build_ == nullptr || build_->done.load(std::memory_order_acquire);
+}
+
+PipelineHandle PipelineFuture::get() const
+{
+    if (build_ == nullptr) { return handle_; }
+    if (!ready()) {
+        const Cory::ScopeTimer s{"PipelineCache/Wait"};
+        build_->done.wait(false, std::memory_order_acquire);
+    }
+    if (build_->error) { std::rethrow_exception(build_->error); }
+    return handle_;
+}
+
+PipelineFuture PipelineCache::request(std::string_view name, const PipelineDescriptor &descriptor)
+{
+    CO_CORE_ASSERT(data_->ctx != nullptr, "PipelineCache was not initialized!");
+    if (auto it = data_->lookup.find(descriptor); it != data_->lookup.end()) {
+        auto entry = it->second;
+        entry->lastUsed = data_->frame;
+        data_->entries.splice(data_->entries.begin(), data_->entries, entry);
+        return entry->pipeline;
+    }
+
+    CO_CORE_INFO("Creating new pipeline for '{}' ({:X})", name, descriptor.hash());
+    PipelineFuture pipeline = data_->startBuild(name, descriptor);
+    data_->entries.push_front({std::string{name}, descriptor, pipeline, data_->frame});
+    data_->lookup.emplace(descriptor, data_->entries.begin());
+    return pipeline;
+}
+
+void PipelineCache::reload(std::span<const ShaderHandle> shaders)
+{
+    CO_CORE_ASSERT(data_->ctx != nullptr, "PipelineCache was not initialized!");
+    const auto usesReloadedShader = [&](const PipelineDescriptor &descriptor) {
+        return std::ranges::any_of(descriptor.shaders, [&](ShaderHandle s) {
+            return std::ranges::find(shaders, s) != shaders.end();
+        });
+    };
+
+    // drop the libraries of the old shaders before the rebuilds start, otherwise the rebuilds
+    // would be linked from them again
+    if (data_->libraries != nullptr) {
+        const std::scoped_lock lock{data_->libraries->mutex};
+        ++data_->libraries->generation;
+        std::erase_if(data_->libraries->libraries, [&](const auto &library) {
+            return usesReloadedShader(library.first.descriptor);
+        });
+    }
+
+    for (auto &entry : data_->entries) {
+        if (!usesReloadedShader(entry.descriptor)) { continue; }
+
+        CO_CORE_INFO("Rebuilding pipeline '{}' ({:X})", entry.name, entry.descriptor.hash());
+        // a rebuild that is still running uses the old shaders
+        if (entry.replacement.handle_) { data_->retire(std::move(entry.replacement)); }
+        entry.replacement = data_->startBuild(entry.name, entry.descriptor);
+    }
+}
+
+PipelineHandle PipelineCache::query(std::string_view name, const PipelineDescriptor &descriptor)
+{
+    return request(name, descriptor).get();
+}
+
+void PipelineCache::wait()
+{
+    auto waitFor = [](const PipelineFuture &pipeline) {
+        if (pipeline.build_ != nullptr) {
+            pipeline.build_->done.wait(false, std::memory_order_acquire);
+        }
+    };
+    for (const auto &entry : data_->entries) {
+        waitFor(entry.pipeline);
+        waitFor(entry.replacement);
+    }
+    for (const auto &retired : data_->retired) {
+        waitFor(retired);
+    }
+}
+
+void PipelineCache::nextFrame()
+{
+    ++data_->frame;
+    for (auto &entry : data_->entries) {
+        // swap in rebuilt pipelines - if the rebuild failed, the old pipeline is kept
+        if (entry.replacement.handle_ && entry.replacement.ready()) {
+            if (entry.replacement.build_->error) {
+                CO_CORE_ERROR("Could not rebuild pipeline '{}', keeping the old one", entry.name);
+                data_->resources->release(entry.replacement.handle_);
+            }
+            else {
+                data_->retire(std::exchange(entry.pipeline, std::move(entry.replacement)));
+            }
+            entry.replacement = {};
+        }
+        // the build information is not needed anymore once a pipeline is compiled
+        if (entry.pipeline.build_ != nullptr && entry.pipeline.ready() &&
+            !entry.pipeline.build_->error) {
+            entry.pipeline.build_.reset();
+        }
+    }
+    std::erase_if(data_->retired, [this](const PipelineFuture &retired) {
+        if (!retired.ready()) { return false; }
+        data_->resources->release(retired.handle_);
+        return true;
+    });
+    // the ResourceManager keeps released pipelines alive until the frames in flight are done.
+    // pipelines of the last frame are kept even beyond the capacity, they are likely needed again
+    while (data_->entries.size() > data_->capacity &&
+           data_->entries.back().lastUsed + 1 < data_->frame &&
+           data_->entries.back().pipeline.ready() && data_->entries.back().replacement.ready()) {
+        data_->evict(std::prev(data_->entries.end()));
+    }
+}
+
+void PipelineCache::clear()
+{
+    wait();
+    while (!data_->entries.empty()) {
+        data_->evict(data_->entries.begin());
+    }
+    for (const auto &retired : data_->retired) {
+        data_->resources->release(retired.handle_);
+    }
+    data_->retired.clear();
+    if (data_->libraries != nullptr) {
+        const std::scoped_lock lock{data_->libraries->mutex};
+        data_->libraries->libraries.clear();
+    }
+}
+
+bool PipelineCache::save()
+{
+    CO_CORE_ASSERT(data_->ctx != nullptr, "PipelineCache was not initialized!");
+    if (data_->cacheFile.empty()) { return false; }
+
+    auto &device = *data_->device;
+    size_t dataSize{};
+    THROW_ON_ERROR(device->GetPipelineCacheData(device, data_->cache, &dataSize, nullptr),
+                   "failed to query the pipeline cache data size");
+    std::vector<char> data(dataSize);
+    THROW_ON_ERROR(device->GetPipelineCacheData(device, data_->cache, &dataSize, data.data()),
+                   "failed to get the pipeline cache data");
+    data.resize(dataSize);
+
+    CacheFileHeader header = makeHeader(data_->deviceProperties);
+    header.dataSize = data.size();
+    header.dataHash = hashData(data.data(), data.size());
+
+    // write to a temporary file first, so a crash while writing does not leave a broken cache
+    std::filesystem::path tempFile{data_->cacheFile};
+    tempFile += ".tmp";
+    {
+        std::ofstream file(tempFile, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(data.data(), gsl::narrow<std::streamsize>(data.size()));
+        if (!file) {
+            CO_CORE_WARN("Could not write pipeline cache file {}", tempFile.string());
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tempFile, data_->cacheFile, ec);
+    if (ec) {
+        CO_CORE_WARN("Could not write pipeline cache file {}: {}",
+                     data_->cacheFile.string(),
+                     ec.message());
+        return false;
+    }
+
+    CO_CORE_DEBUG(
+        "Saved pipeline cache data ({}) to {}", formatBytes(dataSize), data_->cacheFile.string());
+    data_->dirty = false;
+    return true;
+}
+
+bool PipelineCache::loadedFromFile() const { return data_->loadedFromFile; }
+size_t PipelineCache::size() const { return data_->entries.size(); }
+size_t PipelineCache::capacity() const { return data_->capacity; }
+void PipelineCache::setCapacity(size_t capacity) { data_->capacity = capacity; }
+bool PipelineCache::usesLibraries() const { return data_->libraries != nullptr; }
+void PipelineCache::setUseLibraries(bool useLibraries)
+{
+    CO_CORE_ASSERT(!useLibraries || data_->ctx->hasGraphicsPipelineLibrary(),
+                   "Graphics pipeline libraries are not supported by the device");
+    if (useLibraries == usesLibraries()) { return; }
+    // pipelines that are still compiling keep their own reference to the libraries
+    data_->libraries = useLibraries ? std::make_shared<PipelineLibraries>() : nullptr;
+}
+size_t PipelineCache::libraryCount() const
+{
+    if (data_->libraries == nullptr) { return 0; }
+    const std::scoped_lock lock{data_->libraries->mutex};
+    return data_->libraries->libraries.size();
+}
+PendingPipelinePolicy PipelineCache::pendingPolicy() const { return data_->pendingPolicy; }
+void PipelineCache::setPendingPolicy(PendingPipelinePolicy policy)
+{
+    data_->pendingPolicy = policy;
+}
+VkPipelineCache PipelineCache::handle() const { return data_->cache; }
+
+PipelineFuture PipelineCachePrivate::startBuild(std::string_view name,
+                                               const PipelineDescriptor &descriptor)
+{
+    PipelineFuture pipeline;
+    pipeline.handle_ = resources->createPipeline(name, Magnum::NoCreate);
+    pipeline.build_ = std::make_shared<PipelineBuild>(
+        *ctx, name, descriptor, cache, (*resources)[pipeline.handle_], libraries);
+    compileOnWorker(*compilePool, pipeline.build_);
+    dirty = true;
+    return pipeline;
+}
+
+void PipelineCachePrivate::retire(PipelineFuture pipeline)
+{
+    // a pipeline that is still compiling must not be released before the build has written it
+    if (pipeline.ready()) { resources->release(pipeline.handle_); }
+    else {
+        retired.push_back(std::move(pipeline));
+    }
+}
+
+void PipelineCachePrivate::evict(std::list<Entry>::iterator it)
+{
+    CO_CORE_DEBUG("Evicting pipeline {:X} from the cache", it->descriptor.hash());
+    resources->release(it->pipeline.handle_);
+    if (it->replacement.handle_) { resources->release(it->replacement.handle_); }
+    lookup.erase(it->descriptor);
+    entries.erase(it);
+}
+
+PipelineBuild::PipelineBuild(Context &ctx,
+                             std::string_view pipelineName,
+                             const PipelineDescriptor &info,
+                             VkPipelineCache pipelineCache,
+                             Vk::Pipeline &storage,
+                             std::shared_ptr<PipelineLibraries> pipelineLibraries)
+    : name{pipelineName}
+    , device{&ctx.device()}
+    , cache{pipelineCache}
+    , target{&storage}
+    , shaders{copyShaders(ctx.resources(), info.shaders)}
+    , shaderSet{makeShaderSet(shaders, info.specialization)}
+    , colorFormats{info.colorFormats}
+    , createInfo{shaderSet,
+                 ctx.defaultMeshLayout(!info.hasMeshInput),
+                 ctx.defaultPipelineLayout(),
+                 VK_NULL_HANDLE,
+                 0,
+                 1}
+    , libraries{std::move(pipelineLibraries)}
+    , layout{ctx.defaultPipelineLayout()}
+{
+    // configure dynamic states
+    createInfo.setDynamicStates(Vk::DynamicRasterizationState::Viewport |
+                                Vk::DynamicRasterizationState::Scissor |
+                                Vk::DynamicRasterizationState::CullMode |
+                                Vk::DynamicRasterizationState::DepthTestEnable |
+                                Vk::DynamicRasterizationState::DepthWriteEnable |
+                                Vk::DynamicRasterizationState::DepthCompareOperation);
+
+    viewportState = VkPipelineViewportStateCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1,
+    };
+    createInfo->pViewportState = &viewportState;
+
+    // multisampling setup
+    multisampling = VkPipelineMultisampleStateCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = (VkSampleCountFlagBits)info.sampleCount,
+        .sampleShadingEnable = VK_TRUE,
+    };
+
+    // note: depth setup is ignored and actually overridden the dynamic states, only stencil and
+    // depth bounds are relevant here
+    depthStencilState = VkPipelineDepthStencilStateCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = VK_TRUE,
+        .depthWriteEnable = VK_TRUE,
+        .depthCompareOp = VkCompareOp::VK_COMPARE_OP_LESS,
+        .minDepthBounds = 0.0f,
+        .maxDepthBounds = 1.0f,
+    };
+
+    createInfo->pMultisampleState = &multisampling;
+    createInfo->pDepthStencilState = &depthStencilState;
+
+    // set up KHR_dynamic_rendering information
+    renderingCreateInfo = VkPipelineRenderingCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+        .colorAttachmentCount = gsl::narrow<uint32_t>(colorFormats.size()),
+        .pColorAttachmentFormats = colorFormats.data(),
+        .depthAttachmentFormat = info.depthFormat,
+        .stencilAttachmentFormat = info.stencilFormat,
+    };
+    createInfo->pNext = &renderingCreateInfo;
+
+    // each library is keyed only on the parts of the descriptor that affect it, so pipelines
+    // that differ in e.g. their attachment formats share their shader libraries
+    if (libraries != nullptr) {
+        std::vector<ShaderHandle> preRasterizationShaders;
+        std::vector<ShaderHandle> fragmentShaders;
+        std::vector<VkShaderModule> preRasterizationModules;
+        std::vector<VkShaderModule> fragmentModules;
+        for (size_t i = 0; i < shaders.size(); ++i) {
+            const bool fragment = shaders[i].type() == ShaderType::eFragment;
+            (fragment ? fragmentShaders : preRasterizationShaders).push_back(info.shaders[i]);
+            (fragment ? fragmentModules : preRasterizationModules)
+                .push_back(shaders[i].module().handle());
+        }
+        const PipelineDescriptor empty{.sampleCount = 0,
+                                       .depthFormat = VK_FORMAT_UNDEFINED,
+                                       .stencilFormat = VK_FORMAT_UNDEFINED,
+                                       .hasMeshInput = false};
+        PipelineDescriptor vertexInput{empty};
+        vertexInput.hasMeshInput = info.hasMeshInput;
+        PipelineDescriptor preRasterization{empty};
+        preRasterization.shaders = std::move(preRasterizationShaders);
+        preRasterization.specialization = info.specialization;
+        PipelineDescriptor fragmentShader{empty};
+        fragmentShader.shaders = std::move(fragmentShaders);
+        fragmentShader.specialization = info.specialization;
+        fragmentShader.sampleCount = info.sampleCount;
+        PipelineDescriptor fragmentOutput{info};
+        fragmentOutput.shaders.clear();
+        fragmentOutput.specialization.clear();
+        fragmentOutput.hasMeshInput = false;
+
+        libraryKeys = {LibraryKey{LibraryPart::VertexInput, std::move(vertexInput)},
+                       LibraryKey{LibraryPart::PreRasterization,
+                                  std::move(preRasterization),
+                                  std::move(preRasterizationModules)},
+                       LibraryKey{LibraryPart::FragmentShader,
+                                  std::move(fragmentShader),
+                                  std::move(fragmentModules)},
+                       LibraryKey{LibraryPart::FragmentOutput, std::move(fragmentOutput)}};
+
+        const std::scoped_lock lock{libraries->mutex};
+        libraryGeneration = libraries->generation;
+    }
+}
+
+void PipelineBuild::run() noexcept
+{
+    try {
+        const Cory::ScopeTimer s{"PipelineCache/Compile"};
+        // the pipeline cache is internally synchronized, so pipelines can be created concurrently
+        VkPipeline pipeline;
+        if (libraries != nullptr) { pipeline = link(); }
+        else {
+            THROW_ON_ERROR((*device)->CreateGraphicsPipelines(
+                               *device, cache, 1, createInfo, nullptr, &pipeline),
+                           "failed to create a graphics pipeline");
+        }
+        *target = Vk::Pipeline::wrap(*device,
+                                     Vk::PipelineBindPoint::Rasterization,
+                                     pipeline,
+                                     Vk::HandleFlag::DestroyOnDestruction);
+        nameVulkanObject(*device, *target, name);
+    }
+    catch (...) {
+        error = std::current_exception();
+        CO_CORE_ERROR("Could not create pipeline '{}'", name);
+    }
+    done.store(true, std::memory_order_release);
+    done.notify_all();
+}
+
+VkPipeline PipelineBuild::link()
+{
+    // keeps the libraries alive until they are linked, even if a reload drops them meanwhile
+    std::array<std::shared_ptr<PipelineLibrary>, LIBRARY_PART_COUNT> libraryRefs;
+    std::array<VkPipeline, LIBRARY_PART_COUNT> parts;
+    for (size_t i = 0; i < LIBRARY_PART_COUNT; ++i) {
+        libraryRefs[i] = acquireLibrary(libraryKeys[i].part);
+        parts[i] = libraryRefs[i]->pipeline;
+    }
+
+    // no link time optimization - linking only combines the already compiled libraries
+    const VkPipelineLibraryCreateInfoKHR libraryInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR,
+        .libraryCount = gsl::narrow<uint32_t>(parts.size()),
+        .pLibraries = parts.data(),
+    };
+    const VkGraphicsPipelineCreateInfo linkInfo{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = &libraryInfo,
+        .layout = layout,
+    };
+    VkPipeline pipeline;
+    THROW_ON_ERROR(
+        (*device)->CreateGraphicsPipelines(*device, cache, 1, &linkInfo, nullptr, &pipeline),
+        "failed to link a graphics pipeline");
+    return pipeline;
+}
+
+std::shared_ptr<PipelineLibrary> PipelineBuild::acquireLibrary(LibraryPart part)
+{
+    const auto &key = libraryKeys[static_cast<size_t>(part)];
+    std::shared_ptr<PipelineLibrary> library;
+    bool create{false};
+    {
+        const std::scoped_lock lock{libraries->mutex};
+        if (auto it = libraries->libraries.find(key); it != libraries->libraries.end()) {
+            library = it->second;
+        }
+        else {
+            library = std::make_shared<PipelineLibrary>();
+            create = true;
+            // a build that started before a shader reload keeps its library to itself
+            if (libraryGeneration == libraries->generation) {
+                libraries->libraries.emplace(key, library);
+            }
+        }
+    }
+
+    if (create) {
+        try {
+            createLibrary(part, *library);
+        }
+        catch (...) {
+            library->error = std::current_exception();
+        }
+        library->done.store(true, std::memory_order_release);
+        library->done.notify_all();
+    }
+    else {
+        library->done.wait(false, std::memory_order_acquire);
+    }
+
+    if (library->error) { std::rethrow_exception(library->error); }
+    return library;
+}
+
+void PipelineBuild::createLibrary(LibraryPart part, PipelineLibrary &library) const
+{
+    const Cory::ScopeTimer s{"PipelineCache/CompileLibrary"};
+
+    // start from the monolithic create info and remove everything that is not part of the library
+    const VkGraphicsPipelineCreateInfo &full = *createInfo;
+    const VkGraphicsPipelineLibraryCreateInfoEXT partInfo{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT,
+        .pNext = part == LibraryPart::FragmentOutput ? &renderingCreateInfo : nullptr,
+        .flags = libraryFlags(part),
+    };
+    VkGraphicsPipelineCreateInfo info{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = &partInfo,
+        .flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR,
+        .pDynamicState = full.pDynamicState,
+    };
+
+    std::vector<VkPipelineShaderStageCreateInfo> stages;
+    const auto addStages = [&](bool fragment) {
+        for (uint32_t i = 0; i < full.stageCount; ++i) {
+            if ((full.pStages[i].stage == VK_SHADER_STAGE_FRAGMENT_BIT) == fragment) {
+                stages.push_back(full.pStages[i]);
+            }
+        }
+        info.stageCount = gsl::narrow<uint32_t>(stages.size());
+        info.pStages = stages.data();
+    };
+
+    switch (part) {
+    case LibraryPart::VertexInput:
+        info.pVertexInputState = full.pVertexInputState;
+        info.pInputAssemblyState = full.pInputAssemblyState;
+        break;
+    case LibraryPart::PreRasterization:
+        addStages(false);
+        info.pViewportState = full.pViewportState;
+        info.pRasterizationState = full.pRasterizationState;
+        info.layout = layout;
+        break;
+    case LibraryPart::FragmentShader:
+        addStages(true);
+        info.pMultisampleState = full.pMultisampleState;
+        info.pDepthStencilState = full.pDepthStencilState;
+        info.layout = layout;
+        break;
+    case LibraryPart::FragmentOutput:
+        info.pMultisampleState = full.pMultisampleState;
+        info.pColorBlendState = full.pColorBlendState;
+        break;
+    }
+
+    VkPipeline pipeline;
+    THROW_ON_ERROR(
+        (*device)->CreateGraphicsPipelines(*device, cache, 1, &info, nullptr, &pipeline),
+        "failed to create a graphics pipeline library");
+    library.pipeline = Vk::Pipeline::wrap(*device,
+                                          Vk::PipelineBindPoint::Rasterization,
+                                          pipeline,
+                                          Vk::HandleFlag::DestroyOnDestruction);
+    nameVulkanObject(
+        *device, library.pipeline, fmt::format("{} [{}]", name, libraryPartName(part)));
+}
+
+} // namespace Cory
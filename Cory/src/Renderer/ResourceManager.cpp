@@ -1,20 +1,37 @@
 #include <Cory/Renderer/ResourceManager.hpp>
 
 #include <Cory/Base/Log.hpp>
+#include <Cory/Base/Profiling.hpp>
 #include <Cory/Renderer/Context.hpp>
 #include <Cory/Renderer/Shader.hpp>
+#include <Cory/Renderer/VulkanUtils.hpp>
 
 #include <Magnum/Vk/BufferCreateInfo.h>
+#include <Magnum/Vk/CommandBuffer.h>
 #include <Magnum/Vk/DescriptorSetLayoutCreateInfo.h>
 #include <Magnum/Vk/Device.h>
+#include <Magnum/Vk/Image.h>
 #include <Magnum/Vk/ImageCreateInfo.h>
 #include <Magnum/Vk/ImageViewCreateInfo.h>
+#include <Magnum/Vk/Memory.h>
+#include <Magnum/Vk/Pipeline.h>
 #include <Magnum/Vk/RasterizationPipelineCreateInfo.h>
 #include <Magnum/Vk/SamplerCreateInfo.h>
 
+#include <cppcoro/static_thread_pool.hpp>
+#include <cppcoro/sync_wait.hpp>
+#include <cppcoro/task.hpp>
+#include <cppcoro/when_all.hpp>
 #include <range/v3/algorithm/for_each.hpp>
 #include <range/v3/view/take.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
 namespace Cory {
 
 namespace Vk = Magnum::Vk;
@@ -25,17 +42,137 @@ template <typename T> struct ResourceStorage {
     T resource;
 };
 
+/// storage for resources with memory from the MemoryAllocator
+template <typename T, typename CreateInfo> struct AllocatedResourceStorage {
+    const std::string name;
+    const std::source_location loc;
+    /// used to create the replacement when the resource is moved by defragment()
+    CreateInfo createInfo{};
+    /// whether defragment() may move the resource
+    bool relocatable{false};
+    /// images only: the layout the image is in between frames, see allowRelocation()
+    VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+    /// declared before the resource, so the memory is freed after the resource is destroyed
+    MemoryAllocation allocation;
+    T resource;
+};
+using BufferStorage = AllocatedResourceStorage<Vk::Buffer, VkBufferCreateInfo>;
+using ImageStorage = AllocatedResourceStorage<Vk::Image, VkImageCreateInfo>;
+
+/// a resource that was replaced by defragment(), kept until the GPU is done with it
+template <typename T> struct RetiredResource {
+    MemoryAllocation allocation;
+    T resource;
+};
+
+/**
+ * the slots of one resource type, guarded by their own lock so that different resource types
+ * never contend. the lock only covers the slots - resources are created before insert() and
+ * destroyed after take(), outside of it. lookups take the lock shared, so they only wait for an
+ * insert or release of the same type that is running at the same time.
+ *
+ * the elements of a SlotMap never move, so references obtained from a lookup stay valid after
+ * the lock is released, until the resource itself is released.
+ */
+template <typename Storage> struct ResourceRegistry {
+    mutable std::shared_mutex mutex;
+    /// only to be accessed directly with the mutex held
+    SlotMap<Storage> slots;
+
+    SlotMapHandle insert(Storage storage)
+    {
+        const std::unique_lock lock{mutex};
+        return slots.emplace(std::move(storage));
+    }
+    /// throws if the handle is not valid
+    Storage &operator[](SlotMapHandle handle)
+    {
+        const std::shared_lock lock{mutex};
+        return slots[handle];
+    }
+    /// remove the resource from its slot, invalidating the handle
+    Storage take(SlotMapHandle handle)
+    {
+        const std::unique_lock lock{mutex};
+        Storage storage{std::move(slots[handle])};
+        slots.release(handle);
+        return storage;
+    }
+    [[nodiscard]] size_t size() const
+    {
+        const std::shared_lock lock{mutex};
+        return slots.size();
+    }
+};
+
 struct ResourceManagerPrivate {
     Context *ctx;
-    SlotMap<ResourceStorage<Vk::Buffer>> buffers;
-    SlotMap<ResourceStorage<Shader>> shaders;
-    SlotMap<ResourceStorage<Vk::Pipeline>> pipelines;
-    SlotMap<ResourceStorage<Vk::Image>> images;
-    SlotMap<ResourceStorage<Vk::ImageView>> imageViews;
-    SlotMap<ResourceStorage<Vk::Sampler>> samplers;
-    SlotMap<ResourceStorage<Vk::DescriptorSetLayout>> descriptorSetLayouts;
+    ResourceRegistry<BufferStorage> buffers;
+    ResourceRegistry<ResourceStorage<Shader>> shaders;
+    ResourceRegistry<ResourceStorage<Vk::Pipeline>> pipelines;
+    ResourceRegistry<ImageStorage> images;
+    ResourceRegistry<ResourceStorage<Vk::ImageView>> imageViews;
+    ResourceRegistry<ResourceStorage<Vk::Sampler>> samplers;
+    ResourceRegistry<ResourceStorage<Vk::DescriptorSetLayout>> descriptorSetLayouts;
+
+    /// guarded by the mutex of buffers and images, respectively
+    std::vector<RetiredResource<Vk::Buffer>> retiredBuffers;
+    std::vector<RetiredResource<Vk::Image>> retiredImages;
+
+    /// a released resource, destroyed once the frame it was released in has finished
+    struct PendingRelease {
+        uint64_t frame;
+        std::shared_ptr<void> resource;
+    };
+    /// guards frame and pendingReleases
+    mutable std::mutex releaseMutex;
+    /// the current frame, see ResourceManager::beginFrame() - 0 if no frame was started yet
+    uint64_t frame{0};
+    /// in the order of release, so also ordered by frame
+    std::deque<PendingRelease> pendingReleases;
+
+    /// destroy @a resource once the current frame has finished, or right away if no frame was
+    /// started yet
+    template <typename T> void defer(T resource)
+    {
+        // the parameter outlives the lock, so a resource that is not deferred is destroyed
+        // without it
+        const std::scoped_lock lock{releaseMutex};
+        if (frame != 0) {
+            pendingReleases.push_back(PendingRelease{
+                .frame = frame, .resource = std::make_shared<T>(std::move(resource))});
+        }
+    }
+
+    /// remove the resource from the @a registry, and destroy it once the GPU is done with it
+    template <typename Storage>
+    void release(ResourceRegistry<Storage> &registry, SlotMapHandle handle)
+    {
+        defer(registry.take(handle));
+    }
 };
 
+namespace {
+/// a copy of @a info that does not point to memory of the caller
+template <typename CreateInfo> CreateInfo detached(CreateInfo info)
+{
+    info.pNext = nullptr;
+    info.queueFamilyIndexCount = 0;
+    info.pQueueFamilyIndices = nullptr;
+    return info;
+}
+
+Vk::Buffer createUnallocated(Vk::Device &device, const VkBufferCreateInfo &info)
+{
+    return Vk::Buffer{device, Vk::BufferCreateInfo{info}, Magnum::NoAllocate};
+}
+
+Vk::Image createUnallocated(Vk::Device &device, const VkImageCreateInfo &info)
+{
+    return Vk::Image{device, Vk::ImageCreateInfo{info}, Magnum::NoAllocate};
+}
+} // namespace
+
 ResourceManager::ResourceManager()
     : data_{std::make_unique<ResourceManagerPrivate>()}
 {
@@ -43,7 +180,8 @@ ResourceManager::ResourceManager()
 
 ResourceManager::~ResourceManager()
 {
-    auto check_empty = [](std::string_view name, const auto &slotMap) {
+    auto check_empty = [](std::string_view name, const auto &registry) {
+        const auto &slotMap = registry.slots;
         if (!slotMap.empty()) {
             CO_CORE_WARN(
                 "ResourceManager: There are still {} {} elements in use!", slotMap.size(), name);
@@ -64,9 +202,7 @@ ResourceManager::~ResourceManager()
 
     check_empty("buffer", data_->buffers);
     check_empty("shader", data_->shaders);
-    // TODO we currently can't actually free the pipelines in the cache because our cache
-    // is so bare-bones. need to reinstate this when the cache is more sophisticated
-    // check_empty("pipeline", data_->pipelines);
+    check_empty("pipeline", data_->pipelines);
     check_empty("image", data_->images);
     check_empty("imageView", data_->imageViews);
     check_empty("sampler", data_->samplers);
@@ -95,7 +231,7 @@ ShaderHandle ResourceManager::createShader(std::filesystem::path filePath,
                                            std::source_location loc)
 {
     CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
-    return data_->shaders.emplace(ResourceStorage<Shader>{
+    return data_->shaders.insert(ResourceStorage<Shader>{
         .name = filePath.string(),
         .loc = std::move(loc),
         .resource = {std::ref(*data_->ctx), ShaderSource{std::move(filePath), type}}});
@@ -106,12 +242,72 @@ ShaderHandle ResourceManager::createShader(std::string source,
                                            std::source_location loc)
 {
     CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
-    return data_->shaders.emplace(ResourceStorage<Shader>{
+    return data_->shaders.insert(ResourceStorage<Shader>{
         .name = filePath.string(),
         .loc = std::move(loc),
         .resource = {std::ref(*data_->ctx),
                      ShaderSource{std::move(source), type, std::move(filePath)}}});
 }
+
+namespace {
+cppcoro::task<> compileOnWorker(cppcoro::static_thread_pool &pool,
+                                const ShaderSource &source,
+                                std::vector<uint32_t> &code,
+                                std::vector<std::filesystem::path> &includedFiles)
+{
+    co_await pool.schedule();
+    code = Shader::CompileToSpv(source, false, &includedFiles);
+}
+} // namespace
+
+std::vector<ShaderHandle> ResourceManager::createShaders(std::vector<ShaderSource> sources,
+                                                         std::source_location loc)
+{
+    CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
+    const Cory::ScopeTimer s{"ResourceManager/CompileShaders"};
+
+    std::vector<std::vector<uint32_t>> code(sources.size());
+    std::vector<std::vector<std::filesystem::path>> includedFiles(sources.size());
+    std::vector<cppcoro::task<>> workers;
+    workers.reserve(sources.size());
+    for (size_t i = 0; i < sources.size(); ++i) {
+        workers.push_back(compileOnWorker(
+            data_->ctx->workerPool(), sources[i], code[i], includedFiles[i]));
+    }
+    cppcoro::sync_wait(cppcoro::when_all(std::move(workers)));
+
+    for (size_t i = 0; i < sources.size(); ++i) {
+        if (code[i].empty()) {
+            throw std::runtime_error{fmt::format("Could not compile shader {} to SPIR-V",
+                                                 sources[i].filePath().string())};
+        }
+    }
+
+    std::vector<ShaderHandle> handles;
+    handles.reserve(sources.size());
+    for (size_t i = 0; i < sources.size(); ++i) {
+        std::string name = sources[i].filePath().string();
+        handles.push_back(data_->shaders.insert(ResourceStorage<Shader>{
+            .name = std::move(name),
+            .loc = loc,
+            .resource = {std::ref(*data_->ctx),
+                         std::move(sources[i]),
+                         std::move(code[i]),
+                         std::move(includedFiles[i])}}));
+    }
+    return handles;
+}
+std::vector<ShaderHandle> ResourceManager::shaders() const
+{
+    CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
+    const std::shared_lock lock{data_->shaders.mutex};
+    std::vector<ShaderHandle> handles;
+    handles.reserve(data_->shaders.slots.size());
+    for (const SlotMapHandle handle : data_->shaders.slots.handles()) {
+        handles.push_back(ShaderHandle{handle});
+    }
+    return handles;
+}
 Shader &ResourceManager::operator[](ShaderHandle shaderHandle)
 {
     CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
@@ -120,7 +316,8 @@ Shader &ResourceManager::operator[](ShaderHandle shaderHandle)
 void ResourceManager::release(ShaderHandle shaderHandle)
 {
     CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
-    data_->shaders.release(shaderHandle);
+    // shaders are not used by the GPU, so they are destroyed right away
+    data_->shaders.take(shaderHandle);
 }
 
 // BUFFERS
@@ -131,43 +328,86 @@ BufferHandle ResourceManager::createBuffer(std::string_view name,
                                            std::source_location loc)
 {
     CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
-    auto handle = data_->buffers.emplace(ResourceStorage<Vk::Buffer>{
+    const Vk::BufferCreateInfo createInfo{Vk::BufferUsage{usage.underlying_bits()},
+                                          bufferSizeInBytes};
+    Vk::Buffer buffer{data_->ctx->device(), createInfo, Magnum::NoAllocate};
+    MemoryAllocation allocation = data_->ctx->allocator().allocate(buffer, flags.underlying_bits());
+    nameVulkanObject(data_->ctx->device(), buffer, name);
+
+    return data_->buffers.insert(BufferStorage{
         .name{name},
         .loc = std::move(loc),
-        .resource{std::ref(data_->ctx->device()),
-                  Vk::BufferCreateInfo{Vk::BufferUsage{usage.underlying_bits()}, bufferSizeInBytes},
-                  Vk::MemoryFlag{flags.underlying_bits()}}});
-
-    nameVulkanObject(data_->ctx->device(), data_->buffers[handle].resource, name);
-
-    return handle;
+        .createInfo = detached<VkBufferCreateInfo>(createInfo),
+        .allocation = std::move(allocation),
+        .resource = std::move(buffer)});
+}
+BufferHandle ResourceManager::createBuffer(std::string_view name,
+                                           size_t bufferSizeInBytes,
+                                           BufferUsage usage,
+                                           Magnum::NoAllocateT,
+                                           std::source_location loc)
+{
+    CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
+    Vk::Buffer buffer{
+        data_->ctx->device(),
+        Vk::BufferCreateInfo{Vk::BufferUsage{usage.underlying_bits()}, bufferSizeInBytes},
+        Magnum::NoAllocate};
+    nameVulkanObject(data_->ctx->device(), buffer, name);
+
+    return data_->buffers.insert(
+        BufferStorage{.name{name}, .loc = std::move(loc), .resource = std::move(buffer)});
 }
 Vk::Buffer &ResourceManager::operator[](BufferHandle bufferHandle)
 {
     CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
     return data_->buffers[bufferHandle].resource;
 }
+AllocationInfo ResourceManager::memoryInfo(BufferHandle bufferHandle)
+{
+    CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
+    return data_->buffers[bufferHandle].allocation.info();
+}
+void ResourceManager::flush(BufferHandle bufferHandle, VkDeviceSize offset, VkDeviceSize size)
+{
+    CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
+    data_->buffers[bufferHandle].allocation.flush(offset, size);
+}
 void ResourceManager::release(BufferHandle bufferHandle)
 {
     CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
-    data_->buffers.release(bufferHandle.handle_);
+    data_->release(data_->buffers, bufferHandle);
 }
 
 // PIPELINES
 PipelineHandle
 ResourceManager::createPipeline(std::string_view name,
                                 const Vk::RasterizationPipelineCreateInfo &createInfo,
+                                VkPipelineCache cache,
                                 std::source_location loc)
 {
     CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
-    auto handle = data_->pipelines.emplace(ResourceStorage<Vk::Pipeline>{
-        .name{name},
-        .loc = std::move(loc),
-        .resource{std::ref(data_->ctx->device()), std::ref(createInfo)}});
-
-    nameVulkanObject(data_->ctx->device(), data_->pipelines[handle].resource, name);
-
-    return handle;
+    // Magnum's Vk::Pipeline constructor does not take a pipeline cache
+    auto &device = data_->ctx->device();
+    VkPipeline pipeline;
+    THROW_ON_ERROR(
+        device->CreateGraphicsPipelines(device, cache, 1, createInfo, nullptr, &pipeline),
+        "failed to create a graphics pipeline");
+    Vk::Pipeline resource = Vk::Pipeline::wrap(device,
+                                               Vk::PipelineBindPoint::Rasterization,
+                                               pipeline,
+                                               Vk::HandleFlag::DestroyOnDestruction);
+    nameVulkanObject(device, resource, name);
+
+    return data_->pipelines.insert(ResourceStorage<Vk::Pipeline>{
+        .name{name}, .loc = std::move(loc), .resource = std::move(resource)});
+}
+PipelineHandle ResourceManager::createPipeline(std::string_view name,
+                                               Magnum::NoCreateT,
+                                               std::source_location loc)
+{
+    CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
+    return data_->pipelines.insert(ResourceStorage<Vk::Pipeline>{
+        .name{name}, .loc = std::move(loc), .resource{Magnum::NoCreate}});
 }
 Vk::Pipeline &ResourceManager::operator[](PipelineHandle pipelineHandle)
 {
@@ -177,7 +417,7 @@ Vk::Pipeline &ResourceManager::operator[](PipelineHandle pipelineHandle)
 void ResourceManager::release(PipelineHandle pipelineHandle)
 {
     CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
-    data_->pipelines.release(pipelineHandle);
+    data_->release(data_->pipelines, pipelineHandle);
 }
 
 // IMAGES
@@ -187,38 +427,55 @@ ImageHandle ResourceManager::createImage(std::string_view name,
                                          std::source_location loc)
 {
     CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
-    auto handle = data_->images.emplace(ResourceStorage<Vk::Image>{
+    Vk::Image image{data_->ctx->device(), createInfo, Magnum::NoAllocate};
+    MemoryAllocation allocation = data_->ctx->allocator().allocate(
+        image, createInfo->tiling, VkMemoryPropertyFlags(memoryFlags));
+    nameVulkanObject(data_->ctx->device(), image, name);
+
+    return data_->images.insert(ImageStorage{
         .name{name},
         .loc = std::move(loc),
-        .resource{std::ref(data_->ctx->device()), std::ref(createInfo), memoryFlags}});
-
-    nameVulkanObject(data_->ctx->device(), data_->images[handle].resource, name);
+        .createInfo = detached<VkImageCreateInfo>(createInfo),
+        .allocation = std::move(allocation),
+        .resource = std::move(image)});
+}
+ImageHandle ResourceManager::createImage(std::string_view name,
+                                         const Vk::ImageCreateInfo &createInfo,
+                                         Magnum::NoAllocateT,
+                                         std::source_location loc)
+{
+    CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
+    Vk::Image image{data_->ctx->device(), createInfo, Magnum::NoAllocate};
+    nameVulkanObject(data_->ctx->device(), image, name);
 
-    return handle;
+    return data_->images.insert(
+        ImageStorage{.name{name}, .loc = std::move(loc), .resource = std::move(image)});
 }
 ImageHandle ResourceManager::wrapImage(std::string_view name,
                                        Magnum::Vk::Image &resource,
                                        std::source_location loc)
 {
     CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
-    auto handle = data_->images.emplace(ResourceStorage<Vk::Image>{
-        .name{name},
-        .loc = std::move(loc),
-        .resource{Vk::Image::wrap(data_->ctx->device(), resource, resource.format())}});
+    Vk::Image image = Vk::Image::wrap(data_->ctx->device(), resource, resource.format());
+    nameVulkanObject(data_->ctx->device(), image, name);
 
-    nameVulkanObject(data_->ctx->device(), data_->images[handle].resource, name);
-
-    return handle;
+    return data_->images.insert(
+        ImageStorage{.name{name}, .loc = std::move(loc), .resource = std::move(image)});
 }
 Magnum::Vk::Image &ResourceManager::operator[](ImageHandle handle)
 {
     CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
     return data_->images[handle].resource;
 }
+AllocationInfo ResourceManager::memoryInfo(ImageHandle handle)
+{
+    CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
+    return data_->images[handle].allocation.info();
+}
 void ResourceManager::release(ImageHandle handle)
 {
     CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
-    data_->images.release(handle);
+    data_->release(data_->images, handle);
 }
 
 // IMAGE VIEWS
@@ -227,28 +484,22 @@ ImageViewHandle ResourceManager::createImageView(std::string_view name,
                                                  std::source_location loc)
 {
     CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
-    auto handle = data_->imageViews.emplace(ResourceStorage<Vk::ImageView>{
-        .name{name},
-        .loc = std::move(loc),
-        .resource{std::ref(data_->ctx->device()), std::ref(createInfo)}});
-
-    nameVulkanObject(data_->ctx->device(), data_->imageViews[handle].resource, name);
+    Vk::ImageView resource{data_->ctx->device(), createInfo};
+    nameVulkanObject(data_->ctx->device(), resource, name);
 
-    return handle;
+    return data_->imageViews.insert(ResourceStorage<Vk::ImageView>{
+        .name{name}, .loc = std::move(loc), .resource = std::move(resource)});
 }
 ImageViewHandle ResourceManager::wrapImageView(std::string_view name,
                                                Magnum::Vk::ImageView &resource,
                                                std::source_location loc)
 {
     CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
-    auto handle = data_->imageViews.emplace(ResourceStorage<Vk::ImageView>{
-        .name{name},
-        .loc = std::move(loc),
-        .resource{Vk::ImageView::wrap(data_->ctx->device(), resource)}});
+    Vk::ImageView imageView = Vk::ImageView::wrap(data_->ctx->device(), resource);
+    nameVulkanObject(data_->ctx->device(), imageView, name);
 
-    nameVulkanObject(data_->ctx->device(), data_->imageViews[handle].resource, name);
-
-    return handle;
+    return data_->imageViews.insert(ResourceStorage<Vk::ImageView>{
+        .name{name}, .loc = std::move(loc), .resource = std::move(imageView)});
 }
 Magnum::Vk::ImageView &ResourceManager::operator[](ImageViewHandle handle)
 {
@@ -258,7 +509,7 @@ Magnum::Vk::ImageView &ResourceManager::operator[](ImageViewHandle handle)
 void ResourceManager::release(ImageViewHandle handle)
 {
     CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
-    data_->imageViews.release(handle);
+    data_->release(data_->imageViews, handle);
 }
 
 // SAMPLERS
@@ -267,14 +518,11 @@ SamplerHandle ResourceManager::createSampler(std::string_view name,
                                              std::source_location loc)
 {
     CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
-    auto handle = data_->samplers.emplace(ResourceStorage<Vk::Sampler>{
-        .name{name},
-        .loc = std::move(loc),
-        .resource{std::ref(data_->ctx->device()), std::ref(createInfo)}});
-
-    nameVulkanObject(data_->ctx->device(), data_->samplers[handle].resource, name);
+    Vk::Sampler resource{data_->ctx->device(), createInfo};
+    nameVulkanObject(data_->ctx->device(), resource, name);
 
-    return handle;
+    return data_->samplers.insert(ResourceStorage<Vk::Sampler>{
+        .name{name}, .loc = std::move(loc), .resource = std::move(resource)});
 }
 Magnum::Vk::Sampler &ResourceManager::operator[](SamplerHandle handle)
 {
@@ -284,7 +532,7 @@ Magnum::Vk::Sampler &ResourceManager::operator[](SamplerHandle handle)
 void ResourceManager::release(SamplerHandle handle)
 {
     CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
-    data_->samplers.release(handle);
+    data_->release(data_->samplers, handle);
 }
 
 // DESCRIPTOR SET LAYOUTS
@@ -294,14 +542,11 @@ ResourceManager::createDescriptorLayout(std::string_view name,
                                         std::source_location loc)
 {
     CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
-    auto handle = data_->descriptorSetLayouts.emplace(ResourceStorage<Vk::DescriptorSetLayout>{
-        .name{name},
-        .loc = std::move(loc),
-        .resource{std::ref(data_->ctx->device()), std::ref(createInfo)}});
+    Vk::DescriptorSetLayout resource{data_->ctx->device(), createInfo};
+    nameVulkanObject(data_->ctx->device(), resource, name);
 
-    nameVulkanObject(data_->ctx->device(), data_->descriptorSetLayouts[handle].resource, name);
-
-    return handle;
+    return data_->descriptorSetLayouts.insert(ResourceStorage<Vk::DescriptorSetLayout>{
+        .name{name}, .loc = std::move(loc), .resource = std::move(resource)});
 }
 Magnum::Vk::DescriptorSetLayout &ResourceManager::operator[](DescriptorSetLayoutHandle handle)
 {
@@ -311,6 +556,285 @@ Magnum::Vk::DescriptorSetLayout &ResourceManager::operator[](DescriptorSetLayout
 void ResourceManager::release(DescriptorSetLayoutHandle handle)
 {
     CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
-    data_->descriptorSetLayouts.release(handle);
+    data_->release(data_->descriptorSetLayouts, handle);
+}
+
+// DEFRAGMENTATION
+void ResourceManager::allowRelocation(BufferHandle handle)
+{
+    CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
+    const std::unique_lock lock{data_->buffers.mutex};
+    BufferStorage &storage = data_->buffers.slots[handle];
+    constexpr VkBufferUsageFlags transferUsage =
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    CO_CORE_ASSERT((storage.createInfo.usage & transferUsage) == transferUsage,
+                   "Relocatable buffers need transfer source and destination usage");
+    CO_CORE_ASSERT(storage.allocation.info().mappedData == nullptr,
+                   "Host visible buffers can not be relocated");
+    storage.relocatable = true;
+}
+void ResourceManager::allowRelocation(ImageHandle handle, VkImageLayout layout)
+{
+    CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
+    const std::unique_lock lock{data_->images.mutex};
+    ImageStorage &storage = data_->images.slots[handle];
+    constexpr VkImageUsageFlags transferUsage =
+        VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    CO_CORE_ASSERT((storage.createInfo.usage & transferUsage) == transferUsage,
+                   "Relocatable images need transfer source and destination usage");
+    CO_CORE_ASSERT(layout != VK_IMAGE_LAYOUT_PREINITIALIZED,
+                   "Relocatable images can not be kept in the preinitialized layout");
+    storage.relocatable = true;
+    storage.layout = layout;
+}
+
+DefragmentationStats ResourceManager::defragment(Vk::CommandBuffer &cmd,
+                                                 const DefragmentationBudget &budget)
+{
+    CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
+    const Cory::ScopeTimer s{"ResourceManager/Defragment"};
+    // resources are replaced in their slots, so no buffer or image may be created or released
+    // during the pass
+    const std::scoped_lock lock{data_->buffers.mutex, data_->images.mutex};
+    SlotMap<BufferStorage> &buffers = data_->buffers.slots;
+    SlotMap<ImageStorage> &images = data_->images.slots;
+    const auto deadline = std::chrono::steady_clock::now() + budget.time;
+    Vk::Device &device = data_->ctx->device();
+    MemoryAllocator &allocator = data_->ctx->allocator();
+
+    // resources are moved out of the blocks with the fewest used bytes first, so these become
+    // empty and are freed. resources are only moved to blocks that are used more than their
+    // current one, which also keeps them from moving back and forth between passes
+    std::unordered_map<VkDeviceMemory, VkDeviceSize> blockUsage;
+    struct Candidate {
+        VkDeviceMemory memory;
+        VkDeviceSize size;
+        SlotMapHandle handle;
+        bool isImage;
+    };
+    std::vector<Candidate> candidates;
+    auto gather = [&](auto &slotMap, bool isImage) {
+        for (auto [handle, storage] : slotMap.items()) {
+            if (!storage.allocation.valid()) { continue; }
+            const AllocationInfo info = storage.allocation.info();
+            blockUsage[info.memory] += info.size;
+            if (storage.relocatable) {
+                candidates.push_back(Candidate{info.memory, info.size, handle, isImage});
+            }
+        }
+    };
+    gather(buffers, false);
+    gather(images, true);
+    std::ranges::sort(candidates, [&](const Candidate &lhs, const Candidate &rhs) {
+        return std::pair{blockUsage[lhs.memory], lhs.size} <
+               std::pair{blockUsage[rhs.memory], rhs.size};
+    });
+
+    // replace the resource of the storage with a new one in a fuller block, and retire the old
+    // one - returns false if there is no space for the resource in a fuller block
+    auto relocate = [&]<typename T, typename CreateInfo>(
+                        AllocatedResourceStorage<T, CreateInfo> &storage,
+                        std::vector<RetiredResource<T>> &retired) {
+        const AllocationInfo from = storage.allocation.info();
+        T resource = createUnallocated(device, storage.createInfo);
+        MemoryAllocation allocation = allocator.reallocate(
+            storage.allocation, resource.memoryRequirements()->memoryRequirements);
+        if (!allocation.valid()) { return false; }
+        const AllocationInfo to = allocation.info();
+        if (blockUsage[to.memory] <= blockUsage[from.memory]) { return false; }
+
+        allocator.bind(allocation, resource);
+        nameVulkanObject(device, resource, storage.name);
+        blockUsage[from.memory] -= from.size;
+        blockUsage[to.memory] += from.size;
+        retired.push_back(
+            RetiredResource<T>{std::move(storage.allocation), std::move(storage.resource)});
+        storage.allocation = std::move(allocation);
+        storage.resource = std::move(resource);
+        return true;
+    };
+
+    DefragmentationStats stats{};
+    const size_t firstBuffer = data_->retiredBuffers.size();
+    const size_t firstImage = data_->retiredImages.size();
+    std::vector<BufferHandle> movedBuffers;
+    std::vector<ImageHandle> movedImages;
+    for (const Candidate &candidate : candidates) {
+        if (std::chrono::steady_clock::now() >= deadline) { break; }
+        if (stats.bytesMoved + candidate.size > budget.bytes) { continue; }
+        if (candidate.isImage) {
+            if (!relocate(images[candidate.handle], data_->retiredImages)) { continue; }
+            movedImages.push_back(ImageHandle{candidate.handle});
+        }
+        else {
+            if (!relocate(buffers[candidate.handle], data_->retiredBuffers)) { continue; }
+            movedBuffers.push_back(BufferHandle{candidate.handle});
+        }
+        ++stats.moves;
+        stats.bytesMoved += candidate.size;
+    }
+    if (stats.moves == 0) { return stats; }
+
+    // copy the contents of the old resources - a single barrier each for all resources before
+    // and after the copies, images are transitioned from and back to their layout
+    std::vector<VkImageMemoryBarrier> preCopy;
+    std::vector<VkImageMemoryBarrier> postCopy;
+    auto imageBarrier = [](VkImage image,
+                           const VkImageCreateInfo &info,
+                           VkAccessFlags srcAccess,
+                           VkAccessFlags dstAccess,
+                           VkImageLayout oldLayout,
+                           VkImageLayout newLayout) {
+        return VkImageMemoryBarrier{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = srcAccess,
+            .dstAccessMask = dstAccess,
+            .oldLayout = oldLayout,
+            .newLayout = newLayout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange = {VkImageAspectFlags(imageAspectsFor(PixelFormat(info.format))),
+                                 0,
+                                 VK_REMAINING_MIP_LEVELS,
+                                 0,
+                                 VK_REMAINING_ARRAY_LAYERS}};
+    };
+    for (size_t i = 0; i < movedImages.size(); ++i) {
+        ImageStorage &storage = images[movedImages[i]];
+        if (storage.layout == VK_IMAGE_LAYOUT_UNDEFINED) { continue; }
+        const VkImage oldImage = data_->retiredImages[firstImage + i].resource;
+        preCopy.push_back(imageBarrier(oldImage,
+                                       storage.createInfo,
+                                       VK_ACCESS_MEMORY_WRITE_BIT,
+                                       VK_ACCESS_TRANSFER_READ_BIT,
+                                       storage.layout,
+                                       VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL));
+        preCopy.push_back(imageBarrier(storage.resource,
+                                       storage.createInfo,
+                                       0,
+                                       VK_ACCESS_TRANSFER_WRITE_BIT,
+                                       VK_IMAGE_LAYOUT_UNDEFINED,
+                                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL));
+        postCopy.push_back(imageBarrier(storage.resource,
+                                        storage.createInfo,
+                                        VK_ACCESS_TRANSFER_WRITE_BIT,
+                                        VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+                                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                        storage.layout));
+    }
+
+    const VkMemoryBarrier beforeCopies{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                       .srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT,
+                                       .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT};
+    device->CmdPipelineBarrier(cmd,
+                               VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                               VK_PIPELINE_STAGE_TRANSFER_BIT,
+                               0,
+                               1,
+                               &beforeCopies,
+                               0,
+                               nullptr,
+                               static_cast<uint32_t>(preCopy.size()),
+                               preCopy.data());
+
+    for (size_t i = 0; i < movedBuffers.size(); ++i) {
+        BufferStorage &storage = buffers[movedBuffers[i]];
+        const VkBufferCopy region{.size = storage.createInfo.size};
+        device->CmdCopyBuffer(cmd,
+                              data_->retiredBuffers[firstBuffer + i].resource,
+                              storage.resource,
+                              1,
+                              &region);
+    }
+    std::vector<VkImageCopy> regions;
+    for (size_t i = 0; i < movedImages.size(); ++i) {
+        ImageStorage &storage = images[movedImages[i]];
+        if (storage.layout == VK_IMAGE_LAYOUT_UNDEFINED) { continue; }
+        const VkImageCreateInfo &info = storage.createInfo;
+        const auto aspects = VkImageAspectFlags(imageAspectsFor(PixelFormat(info.format)));
+        regions.clear();
+        for (uint32_t level = 0; level < info.mipLevels; ++level) {
+            const VkImageSubresourceLayers subresource{aspects, level, 0, info.arrayLayers};
+            regions.push_back(VkImageCopy{
+                .srcSubresource = subresource,
+                .dstSubresource = subresource,
+                .extent = {std::max(info.extent.width >> level, 1u),
+                           std::max(info.extent.height >> level, 1u),
+                           std::max(info.extent.depth >> level, 1u)}});
+        }
+        device->CmdCopyImage(cmd,
+                             data_->retiredImages[firstImage + i].resource,
+                             VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                             storage.resource,
+                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                             static_cast<uint32_t>(regions.size()),
+                             regions.data());
+    }
+
+    const VkMemoryBarrier afterCopies{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                      .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                                      .dstAccessMask =
+                                          VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT};
+    device->CmdPipelineBarrier(cmd,
+                               VK_PIPELINE_STAGE_TRANSFER_BIT,
+                               VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                               0,
+                               1,
+                               &afterCopies,
+                               0,
+                               nullptr,
+                               static_cast<uint32_t>(postCopy.size()),
+                               postCopy.data());
+
+    CO_CORE_DEBUG("Defragmentation moved {} resources ({} bytes)", stats.moves, stats.bytesMoved);
+    return stats;
+}
+void ResourceManager::releaseRelocated()
+{
+    CO_CORE_ASSERT(data_->ctx != nullptr, "Context was not initialized!");
+    std::vector<RetiredResource<Vk::Buffer>> buffers;
+    std::vector<RetiredResource<Vk::Image>> images;
+    {
+        const std::scoped_lock lock{data_->buffers.mutex, data_->images.mutex};
+        std::swap(buffers, data_->retiredBuffers);
+        std::swap(images, data_->retiredImages);
+    }
+    if (!buffers.empty()) { data_->defer(std::move(buffers)); }
+    if (!images.empty()) { data_->defer(std::move(images)); }
+}
+size_t ResourceManager::relocatedCount() const
+{
+    const std::scoped_lock lock{data_->buffers.mutex, data_->images.mutex};
+    return data_->retiredBuffers.size() + data_->retiredImages.size();
+}
+
+// DEFERRED DESTRUCTION
+uint64_t ResourceManager::beginFrame()
+{
+    const std::scoped_lock lock{data_->releaseMutex};
+    return ++data_->frame;
+}
+void ResourceManager::collect(uint64_t completedFrame)
+{
+    // the resources are destroyed after the lock is released
+    std::vector<ResourceManagerPrivate::PendingRelease> completed;
+    const std::scoped_lock lock{data_->releaseMutex};
+    auto &pending = data_->pendingReleases;
+    while (!pending.empty() && pending.front().frame <= completedFrame) {
+        completed.push_back(std::move(pending.front()));
+        pending.pop_front();
+    }
+}
+void ResourceManager::collectAll()
+{
+    std::deque<ResourceManagerPrivate::PendingRelease> completed;
+    const std::scoped_lock lock{data_->releaseMutex};
+    std::swap(completed, data_->pendingReleases);
+}
+size_t ResourceManager::pendingReleaseCount() const
+{
+    const std::scoped_lock lock{data_->releaseMutex};
+    return data_->pendingReleases.size();
 }
 } // namespace Cory
@@ -8,17 +8,180 @@
 
 #include <Corrade/Containers/ArrayViewStl.h>
 #include <Magnum/Vk/ShaderCreateInfo.h>
+#include <gsl/narrow>
 #include <shaderc/shaderc.hpp>
 
+#include <algorithm>
 #include <fstream>
 #include <mutex>
+#include <optional>
+#include <random>
+#include <unordered_map>
 
 namespace Cory {
 
+namespace {
+/// files included by shaders, kept in memory so that every include does not read the file
+/// again. an entry is reloaded if the modification time of its file changes.
+class IncludeCache {
+  public:
+    static IncludeCache &instance()
+    {
+        static IncludeCache cache;
+        return cache;
+    }
+
+    std::shared_ptr<const std::vector<char>> read(const std::filesystem::path &path)
+    {
+        std::error_code ec;
+        const auto writeTime = std::filesystem::last_write_time(path, ec);
+
+        const std::scoped_lock lock{mutex_};
+        auto &entry = entries_[path.string()];
+        if (entry.contents == nullptr || ec || entry.writeTime != writeTime) {
+            entry.contents = std::make_shared<const std::vector<char>>(readFile(path));
+            entry.writeTime = writeTime;
+        }
+        return entry.contents;
+    }
+
+  private:
+    struct Entry {
+        std::shared_ptr<const std::vector<char>> contents;
+        std::filesystem::file_time_type writeTime;
+    };
+    std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+};
+
+/// precedes the SPIR-V code in a file of the shader cache
+struct SpirvCacheHeader {
+    static constexpr uint32_t MAGIC{0x43595350}; // "PSYC"
+    static constexpr uint32_t VERSION{1};
+
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint64_t codeSize; ///< in words
+    uint64_t codeHash;
+};
+static constexpr uint32_t SPIRV_MAGIC{0x07230203};
+
+/// FNV-1a - unlike std::hash, this is guaranteed to be the same across platforms and runs
+static constexpr uint64_t FNV_OFFSET_BASIS{0xcbf29ce484222325ULL};
+uint64_t hashBytes(const void *data, size_t size, uint64_t hash = FNV_OFFSET_BASIS)
+{
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+uint64_t hashString(std::string_view str, uint64_t hash)
+{
+    // include the terminator so that consecutive strings can not be shifted into each other
+    return hashBytes(str.data(), str.size() + 1, hash);
+}
+uint64_t hashCode(const std::vector<uint32_t> &code)
+{
+    return hashBytes(code.data(), code.size() * sizeof(uint32_t));
+}
+
+struct SpirvCacheDirectory {
+    std::mutex mutex;
+    std::filesystem::path path;
+};
+SpirvCacheDirectory &spirvCacheDirectory()
+{
+    static SpirvCacheDirectory directory;
+    return directory;
+}
+
+std::filesystem::path spirvCacheFile(const std::filesystem::path &directory, uint64_t key)
+{
+    return directory / fmt::format("{:016x}.spv", key);
+}
+
+/// read the cached code for @a key - returns nothing if there is no valid cached code
+std::optional<std::vector<uint32_t>> loadCachedSpirv(const std::filesystem::path &file,
+                                                     uint64_t key)
+{
+    std::ifstream stream(file, std::ios::binary);
+    if (!stream) { return std::nullopt; }
+
+    SpirvCacheHeader header{};
+    stream.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!stream || header.magic != SpirvCacheHeader::MAGIC ||
+        header.version != SpirvCacheHeader::VERSION || header.key != key ||
+        header.codeSize == 0) {
+        CO_CORE_WARN("Ignoring invalid shader cache file {}", file.string());
+        return std::nullopt;
+    }
+
+    std::vector<uint32_t> code(header.codeSize);
+    stream.read(reinterpret_cast<char *>(code.data()),
+                gsl::narrow<std::streamsize>(code.size() * sizeof(uint32_t)));
+    // the file must end right after the code
+    if (!stream || stream.peek() != std::ifstream::traits_type::eof() ||
+        code[0] != SPIRV_MAGIC || hashCode(code) != header.codeHash) {
+        CO_CORE_WARN("Ignoring corrupted shader cache file {}", file.string());
+        return std::nullopt;
+    }
+    return code;
+}
+
+/// write the code for @a key to the cache. the file is written under a unique temporary name
+/// and then renamed, so concurrent writers (threads or processes) never produce a partial file
+void storeCachedSpirv(const std::filesystem::path &file,
+                      uint64_t key,
+                      const std::vector<uint32_t> &code)
+{
+    const SpirvCacheHeader header{.magic = SpirvCacheHeader::MAGIC,
+                                  .version = SpirvCacheHeader::VERSION,
+                                  .key = key,
+                                  .codeSize = code.size(),
+                                  .codeHash = hashCode(code)};
+
+    static std::mutex rngMutex;
+    static std::mt19937_64 rng{std::random_device{}()};
+    std::filesystem::path tempFile{file};
+    {
+        const std::scoped_lock lock{rngMutex};
+        tempFile += fmt::format(".{:016x}.tmp", rng());
+    }
+
+    {
+        std::ofstream stream(tempFile, std::ios::binary | std::ios::trunc);
+        stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char *>(code.data()),
+                     gsl::narrow<std::streamsize>(code.size() * sizeof(uint32_t)));
+        if (!stream) {
+            CO_CORE_WARN("Could not write shader cache file {}", tempFile.string());
+            std::error_code ec;
+            std::filesystem::remove(tempFile, ec);
+            return;
+        }
+    }
+    // replaces the file if another writer was faster - both wrote the same contents
+    std::error_code ec;
+    std::filesystem::rename(tempFile, file, ec);
+    if (ec) {
+        CO_CORE_WARN("Could not write shader cache file {}: {}", file.string(), ec.message());
+        std::filesystem::remove(tempFile, ec);
+    }
+}
+} // namespace
+
 class FileIncludeHandler : public shaderc::CompileOptions::IncluderInterface {
   public:
+    /// if @a includedFiles is given, the resolved paths of all included files are added to it
+    explicit FileIncludeHandler(std::vector<std::filesystem::path> *includedFiles = nullptr)
+        : includedFiles_{includedFiles}
+    {
+    }
+
     struct IncludeData {
-        std::vector<char> data;
+        std::shared_ptr<const std::vector<char>> data;
         std::string resourceName;
     };
 
@@ -31,16 +194,21 @@ class FileIncludeHandler : public shaderc::CompileOptions::IncluderInterface {
         CO_CORE_DEBUG("Include file {} from {}", requested_source, requesting_source);
 
         auto resolvedLocation = ResourceLocator::Locate(requested_source);
+        if (includedFiles_ != nullptr &&
+            std::find(includedFiles_->begin(), includedFiles_->end(), resolvedLocation) ==
+                includedFiles_->end()) {
+            includedFiles_->push_back(resolvedLocation);
+        }
 
         auto ir = new shaderc_include_result;
         IncludeData *id = new IncludeData;
         ir->user_data = id;
 
-        id->data = readFile(resolvedLocation);
+        id->data = IncludeCache::instance().read(resolvedLocation);
         id->resourceName = resolvedLocation.string();
 
-        ir->content = id->data.data();
-        ir->content_length = id->data.size();
+        ir->content = id->data->data();
+        ir->content_length = id->data->size();
         ir->source_name = id->resourceName.data();
         ir->source_name_length = id->resourceName.size();
 
@@ -55,6 +223,9 @@ class FileIncludeHandler : public shaderc::CompileOptions::IncluderInterface {
     };
 
     virtual ~FileIncludeHandler() = default;
+
+  private:
+    std::vector<std::filesystem::path> *includedFiles_;
 };
 
 shaderc_shader_kind ShaderTypeToShaderKind(ShaderType type)
@@ -83,9 +254,9 @@ ShaderSource::ShaderSource(std::string source, ShaderType type, std::filesystem:
 ShaderSource::ShaderSource(std::filesystem::path filePath, ShaderType type)
     : type_{type}
     , filename_{std::move(filePath)}
+    , isFile_{true}
 {
-    auto fileBytes = readFile(filename_);
-    source_ = std::string{fileBytes.begin(), fileBytes.end()};
+    reload();
 
     if (type_ == ShaderType::eUnknown) {
         auto ext = filename_.extension();
@@ -100,12 +271,14 @@ ShaderSource::ShaderSource(std::filesystem::path filePath, ShaderType type)
     }
 }
 
-std::vector<uint32_t> Shader::CompileToSpv(const ShaderSource &source, bool optimize)
+std::vector<uint32_t> Shader::CompileToSpv(const ShaderSource &source,
+                                           bool optimize,
+                                           std::vector<std::filesystem::path> *includedFiles)
 {
-    // static for now, we should really move this to a global static instance
-    static shaderc::Compiler compiler;
+    // shaderc compilers must not be used concurrently, so every thread gets its own
+    thread_local shaderc::Compiler compiler;
     shaderc::CompileOptions options;
-    options.SetIncluder(std::make_unique<FileIncludeHandler>());
+    options.SetIncluder(std::make_unique<FileIncludeHandler>(includedFiles));
 
     for (const auto [k, v] : source.defines()) {
         options.AddMacroDefinition(k, v);
@@ -116,6 +289,41 @@ std::vector<uint32_t> Shader::CompileToSpv(const ShaderSource &source, bool opti
     const auto &kind = ShaderTypeToShaderKind(source.type());
     auto source_name = source.filePath().filename().string();
 
+    std::filesystem::path cacheDirectory = CacheDirectory();
+    std::filesystem::path cacheFile;
+    uint64_t key{};
+    if (!cacheDirectory.empty()) {
+        // preprocessing resolves the includes, so the key changes if any included file changes
+        shaderc::PreprocessedSourceCompilationResult preprocessed =
+            compiler.PreprocessGlsl(source.source(), kind, source_name.c_str(), options);
+        if (preprocessed.GetCompilationStatus() != shaderc_compilation_status_success) {
+            CO_CORE_ERROR("Failed to preprocess {}: {}",
+                          source.filePath().string(),
+                          preprocessed.GetErrorMessage());
+            return std::vector<uint32_t>();
+        }
+
+        uint32_t spvVersion{};
+        uint32_t spvRevision{};
+        shaderc_get_spv_version(&spvVersion, &spvRevision);
+        const uint32_t settings[]{SpirvCacheHeader::VERSION,
+                                  static_cast<uint32_t>(kind),
+                                  optimize ? 1U : 0U,
+                                  spvVersion,
+                                  spvRevision};
+        key = hashString({preprocessed.cbegin(), preprocessed.cend()}, FNV_OFFSET_BASIS);
+        for (const auto &[k, v] : source.defines()) {
+            key = hashString(v, hashString(k, key));
+        }
+        key = hashBytes(settings, sizeof(settings), key);
+
+        cacheFile = spirvCacheFile(cacheDirectory, key);
+        if (auto cached = loadCachedSpirv(cacheFile, key); cached) {
+            CO_CORE_TRACE("Loaded {} from the shader cache", source.filePath().string());
+            return std::move(*cached);
+        }
+    }
+
     shaderc::SpvCompilationResult spvModule =
         compiler.CompileGlslToSpv(source.source(), kind, source_name.c_str(), options);
 
@@ -125,7 +333,24 @@ std::vector<uint32_t> Shader::CompileToSpv(const ShaderSource &source, bool opti
         return std::vector<uint32_t>();
     }
 
-    return {spvModule.cbegin(), spvModule.cend()};
+    std::vector<uint32_t> code{spvModule.cbegin(), spvModule.cend()};
+    if (!cacheFile.empty()) { storeCachedSpirv(cacheFile, key, code); }
+    return code;
+}
+
+void Shader::SetCacheDirectory(std::filesystem::path directory)
+{
+    if (!directory.empty()) { std::filesystem::create_directories(directory); }
+    auto &cache = spirvCacheDirectory();
+    const std::scoped_lock lock{cache.mutex};
+    cache.path = std::move(directory);
+}
+
+std::filesystem::path Shader::CacheDirectory()
+{
+    auto &cache = spirvCacheDirectory();
+    const std::scoped_lock lock{cache.mutex};
+    return cache.path;
 }
 
 // default is an empty (invalid) shader
@@ -134,22 +359,47 @@ Shader::Shader()
 {
 }
 
+void ShaderSource::reload()
+{
+    if (!isFile_) { return; }
+    auto fileBytes = readFile(filename_);
+    source_ = std::string{fileBytes.begin(), fileBytes.end()};
+}
+
 Shader::Shader(Context &ctx, ShaderSource source)
     : ctx_{&ctx}
-    , source_{source}
+    , source_{std::move(source)}
+    , type_{source_.type()}
+{
+    create(CompileToSpv(source_, false, &dependencies_));
+}
+
+Shader::Shader(Context &ctx,
+               ShaderSource source,
+               std::vector<uint32_t> spirvBinary,
+               std::vector<std::filesystem::path> includedFiles)
+    : ctx_{&ctx}
+    , source_{std::move(source)}
     , type_{source_.type()}
+    , dependencies_{std::move(includedFiles)}
 {
-    std::vector<uint32_t> spirvBinary = CompileToSpv(source, false);
+    create(std::move(spirvBinary));
+}
+
+void Shader::create(std::vector<uint32_t> spirvBinary)
+{
+    if (source_.isFile()) { dependencies_.insert(dependencies_.begin(), source_.filePath()); }
+
     if (spirvBinary.empty()) {
         throw std::runtime_error{"Could not compile shader source to SPIR-V"};
     }
 
     Magnum::Vk::ShaderCreateInfo info{Corrade::Containers::ArrayView<uint32_t>{spirvBinary}};
 
-    module_ = std::make_shared<Magnum::Vk::Shader>(ctx.device(), info);
+    module_ = std::make_shared<Magnum::Vk::Shader>(ctx_->device(), info);
     size_ = spirvBinary.size() * sizeof(uint32_t);
     nameVulkanObject(
-        ctx_->device(), *module_, fmt::format("SHDR_{}", source.filePath().filename().string()));
+        ctx_->device(), *module_, fmt::format("SHDR_{}", source_.filePath().filename().string()));
 }
 
 // vk::PipelineShaderStageCreateInfo Shader::stageCreateInfo()
@@ -0,0 +1,187 @@
+#include <Cory/Renderer/ShaderReloader.hpp>
+
+#include <Cory/Base/DetachedTask.hpp>
+#include <Cory/Base/FileWatcher.hpp>
+#include <Cory/Base/Log.hpp>
+#include <Cory/Base/Profiling.hpp>
+#include <Cory/Renderer/Context.hpp>
+#include <Cory/Renderer/PipelineCache.hpp>
+#include <Cory/Renderer/ResourceManager.hpp>
+#include <Cory/Renderer/Shader.hpp>
+
+#include <cppcoro/static_thread_pool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <thread>
+#include <unordered_set>
+
+namespace Cory {
+
+namespace {
+/// a shader that is recompiled on a worker thread
+struct ReloadJob {
+    ReloadJob(ShaderHandle shaderHandle, ShaderSource shaderSource)
+        : handle{shaderHandle}
+        , source{std::move(shaderSource)}
+    {
+    }
+
+    ShaderHandle handle;
+    ShaderSource source;
+    std::optional<Shader> shader;
+    std::string error;
+    std::atomic<bool> done{false};
+};
+
+DetachedTask compileOnWorker(cppcoro::static_thread_pool &pool,
+                             Context &ctx,
+                             std::shared_ptr<ReloadJob> job)
+{
+    co_await pool.schedule();
+    try {
+        const Cory::ScopeTimer s{"ShaderReloader/Compile"};
+        job->source.reload();
+        job->shader.emplace(ctx, job->source);
+    }
+    catch (const std::exception &e) {
+        job->error = e.what();
+    }
+    job->done.store(true, std::memory_order_release);
+    job->done.notify_all();
+}
+
+bool dependsOn(const Shader &shader, const std::vector<std::filesystem::path> &changedFiles)
+{
+    return std::ranges::any_of(shader.dependencies(), [&](const std::filesystem::path &file) {
+        std::error_code ec;
+        const auto path = std::filesystem::weakly_canonical(file, ec);
+        return !ec && std::ranges::find(changedFiles, path) != changedFiles.end();
+    });
+}
+} // namespace
+
+struct ShaderReloaderPrivate {
+    Context *ctx{};
+    bool enabled{false};
+    FileWatcher watcher;
+    // shaders whose files are watched
+    std::unordered_set<ShaderHandle> tracked;
+    std::vector<std::shared_ptr<ReloadJob>> jobs;
+    // shaders whose files changed again while they were being compiled
+    std::vector<ShaderHandle> deferred;
+    // created when reloading is enabled
+    std::unique_ptr<cppcoro::static_thread_pool> compilePool;
+
+    void watch(const Shader &shader);
+    void schedule(ShaderHandle handle);
+};
+
+ShaderReloader::ShaderReloader()
+    : data_{std::make_unique<ShaderReloaderPrivate>()}
+{
+}
+
+ShaderReloader::~ShaderReloader()
+{
+    // if data_ is empty, object is moved-from
+    if (data_) { wait(); }
+}
+
+void ShaderReloader::init(Context &ctx)
+{
+    CO_CORE_ASSERT(data_->ctx == nullptr, "ShaderReloader already initialized!");
+    data_->ctx = &ctx;
+}
+
+bool ShaderReloader::enabled() const { return data_->enabled; }
+
+void ShaderReloader::setEnabled(bool enabled)
+{
+    CO_CORE_ASSERT(data_->ctx != nullptr, "ShaderReloader was not initialized!");
+    if (enabled && data_->compilePool == nullptr) {
+        data_->compilePool = std::make_unique<cppcoro::static_thread_pool>(
+            std::max(1U, std::thread::hardware_concurrency() / 2));
+    }
+    data_->enabled = enabled;
+}
+
+void ShaderReloader::update()
+{
+    if (!data_->enabled) { return; }
+    const Cory::ScopeTimer s{"ShaderReloader/Update"};
+    auto &resources = data_->ctx->resources();
+
+    // watch the files of shaders that were created since the last update
+    const std::vector<ShaderHandle> shaders = resources.shaders();
+    std::unordered_set<ShaderHandle> tracked;
+    for (const ShaderHandle handle : shaders) {
+        if (!data_->tracked.contains(handle)) { data_->watch(resources[handle]); }
+        tracked.insert(handle);
+    }
+    data_->tracked = std::move(tracked);
+
+    const std::vector<std::filesystem::path> changedFiles = data_->watcher.poll();
+    if (!changedFiles.empty()) {
+        for (const ShaderHandle handle : shaders) {
+            if (dependsOn(resources[handle], changedFiles)) { data_->schedule(handle); }
+        }
+    }
+
+    // swap in the shaders that finished compiling
+    std::vector<ShaderHandle> reloaded;
+    std::erase_if(data_->jobs, [&](const std::shared_ptr<ReloadJob> &job) {
+        if (!job->done.load(std::memory_order_acquire)) { return false; }
+        // the shader might have been released in the meantime
+        if (job->shader && data_->tracked.contains(job->handle)) {
+            CO_CORE_INFO("Reloaded shader {}", job->source.filePath().string());
+            resources[job->handle] = std::move(*job->shader);
+            data_->watch(resources[job->handle]);
+            reloaded.push_back(job->handle);
+        }
+        else if (!job->shader) {
+            CO_CORE_ERROR("Could not reload shader {}, keeping the old one: {}",
+                          job->source.filePath().string(),
+                          job->error);
+        }
+        return true;
+    });
+
+    for (const ShaderHandle handle : std::exchange(data_->deferred, {})) {
+        if (data_->tracked.contains(handle)) { data_->schedule(handle); }
+    }
+
+    if (!reloaded.empty()) { data_->ctx->pipelines().reload(reloaded); }
+}
+
+void ShaderReloader::wait()
+{
+    for (const auto &job : data_->jobs) {
+        job->done.wait(false, std::memory_order_acquire);
+    }
+}
+
+size_t ShaderReloader::pendingCount() const { return data_->jobs.size(); }
+
+void ShaderReloaderPrivate::watch(const Shader &shader)
+{
+    for (const auto &file : shader.dependencies()) {
+        watcher.watch(file);
+    }
+}
+
+void ShaderReloaderPrivate::schedule(ShaderHandle handle)
+{
+    // the running job might have read the file before it was changed, so compile again after it
+    if (std::ranges::any_of(jobs, [&](const auto &job) { return job->handle == handle; })) {
+        if (std::ranges::find(deferred, handle) == deferred.end()) { deferred.push_back(handle); }
+        return;
+    }
+
+    auto job = std::make_shared<ReloadJob>(handle, ctx->resources()[handle].source());
+    jobs.push_back(job);
+    compileOnWorker(*compilePool, *ctx, std::move(job));
+}
+
+} // namespace Cory
@@ -4,6 +4,10 @@
 #include <Cory/Base/Log.hpp>
 #include <Cory/Renderer/APIConversion.hpp>
 #include <Cory/Renderer/Context.hpp>
+#include <Cory/Renderer/MemoryDefragmenter.hpp>
+#include <Cory/Renderer/PipelineCache.hpp>
+#include <Cory/Renderer/ResourceManager.hpp>
+#include <Cory/Renderer/ShaderReloader.hpp>
 #include <Cory/Renderer/VulkanUtils.hpp>
 
 #include <Magnum/Vk/CommandBuffer.h>
@@ -175,13 +179,26 @@ FrameContext Swapchain::nextImage()
     fc.frameNumber = nextFrameNumber_;
     fc.shouldRecreateSwapchain = false;
 
-    // wait for the fence of the previous frame operating on that image
-    if (imageFences_[fc.index] != nullptr) { imageFences_[fc.index]->wait(); }
+    // wait for the fence of the previous frame operating on that image - the fence also covers
+    // all frames submitted before it, so the resources released in them can be destroyed
+    if (imageFences_[fc.index] != nullptr) {
+        imageFences_[fc.index]->wait();
+        const auto fenceIndex = imageFences_[fc.index] - inFlightFences_.data();
+        ctx_->resources().collect(fenceFrames_[fenceIndex]);
+    }
 
     // assign the image a new fence and reset it
     imageFences_[fc.index] = &inFlightFences_[nextFrameIndex];
     fc.inFlight = &inFlightFences_[nextFrameIndex];
     fc.inFlight->reset();
+    fenceFrames_[nextFrameIndex] = ctx_->resources().beginFrame();
+
+    // the per-frame work of the context's services, once per frame no matter how many
+    // framegraphs the application records. shaders are swapped before the pipelines, so the
+    // rebuilds of the pipelines using them start right away
+    ctx_->shaderReloader().update();
+    ctx_->pipelines().nextFrame();
+    ctx_->defragmenter().nextFrame();
 
     // assign the semaphores to the struct
     fc.inFlight = &inFlightFences_[nextFrameIndex];
@@ -261,6 +278,8 @@ void Swapchain::createSyncObjects()
             ctx_->createFence(fmt::format("FNCE_Swapchain[{}]_InFlight", i), FenceCreateMode::Signaled));
     }
 
+    fenceFrames_.resize(maxFramesInFlight_);
+
     // initialize an array of (empty) fences, one for each image in the swap chain
     imageFences_.resize(imageViews_.size(), nullptr);
 }
@@ -7,6 +7,8 @@
 //     values
 //   - C++ify the interface, replacing count+pointer with std::span where applicable
 //   - Rename enum values to avoid SCREAMING_SNAKE_CASE in favor of CamelCase + scoped enums
+//   - Add synchronization2 variants (CmdPipelineBarrier2, CmdSetEvent2, CmdWaitEvents2) with
+//     per-barrier stage masks
 
 // The library is originally under the MIT license:
 // Copyright (c) 2017-2019 Tobias Hector
@@ -34,6 +36,7 @@
 #include <Magnum/Vk/Device.h>
 #include <array>
 #include <gsl/narrow>
+#include <memory_resource>
 
 //// Optional Error Checking ////
 
@@ -62,26 +65,6 @@ a valid range.
 */
 #define SYNC_ERROR_CHECK_ACCESS_TYPE_IN_RANGE
 #endif
-//// Temporary Memory Allocation ////
-/*
-Override these if you can't afford the stack space or just want to use a
-custom temporary allocator.
-These are currently used exclusively to allocate Vulkan memory barriers in
-the API, one for each Buffer or Image barrier passed into the pipeline and
-event functions.
-May consider other allocation strategies in future.
-*/
-
-// Alloca inclusion code below copied from
-// https://github.com/nothings/stb/blob/master/stb_vorbis.c
-
-// find definition of alloca if it's not in stdlib.h:
-#if defined(_MSC_VER) || defined(__MINGW32__)
-#include <malloc.h>
-#endif
-#if defined(__linux__) || defined(__linux) || defined(__EMSCRIPTEN__)
-#include <alloca.h>
-#endif
 
 #if defined(SYNC_ERROR_CHECK_ACCESS_TYPE_IN_RANGE) ||                                              \
     defined(SYNC_ERROR_CHECK_COULD_USE_GLOBAL_BARRIER) ||                                          \
@@ -89,14 +72,6 @@ May consider other allocation strategies in future.
 #include <assert.h>
 #endif
 
-#if !defined(SYNC_TEMP_ALLOC)
-#define SYNC_TEMP_ALLOC(size) (alloca(size))
-#endif
-
-#if !defined(SYNC_TEMP_FREE)
-#define SYNC_TEMP_FREE(x) ((void)(x))
-#endif
-
 namespace Cory::Sync {
 
 struct AccessInfo {
@@ -367,12 +342,156 @@ static_assert(AccessMap.back().stageMask == VK_PIPELINE_STAGE_ALL_COMMANDS_BIT &
                   (VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT) &&
               AccessMap.back().imageLayout == VK_IMAGE_LAYOUT_GENERAL);
 
+namespace {
+/*
+The translation of a barrier from a single previous access to a single next
+access (with optimal layouts) - by far the most common kind of barrier.
+*/
+struct TransitionInfo {
+    VkPipelineStageFlags srcStageMask;
+    VkPipelineStageFlags dstStageMask;
+    VkAccessFlags srcAccessMask;
+    VkAccessFlags dstAccessMask;
+    VkImageLayout oldLayout;
+    VkImageLayout newLayout;
+};
+
+constexpr uint32_t AccessTypeCount = static_cast<uint32_t>(AccessType::NUM_ACCESS_TYPES);
+
+// precomputed from AccessMap with the same rules as the generic translation functions below
+constexpr auto TransitionTable = []() {
+    std::array<std::array<TransitionInfo, AccessTypeCount>, AccessTypeCount> table{};
+    for (uint32_t prev = 0; prev < AccessTypeCount; ++prev) {
+        const AccessInfo &prevInfo = AccessMap[prev];
+        const bool prevIsWrite = prev > static_cast<uint32_t>(AccessType::END_OF_READ_ACCESS);
+        for (uint32_t next = 0; next < AccessTypeCount; ++next) {
+            const AccessInfo &nextInfo = AccessMap[next];
+            TransitionInfo &transition = table[prev][next];
+
+            transition.srcStageMask = prevInfo.stageMask != 0
+                                          ? prevInfo.stageMask
+                                          : VkPipelineStageFlags{VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT};
+            transition.dstStageMask =
+                nextInfo.stageMask != 0
+                    ? nextInfo.stageMask
+                    : VkPipelineStageFlags{VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT};
+            // availability operations for writes only, and visibility operations only if there
+            // was something made available - WAR hazards only need an execution dependency
+            transition.srcAccessMask = prevIsWrite ? prevInfo.accessMask : 0;
+            transition.dstAccessMask = transition.srcAccessMask != 0 ? nextInfo.accessMask : 0;
+            transition.oldLayout = prevInfo.imageLayout;
+            transition.newLayout = nextInfo.imageLayout;
+        }
+    }
+    return table;
+}();
+
+static_assert(TransitionTable[static_cast<uint32_t>(AccessType::ColorAttachmentWrite)]
+                             [static_cast<uint32_t>(AccessType::TransferRead)]
+                                 .dstAccessMask == VK_ACCESS_TRANSFER_READ_BIT);
+static_assert(TransitionTable[static_cast<uint32_t>(AccessType::TransferRead)]
+                             [static_cast<uint32_t>(AccessType::TransferWrite)]
+                                 .dstAccessMask == 0);
+
+/*
+Look up the precomputed translation if the barrier goes from at most one
+access to exactly one access, or nullptr if the generic translation is
+needed.
+*/
+const TransitionInfo *LookupTransition(std::span<const AccessType> prevAccesses,
+                                       std::span<const AccessType> nextAccesses)
+{
+    if (prevAccesses.size() > 1 || nextAccesses.size() != 1) { return nullptr; }
+    const AccessType prevAccess = prevAccesses.empty() ? AccessType::None : prevAccesses[0];
+
+#ifdef SYNC_ERROR_CHECK_ACCESS_TYPE_IN_RANGE
+    assert(prevAccess < AccessType::NUM_ACCESS_TYPES);
+    assert(nextAccesses[0] < AccessType::NUM_ACCESS_TYPES);
+#endif
+
+    return &TransitionTable[static_cast<uint32_t>(prevAccess)]
+                           [static_cast<uint32_t>(nextAccesses[0])];
+}
+
+/*
+Temporary storage for the translated barriers: carved from the scratch
+memory provided by the caller, and only allocated from the default memory
+resource if that is not big enough.
+*/
+class ScratchArena {
+  public:
+    explicit ScratchArena(std::span<std::byte> scratch)
+        : resource_{scratch.data(), scratch.size()}
+    {
+    }
+
+    template <typename T> T *allocate(size_t count)
+    {
+        if (count == 0) { return nullptr; }
+        return std::pmr::polymorphic_allocator<T>{&resource_}.allocate(count);
+    }
+
+  private:
+    std::pmr::monotonic_buffer_resource resource_;
+};
+} // namespace
+
 
 VkImageLayout GetVkImageLayout(AccessType access)
 {
     return AccessMap[static_cast<uint32_t>(access)].imageLayout;
 }
 
+VkImageUsageFlags GetVkImageUsage(AccessType access)
+{
+    switch (access) {
+    case AccessType::VertexShaderReadSampledImageOrUniformTexelBuffer:
+    case AccessType::TessellationControlShaderReadSampledImageOrUniformTexelBuffer:
+    case AccessType::TessellationEvaluationShaderReadSampledImageOrUniformTexelBuffer:
+    case AccessType::GeometryShaderReadSampledImageOrUniformTexelBuffer:
+    case AccessType::FragmentShaderReadSampledImageOrUniformTexelBuffer:
+    case AccessType::ComputeShaderReadSampledImageOrUniformTexelBuffer:
+    case AccessType::AnyShaderReadSampledImageOrUniformTexelBuffer:
+        return VK_IMAGE_USAGE_SAMPLED_BIT;
+    case AccessType::VertexShaderReadOther:
+    case AccessType::TessellationControlShaderReadOther:
+    case AccessType::TessellationEvaluationShaderReadOther:
+    case AccessType::GeometryShaderReadOther:
+    case AccessType::FragmentShaderReadOther:
+    case AccessType::ComputeShaderReadOther:
+    case AccessType::AnyShaderReadOther:
+    case AccessType::VertexShaderWrite:
+    case AccessType::TessellationControlShaderWrite:
+    case AccessType::TessellationEvaluationShaderWrite:
+    case AccessType::GeometryShaderWrite:
+    case AccessType::FragmentShaderWrite:
+    case AccessType::ComputeShaderWrite:
+    case AccessType::AnyShaderWrite:
+        return VK_IMAGE_USAGE_STORAGE_BIT;
+    case AccessType::FragmentShaderReadColorInputAttachment:
+    case AccessType::FragmentShaderReadDepthStencilInputAttachment:
+        return VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+    case AccessType::ColorAttachmentRead:
+    case AccessType::ColorAttachmentWrite:
+    case AccessType::ColorAttachmentReadWrite:
+        return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    case AccessType::DepthStencilAttachmentRead:
+    case AccessType::DepthStencilAttachmentWrite:
+    case AccessType::DepthAttachmentWriteStencilReadOnly:
+    case AccessType::StencilAttachmentWriteDepthReadOnly:
+        return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    case AccessType::TransferRead:
+        return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    case AccessType::TransferWrite:
+        return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    case AccessType::General:
+        return VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT |
+               VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    default:
+        return 0;
+    }
+}
+
 void GetAccessInfo(std::span<const AccessType> accesses,
                    VkPipelineStageFlags *pStageMask,
                    VkAccessFlags *pAccessMask,
@@ -426,6 +545,15 @@ void GetVulkanMemoryBarrier(const GlobalBarrier &thBarrier,
     pVkBarrier->srcAccessMask = 0;
     pVkBarrier->dstAccessMask = 0;
 
+    if (const TransitionInfo *pTransition =
+            LookupTransition(thBarrier.prevAccesses, thBarrier.nextAccesses)) {
+        *pSrcStages = pTransition->srcStageMask;
+        *pDstStages = pTransition->dstStageMask;
+        pVkBarrier->srcAccessMask = pTransition->srcAccessMask;
+        pVkBarrier->dstAccessMask = pTransition->dstAccessMask;
+        return;
+    }
+
     for (uint32_t i = 0; i < thBarrier.prevAccesses.size(); ++i) {
         AccessType prevAccess = thBarrier.prevAccesses[i];
         const AccessInfo *pPrevAccessInfo = &AccessMap[static_cast<uint32_t>(prevAccess)];
@@ -495,6 +623,15 @@ void GetVulkanBufferMemoryBarrier(const BufferBarrier &thBarrier,
     assert(pVkBarrier->srcQueueFamilyIndex != pVkBarrier->dstQueueFamilyIndex);
 #endif
 
+    if (const TransitionInfo *pTransition =
+            LookupTransition(thBarrier.prevAccesses, thBarrier.nextAccesses)) {
+        *pSrcStages = pTransition->srcStageMask;
+        *pDstStages = pTransition->dstStageMask;
+        pVkBarrier->srcAccessMask = pTransition->srcAccessMask;
+        pVkBarrier->dstAccessMask = pTransition->dstAccessMask;
+        return;
+    }
+
     for (uint32_t i = 0; i < thBarrier.prevAccesses.size(); ++i) {
         AccessType prevAccess = thBarrier.prevAccesses[i];
         const AccessInfo *pPrevAccessInfo = &AccessMap[static_cast<uint32_t>(prevAccess)];
@@ -562,6 +699,24 @@ void GetVulkanImageMemoryBarrier(const ImageBarrier &thBarrier,
     pVkBarrier->oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     pVkBarrier->newLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
+    // the precomputed transitions only cover optimal layouts, the general layout needs special
+    // handling for presentation
+    if (thBarrier.prevLayout == ImageLayout::Optimal &&
+        thBarrier.nextLayout == ImageLayout::Optimal) {
+        if (const TransitionInfo *pTransition =
+                LookupTransition(thBarrier.prevAccesses, thBarrier.nextAccesses)) {
+            *pSrcStages = pTransition->srcStageMask;
+            *pDstStages = pTransition->dstStageMask;
+            pVkBarrier->srcAccessMask = pTransition->srcAccessMask;
+            pVkBarrier->dstAccessMask = pTransition->dstAccessMask;
+            pVkBarrier->oldLayout = (thBarrier.discardContents == VK_TRUE)
+                                        ? VK_IMAGE_LAYOUT_UNDEFINED
+                                        : pTransition->oldLayout;
+            pVkBarrier->newLayout = pTransition->newLayout;
+            return;
+        }
+    }
+
     for (uint32_t i = 0; i < thBarrier.prevAccesses.size(); ++i) {
         AccessType prevAccess = thBarrier.prevAccesses[i];
         const AccessInfo *pPrevAccessInfo = &AccessMap[static_cast<uint32_t>(prevAccess)];
@@ -670,8 +825,10 @@ void CmdPipelineBarrier(Magnum::Vk::Device &device,
                         VkCommandBuffer commandBuffer,
                         const GlobalBarrier *pGlobalBarrier,
                         std::span<const BufferBarrier> bufferBarriers,
-                        std::span<const ImageBarrier> imageBarriers)
+                        std::span<const ImageBarrier> imageBarriers,
+                        std::span<std::byte> scratch)
 {
+    ScratchArena arena{scratch};
     VkMemoryBarrier memoryBarrier;
     // Vulkan pipeline barrier command parameters
     //                     commandBuffer;
@@ -696,8 +853,7 @@ void CmdPipelineBarrier(Magnum::Vk::Device &device,
 
     // Buffer memory barriers
     if (bufferMemoryBarrierCount > 0) {
-        pBufferMemoryBarriers = (VkBufferMemoryBarrier *)SYNC_TEMP_ALLOC(
-            sizeof(VkBufferMemoryBarrier) * bufferMemoryBarrierCount);
+        pBufferMemoryBarriers = arena.allocate<VkBufferMemoryBarrier>(bufferMemoryBarrierCount);
 
         VkPipelineStageFlags tempSrcStageMask = 0;
         VkPipelineStageFlags tempDstStageMask = 0;
@@ -711,8 +867,7 @@ void CmdPipelineBarrier(Magnum::Vk::Device &device,
 
     // Image memory barriers
     if (imageMemoryBarrierCount > 0) {
-        pImageMemoryBarriers = (VkImageMemoryBarrier *)SYNC_TEMP_ALLOC(
-            sizeof(VkImageMemoryBarrier) * imageMemoryBarrierCount);
+        pImageMemoryBarriers = arena.allocate<VkImageMemoryBarrier>(imageMemoryBarrierCount);
 
         VkPipelineStageFlags tempSrcStageMask = 0;
         VkPipelineStageFlags tempDstStageMask = 0;
@@ -734,9 +889,6 @@ void CmdPipelineBarrier(Magnum::Vk::Device &device,
                                pBufferMemoryBarriers,
                                imageMemoryBarrierCount,
                                pImageMemoryBarriers);
-
-    SYNC_TEMP_FREE(pBufferMemoryBarriers);
-    SYNC_TEMP_FREE(pImageMemoryBarriers);
 }
 
 void CmdSetEvent(Magnum::Vk::Device &device,
@@ -788,8 +940,10 @@ void CmdWaitEvents(Magnum::Vk::Device &device,
                    std::span<const VkEvent> events,
                    const GlobalBarrier *pGlobalBarrier,
                    std::span<const BufferBarrier> bufferBarriers,
-                   std::span<const ImageBarrier> imageBarriers)
+                   std::span<const ImageBarrier> imageBarriers,
+                   std::span<std::byte> scratch)
 {
+    ScratchArena arena{scratch};
     VkMemoryBarrier memoryBarrier;
     // Vulkan pipeline barrier command parameters
     //                     commandBuffer;
@@ -816,8 +970,7 @@ void CmdWaitEvents(Magnum::Vk::Device &device,
 
     // Buffer memory barriers
     if (bufferMemoryBarrierCount > 0) {
-        pBufferMemoryBarriers = (VkBufferMemoryBarrier *)SYNC_TEMP_ALLOC(
-            sizeof(VkBufferMemoryBarrier) * bufferMemoryBarrierCount);
+        pBufferMemoryBarriers = arena.allocate<VkBufferMemoryBarrier>(bufferMemoryBarrierCount);
 
         VkPipelineStageFlags tempSrcStageMask = 0;
         VkPipelineStageFlags tempDstStageMask = 0;
@@ -831,8 +984,7 @@ void CmdWaitEvents(Magnum::Vk::Device &device,
 
     // Image memory barriers
     if (imageMemoryBarrierCount > 0) {
-        pImageMemoryBarriers = (VkImageMemoryBarrier *)SYNC_TEMP_ALLOC(
-            sizeof(VkImageMemoryBarrier) * imageMemoryBarrierCount);
+        pImageMemoryBarriers = arena.allocate<VkImageMemoryBarrier>(imageMemoryBarrierCount);
 
         VkPipelineStageFlags tempSrcStageMask = 0;
         VkPipelineStageFlags tempDstStageMask = 0;
@@ -855,8 +1007,209 @@ void CmdWaitEvents(Magnum::Vk::Device &device,
                           pBufferMemoryBarriers,
                           imageMemoryBarrierCount,
                           pImageMemoryBarriers);
+}
+
+namespace {
+/*
+The legacy translation substitutes TOP_OF_PIPE and BOTTOM_OF_PIPE for an empty
+source or destination scope, which synchronization2 expresses as NONE without
+any accesses. No access type maps to either stage on its own, so they only ever
+come from that substitution.
+*/
+template <typename VkBarrier2>
+void SetEmptyScopesToNone(VkBarrier2 *pVkBarrier)
+{
+    if (pVkBarrier->srcStageMask == VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT) {
+        pVkBarrier->srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+        pVkBarrier->srcAccessMask = VK_ACCESS_2_NONE;
+    }
+    if (pVkBarrier->dstStageMask == VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT) {
+        pVkBarrier->dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+        pVkBarrier->dstAccessMask = VK_ACCESS_2_NONE;
+    }
+}
+} // namespace
+
+void GetVulkanMemoryBarrier2(const GlobalBarrier &thBarrier, VkMemoryBarrier2 *pVkBarrier)
+{
+    // the legacy stage and access bits are identical to the lower 32 bits of their sync2
+    // counterparts, the only difference is that the stages are kept per barrier
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+    VkMemoryBarrier barrier;
+    GetVulkanMemoryBarrier(thBarrier, &srcStages, &dstStages, &barrier);
+
+    *pVkBarrier = VkMemoryBarrier2{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+                                   .pNext = nullptr,
+                                   .srcStageMask = srcStages,
+                                   .srcAccessMask = barrier.srcAccessMask,
+                                   .dstStageMask = dstStages,
+                                   .dstAccessMask = barrier.dstAccessMask};
+    SetEmptyScopesToNone(pVkBarrier);
+}
+
+void GetVulkanBufferMemoryBarrier2(const BufferBarrier &thBarrier,
+                                   VkBufferMemoryBarrier2 *pVkBarrier)
+{
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+    VkBufferMemoryBarrier barrier;
+    GetVulkanBufferMemoryBarrier(thBarrier, &srcStages, &dstStages, &barrier);
+
+    *pVkBarrier = VkBufferMemoryBarrier2{.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+                                         .pNext = nullptr,
+                                         .srcStageMask = srcStages,
+                                         .srcAccessMask = barrier.srcAccessMask,
+                                         .dstStageMask = dstStages,
+                                         .dstAccessMask = barrier.dstAccessMask,
+                                         .srcQueueFamilyIndex = barrier.srcQueueFamilyIndex,
+                                         .dstQueueFamilyIndex = barrier.dstQueueFamilyIndex,
+                                         .buffer = barrier.buffer,
+                                         .offset = barrier.offset,
+                                         .size = barrier.size};
+    SetEmptyScopesToNone(pVkBarrier);
+}
+
+void GetVulkanImageMemoryBarrier2(const ImageBarrier &thBarrier,
+                                  VkImageMemoryBarrier2 *pVkBarrier)
+{
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+    VkImageMemoryBarrier barrier;
+    GetVulkanImageMemoryBarrier(thBarrier, &srcStages, &dstStages, &barrier);
+
+    *pVkBarrier = VkImageMemoryBarrier2{.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                                        .pNext = nullptr,
+                                        .srcStageMask = srcStages,
+                                        .srcAccessMask = barrier.srcAccessMask,
+                                        .dstStageMask = dstStages,
+                                        .dstAccessMask = barrier.dstAccessMask,
+                                        .oldLayout = barrier.oldLayout,
+                                        .newLayout = barrier.newLayout,
+                                        .srcQueueFamilyIndex = barrier.srcQueueFamilyIndex,
+                                        .dstQueueFamilyIndex = barrier.dstQueueFamilyIndex,
+                                        .image = barrier.image,
+                                        .subresourceRange = barrier.subresourceRange};
+    SetEmptyScopesToNone(pVkBarrier);
+}
+
+namespace {
+/*
+Translates a set of barriers into the given storage, and points the
+VkDependencyInfo to it.
+*/
+void GetVulkanDependencyInfo(const GlobalBarrier *pGlobalBarrier,
+                             std::span<const BufferBarrier> bufferBarriers,
+                             std::span<const ImageBarrier> imageBarriers,
+                             VkMemoryBarrier2 *pMemoryBarrier,
+                             VkBufferMemoryBarrier2 *pBufferMemoryBarriers,
+                             VkImageMemoryBarrier2 *pImageMemoryBarriers,
+                             VkDependencyInfo *pDependencyInfo)
+{
+    if (pGlobalBarrier != nullptr) { GetVulkanMemoryBarrier2(*pGlobalBarrier, pMemoryBarrier); }
+    for (uint32_t i = 0; i < bufferBarriers.size(); ++i) {
+        GetVulkanBufferMemoryBarrier2(bufferBarriers[i], &pBufferMemoryBarriers[i]);
+    }
+    for (uint32_t i = 0; i < imageBarriers.size(); ++i) {
+        GetVulkanImageMemoryBarrier2(imageBarriers[i], &pImageMemoryBarriers[i]);
+    }
+
+    *pDependencyInfo = VkDependencyInfo{
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .pNext = nullptr,
+        .dependencyFlags = 0,
+        .memoryBarrierCount = (pGlobalBarrier != nullptr) ? 1u : 0u,
+        .pMemoryBarriers = (pGlobalBarrier != nullptr) ? pMemoryBarrier : nullptr,
+        .bufferMemoryBarrierCount = gsl::narrow<uint32_t>(bufferBarriers.size()),
+        .pBufferMemoryBarriers = bufferBarriers.empty() ? nullptr : pBufferMemoryBarriers,
+        .imageMemoryBarrierCount = gsl::narrow<uint32_t>(imageBarriers.size()),
+        .pImageMemoryBarriers = imageBarriers.empty() ? nullptr : pImageMemoryBarriers};
+}
+} // namespace
+
+void CmdPipelineBarrier2(Magnum::Vk::Device &device,
+                         VkCommandBuffer commandBuffer,
+                         const GlobalBarrier *pGlobalBarrier,
+                         std::span<const BufferBarrier> bufferBarriers,
+                         std::span<const ImageBarrier> imageBarriers,
+                         std::span<std::byte> scratch)
+{
+    ScratchArena arena{scratch};
+    VkMemoryBarrier2 memoryBarrier;
+    VkDependencyInfo dependencyInfo;
+    auto *pBufferMemoryBarriers = arena.allocate<VkBufferMemoryBarrier2>(bufferBarriers.size());
+    auto *pImageMemoryBarriers = arena.allocate<VkImageMemoryBarrier2>(imageBarriers.size());
+
+    GetVulkanDependencyInfo(pGlobalBarrier,
+                            bufferBarriers,
+                            imageBarriers,
+                            &memoryBarrier,
+                            pBufferMemoryBarriers,
+                            pImageMemoryBarriers,
+                            &dependencyInfo);
+    device->CmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
+void CmdSetEvent2(Magnum::Vk::Device &device,
+                  VkCommandBuffer commandBuffer,
+                  const EventDependency &dependency,
+                  std::span<std::byte> scratch)
+{
+    ScratchArena arena{scratch};
+    VkMemoryBarrier2 memoryBarrier;
+    VkDependencyInfo dependencyInfo;
+    auto *pBufferMemoryBarriers =
+        arena.allocate<VkBufferMemoryBarrier2>(dependency.bufferBarriers.size());
+    auto *pImageMemoryBarriers =
+        arena.allocate<VkImageMemoryBarrier2>(dependency.imageBarriers.size());
+
+    GetVulkanDependencyInfo(dependency.pGlobalBarrier,
+                            dependency.bufferBarriers,
+                            dependency.imageBarriers,
+                            &memoryBarrier,
+                            pBufferMemoryBarriers,
+                            pImageMemoryBarriers,
+                            &dependencyInfo);
+    device->CmdSetEvent2(commandBuffer, dependency.event, &dependencyInfo);
+}
+
+void CmdWaitEvents2(Magnum::Vk::Device &device,
+                    VkCommandBuffer commandBuffer,
+                    std::span<const EventDependency> dependencies,
+                    std::span<std::byte> scratch)
+{
+    ScratchArena arena{scratch};
+    const auto eventCount = gsl::narrow<uint32_t>(dependencies.size());
+    size_t bufferBarrierCount = 0;
+    size_t imageBarrierCount = 0;
+    for (const EventDependency &dependency : dependencies) {
+        bufferBarrierCount += dependency.bufferBarriers.size();
+        imageBarrierCount += dependency.imageBarriers.size();
+    }
+
+    auto *pEvents = arena.allocate<VkEvent>(eventCount);
+    auto *pDependencyInfos = arena.allocate<VkDependencyInfo>(eventCount);
+    auto *pMemoryBarriers = arena.allocate<VkMemoryBarrier2>(eventCount);
+    auto *pBufferMemoryBarriers = arena.allocate<VkBufferMemoryBarrier2>(bufferBarrierCount);
+    auto *pImageMemoryBarriers = arena.allocate<VkImageMemoryBarrier2>(imageBarrierCount);
+
+    // the barriers of all events are laid out back to back
+    size_t bufferOffset = 0;
+    size_t imageOffset = 0;
+    for (uint32_t i = 0; i < eventCount; ++i) {
+        const EventDependency &dependency = dependencies[i];
+        pEvents[i] = dependency.event;
+        GetVulkanDependencyInfo(dependency.pGlobalBarrier,
+                                dependency.bufferBarriers,
+                                dependency.imageBarriers,
+                                &pMemoryBarriers[i],
+                                pBufferMemoryBarriers + bufferOffset,
+                                pImageMemoryBarriers + imageOffset,
+                                &pDependencyInfos[i]);
+        bufferOffset += dependency.bufferBarriers.size();
+        imageOffset += dependency.imageBarriers.size();
+    }
 
-    SYNC_TEMP_FREE(pBufferMemoryBarriers);
-    SYNC_TEMP_FREE(pImageMemoryBarriers);
+    device->CmdWaitEvents2(commandBuffer, eventCount, pEvents, pDependencyInfos);
 }
 } // namespace Cory::Sync
\ No newline at end of file
@@ -39,11 +39,11 @@ UniformBufferObjectBase::UniformBufferObjectBase(Context &ctx,
     buffer_ = ctx_->resources().createBuffer(
         "Uniform Buffer", size, BufferUsageBits::UniformBuffer, MemoryFlagBits::HostVisible);
 
-    // map the memory
-    VkDeviceMemory memory = ctx_->resources()[buffer_].dedicatedMemory();
-    VkResult r = ctx_->device()->MapMemory(
-        ctx_->device(), memory, 0, VK_WHOLE_SIZE, 0, (void **)&mappedMemory_);
-    THROW_ON_ERROR(r, "Mapping memory for uniform buffer failed");
+    // host-visible buffers are persistently mapped by the allocator
+    mappedMemory_ = ctx_->resources().memoryInfo(buffer_).mappedData;
+    if (mappedMemory_ == nullptr) {
+        throw std::runtime_error{"Mapping memory for uniform buffer failed"};
+    }
 }
 
 void swap(UniformBufferObjectBase &lhs, UniformBufferObjectBase &rhs) noexcept
@@ -72,10 +72,7 @@ UniformBufferObjectBase &UniformBufferObjectBase::operator=(UniformBufferObjectB
 UniformBufferObjectBase::~UniformBufferObjectBase()
 {
     if (buffer_.valid()) {
-        // unmap memory
-        VkDeviceMemory memory = ctx_->resources()[buffer_].dedicatedMemory();
-        ctx_->device()->UnmapMemory(ctx_->device(), memory);
-        // release buffer
+        // release buffer - the memory is unmapped when it is freed
         ctx_->resources().release(buffer_);
     }
 }
@@ -93,13 +90,8 @@ void UniformBufferObjectBase::flushInternal(gsl::index instance)
 
 void UniformBufferObjectBase::flushInternal(VkDeviceSize offset, VkDeviceSize size)
 {
-    VkDeviceMemory memory = ctx_->resources()[buffer_].dedicatedMemory();
-    VkMappedMemoryRange mappedRange = {.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
-                                       .memory = memory,
-                                       .offset = offset,
-                                       .size = size};
-    auto r = ctx_->device()->FlushMappedMemoryRanges(ctx_->device(), 1, &mappedRange);
-    THROW_ON_ERROR(r, "Error flushing UBO memory!");
+    // the offset is relative to the buffer, the allocator adds the offset of its memory block
+    ctx_->resources().flush(buffer_, offset, size);
 }
 
 std::byte *UniformBufferObjectBase::instanceAt(gsl::index instance)
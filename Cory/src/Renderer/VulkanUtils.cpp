@@ -1,5 +1,6 @@
 #include <Cory/Renderer/VulkanUtils.hpp>
 
+#include <Cory/Renderer/GpuEvent.hpp>
 #include <Cory/Renderer/Semaphore.hpp>
 
 #include <Magnum/Vk/Buffer.h>
@@ -11,6 +12,7 @@
 #include <Magnum/Vk/Image.h>
 #include <Magnum/Vk/ImageView.h>
 #include <Magnum/Vk/Instance.h>
+#include <Magnum/Vk/Memory.h>
 #include <Magnum/Vk/Pipeline.h>
 #include <Magnum/Vk/Queue.h>
 #include <Magnum/Vk/Sampler.h>
@@ -41,6 +43,7 @@ template <typename VulkanObjectHandle> VkObjectType getVulkanObjectType()
         return VK_OBJECT_TYPE_SEMAPHORE;
     }
     if constexpr (std::is_same_v<VulkanObjectHandle, VkFence>) { return VK_OBJECT_TYPE_FENCE; }
+    if constexpr (std::is_same_v<VulkanObjectHandle, VkEvent>) { return VK_OBJECT_TYPE_EVENT; }
     if constexpr (std::is_same_v<VulkanObjectHandle, VkCommandBuffer>) {
         return VK_OBJECT_TYPE_COMMAND_BUFFER;
     }
@@ -61,6 +64,9 @@ template <typename VulkanObjectHandle> VkObjectType getVulkanObjectType()
     if constexpr (std::is_same_v<VulkanObjectHandle, VkDescriptorSet>) {
         return VK_OBJECT_TYPE_DESCRIPTOR_SET;
     }
+    if constexpr (std::is_same_v<VulkanObjectHandle, VkDeviceMemory>) {
+        return VK_OBJECT_TYPE_DEVICE_MEMORY;
+    }
 }
 
 template <typename DeviceHandle, typename VulkanObjectHandle>
@@ -101,6 +107,7 @@ INSTANTIATE(VkSwapchainKHR);
 INSTANTIATE_WRAPPED(Magnum::Vk::Queue);
 INSTANTIATE_WRAPPED(BasicVkObjectWrapper<VkSemaphore>);
 INSTANTIATE_WRAPPED(Magnum::Vk::Fence);
+INSTANTIATE(VkEvent);
 INSTANTIATE_WRAPPED(Magnum::Vk::CommandBuffer);
 INSTANTIATE(VkImage);
 INSTANTIATE_WRAPPED(Magnum::Vk::Image);
@@ -110,5 +117,6 @@ INSTANTIATE_WRAPPED(Magnum::Vk::Shader);
 INSTANTIATE_WRAPPED(Magnum::Vk::Sampler);
 INSTANTIATE_WRAPPED(Magnum::Vk::DescriptorSetLayout);
 INSTANTIATE_WRAPPED(Magnum::Vk::DescriptorSet);
+INSTANTIATE_WRAPPED(Magnum::Vk::Memory);
 
 } // namespace Cory
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <Cory/Framegraph/AliasingPlanner.hpp>
+
+#include <vector>
+
+using namespace Cory;
+
+TEST_CASE("Memory aliasing of transient resources", "[Cory/Framegraph/AliasingPlanner]")
+{
+    SECTION("Resources with overlapping lifetimes get disjoint memory")
+    {
+        const std::vector<AliasingRequest> requests{
+            {.lifetime = {0, 2}, .size = 100, .alignment = 1},
+            {.lifetime = {1, 3}, .size = 100, .alignment = 1},
+        };
+        const auto plan = planMemoryAliasing(requests);
+        CHECK(plan.heapSize == 200);
+        CHECK(plan.offsets[0] != plan.offsets[1]);
+        CHECK(plan.predecessors[0].empty());
+        CHECK(plan.predecessors[1].empty());
+    }
+
+    SECTION("Resources with disjoint lifetimes share memory")
+    {
+        const std::vector<AliasingRequest> requests{
+            {.lifetime = {0, 1}, .size = 100, .alignment = 1},
+            {.lifetime = {2, 3}, .size = 80, .alignment = 1},
+        };
+        const auto plan = planMemoryAliasing(requests);
+        CHECK(plan.heapSize == 100);
+        CHECK(plan.offsets[0] == 0);
+        CHECK(plan.offsets[1] == 0);
+        CHECK(plan.predecessors[0].empty());
+        CHECK(plan.predecessors[1] == std::vector<uint32_t>{0});
+    }
+
+    SECTION("Gaps between live resources are reused and alignment is respected")
+    {
+        const std::vector<AliasingRequest> requests{
+            {.lifetime = {0, 4}, .size = 100, .alignment = 64},
+            {.lifetime = {0, 1}, .size = 100, .alignment = 64},
+            {.lifetime = {0, 4}, .size = 100, .alignment = 64},
+            {.lifetime = {2, 4}, .size = 60, .alignment = 64},
+        };
+        const auto plan = planMemoryAliasing(requests);
+        for (const auto offset : plan.offsets) {
+            CHECK(offset % 64 == 0);
+        }
+        // resource 3 should go into the memory of resource 1, which is dead by then
+        CHECK(plan.offsets[3] == plan.offsets[1]);
+        CHECK(plan.predecessors[3] == std::vector<uint32_t>{1});
+        CHECK(plan.heapSize == 356);
+    }
+
+    SECTION("Resources that are alive until the end of the frame are never aliased")
+    {
+        const std::vector<AliasingRequest> requests{
+            {.lifetime = {0, ResourceLifetime::END_OF_FRAME}, .size = 100, .alignment = 1},
+            {.lifetime = {5, 6}, .size = 100, .alignment = 1},
+        };
+        const auto plan = planMemoryAliasing(requests);
+        CHECK(plan.heapSize == 200);
+    }
+}
@@ -0,0 +1,51 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <Cory/Base/FileWatcher.hpp>
+
+#include <chrono>
+#include <filesystem>
+
+#include "TestUtils.hpp"
+
+using namespace Cory;
+
+TEST_CASE("FileWatcher", "[Cory/Base]")
+{
+    const auto directory = std::filesystem::temp_directory_path() / "Cory_FileWatcher_Test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    const auto watchedFile = directory / "watched.txt";
+    const auto otherFile = directory / "other.txt";
+    testing::writeAndTouch(watchedFile, "a");
+    testing::writeAndTouch(otherFile, "a");
+
+    FileWatcher watcher;
+    watcher.watch(watchedFile);
+    watcher.watch(directory / "." / "watched.txt");
+    CHECK(watcher.size() == 1);
+    CHECK(watcher.isWatched(watchedFile));
+    CHECK_FALSE(watcher.isWatched(otherFile));
+    CHECK(watcher.poll().empty());
+
+    SECTION("Modified files are reported once")
+    {
+        testing::writeAndTouch(watchedFile, "b");
+        testing::writeAndTouch(otherFile, "b");
+        const auto changed = watcher.poll();
+        REQUIRE(changed.size() == 1);
+        CHECK(std::filesystem::equivalent(changed.front(), watchedFile));
+        CHECK(watcher.poll().empty());
+    }
+
+    SECTION("Replaced files are reported")
+    {
+        const auto tempFile = directory / "watched.txt.tmp";
+        testing::writeAndTouch(tempFile, "c");
+        std::filesystem::last_write_time(
+            tempFile, std::filesystem::last_write_time(watchedFile) + std::chrono::seconds{1});
+        std::filesystem::rename(tempFile, watchedFile);
+        CHECK(watcher.poll().size() == 1);
+    }
+
+    std::filesystem::remove_all(directory);
+}
@@ -6,6 +6,7 @@
 #include <Cory/Framegraph/CommandList.hpp>
 #include <Cory/Framegraph/Framegraph.hpp>
 #include <Cory/Framegraph/RenderTaskDeclaration.hpp>
+#include <Cory/Framegraph/TransientTexturePool.hpp>
 #include <Cory/Renderer/ResourceManager.hpp>
 
 #include <Magnum/Vk/CommandBuffer.h>
@@ -18,6 +19,9 @@
 
 #include <gsl/gsl>
 
+#include <algorithm>
+#include <vector>
+
 using namespace Cory;
 
 namespace Vk = Magnum::Vk;
@@ -195,6 +199,189 @@ RenderTaskDeclaration<PostProcessOut> postProcess(RenderTaskBuilder builder,
 
     CO_APP_INFO("[Postprocess] Pass render commands are executed");
 }
+
+RenderTaskDeclaration<TransientTextureHandle> colorPass(RenderTaskBuilder builder,
+                                                       TransientTextureHandle input)
+{
+    if (input) {
+        builder.read(input, Sync::AccessType::FragmentShaderReadSampledImageOrUniformTexelBuffer);
+    }
+    auto color = builder.create("TEX_color",
+                                glm::u32vec3{128, 128, 1},
+                                PixelFormat::RGBA8Srgb,
+                                Sync::AccessType::ColorAttachmentWrite);
+
+    co_yield color;
+    RenderInput render = co_await builder.finishDeclaration();
+
+    CO_APP_INFO("{} Pass render commands are executed", builder.name());
+}
+
+/// reads all @a inputs and creates a color texture, can be recorded on a worker thread
+RenderTaskDeclaration<TransientTextureHandle>
+parallelPass(RenderTaskBuilder builder, std::vector<TransientTextureHandle> inputs)
+{
+    builder.allowParallelRecording();
+    for (auto &input : inputs) {
+        builder.read(input, Sync::AccessType::FragmentShaderReadSampledImageOrUniformTexelBuffer);
+    }
+    auto color = builder.create("TEX_color",
+                                glm::u32vec3{64, 64, 1},
+                                PixelFormat::RGBA8Srgb,
+                                Sync::AccessType::ColorAttachmentWrite);
+
+    co_yield color;
+    RenderInput render = co_await builder.finishDeclaration();
+    CO_CORE_ASSERT(render.cmd != nullptr, "No command list for the render task!");
+}
+
+/// reads all @a inputs and creates a storage texture, wants to run on the async compute queue
+RenderTaskDeclaration<TransientTextureHandle>
+computePass(RenderTaskBuilder builder, std::vector<TransientTextureHandle> inputs)
+{
+    builder.runOnAsyncCompute();
+    for (auto &input : inputs) {
+        builder.read(input, Sync::AccessType::ComputeShaderReadSampledImageOrUniformTexelBuffer);
+    }
+    auto storage = builder.create("TEX_storage",
+                                  glm::u32vec3{64, 64, 1},
+                                  PixelFormat::RGBA8Unorm,
+                                  Sync::AccessType::ComputeShaderWrite);
+
+    co_yield storage;
+    RenderInput render = co_await builder.finishDeclaration();
+    CO_CORE_ASSERT(render.cmd != nullptr, "No command list for the render task!");
+}
+
+struct ScratchDepthOutputs {
+    TransientTextureHandle color;
+    TransientTextureHandle depth;
+};
+/// reads @a input and renders into a color target, using a depth buffer nobody else needs
+RenderTaskDeclaration<ScratchDepthOutputs> scratchDepthPass(RenderTaskBuilder builder,
+                                                            TransientTextureHandle input)
+{
+    builder.read(input, Sync::AccessType::FragmentShaderReadSampledImageOrUniformTexelBuffer);
+    auto color = builder.create("TEX_color",
+                                glm::u32vec3{64, 64, 1},
+                                PixelFormat::RGBA8Srgb,
+                                Sync::AccessType::ColorAttachmentWrite);
+    auto depth = builder.create("TEX_scratchDepth",
+                                glm::u32vec3{64, 64, 1},
+                                PixelFormat::Depth32F,
+                                Sync::AccessType::DepthStencilAttachmentWrite);
+
+    co_yield ScratchDepthOutputs{.color = color, .depth = depth};
+    RenderInput render = co_await builder.finishDeclaration();
+    CO_CORE_ASSERT(render.cmd != nullptr, "No command list for the render task!");
+}
+
+/// renders into a color target and a depth buffer, leaving their load and store ops to the
+/// framegraph
+RenderTaskDeclaration<ScratchDepthOutputs> inferredOpsPass(Context &ctx,
+                                                           RenderTaskBuilder builder)
+{
+    auto color = builder.create("TEX_color",
+                                glm::u32vec3{64, 64, 1},
+                                PixelFormat::RGBA8Srgb,
+                                Sync::AccessType::ColorAttachmentWrite);
+    auto depth = builder.create("TEX_inferredDepth",
+                                glm::u32vec3{64, 64, 1},
+                                PixelFormat::Depth32F,
+                                Sync::AccessType::DepthStencilAttachmentWrite);
+
+    const ShaderHandle vertexShader = ctx.resources().createShader(
+        R"glsl(#version 450
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inTexCoord;
+layout(location = 2) in vec4 inColor;
+void main() {
+    gl_Position = vec4(inPosition, 1.0);
+}
+)glsl",
+        ShaderType::eVertex,
+        "inferred.vert");
+    const ShaderHandle fragmentShader = ctx.resources().createShader(
+        R"glsl(#version 450
+layout(location = 0) out vec4 outColor;
+void main() {
+    outColor = vec4(1.0);
+}
+)glsl",
+        ShaderType::eFragment,
+        "inferred.frag");
+
+    auto renderPass = builder.declareRenderPass()
+                          .attach(color, VkClearColorValue{})
+                          .attachDepth(depth, 1.0f)
+                          .shaders({vertexShader, fragmentShader})
+                          .finish();
+
+    co_yield ScratchDepthOutputs{.color = color, .depth = depth};
+    RenderInput render = co_await builder.finishDeclaration();
+    CO_CORE_ASSERT(render.cmd != nullptr, "No command list for the render task!");
+    renderPass.begin(*render.cmd);
+    renderPass.end(*render.cmd);
+}
+
+/// fills a transient buffer with indirect draw arguments in a compute shader
+RenderTaskDeclaration<TransientBufferHandle> argumentsPass(RenderTaskBuilder builder)
+{
+    const auto usage =
+        BufferUsage{BufferUsageBits::StorageBuffer}.set(BufferUsageBits::IndirectBuffer);
+    auto arguments = builder.createBuffer(
+        "BUF_arguments", 1024, usage, Sync::AccessType::ComputeShaderWrite);
+
+    co_yield arguments;
+    RenderInput render = co_await builder.finishDeclaration();
+    CO_CORE_ASSERT(render.resources->buffer(arguments.buffer()).valid(),
+                   "Buffer was not allocated!");
+}
+
+/// draws with the indirect arguments in @a arguments
+RenderTaskDeclaration<TransientTextureHandle> indirectDrawPass(RenderTaskBuilder builder,
+                                                              TransientBufferHandle arguments)
+{
+    const BufferInfo argumentsInfo = builder.read(arguments, Sync::AccessType::IndirectBuffer);
+    CO_CORE_ASSERT(argumentsInfo.size == 1024, "Unexpected buffer size");
+    auto color = builder.create("TEX_color",
+                                glm::u32vec3{64, 64, 1},
+                                PixelFormat::RGBA8Srgb,
+                                Sync::AccessType::ColorAttachmentWrite);
+
+    co_yield color;
+    RenderInput render = co_await builder.finishDeclaration();
+}
+
+/// creates a color texture with @a mipLevels mip levels, but only renders to the first one
+RenderTaskDeclaration<TransientTextureHandle> mipChainPass(RenderTaskBuilder builder,
+                                                          uint32_t mipLevels)
+{
+    auto color = builder.create(TextureInfo{.name = "TEX_mipChain",
+                                            .size = glm::u32vec3{64, 64, 1},
+                                            .format = PixelFormat::RGBA8Unorm,
+                                            .mipLevels = mipLevels},
+                                Sync::AccessType::ColorAttachmentWrite,
+                                SubresourceRange::mip(0));
+
+    co_yield color;
+    RenderInput render = co_await builder.finishDeclaration();
+    CO_CORE_ASSERT(render.resources->imageView(color, 0, 0).valid(), "Mip view was not created!");
+}
+
+/// downsamples mip level @a level - 1 of @a input into mip level @a level
+RenderTaskDeclaration<TransientTextureHandle>
+downsamplePass(RenderTaskBuilder builder, TransientTextureHandle input, uint32_t level)
+{
+    builder.read(input,
+                 Sync::AccessType::FragmentShaderReadSampledImageOrUniformTexelBuffer,
+                 SubresourceRange::mip(level - 1));
+    auto [output, info] =
+        builder.write(input, Sync::AccessType::ColorAttachmentWrite, SubresourceRange::mip(level));
+
+    co_yield output;
+    RenderInput render = co_await builder.finishDeclaration();
+}
 } // namespace passes
 
 TEST_CASE("Framegraph API", "[Cory/Framegraph/Framegraph]")
@@ -269,4 +456,406 @@ TEST_CASE("Framegraph API", "[Cory/Framegraph/Framegraph]")
     CO_APP_INFO(graph.dump(g));
 
     buffer.end();
-}
\ No newline at end of file
+}
+TEST_CASE("Transient texture pool", "[Cory/Framegraph/TransientTexturePool]")
+{
+    testing::VulkanTester t;
+
+    const uint32_t maxUnusedFrames = 2;
+    TransientTexturePool pool{t.ctx(), maxUnusedFrames};
+
+    const TransientImageDesc desc{.size = {256, 256, 1},
+                                  .format = PixelFormat::RGBA8Srgb,
+                                  .sampleCount = 1,
+                                  .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT};
+    const auto requirements = pool.memoryRequirements(desc);
+    CHECK(requirements.size >= 256 * 256 * 4);
+
+    // first frame creates the heap and the image
+    auto heap = pool.acquireHeap(requirements.memoryType, requirements.size);
+    auto [image, view] = pool.acquireImage(heap, desc, 0, "TEX_pooled");
+    // the same image should not be handed out twice in the same frame
+    auto [otherImage, otherView] = pool.acquireImage(heap, desc, 0, "TEX_pooled2");
+    CHECK(image != otherImage);
+    pool.releaseHeap(heap);
+    pool.collectGarbage();
+
+    // second frame reuses heap and image
+    auto reusedHeap = pool.acquireHeap(requirements.memoryType, requirements.size);
+    CHECK(reusedHeap == heap);
+    auto [reusedImage, reusedView] = pool.acquireImage(reusedHeap, desc, 0, "TEX_pooled");
+    CHECK(reusedImage == image);
+    CHECK(reusedView == view);
+    pool.releaseHeap(reusedHeap);
+    CHECK(pool.heapCount() == 1);
+    CHECK(pool.imageCount() == 2);
+
+    // unused resources get evicted after a couple of frames
+    for (uint32_t i = 0; i <= maxUnusedFrames + 1; ++i) {
+        pool.collectGarbage();
+    }
+    CHECK(pool.heapCount() == 0);
+    CHECK(pool.imageCount() == 0);
+}
+
+namespace {
+
+/// a framegraph and a command buffer to record it into, which is ended and the graph reset once
+/// the test is done
+struct FramegraphTester {
+    enum class PoolKind { Private, Shared };
+
+    explicit FramegraphTester(PoolKind poolKind = PoolKind::Private)
+        : pool{poolKind == PoolKind::Shared ? std::make_shared<TransientTexturePool>(t.ctx())
+                                            : nullptr}
+        , graph{pool ? Framegraph{t.ctx(), pool} : Framegraph{t.ctx()}}
+        , buffer{t.ctx().commandPool().allocate()}
+    {
+        buffer.begin();
+    }
+    ~FramegraphTester()
+    {
+        buffer.end();
+        graph.resetForNextFrame();
+    }
+    FramegraphTester(const FramegraphTester &) = delete;
+    FramegraphTester &operator=(const FramegraphTester &) = delete;
+
+    /// start declaring the next frame of the graph
+    void nextFrame()
+    {
+        graph.resetForNextFrame();
+        frameCtx.frameNumber++;
+    }
+    ExecutionInfo record() { return graph.record(frameCtx); }
+
+    testing::VulkanTester t;
+    std::shared_ptr<TransientTexturePool> pool;
+    Framegraph graph;
+    Magnum::Vk::CommandBuffer buffer;
+    FrameContext frameCtx{.index = 0, .frameNumber = 0, .commandBuffer = &buffer};
+};
+
+} // namespace
+
+TEST_CASE("Compiled graphs are reused for structurally identical graphs",
+          "[Cory/Framegraph/Framegraph]")
+{
+    FramegraphTester f;
+
+    auto recordFrame = [&](bool withPostprocess) {
+        f.nextFrame();
+        auto mainPass = passes::colorPass(f.graph.declareTask("TASK_Main"), NullHandle);
+        auto output = mainPass.output();
+        if (withPostprocess) {
+            auto postPass = passes::colorPass(f.graph.declareTask("TASK_Post"), output);
+            output = postPass.output();
+        }
+        f.graph.declareOutput(output);
+        return f.record();
+    };
+
+    const ExecutionInfo first = recordFrame(false);
+    CHECK_FALSE(first.cacheHit);
+    CHECK(first.tasks.size() == 1);
+
+    const ExecutionInfo second = recordFrame(false);
+    CHECK(second.cacheHit);
+    CHECK(second.tasks.size() == 1);
+
+    // a new variant of the graph needs to be resolved once, but then is also cached
+    const ExecutionInfo withPost = recordFrame(true);
+    CHECK_FALSE(withPost.cacheHit);
+    CHECK(withPost.tasks.size() == 2);
+    const ExecutionInfo cachedPost = recordFrame(true);
+    CHECK(cachedPost.cacheHit);
+    CHECK(recordFrame(false).cacheHit);
+
+    // the levels and barriers are reused as well, for the tasks of the current frame
+    CHECK(cachedPost.levels == withPost.levels);
+    REQUIRE(cachedPost.transitions.size() == withPost.transitions.size());
+    for (size_t i = 0; i < cachedPost.transitions.size(); ++i) {
+        const auto &cachedTransition = cachedPost.transitions[i];
+        CHECK(cachedTransition.stateBefore == withPost.transitions[i].stateBefore);
+        CHECK(cachedTransition.stateAfter == withPost.transitions[i].stateAfter);
+        CHECK(cachedTransition.elided == withPost.transitions[i].elided);
+        CHECK(std::ranges::count(cachedPost.tasks, cachedTransition.task) == 1);
+    }
+}
+
+TEST_CASE("Compiled graphs are not reused for graphs that access other subresources",
+          "[Cory/Framegraph/Framegraph]")
+{
+    FramegraphTester f;
+
+    auto recordFrame = [&](uint32_t level) {
+        f.nextFrame();
+        auto chain = passes::mipChainPass(f.graph.declareTask("TASK_MipChain"), 4);
+        auto downsample =
+            passes::downsamplePass(f.graph.declareTask("TASK_Downsample"), chain.output(), level);
+        f.graph.declareOutput(downsample.output());
+        return f.record();
+    };
+
+    CHECK_FALSE(recordFrame(1).cacheHit);
+    CHECK(recordFrame(1).cacheHit);
+
+    // same tasks and textures, only the mip levels of the downsample differ
+    const ExecutionInfo other = recordFrame(2);
+    CHECK_FALSE(other.cacheHit);
+    // mip level 1 is not rendered to in this graph, so its read does not wait for a write
+    CHECK(std::ranges::any_of(other.transitions, [](const auto &transition) {
+        return !transition.kind.is_set(TaskDependencyKindBits::Write) &&
+               transition.stateBefore == Sync::AccessType::None;
+    }));
+    CHECK(recordFrame(2).cacheHit);
+}
+
+TEST_CASE("Independent render tasks are recorded in parallel", "[Cory/Framegraph/Framegraph]")
+{
+    FramegraphTester f;
+
+    // four independent producers and one task that combines their results
+    std::vector<RenderTaskDeclaration<TransientTextureHandle>> producers;
+    std::vector<TransientTextureHandle> producerOutputs;
+    for (int i = 0; i < 4; ++i) {
+        producers.push_back(
+            passes::parallelPass(f.graph.declareTask(fmt::format("TASK_Producer{}", i)), {}));
+        producerOutputs.push_back(producers.back().output());
+    }
+    auto combine = passes::parallelPass(f.graph.declareTask("TASK_Combine"), producerOutputs);
+    f.graph.declareOutput(combine.output());
+
+    const ExecutionInfo info = f.record();
+    REQUIRE(info.tasks.size() == 5);
+    REQUIRE(info.levels.size() == 5);
+    // the combining task runs last and in its own level
+    CHECK(info.levels.back() == 1);
+    for (size_t i = 0; i < 4; ++i) {
+        CHECK(info.levels[i] == 0);
+    }
+    // the combine task has a transition for each input and its output
+    CHECK(info.transitions.size() == 4 + 5);
+}
+
+TEST_CASE("Redundant barriers are elided", "[Cory/Framegraph/Framegraph]")
+{
+    FramegraphTester f;
+
+    // the output of the producer is read twice with the same access
+    auto producer = passes::parallelPass(f.graph.declareTask("TASK_Producer"), {});
+    auto first = passes::parallelPass(f.graph.declareTask("TASK_First"), {producer.output()});
+    auto second = passes::parallelPass(f.graph.declareTask("TASK_Second"),
+                                         {producer.output(), first.output()});
+    f.graph.declareOutput(second.output());
+
+    const ExecutionInfo info = f.record();
+    REQUIRE(info.tasks.size() == 3);
+    CHECK(info.levels == std::vector<uint32_t>{0, 1, 2});
+    CHECK(info.transitions.size() == 1 + 2 + 3);
+
+    // only the second read of the producer's output does not need a barrier
+    for (const auto &transition : info.transitions) {
+        const bool secondReadOfProducer = transition.task == info.tasks[2] &&
+                                          transition.resource == producer.output();
+        CHECK(transition.elided == secondReadOfProducer);
+    }
+}
+
+TEST_CASE("Barriers across independent levels are split", "[Cory/Framegraph/Framegraph]")
+{
+    FramegraphTester f;
+
+    // the output of the producer is only consumed after an independent chain of two tasks
+    auto producer = passes::parallelPass(f.graph.declareTask("TASK_Producer"), {});
+    auto chainStart = passes::parallelPass(f.graph.declareTask("TASK_ChainStart"), {});
+    auto chainEnd =
+        passes::parallelPass(f.graph.declareTask("TASK_ChainEnd"), {chainStart.output()});
+    auto consumer = passes::parallelPass(f.graph.declareTask("TASK_Consumer"),
+                                           {producer.output(), chainEnd.output()});
+    f.graph.declareOutput(consumer.output());
+
+    const ExecutionInfo info = f.record();
+    REQUIRE(info.tasks.size() == 4);
+    CHECK(info.levels.back() == 2);
+    CHECK(info.transitions.size() == 1 + 1 + 2 + 3);
+
+    // only the read of the producer's output skips a level
+    for (const auto &transition : info.transitions) {
+        const bool readOfProducer =
+            transition.task == info.tasks.back() && transition.resource == producer.output();
+        CHECK(transition.split == readOfProducer);
+        CHECK(!transition.elided);
+    }
+}
+
+TEST_CASE("Render tasks can run on the async compute queue", "[Cory/Framegraph/Framegraph]")
+{
+    FramegraphTester f;
+    const bool hasAsyncCompute = f.t.ctx().hasAsyncCompute();
+
+    // two compute tasks feed a graphics task. the third compute task reads the output of the
+    // graphics task, so it has to run on the graphics queue as well
+    auto producer = passes::computePass(f.graph.declareTask("TASK_ComputeProducer"), {});
+    auto filter =
+        passes::computePass(f.graph.declareTask("TASK_ComputeFilter"), {producer.output()});
+    auto draw = passes::parallelPass(f.graph.declareTask("TASK_Draw"), {filter.output()});
+    auto post = passes::computePass(f.graph.declareTask("TASK_ComputePost"), {draw.output()});
+    auto present = passes::parallelPass(f.graph.declareTask("TASK_Present"), {post.output()});
+    f.graph.declareOutput(present.output());
+
+    const ExecutionInfo info = f.record();
+    REQUIRE(info.tasks.size() == 5);
+    CHECK(info.asyncCompute ==
+          std::vector<bool>{hasAsyncCompute, hasAsyncCompute, false, false, false});
+
+    // the graphics work waits for the async compute work, which hands over the filtered texture
+    CHECK((f.frameCtx.asyncComputeDone != nullptr) == hasAsyncCompute);
+    const bool separateFamily =
+        hasAsyncCompute && f.t.ctx().computeQueueFamily() != f.t.ctx().graphicsQueueFamily();
+    for (const auto &transition : info.transitions) {
+        const bool drawReadsFilter =
+            transition.task == info.tasks[2] && transition.resource == filter.output();
+        CHECK(transition.queueTransfer == (drawReadsFilter && separateFamily));
+        CHECK(!transition.split);
+    }
+}
+
+TEST_CASE("Render tasks can use transient buffers", "[Cory/Framegraph/Framegraph]")
+{
+    FramegraphTester f{FramegraphTester::PoolKind::Shared};
+
+    auto recordFrame = [&]() {
+        f.nextFrame();
+        auto arguments = passes::argumentsPass(f.graph.declareTask("TASK_Arguments"));
+        auto draw = passes::indirectDrawPass(f.graph.declareTask("TASK_Draw"), arguments.output());
+        f.graph.declareOutput(draw.output());
+        return f.record();
+    };
+
+    const ExecutionInfo info = recordFrame();
+    REQUIRE(info.tasks.size() == 2);
+    CHECK(info.levels == std::vector<uint32_t>{0, 1});
+    CHECK(info.buffers.size() == 1);
+    // the buffer is created by the first task and read by the second one, both need a barrier
+    REQUIRE(info.bufferTransitions.size() == 2);
+    CHECK(info.bufferTransitions[1].stateBefore == Sync::AccessType::ComputeShaderWrite);
+    CHECK(info.bufferTransitions[1].stateAfter == Sync::AccessType::IndirectBuffer);
+    for (const auto &transition : info.bufferTransitions) {
+        CHECK(!transition.elided);
+    }
+
+    // the buffer is reused in the next frame
+    CHECK(recordFrame().cacheHit);
+    CHECK(f.pool->bufferCount() == 1);
+}
+
+TEST_CASE("Attachments that are never consumed are memoryless", "[Cory/Framegraph/Framegraph]")
+{
+    FramegraphTester f;
+
+    auto producer = passes::parallelPass(f.graph.declareTask("TASK_Producer"), {});
+    auto scratch =
+        passes::scratchDepthPass(f.graph.declareTask("TASK_ScratchDepth"), producer.output());
+    const passes::ScratchDepthOutputs outputs = scratch.output();
+    f.graph.declareOutput(outputs.color);
+
+    const ExecutionInfo info = f.record();
+    REQUIRE(info.tasks.size() == 2);
+
+    const TextureManager &resources = f.graph.resources();
+    CHECK(resources.consumed(producer.output()));
+    CHECK(resources.consumed(outputs.color));
+    CHECK(!resources.consumed(outputs.depth));
+    // the producer's output is sampled, and the color output is used after the graph executed
+    CHECK(!resources.memoryless(producer.output().texture()));
+    CHECK(!resources.memoryless(outputs.color.texture()));
+    CHECK(resources.memoryless(outputs.depth.texture()));
+}
+
+TEST_CASE("Attachment load and store ops are inferred from the framegraph",
+          "[Cory/Framegraph/Framegraph]")
+{
+    FramegraphTester f;
+
+    auto pass = passes::inferredOpsPass(f.t.ctx(), f.graph.declareTask("TASK_InferredOps"));
+    const passes::ScratchDepthOutputs outputs = pass.output();
+    f.graph.declareOutput(outputs.color);
+
+    const ExecutionInfo info = f.record();
+    REQUIRE(info.tasks.size() == 1);
+
+    // the color output is stored for later use, the depth buffer is only needed while rendering
+    const TextureManager &resources = f.graph.resources();
+    CHECK(resources.consumed(outputs.color));
+    CHECK(!resources.consumed(outputs.depth));
+    CHECK(!resources.memoryless(outputs.color.texture()));
+    CHECK(resources.memoryless(outputs.depth.texture()));
+}
+
+TEST_CASE("Transient textures are created with the usage of their accesses",
+          "[Cory/Framegraph/Framegraph]")
+{
+    FramegraphTester f;
+
+    auto producer = passes::parallelPass(f.graph.declareTask("TASK_Producer"), {});
+    auto scratch =
+        passes::scratchDepthPass(f.graph.declareTask("TASK_ScratchDepth"), producer.output());
+    const passes::ScratchDepthOutputs outputs = scratch.output();
+    f.graph.declareOutput(outputs.color);
+
+    const ExecutionInfo info = f.record();
+    REQUIRE(info.tasks.size() == 2);
+
+    const TextureManager &resources = f.graph.resources();
+    CHECK(resources.usage(producer.output().texture()) ==
+          (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT));
+    CHECK(resources.usage(outputs.depth.texture()) == VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+    // outputs can be sampled or copied after the graph has executed
+    CHECK(resources.usage(outputs.color.texture()) ==
+          (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+           VK_IMAGE_USAGE_TRANSFER_SRC_BIT));
+}
+
+TEST_CASE("Mip levels of transient textures are synchronized separately",
+          "[Cory/Framegraph/Framegraph]")
+{
+    FramegraphTester f;
+
+    static constexpr uint32_t MIP_LEVELS{4};
+    auto chain = passes::mipChainPass(f.graph.declareTask("TASK_MipChain"), MIP_LEVELS);
+    TransientTextureHandle current = chain.output();
+    std::vector<RenderTaskDeclaration<TransientTextureHandle>> downsamples;
+    for (uint32_t level = 1; level < MIP_LEVELS; ++level) {
+        downsamples.push_back(
+            passes::downsamplePass(f.graph.declareTask("TASK_Downsample"), current, level));
+        current = downsamples.back().output();
+    }
+    f.graph.declareOutput(current);
+
+    const ExecutionInfo info = f.record();
+    REQUIRE(info.tasks.size() == MIP_LEVELS);
+    CHECK(info.transitions.size() == 1 + 2 * (MIP_LEVELS - 1));
+
+    // each downsample reads the level written just before, and writes a level nobody touched yet
+    for (const auto &transition : info.transitions) {
+        CHECK(!transition.elided);
+        if (transition.kind.is_set(TaskDependencyKindBits::Write)) {
+            CHECK(transition.stateBefore == Sync::AccessType::None);
+        }
+        else {
+            CHECK(transition.stateBefore == Sync::AccessType::ColorAttachmentWrite);
+        }
+    }
+
+    // all levels but the last have been read, the last one has only been written
+    const TextureManager &resources = f.graph.resources();
+    for (uint32_t level = 0; level + 1 < MIP_LEVELS; ++level) {
+        CHECK(resources.lastAccess(current, level, 0) ==
+              Sync::AccessType::FragmentShaderReadSampledImageOrUniformTexelBuffer);
+    }
+    CHECK(resources.lastAccess(current, MIP_LEVELS - 1, 0) ==
+          Sync::AccessType::ColorAttachmentWrite);
+    CHECK(resources.state(current).lastAccess ==
+          Sync::AccessType::FragmentShaderReadSampledImageOrUniformTexelBuffer);
+}
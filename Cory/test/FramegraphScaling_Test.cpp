@@ -0,0 +1,86 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "TestUtils.hpp"
+
+#include <Cory/Framegraph/Framegraph.hpp>
+#include <Cory/Framegraph/RenderTaskDeclaration.hpp>
+
+#include <fmt/format.h>
+
+#include <vector>
+
+using namespace Cory;
+
+namespace {
+
+/// a task that reads up to two textures and creates a new one
+RenderTaskDeclaration<TransientTextureHandle> syntheticTask(RenderTaskBuilder builder,
+                                                            TransientTextureHandle first,
+                                                            TransientTextureHandle second)
+{
+    const auto readAccess = Sync::AccessType::FragmentShaderReadSampledImageOrUniformTexelBuffer;
+    if (first) { builder.read(first, readAccess); }
+    if (second && second != first) { builder.read(second, readAccess); }
+    auto output = builder.create("TEX_synthetic",
+                                 glm::u32vec3{16, 16, 1},
+                                 PixelFormat::RGBA8Unorm,
+                                 Sync::AccessType::ColorAttachmentWrite);
+
+    co_yield output;
+    co_await builder.finishDeclaration();
+}
+
+/**
+ * declares a graph of @a taskCount tasks where task i reads the outputs of task i-1 and task i/2,
+ * and every 16th task is never used
+ */
+void declareSyntheticGraph(Framegraph &graph, size_t taskCount)
+{
+    std::vector<TransientTextureHandle> outputs;
+    outputs.reserve(taskCount);
+    for (size_t i = 0; i < taskCount; ++i) {
+        const TransientTextureHandle previous = i > 0 ? outputs[i - 1] : NullHandle;
+        const TransientTextureHandle half = i > 1 ? outputs[i / 2] : NullHandle;
+        auto task = syntheticTask(graph.declareTask(fmt::format("TASK_{}", i)),
+                                  i % 16 == 15 ? NullHandle : previous,
+                                  half);
+        outputs.push_back(task.output());
+    }
+    graph.declareOutput(outputs.back());
+}
+
+} // namespace
+
+// a correctness smoke test for big graphs - how resolve scales is measured by the benchmark below
+TEST_CASE("Framegraph resolve produces a valid order for big graphs",
+          "[Cory/Framegraph/Framegraph]")
+{
+    testing::VulkanTester t;
+
+    const size_t taskCount = GENERATE(100, 1000, 10000);
+    Framegraph graph(t.ctx());
+    declareSyntheticGraph(graph, taskCount);
+
+    const ExecutionInfo info = graph.dryRun();
+    CHECK(!info.tasks.empty());
+    CHECK(info.tasks.size() <= taskCount);
+    // every executed task creates a texture
+    CHECK(info.resources.size() >= info.tasks.size());
+
+    // resolving again reuses the arena, grown to fit the first run if needed
+    CHECK(graph.dryRun().tasks == info.tasks);
+}
+
+TEST_CASE("Framegraph resolve scaling", "[Cory/Framegraph/Framegraph][!benchmark]")
+{
+    testing::VulkanTester t;
+
+    for (const size_t taskCount : {100, 1000, 10000}) {
+        Framegraph graph(t.ctx());
+        declareSyntheticGraph(graph, taskCount);
+
+        BENCHMARK(fmt::format("resolve {} tasks", taskCount)) { return graph.dryRun(); };
+    }
+}
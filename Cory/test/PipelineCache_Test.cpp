@@ -0,0 +1,241 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <Cory/Renderer/Context.hpp>
+#include <Cory/Renderer/PipelineCache.hpp>
+#include <Cory/Renderer/ResourceManager.hpp>
+
+#include <array>
+#include <filesystem>
+#include <fstream>
+
+#include "TestUtils.hpp"
+
+static constexpr auto testVertexShader = R"(
+#version 450
+
+void main() {
+    gl_Position = vec4(0.0, 0.0, 0.0, 1.0);
+})";
+
+static constexpr auto testFragmentShader = R"(
+#version 450
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = vec4(1.0);
+})";
+
+static constexpr auto editedFragmentShader = R"(
+#version 450
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = vec4(0.5);
+})";
+
+static constexpr auto specializedFragmentShader = R"(
+#version 450
+
+layout(constant_id = 0) const float BRIGHTNESS = 1.0;
+layout(constant_id = 1) const bool INVERT = false;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = vec4(INVERT ? 1.0 - BRIGHTNESS : BRIGHTNESS);
+})";
+
+using namespace Cory;
+
+TEST_CASE("PipelineCache", "[Cory/Renderer]")
+{
+    testing::VulkanTester t;
+    ResourceManager &resources = t.ctx().resources();
+
+    ShaderHandle vertexShader =
+        resources.createShader(testVertexShader, ShaderType::eVertex, "pipelineCache.vert");
+    ShaderHandle fragmentShader =
+        resources.createShader(testFragmentShader, ShaderType::eFragment, "pipelineCache.frag");
+    auto descriptor = [&](VkFormat colorFormat) {
+        return PipelineDescriptor{.shaders = {vertexShader, fragmentShader},
+                                  .sampleCount = 1,
+                                  .colorFormats = {colorFormat},
+                                  .depthFormat = VK_FORMAT_UNDEFINED,
+                                  .stencilFormat = VK_FORMAT_UNDEFINED,
+                                  .hasMeshInput = false};
+    };
+
+    SECTION("Pipelines are reused and evicted in least-recently-used order")
+    {
+        PipelineCache cache;
+        cache.init(t.ctx(), {});
+        cache.setCapacity(1);
+
+        const PipelineHandle rgba = cache.query("RGBA", descriptor(VK_FORMAT_R8G8B8A8_UNORM));
+        CHECK(cache.query("RGBA", descriptor(VK_FORMAT_R8G8B8A8_UNORM)) == rgba);
+        const PipelineHandle bgra = cache.query("BGRA", descriptor(VK_FORMAT_B8G8R8A8_UNORM));
+        CHECK(bgra != rgba);
+        CHECK(cache.size() == 2);
+
+        // pipelines used in the last frame are likely needed again and are not evicted yet
+        cache.nextFrame();
+        CHECK(cache.size() == 2);
+
+        CHECK(cache.query("BGRA", descriptor(VK_FORMAT_B8G8R8A8_UNORM)) == bgra);
+        cache.nextFrame();
+        CHECK(cache.size() == 1);
+        CHECK_THROWS(resources[rgba]);
+        CHECK_NOTHROW(resources[bgra]);
+    }
+
+    SECTION("Pipelines are compiled in the background")
+    {
+        PipelineCache cache;
+        cache.init(t.ctx(), {});
+
+        const PipelineFuture pipeline = cache.request("RGBA", descriptor(VK_FORMAT_R8G8B8A8_UNORM));
+        const PipelineFuture again = cache.request("RGBA", descriptor(VK_FORMAT_R8G8B8A8_UNORM));
+        CHECK(cache.size() == 1);
+
+        const PipelineHandle handle = pipeline.get();
+        CHECK(pipeline.ready());
+        CHECK(again.get() == handle);
+        CHECK(resources[handle].handle() != VK_NULL_HANDLE);
+    }
+
+    SECTION("Pipelines are linked from shared pipeline libraries")
+    {
+        PipelineCache cache;
+        cache.init(t.ctx(), {});
+        // nothing to test if the device does not support graphics pipeline libraries
+        if (cache.usesLibraries()) {
+            const PipelineHandle rgba = cache.query("RGBA", descriptor(VK_FORMAT_R8G8B8A8_UNORM));
+            CHECK(cache.libraryCount() == 4);
+            // only the fragment output library depends on the attachment formats
+            const PipelineHandle bgra = cache.query("BGRA", descriptor(VK_FORMAT_B8G8R8A8_UNORM));
+            CHECK(cache.libraryCount() == 5);
+            CHECK(resources[rgba].handle() != VK_NULL_HANDLE);
+            CHECK(resources[bgra].handle() != VK_NULL_HANDLE);
+
+            cache.clear();
+            CHECK(cache.libraryCount() == 0);
+        }
+    }
+
+    SECTION("Pipelines of reloaded shaders are linked from new pipeline libraries")
+    {
+        PipelineCache cache;
+        cache.init(t.ctx(), {});
+        // nothing to test if the device does not support graphics pipeline libraries
+        if (t.ctx().hasGraphicsPipelineLibrary()) {
+            cache.setUseLibraries(true);
+            const PipelineHandle rgba = cache.query("RGBA", descriptor(VK_FORMAT_R8G8B8A8_UNORM));
+            CHECK(cache.libraryCount() == 4);
+
+            // replace the fragment shader the same way the ShaderReloader does
+            const ShaderHandle edited = resources.createShader(
+                editedFragmentShader, ShaderType::eFragment, "pipelineCacheEdited.frag");
+            resources[fragmentShader] = resources[edited];
+            resources.release(edited);
+
+            // the edited shader must not be linked from the library of the old one
+            const PipelineHandle bgra = cache.query("BGRA", descriptor(VK_FORMAT_B8G8R8A8_UNORM));
+            CHECK(cache.libraryCount() == 6);
+
+            cache.reload(std::array{fragmentShader});
+            cache.wait();
+            cache.nextFrame();
+            const PipelineHandle rebuilt =
+                cache.query("RGBA", descriptor(VK_FORMAT_R8G8B8A8_UNORM));
+            CHECK(rebuilt != rgba);
+            CHECK(cache.query("BGRA", descriptor(VK_FORMAT_B8G8R8A8_UNORM)) != bgra);
+            CHECK(resources[rebuilt].handle() != VK_NULL_HANDLE);
+            // the fragment shader library of the old shader was dropped
+            CHECK(cache.libraryCount() == 5);
+
+            cache.clear();
+        }
+    }
+
+    SECTION("Pipelines are created monolithically without pipeline libraries")
+    {
+        PipelineCache cache;
+        cache.init(t.ctx(), {});
+        cache.setUseLibraries(false);
+
+        const PipelineHandle rgba = cache.query("RGBA", descriptor(VK_FORMAT_R8G8B8A8_UNORM));
+        CHECK(cache.libraryCount() == 0);
+        CHECK(resources[rgba].handle() != VK_NULL_HANDLE);
+    }
+
+    SECTION("Shader variants are created through specialization constants")
+    {
+        PipelineCache cache;
+        cache.init(t.ctx(), {});
+
+        ShaderHandle specializedShader = resources.createShader(
+            specializedFragmentShader, ShaderType::eFragment, "pipelineCacheSpecialized.frag");
+        auto specialized = [&](std::vector<SpecializationConstant> constants) {
+            PipelineDescriptor desc = descriptor(VK_FORMAT_R8G8B8A8_UNORM);
+            desc.shaders = {vertexShader, specializedShader};
+            desc.specialization = std::move(constants);
+            return desc;
+        };
+
+        // all variants share the same shader module, but are different pipelines
+        const PipelineHandle bright = cache.query("Bright", specialized({{0, 1.0f}}));
+        const PipelineHandle dark = cache.query("Dark", specialized({{0, 0.25f}}));
+        const PipelineHandle inverted =
+            cache.query("Inverted", specialized({{0, 0.25f}, {1, true}}));
+        CHECK(bright != dark);
+        CHECK(dark != inverted);
+        CHECK(cache.size() == 3);
+        CHECK(cache.query("Dark", specialized({{0, 0.25f}})) == dark);
+        CHECK(resources[inverted].handle() != VK_NULL_HANDLE);
+
+        cache.clear();
+        resources.release(specializedShader);
+    }
+
+    SECTION("Cache data is persisted and validated")
+    {
+        const auto cacheFile =
+            std::filesystem::temp_directory_path() / "Cory_PipelineCache_Test.pipelinecache";
+        std::filesystem::remove(cacheFile);
+
+        {
+            PipelineCache cache;
+            cache.init(t.ctx(), cacheFile);
+            CHECK_FALSE(cache.loadedFromFile());
+            cache.query("RGBA", descriptor(VK_FORMAT_R8G8B8A8_UNORM));
+        }
+        REQUIRE(std::filesystem::exists(cacheFile));
+
+        {
+            PipelineCache cache;
+            cache.init(t.ctx(), cacheFile);
+            CHECK(cache.loadedFromFile());
+        }
+
+        // flip a bit in the driver data
+        {
+            std::fstream file(cacheFile, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekg(-1, std::ios::end);
+            const char last = static_cast<char>(file.get());
+            file.seekp(-1, std::ios::end);
+            file.put(static_cast<char>(last ^ 1));
+        }
+        {
+            PipelineCache cache;
+            cache.init(t.ctx(), cacheFile);
+            CHECK_FALSE(cache.loadedFromFile());
+        }
+
+        std::filesystem::remove(cacheFile);
+    }
+
+    resources.release(vertexShader);
+    resources.release(fragmentShader);
+}
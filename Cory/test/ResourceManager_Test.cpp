@@ -1,9 +1,21 @@
 #include <catch2/catch_test_macros.hpp>
 
+#include <Cory/Renderer/Context.hpp>
+#include <Cory/Renderer/MemoryAllocator.hpp>
 #include <Cory/Renderer/ResourceManager.hpp>
 #include <Cory/Renderer/Shader.hpp>
+#include <Cory/Renderer/SingleShotCommandBuffer.hpp>
 
 #include <Magnum/Vk/Buffer.h>
+#include <Magnum/Vk/Device.h>
+#include <Magnum/Vk/SamplerCreateInfo.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+#include <vector>
 
 #include "TestUtils.hpp"
 
@@ -43,7 +55,8 @@ TEST_CASE("ResourceManager", "[Cory/Renderer]")
                                                MemoryFlagBits::HostCoherent);
         CHECK(mgr.resourcesInUse()[ResourceType::Buffer] == 1);
 
-        CHECK(mgr[buffer].dedicatedMemory().size() == 1024);
+        CHECK(mgr.memoryInfo(buffer).memory != VK_NULL_HANDLE);
+        CHECK(mgr.memoryInfo(buffer).size >= 1024);
 
         BufferHandle invalidHandle;
         CHECK_THROWS(mgr[invalidHandle]);
@@ -53,6 +66,216 @@ TEST_CASE("ResourceManager", "[Cory/Renderer]")
         CHECK(mgr.resourcesInUse()[ResourceType::Buffer] == 0);
     }
 
+    SECTION("Buffers are sub-allocated from shared memory blocks")
+    {
+        auto countAllocations = [&] {
+            uint32_t count{0};
+            for (const MemoryHeapStats &heap : t.ctx().allocator().heapStats()) {
+                count += heap.allocationCount;
+            }
+            return count;
+        };
+        const uint32_t allocationsBefore = countAllocations();
+
+        BufferHandle first = mgr.createBuffer(
+            "First", 1024, Cory::BufferUsageBits::StorageBuffer, MemoryFlagBits::DeviceLocal);
+        BufferHandle second = mgr.createBuffer(
+            "Second", 1024, Cory::BufferUsageBits::StorageBuffer, MemoryFlagBits::DeviceLocal);
+        const AllocationInfo firstInfo = mgr.memoryInfo(first);
+        const AllocationInfo secondInfo = mgr.memoryInfo(second);
+        CHECK(firstInfo.memory == secondInfo.memory);
+        CHECK(firstInfo.offset != secondInfo.offset);
+        CHECK(countAllocations() == allocationsBefore + 2);
+
+        // host-visible buffers are persistently mapped
+        BufferHandle upload = mgr.createBuffer(
+            "Upload", 256, Cory::BufferUsageBits::UniformBuffer, MemoryFlagBits::HostVisible);
+        const AllocationInfo uploadInfo = mgr.memoryInfo(upload);
+        REQUIRE(uploadInfo.mappedData != nullptr);
+        std::fill_n(uploadInfo.mappedData, 256, std::byte{42});
+        CHECK_NOTHROW(mgr.flush(upload));
+        CHECK(firstInfo.mappedData == nullptr);
+
+        mgr.release(first);
+        mgr.release(second);
+        mgr.release(upload);
+        CHECK(countAllocations() == allocationsBefore);
+    }
+
+    SECTION("Released resources are destroyed once their frame has finished")
+    {
+        // without any frames, resources are destroyed right away
+        BufferHandle immediate = mgr.createBuffer(
+            "Immediate", 1024, Cory::BufferUsageBits::StorageBuffer, MemoryFlagBits::DeviceLocal);
+        mgr.release(immediate);
+        CHECK(mgr.pendingReleaseCount() == 0);
+
+        const uint64_t first = mgr.beginFrame();
+        BufferHandle buffer = mgr.createBuffer(
+            "Deferred", 1024, Cory::BufferUsageBits::StorageBuffer, MemoryFlagBits::DeviceLocal);
+        const AllocationInfo deferredInfo = mgr.memoryInfo(buffer);
+        mgr.release(buffer);
+        CHECK_THROWS(mgr[buffer]);
+        CHECK(mgr.resourcesInUse()[ResourceType::Buffer] == 0);
+        CHECK(mgr.pendingReleaseCount() == 1);
+
+        const uint64_t second = mgr.beginFrame();
+        CHECK(second > first);
+        SamplerHandle sampler = mgr.createSampler("Deferred", Magnum::Vk::SamplerCreateInfo{});
+        mgr.release(sampler);
+        CHECK(mgr.pendingReleaseCount() == 2);
+
+        // the memory of pending buffers is not reused until they are destroyed
+        BufferHandle other = mgr.createBuffer(
+            "Other", 1024, Cory::BufferUsageBits::StorageBuffer, MemoryFlagBits::DeviceLocal);
+        const AllocationInfo otherInfo = mgr.memoryInfo(other);
+        CHECK((otherInfo.memory != deferredInfo.memory ||
+               otherInfo.offset != deferredInfo.offset));
+
+        mgr.collect(first);
+        CHECK(mgr.pendingReleaseCount() == 1);
+        mgr.collect(second);
+        CHECK(mgr.pendingReleaseCount() == 0);
+
+        mgr.release(other);
+        CHECK(mgr.pendingReleaseCount() == 1);
+        mgr.collectAll();
+        CHECK(mgr.pendingReleaseCount() == 0);
+    }
+
+    SECTION("Resources are created and released from multiple threads")
+    {
+        BufferHandle renderBuffer = mgr.createBuffer(
+            "Render", 1024, Cory::BufferUsageBits::StorageBuffer, MemoryFlagBits::DeviceLocal);
+        const VkBuffer renderVkBuffer = mgr[renderBuffer];
+
+        constexpr int threadCount = 4;
+        constexpr int iterations = 64;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threadCount; ++t) {
+            workers.emplace_back([&] {
+                std::vector<BufferHandle> buffers;
+                std::vector<SamplerHandle> samplers;
+                for (int i = 0; i < iterations; ++i) {
+                    buffers.push_back(mgr.createBuffer("Worker",
+                                                       1024,
+                                                       Cory::BufferUsageBits::StorageBuffer,
+                                                       MemoryFlagBits::DeviceLocal));
+                    samplers.push_back(
+                        mgr.createSampler("Worker", Magnum::Vk::SamplerCreateInfo{}));
+                }
+                for (int i = 0; i < iterations; ++i) {
+                    mgr.release(buffers[i]);
+                    mgr.release(samplers[i]);
+                }
+            });
+        }
+        // lookups on this thread are not affected by the workers
+        for (int i = 0; i < iterations * threadCount; ++i) {
+            CHECK(VkBuffer(mgr[renderBuffer]) == renderVkBuffer);
+        }
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+
+        CHECK(mgr.resourcesInUse()[ResourceType::Buffer] == 1);
+        CHECK(mgr.resourcesInUse()[ResourceType::Sampler] == 0);
+        mgr.release(renderBuffer);
+    }
+
+    SECTION("Relocatable buffers are moved out of sparsely used memory blocks")
+    {
+        constexpr size_t bufferSize = 4 * 1024 * 1024;
+        const BufferUsage usage = BufferUsage{BufferUsageBits::StorageBuffer}
+                                      .set(BufferUsageBits::TransferSource)
+                                      .set(BufferUsageBits::TransferDestination);
+        auto create = [&] {
+            return mgr.createBuffer("Relocation", bufferSize, usage, MemoryFlagBits::DeviceLocal);
+        };
+
+        // fill the first block until a buffer ends up in a second one
+        std::vector<BufferHandle> buffers{create()};
+        const VkDeviceMemory firstBlock = mgr.memoryInfo(buffers.front()).memory;
+        while (mgr.memoryInfo(buffers.back()).memory == firstBlock && buffers.size() < 256) {
+            buffers.push_back(create());
+        }
+        REQUIRE(mgr.memoryInfo(buffers.back()).memory != firstBlock);
+        const BufferHandle moved = buffers.back();
+        buffers.pop_back();
+        // make space in the first block, which is still used more than the second one
+        std::vector<BufferHandle> kept;
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            if (i % 2 == 0) { mgr.release(buffers[i]); }
+            else {
+                kept.push_back(buffers[i]);
+            }
+        }
+
+        mgr.allowRelocation(moved);
+        const VkBuffer before = mgr[moved];
+        const DefragmentationBudget budget{.time = std::chrono::seconds{1}};
+        Magnum::Vk::Device &device = t.ctx().device();
+        DefragmentationStats stats;
+        {
+            SingleShotCommandBuffer cmd{t.ctx()};
+            device->CmdFillBuffer(cmd, mgr[moved], 0, VK_WHOLE_SIZE, 0xC0FFEE);
+            stats = mgr.defragment(cmd.buffer(), budget);
+        }
+        CHECK(stats.moves == 1);
+        CHECK(stats.bytesMoved >= bufferSize);
+        CHECK(mgr.memoryInfo(moved).memory == firstBlock);
+        CHECK(VkBuffer(mgr[moved]) != before);
+        CHECK(mgr.relocatedCount() == 1);
+        // the old buffer might still be used by frames in flight
+        const uint64_t frame = mgr.beginFrame();
+        mgr.releaseRelocated();
+        CHECK(mgr.relocatedCount() == 0);
+        CHECK(mgr.pendingReleaseCount() == 1);
+        mgr.collect(frame);
+        CHECK(mgr.pendingReleaseCount() == 0);
+
+        // the contents were copied to the new buffer
+        BufferHandle readback = mgr.createBuffer("Readback",
+                                                 sizeof(uint32_t),
+                                                 BufferUsageBits::TransferDestination,
+                                                 MemoryFlags{MemoryFlagBits::HostVisible}.set(
+                                                     MemoryFlagBits::HostCoherent));
+        {
+            SingleShotCommandBuffer cmd{t.ctx()};
+            const VkBufferCopy region{.size = sizeof(uint32_t)};
+            device->CmdCopyBuffer(cmd, mgr[moved], mgr[readback], 1, &region);
+            const VkMemoryBarrier toHost{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                         .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                                         .dstAccessMask = VK_ACCESS_HOST_READ_BIT};
+            device->CmdPipelineBarrier(cmd,
+                                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                       VK_PIPELINE_STAGE_HOST_BIT,
+                                       0,
+                                       1,
+                                       &toHost,
+                                       0,
+                                       nullptr,
+                                       0,
+                                       nullptr);
+        }
+        uint32_t value{};
+        std::memcpy(&value, mgr.memoryInfo(readback).mappedData, sizeof(value));
+        CHECK(value == 0xC0FFEE);
+
+        // the buffer is in the fullest block now, so there is nothing left to move
+        {
+            SingleShotCommandBuffer cmd{t.ctx()};
+            CHECK(mgr.defragment(cmd.buffer(), budget).moves == 0);
+        }
+
+        mgr.release(readback);
+        mgr.release(moved);
+        for (const BufferHandle buffer : kept) {
+            mgr.release(buffer);
+        }
+        mgr.collectAll();
+    }
+
     SECTION("Shaders")
     {
         ShaderHandle shader =
@@ -72,4 +295,29 @@ TEST_CASE("ResourceManager", "[Cory/Renderer]")
         CHECK_THROWS(mgr[shader]);
         CHECK(mgr.resourcesInUse()[ResourceType::Shader] == 0);
     }
+
+    SECTION("Batch shader compilation")
+    {
+        std::vector<ShaderSource> sources;
+        for (int i = 0; i < 8; ++i) {
+            sources.emplace_back(testVertexShader,
+                                 Cory::ShaderType::eVertex,
+                                 "batch" + std::to_string(i) + ".vert");
+            sources.back().setDefinition("PERMUTATION", std::to_string(i));
+        }
+        const std::vector<ShaderHandle> shaders = mgr.createShaders(sources);
+        REQUIRE(shaders.size() == sources.size());
+        CHECK(mgr.resourcesInUse()[ResourceType::Shader] == sources.size());
+        for (const ShaderHandle shader : shaders) {
+            CHECK(mgr[shader].valid());
+            CHECK(mgr[shader].type() == Cory::ShaderType::eVertex);
+            mgr.release(shader);
+        }
+
+        // a single failing shader fails the whole batch
+        sources.emplace_back(
+            testInvalidVertexShader, Cory::ShaderType::eVertex, "testInvalidVertexShader.vert");
+        CHECK_THROWS(mgr.createShaders(sources));
+        CHECK(mgr.resourcesInUse()[ResourceType::Shader] == 0);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <Cory/Renderer/Context.hpp>
+#include <Cory/Renderer/ResourceManager.hpp>
+#include <Cory/Renderer/Shader.hpp>
+#include <Cory/Renderer/ShaderReloader.hpp>
+
+#include <Magnum/Vk/Shader.h>
+
+#include <filesystem>
+
+#include "TestUtils.hpp"
+
+using namespace Cory;
+
+TEST_CASE("ShaderReloader", "[Cory/Renderer]")
+{
+    testing::VulkanTester t;
+    ResourceManager &resources = t.ctx().resources();
+    ShaderReloader &reloader = t.ctx().shaderReloader();
+
+    // the reloader of the test context keeps watching the files of previous runs, so every run
+    // uses a new directory
+    static int run{0};
+    const auto directory = std::filesystem::temp_directory_path() /
+                           ("Cory_ShaderReloader_Test" + std::to_string(run++));
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    const auto includeFile = directory / "color.glsl";
+    const auto shaderFile = directory / "reload.frag";
+    testing::writeAndTouch(includeFile, "const vec4 COLOR = vec4(1.0);\n");
+    testing::writeAndTouch(shaderFile,
+                           "#version 450\n"
+                           "#extension GL_GOOGLE_include_directive : require\n"
+                           "#include \"" +
+                               includeFile.generic_string() +
+                               "\"\n"
+                               "layout(location = 0) out vec4 outColor;\n"
+                               "void main() { outColor = COLOR; }\n");
+
+    const ShaderHandle shader = resources.createShader(shaderFile);
+    REQUIRE(resources[shader].dependencies().size() == 2);
+    const VkShaderModule original = resources[shader].module();
+
+    reloader.setEnabled(true);
+    reloader.update();
+
+    // updates the reloader until the pending compilation is done and swapped in
+    auto finishReload = [&]() {
+        reloader.update();
+        REQUIRE(reloader.pendingCount() == 1);
+        reloader.wait();
+        reloader.update();
+        CHECK(reloader.pendingCount() == 0);
+    };
+
+    SECTION("Shaders are reloaded when an included file changes")
+    {
+        testing::writeAndTouch(includeFile, "const vec4 COLOR = vec4(0.5);\n");
+        finishReload();
+        CHECK(resources[shader].valid());
+        CHECK(VkShaderModule(resources[shader].module()) != original);
+    }
+
+    SECTION("The old shader is kept if the new one can not be compiled")
+    {
+        testing::writeAndTouch(includeFile, "const vec4 COLOR = vec4(;\n");
+        finishReload();
+        CHECK(VkShaderModule(resources[shader].module()) == original);
+    }
+
+    reloader.setEnabled(false);
+    resources.release(shader);
+    std::filesystem::remove_all(directory);
+}
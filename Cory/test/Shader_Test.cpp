@@ -0,0 +1,73 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <Cory/Renderer/Shader.hpp>
+
+#include <filesystem>
+#include <fstream>
+
+static constexpr auto testFragmentShader = R"(
+#version 450
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = vec4(COLOR);
+})";
+
+using namespace Cory;
+
+TEST_CASE("SPIR-V cache", "[Cory/Renderer]")
+{
+    const auto cacheDirectory = std::filesystem::temp_directory_path() / "Cory_Shader_Test";
+    std::filesystem::remove_all(cacheDirectory);
+    Shader::SetCacheDirectory(cacheDirectory);
+
+    ShaderSource source{testFragmentShader, ShaderType::eFragment, "spirvCache.frag"};
+    source.setDefinition("COLOR", "1.0");
+    auto cacheFiles = [&]() {
+        std::vector<std::filesystem::path> files;
+        for (const auto &entry : std::filesystem::directory_iterator{cacheDirectory}) {
+            files.push_back(entry.path());
+        }
+        return files;
+    };
+
+    const std::vector<uint32_t> code = Shader::CompileToSpv(source, false);
+    REQUIRE_FALSE(code.empty());
+    REQUIRE(cacheFiles().size() == 1);
+    const auto cacheFile = cacheFiles().front();
+
+    SECTION("Cached code is reused")
+    {
+        CHECK(Shader::CompileToSpv(source, false) == code);
+        CHECK(cacheFiles().size() == 1);
+    }
+
+    SECTION("Defines and compiler options are part of the key")
+    {
+        CHECK_FALSE(Shader::CompileToSpv(source, true).empty());
+        CHECK(cacheFiles().size() == 2);
+
+        source.setDefinition("COLOR", "0.5");
+        CHECK(Shader::CompileToSpv(source, false) != code);
+        CHECK(cacheFiles().size() == 3);
+    }
+
+    SECTION("Corrupted cache files are detected and replaced")
+    {
+        {
+            std::fstream file(cacheFile, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekg(-1, std::ios::end);
+            const char last = static_cast<char>(file.get());
+            file.seekp(-1, std::ios::end);
+            file.put(static_cast<char>(last ^ 1));
+        }
+        CHECK(Shader::CompileToSpv(source, false) == code);
+        // the corrupted file was replaced with a valid one
+        CHECK(Shader::CompileToSpv(source, false) == code);
+        CHECK(cacheFiles().size() == 1);
+    }
+
+    Shader::SetCacheDirectory({});
+    std::filesystem::remove_all(cacheDirectory);
+}
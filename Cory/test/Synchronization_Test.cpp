@@ -0,0 +1,151 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include <Cory/Renderer/Common.hpp>
+
+using namespace Cory;
+
+TEST_CASE("Sync2 barriers keep their own stage masks", "[Cory/Renderer/Synchronization]")
+{
+    const Sync::ImageBarrier colorToSampled{
+        .prevAccesses = {Sync::AccessType::ColorAttachmentWrite},
+        .nextAccesses = {Sync::AccessType::FragmentShaderReadSampledImageOrUniformTexelBuffer},
+        .prevLayout = Sync::ImageLayout::Optimal,
+        .nextLayout = Sync::ImageLayout::Optimal,
+        .discardContents = VK_FALSE,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = VK_NULL_HANDLE,
+        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}};
+    const Sync::ImageBarrier transferToColor{
+        .prevAccesses = {Sync::AccessType::TransferWrite},
+        .nextAccesses = {Sync::AccessType::ColorAttachmentWrite},
+        .prevLayout = Sync::ImageLayout::Optimal,
+        .nextLayout = Sync::ImageLayout::Optimal,
+        .discardContents = VK_FALSE,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = VK_NULL_HANDLE,
+        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}};
+
+    VkImageMemoryBarrier2 first{};
+    VkImageMemoryBarrier2 second{};
+    Sync::GetVulkanImageMemoryBarrier2(colorToSampled, &first);
+    Sync::GetVulkanImageMemoryBarrier2(transferToColor, &second);
+
+    CHECK(first.sType == VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2);
+    CHECK(first.srcStageMask == VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+    CHECK(first.dstStageMask == VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+    CHECK(first.oldLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    CHECK(first.newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    // batching does not leak the stages of one barrier into the other
+    CHECK(second.srcStageMask == VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+    CHECK(second.dstStageMask == VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+    CHECK(second.srcAccessMask == VK_ACCESS_2_TRANSFER_WRITE_BIT);
+}
+
+TEST_CASE("Sync2 barriers map empty scopes to no stages", "[Cory/Renderer/Synchronization]")
+{
+    const Sync::ImageBarrier initialToColor{
+        .prevAccesses = {Sync::AccessType::None},
+        .nextAccesses = {Sync::AccessType::ColorAttachmentWrite},
+        .prevLayout = Sync::ImageLayout::Optimal,
+        .nextLayout = Sync::ImageLayout::Optimal,
+        .discardContents = VK_TRUE,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = VK_NULL_HANDLE,
+        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}};
+    const Sync::BufferBarrier writeToNone{.prevAccesses = {Sync::AccessType::TransferWrite},
+                                          .nextAccesses = {Sync::AccessType::None},
+                                          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                          .buffer = VK_NULL_HANDLE,
+                                          .offset = 0,
+                                          .size = VK_WHOLE_SIZE};
+
+    VkImageMemoryBarrier2 image{};
+    Sync::GetVulkanImageMemoryBarrier2(initialToColor, &image);
+    CHECK(image.srcStageMask == VK_PIPELINE_STAGE_2_NONE);
+    CHECK(image.srcAccessMask == VK_ACCESS_2_NONE);
+    CHECK(image.dstStageMask == VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+    CHECK(image.oldLayout == VK_IMAGE_LAYOUT_UNDEFINED);
+
+    VkBufferMemoryBarrier2 buffer{};
+    Sync::GetVulkanBufferMemoryBarrier2(writeToNone, &buffer);
+    CHECK(buffer.srcStageMask == VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+    CHECK(buffer.dstStageMask == VK_PIPELINE_STAGE_2_NONE);
+    CHECK(buffer.dstAccessMask == VK_ACCESS_2_NONE);
+}
+
+TEST_CASE("Precomputed transitions match the generic barrier translation",
+          "[Cory/Renderer/Synchronization]")
+{
+    const auto makeBarrier = [](Sync::AccessList prev, Sync::AccessList next) {
+        return Sync::ImageBarrier{.prevAccesses = prev,
+                                  .nextAccesses = next,
+                                  .prevLayout = Sync::ImageLayout::Optimal,
+                                  .nextLayout = Sync::ImageLayout::Optimal,
+                                  .discardContents = VK_FALSE,
+                                  .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                  .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                  .image = VK_NULL_HANDLE,
+                                  .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}};
+    };
+
+    const Sync::AccessType prev =
+        GENERATE(Sync::AccessType::None,
+                 Sync::AccessType::ColorAttachmentWrite,
+                 Sync::AccessType::TransferWrite,
+                 Sync::AccessType::FragmentShaderReadSampledImageOrUniformTexelBuffer);
+    const Sync::AccessType next =
+        GENERATE(Sync::AccessType::FragmentShaderReadSampledImageOrUniformTexelBuffer,
+                 Sync::AccessType::TransferRead);
+
+    // a single next access uses the precomputed table, listing it twice uses the generic path
+    VkPipelineStageFlags srcStages{}, dstStages{}, genericSrcStages{}, genericDstStages{};
+    VkImageMemoryBarrier barrier{}, generic{};
+    Sync::GetVulkanImageMemoryBarrier(
+        makeBarrier({prev}, {next}), &srcStages, &dstStages, &barrier);
+    Sync::GetVulkanImageMemoryBarrier(
+        makeBarrier({prev}, {next, next}), &genericSrcStages, &genericDstStages, &generic);
+
+    CHECK(srcStages == genericSrcStages);
+    CHECK(dstStages == genericDstStages);
+    CHECK(barrier.srcAccessMask == generic.srcAccessMask);
+    CHECK(barrier.dstAccessMask == generic.dstAccessMask);
+    CHECK(barrier.oldLayout == generic.oldLayout);
+    CHECK(barrier.newLayout == generic.newLayout);
+}
+
+TEST_CASE("Barriers can be translated into caller-provided scratch memory",
+          "[Cory/Renderer/Synchronization]")
+{
+    // the scratch size needs to cover the synchronization2 structures for every barrier
+    CHECK(Sync::BarrierScratchSize(0, 4) >= 4 * sizeof(VkImageMemoryBarrier2));
+    CHECK(Sync::BarrierScratchSize(2, 0, 3) >=
+          2 * sizeof(VkBufferMemoryBarrier2) + 3 * sizeof(VkDependencyInfo));
+
+    Sync::AccessList accesses{Sync::AccessType::TransferRead};
+    accesses.push_back(Sync::AccessType::FragmentShaderReadSampledImageOrUniformTexelBuffer);
+    CHECK(accesses.size() == 2);
+    CHECK(accesses.contains(Sync::AccessType::TransferRead));
+    CHECK(!accesses.contains(Sync::AccessType::TransferWrite));
+    CHECK(std::span<const Sync::AccessType>{accesses}.back() == accesses.back());
+}
+
+TEST_CASE("Image usage is derived from access types", "[Cory/Renderer/Synchronization]")
+{
+    CHECK(Sync::GetVkImageUsage(Sync::AccessType::ColorAttachmentReadWrite) ==
+          VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+    CHECK(Sync::GetVkImageUsage(Sync::AccessType::DepthAttachmentWriteStencilReadOnly) ==
+          VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+    const auto sampled = Sync::AccessType::ComputeShaderReadSampledImageOrUniformTexelBuffer;
+    CHECK(Sync::GetVkImageUsage(sampled) == VK_IMAGE_USAGE_SAMPLED_BIT);
+    CHECK(Sync::GetVkImageUsage(Sync::AccessType::ComputeShaderWrite) ==
+          VK_IMAGE_USAGE_STORAGE_BIT);
+    CHECK(Sync::GetVkImageUsage(Sync::AccessType::TransferRead) == VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+    // buffer-only accesses don't need any image usage
+    CHECK(Sync::GetVkImageUsage(Sync::AccessType::IndirectBuffer) == 0);
+}
@@ -10,6 +10,8 @@
 #include <catch2/catch_test_macros.hpp>
 #include <range/v3/algorithm/equal.hpp>
 
+#include <chrono>
+#include <fstream>
 #include <mutex>
 #include <vector>
 
@@ -77,6 +79,16 @@ void VulkanTester::expectMessageId(int32_t messageIdNumber)
     data_->expectedMessages.push_back(messageIdNumber);
 }
 
+void writeAndTouch(const std::filesystem::path &file, std::string_view contents)
+{
+    const bool existed = std::filesystem::exists(file);
+    const auto before = existed ? std::filesystem::last_write_time(file)
+                                : std::filesystem::file_time_type{};
+    std::ofstream{file, std::ios::trunc} << contents;
+    // make sure the modification time changes even on file systems with a coarse resolution
+    if (existed) { std::filesystem::last_write_time(file, before + std::chrono::seconds{1}); }
+}
+
 } // namespace Cory::testing
 
 TEST_CASE("VulkanTester")
@@ -4,7 +4,9 @@
 
 #include <Cory/Renderer/Context.hpp>
 
+#include <filesystem>
 #include <memory>
+#include <string_view>
 
 namespace Cory::testing {
 
@@ -24,4 +26,7 @@ class VulkanTester {
     std::unique_ptr<struct VulkanTestContextPrivate> data_;
 };
 
+/// write @a contents to @a file and make sure its modification time changes
+void writeAndTouch(const std::filesystem::path &file, std::string_view contents);
+
 } // namespace Cory::testing
\ No newline at end of file
@@ -14,10 +14,16 @@
 #include <Cory/Cory.hpp>
 #include <Cory/Framegraph/CommandList.hpp>
 #include <Cory/Framegraph/Framegraph.hpp>
+#include <Cory/Framegraph/TransientTexturePool.hpp>
 #include <Cory/ImGui/Inputs.hpp>
 #include <Cory/Renderer/Context.hpp>
 #include <Cory/Renderer/DescriptorSets.hpp>
+#include <Cory/Renderer/MemoryAllocator.hpp>
+#include <Cory/Renderer/MemoryDefragmenter.hpp>
+#include <Cory/Renderer/PipelineCache.hpp>
 #include <Cory/Renderer/ResourceManager.hpp>
+#include <Cory/Renderer/Shader.hpp>
+#include <Cory/Renderer/ShaderReloader.hpp>
 #include <Cory/Renderer/Swapchain.hpp>
 
 #include <Corrade/Containers/Array.h>
@@ -144,11 +150,16 @@ CubeDemoApplication::CubeDemoApplication(int argc, char **argv)
     app.parse(argc, argv);
 
     Cory::ResourceLocator::addSearchPath(CUBEDEMO_RESOURCE_DIR);
+    Cory::Shader::SetCacheDirectory("CubeDemo.shadercache");
 
     init(Cory::ContextCreationInfo{
         .validation =
             disableValidation_ ? Cory::ValidationLayers::Disabled : Cory::ValidationLayers::Enabled,
+        .pipelineCacheFile = "CubeDemo.pipelinecache",
     });
+    // rather render a frame without cubes than stall while a new pipeline is compiled
+    ctx().pipelines().setPendingPolicy(Cory::PendingPipelinePolicy::Skip);
+    ctx().shaderReloader().setEnabled(true);
 
     // determine msaa sample count to use - for simplicity, we use either 8 or one sample
     const auto &limits = ctx().physicalDevice().properties().properties.limits;
@@ -181,8 +192,11 @@ CubeDemoApplication::CubeDemoApplication(int argc, char **argv)
 void CubeDemoApplication::createShaders()
 {
     const Cory::ScopeTimer st{"Init/Shaders"};
-    vertexShader_ = ctx().resources().createShader(Cory::ResourceLocator::Locate("cube.vert"));
-    fragmentShader_ = ctx().resources().createShader(Cory::ResourceLocator::Locate("cube.frag"));
+    const auto shaders = ctx().resources().createShaders(
+        {Cory::ShaderSource{Cory::ResourceLocator::Locate("cube.vert")},
+         Cory::ShaderSource{Cory::ResourceLocator::Locate("cube.frag")}});
+    vertexShader_ = shaders[0];
+    fragmentShader_ = shaders[1];
 }
 
 void CubeDemoApplication::createUBO()
@@ -203,11 +217,12 @@ CubeDemoApplication::~CubeDemoApplication()
 
 void CubeDemoApplication::run()
 {
-    // one framegraph for each frame in flight
+    // one framegraph for each frame in flight, all sharing the same transient resources
+    auto texturePool = std::make_shared<Cory::TransientTexturePool>(ctx());
     std::vector<Cory::Framegraph> framegraphs;
     std::generate_n(std::back_inserter(framegraphs),
                     window_->swapchain().maxFramesInFlight(),
-                    [&]() { return Cory::Framegraph(ctx()); });
+                    [&]() { return Cory::Framegraph(ctx(), texturePool); });
 
     while (!window_->shouldClose()) {
         glfwPollEvents();
@@ -222,6 +237,7 @@ void CubeDemoApplication::run()
         // used - our frame synchronization ensures that the resources
         // are no longer in use
         fg.resetForNextFrame();
+        texturePool->collectGarbage();
 
         defineRenderPasses(fg, frameCtx);
         frameCtx.commandBuffer->begin(Vk::CommandBufferBeginInfo{});
@@ -292,14 +308,8 @@ CubeDemoApplication::cubeRenderTask(Cory::RenderTaskBuilder builder,
 
     auto cubePass = builder.declareRenderPass("PASS_Cubes")
                         .shaders({vertexShader_, fragmentShader_})
-                        .attach(colorTarget,
-                                VkAttachmentLoadOp::VK_ATTACHMENT_LOAD_OP_CLEAR,
-                                VK_ATTACHMENT_STORE_OP_STORE,
-                                clearColor)
-                        .attachDepth(depthTarget,
-                                     VkAttachmentLoadOp::VK_ATTACHMENT_LOAD_OP_CLEAR,
-                                     VK_ATTACHMENT_STORE_OP_STORE,
-                                     clearDepth)
+                        .attach(colorTarget, clearColor)
+                        .attachDepth(depthTarget, clearDepth)
                         .finish();
 
     co_yield PassOutputs{.colorOut = writtenColorHandle, .depthOut = writtenDepthHandle};
@@ -310,7 +320,7 @@ CubeDemoApplication::cubeRenderTask(Cory::RenderTaskBuilder builder,
 
     auto t = gsl::narrow_cast<float>(getElapsedTimeSeconds());
 
-    cubePass.begin(*renderApi.cmd);
+    const bool pipelineReady = cubePass.begin(*renderApi.cmd);
 
     PushConstants pushData{};
 
@@ -336,7 +346,8 @@ CubeDemoApplication::cubeRenderTask(Cory::RenderTaskBuilder builder,
         .flushWrites()
         .bind(renderApi.cmd->handle(), frameCtx.index, ctx().defaultPipelineLayout());
 
-    for (int idx = 0; idx < ad.num_cubes; ++idx) {
+    const int numCubes = pipelineReady ? ad.num_cubes : 0;
+    for (int idx = 0; idx < numCubes; ++idx) {
         float i = ad.num_cubes == 1
                       ? 1.0f
                       : static_cast<float>(idx) / static_cast<float>(ad.num_cubes - 1);
@@ -458,6 +469,44 @@ void CubeDemoApplication::drawImguiControls()
         }
     }
     ImGui::End();
+
+    if (ImGui::Begin("Memory")) {
+        const auto to_mb = [](VkDeviceSize bytes) { return double(bytes) / (1024.0 * 1024.0); };
+        const auto heaps = ctx().allocator().heapStats();
+        if (ImGui::BeginTable("Memory", 5)) {
+            ImGui::TableSetupColumn("heap", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableSetupColumn("blocks", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableSetupColumn("allocations", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableSetupColumn("used/allocated [MB]", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableSetupColumn("usage/budget [MB]", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableHeadersRow();
+
+            for (size_t i = 0; i < heaps.size(); ++i) {
+                const Cory::MemoryHeapStats &heap = heaps[i];
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                CoImGui::Text("{} ({})", i, heap.deviceLocal ? "device" : "host");
+                ImGui::TableNextColumn();
+                CoImGui::Text("{}", heap.blockCount);
+                ImGui::TableNextColumn();
+                CoImGui::Text("{}", heap.allocationCount);
+                ImGui::TableNextColumn();
+                CoImGui::Text(
+                    "{:.1f}/{:.1f}", to_mb(heap.allocationBytes), to_mb(heap.blockBytes));
+                ImGui::TableNextColumn();
+                CoImGui::Text("{:.1f}/{:.1f}", to_mb(heap.usage), to_mb(heap.budget));
+            }
+            ImGui::EndTable();
+        }
+
+        Cory::MemoryDefragmenter &defragmenter = ctx().defragmenter();
+        bool defragment = defragmenter.enabled();
+        if (ImGui::Checkbox("Defragment", &defragment)) { defragmenter.setEnabled(defragment); }
+        const Cory::DefragmentationStats moved = defragmenter.stats();
+        ImGui::SameLine();
+        CoImGui::Text("moved {} resources ({:.1f} MB)", moved.moves, to_mb(moved.bytesMoved));
+    }
+    ImGui::End();
 }
 
 void CubeDemoApplication::setupCameraCallbacks()